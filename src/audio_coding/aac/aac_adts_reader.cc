@@ -4,10 +4,22 @@
 
 #include "aac_adts_reader.h"
 #include <stdio.h>
+#include <string.h>
 
 #define AAC_ADTS_HEADER_SIZE 7
+#define AAC_ADTS_MAX_FRAME_SIZE 8191
+#define AAC_ADTS_BUFFER_SIZE (64 * 1024)
 
-AacAdtsReader::AacAdtsReader() : aac_adts_file_(nullptr) {}
+AacAdtsReader::AacAdtsReader()
+    : aac_adts_file_(nullptr),
+      buffer_pos_(0),
+      buffer_end_(0),
+      eof_(false),
+      synced_(false),
+      got_fixed_header_(false) {
+  memset(fixed_header_, 0, sizeof(fixed_header_));
+  memset(&stats_, 0, sizeof(stats_));
+}
 
 AacAdtsReader::~AacAdtsReader() {
   if (aac_adts_file_) {
@@ -16,12 +28,24 @@ AacAdtsReader::~AacAdtsReader() {
 }
 
 int32_t AacAdtsReader::Open(const char* filename) {
-  FILE* aac_adts_file = fopen(filename, "rb");
+  FILE* aac_adts_file = nullptr;
+  if (strcmp(filename, "-") == 0) {
+    aac_adts_file = stdin;
+  } else {
+    aac_adts_file = fopen(filename, "rb");
+  }
   if (aac_adts_file == nullptr) {
     printf("Unable to open aac adts file '%s'\n", filename);
     return -1;
   }
   aac_adts_file_ = aac_adts_file;
+  buffer_.resize(AAC_ADTS_BUFFER_SIZE);
+  buffer_pos_ = 0;
+  buffer_end_ = 0;
+  eof_ = false;
+  synced_ = false;
+  got_fixed_header_ = false;
+  memset(&stats_, 0, sizeof(stats_));
   return 0;
 }
 
@@ -35,37 +59,150 @@ int32_t AacAdtsReader::ReadOneFrame(uint8_t* data, int32_t* size_in_bytes) {
     return -1;
   }
 
-  int32_t n = fread(data, 1, AAC_ADTS_HEADER_SIZE, aac_adts_file_);
-  if (n != AAC_ADTS_HEADER_SIZE) {
-    return -1;
-  }
+  while (1) {
+    if (Fill(AAC_ADTS_HEADER_SIZE) < AAC_ADTS_HEADER_SIZE) {
+      // Trailing bytes too short for a frame
+      Skip(buffer_end_ - buffer_pos_);
+      return -1;
+    }
 
-  if (data[0] != 0xff || (data[1] & 0xf0) != 0xf0) {
-    printf("Invalid ADTS header.\n");
-    return -1;
-  }
+    int32_t frame_size = ParseHeader(buffer_.data() + buffer_pos_);
+    if (frame_size > 0 && Fill(frame_size) < frame_size) {
+      // Truncated last frame
+      frame_size = 0;
+    }
 
-  int32_t frame_size =
-      ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
-  if (*size_in_bytes < frame_size) {
-    printf("Buffer size is not enough\n");
-    return -1;
+    if (frame_size > 0 && !synced_) {
+      // After a loss, a candidate is only trusted if the next header of the
+      // same stream follows right behind it, or it ends the file.
+      int32_t available = Fill(frame_size + AAC_ADTS_HEADER_SIZE);
+      const uint8_t* header = buffer_.data() + buffer_pos_;
+      if (available >= frame_size + AAC_ADTS_HEADER_SIZE) {
+        const uint8_t* next_header = header + frame_size;
+        if (ParseHeader(next_header) <= 0 ||
+            !IsSameStream(header, next_header)) {
+          frame_size = 0;
+        }
+      } else if (available != frame_size) {
+        frame_size = 0;
+      }
+    }
+
+    if (frame_size <= 0) {
+      if (synced_) {
+        synced_ = false;
+        stats_.resyncs += 1;
+      }
+      // Next sync word candidate, memchr is vectorized by the libc.
+      const uint8_t* begin = buffer_.data() + buffer_pos_ + 1;
+      const uint8_t* end = buffer_.data() + buffer_end_;
+      const uint8_t* next = begin;
+      while (next < end) {
+        next = static_cast<const uint8_t*>(memchr(next, 0xff, end - next));
+        if (next == nullptr || next + 1 >= end || (next[1] & 0xf6) == 0xf0) {
+          break;
+        }
+        next += 1;
+      }
+      if (next == nullptr) {
+        next = end;
+      } else if (next + 1 >= end) {
+        // Keep a trailing 0xff, it may start a header after the next read.
+        next = end - 1 > begin ? end - 1 : begin;
+      }
+      Skip(static_cast<int32_t>(next - (buffer_.data() + buffer_pos_)));
+      continue;
+    }
+
+    if (*size_in_bytes < frame_size) {
+      printf("Buffer size is not enough\n");
+      return -1;
+    }
+
+    const uint8_t* p = buffer_.data() + buffer_pos_;
+    if (!got_fixed_header_) {
+      memcpy(fixed_header_, p, sizeof(fixed_header_));
+      got_fixed_header_ = true;
+    }
+
+    memcpy(data, p, frame_size);
+    buffer_pos_ += frame_size;
+    synced_ = true;
+    stats_.frames += 1;
+    *size_in_bytes = frame_size;
+    return 0;
   }
+}
 
-  n = fread(data + AAC_ADTS_HEADER_SIZE, 1, frame_size - AAC_ADTS_HEADER_SIZE,
-            aac_adts_file_);
-  if (n != (frame_size - AAC_ADTS_HEADER_SIZE)) {
-    printf("Read ADTS frame failed.\n");
+int32_t AacAdtsReader::GetStats(AacAdtsReaderStats* stats) {
+  if (stats == nullptr) {
+    printf("Invalid param, %p", stats);
     return -1;
   }
 
-  *size_in_bytes = frame_size;
+  *stats = stats_;
   return 0;
 }
 
 void AacAdtsReader::Close() {
-  if (aac_adts_file_) {
+  if (aac_adts_file_ && aac_adts_file_ != stdin) {
     fclose(aac_adts_file_);
   }
   aac_adts_file_ = nullptr;
 }
+
+int32_t AacAdtsReader::Fill(int32_t min_size) {
+  int32_t available = buffer_end_ - buffer_pos_;
+  if (available >= min_size || eof_) {
+    return available;
+  }
+
+  memmove(buffer_.data(), buffer_.data() + buffer_pos_, available);
+  buffer_pos_ = 0;
+  buffer_end_ = available;
+  while (buffer_end_ < min_size && !eof_) {
+    size_t n = fread(buffer_.data() + buffer_end_, 1,
+                     buffer_.size() - buffer_end_, aac_adts_file_);
+    if (n == 0) {
+      eof_ = true;
+    }
+    buffer_end_ += static_cast<int32_t>(n);
+  }
+  return buffer_end_ - buffer_pos_;
+}
+
+// Frame size of a plausible header, 0 otherwise.
+int32_t AacAdtsReader::ParseHeader(const uint8_t* header) {
+  if (header[0] != 0xff || (header[1] & 0xf6) != 0xf0) {
+    return 0;
+  }
+
+  int32_t sample_rate_index = (header[2] >> 2) & 0x0f;
+  if (sample_rate_index > 12) {
+    return 0;
+  }
+
+  bool protection_absent = header[1] & 0x01;
+  int32_t frame_size =
+      ((header[3] & 0x03) << 11) | (header[4] << 3) | (header[5] >> 5);
+  if (frame_size < AAC_ADTS_HEADER_SIZE + (protection_absent ? 0 : 2)) {
+    return 0;
+  }
+
+  if (got_fixed_header_ && !IsSameStream(header, fixed_header_)) {
+    return 0;
+  }
+  return frame_size;
+}
+
+// Fields of the fixed header do not change within a stream.
+bool AacAdtsReader::IsSameStream(const uint8_t* header,
+                                 const uint8_t* other_header) {
+  return header[1] == other_header[1] && header[2] == other_header[2] &&
+         (header[3] & 0xf0) == (other_header[3] & 0xf0);
+}
+
+void AacAdtsReader::Skip(int32_t size) {
+  buffer_pos_ += size;
+  stats_.skipped_bytes += size;
+}
@@ -7,18 +7,43 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <vector>
+
+struct AacAdtsReaderStats {
+  int64_t frames;
+  int64_t skipped_bytes;  // garbage between frames, skipped by resync
+  int64_t resyncs;        // damaged regions, each ends with a resync
+};
 
 class AacAdtsReader {
  public:
   AacAdtsReader();
   ~AacAdtsReader();
 
+  // "-" reads from stdin
   int32_t Open(const char* filename);
+  // Damaged data is skipped up to the next confirmed ADTS header, -1 is only
+  // returned at the end of the file.
   int32_t ReadOneFrame(uint8_t* data, int32_t* size_in_bytes);
+  int32_t GetStats(AacAdtsReaderStats* stats);
   void Close();
 
+ private:
+  int32_t Fill(int32_t min_size);
+  int32_t ParseHeader(const uint8_t* header);
+  bool IsSameStream(const uint8_t* header, const uint8_t* other_header);
+  void Skip(int32_t size);
+
  private:
   FILE* aac_adts_file_;
+  std::vector<uint8_t> buffer_;
+  int32_t buffer_pos_;
+  int32_t buffer_end_;
+  bool eof_;
+  bool synced_;
+  uint8_t fixed_header_[4];  // of the first frame, to confirm candidates
+  bool got_fixed_header_;
+  AacAdtsReaderStats stats_;
 };
 
 #endif  // AAC_ADTS_READER_H_
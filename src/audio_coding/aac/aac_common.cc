@@ -3,6 +3,9 @@
  */
 
 #include "aac_common.h"
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include <stdio.h>
 #include <string.h>
 #include "aacdecoder_lib.h"
@@ -16,6 +19,14 @@ struct aot_info aac_enc_aots[] = {
 
 int32_t aac_enc_aots_size = sizeof(aac_enc_aots) / sizeof(aac_enc_aots[0]);
 
+struct preset_info aac_enc_presets[] = {
+    {AAC_COMMON_PRESET_FAST, "fast", 0},
+    {AAC_COMMON_PRESET_QUALITY, "quality", 1},
+};
+
+int32_t aac_enc_presets_size =
+    sizeof(aac_enc_presets) / sizeof(aac_enc_presets[0]);
+
 const char* get_aot_name(int32_t aot, int32_t flag) {
   if (aot == AAC_COMMON_AOT_LC) {
     if (flag & AC_PS_PRESENT) {
@@ -33,6 +44,197 @@ const char* get_aot_name(int32_t aot, int32_t flag) {
   return "NA";
 }
 
+static const int32_t aac_sample_rates[] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000,
+    22050, 16000, 12000, 11025, 8000,  7350,
+};
+
+int32_t get_sample_rate(int32_t index) {
+  int32_t size = sizeof(aac_sample_rates) / sizeof(aac_sample_rates[0]);
+  if (index < 0 || index >= size) {
+    return 0;
+  }
+  return aac_sample_rates[index];
+}
+
+struct bit_reader {
+  const uint8_t* data;
+  int32_t size_in_bits;
+  int32_t pos;
+};
+
+static uint32_t read_bits(struct bit_reader* br, int32_t n) {
+  uint32_t value = 0;
+  for (int32_t i = 0; i < n; ++i) {
+    uint32_t bit = 0;
+    if (br->pos < br->size_in_bits) {
+      bit = (br->data[br->pos >> 3] >> (7 - (br->pos & 7))) & 1;
+    }
+    value = (value << 1) | bit;
+    br->pos += 1;
+  }
+  return value;
+}
+
+static int32_t bits_left(struct bit_reader* br) {
+  return br->size_in_bits - br->pos;
+}
+
+static int32_t read_aot(struct bit_reader* br) {
+  int32_t aot = read_bits(br, 5);
+  if (aot == 31) {
+    aot = 32 + read_bits(br, 6);
+  }
+  return aot;
+}
+
+static int32_t read_sample_rate(struct bit_reader* br) {
+  int32_t index = read_bits(br, 4);
+  if (index == 0x0f) {
+    return read_bits(br, 24);
+  }
+  return get_sample_rate(index);
+}
+
+int32_t parse_audio_specific_config(const uint8_t* conf,
+                                    int32_t conf_size,
+                                    struct asc_info* info) {
+  if (conf == NULL || conf_size < 2 || info == NULL) {
+    return -1;
+  }
+
+  struct bit_reader br = {conf, conf_size * 8, 0};
+  memset(info, 0, sizeof(*info));
+  info->sbr = -1;
+  info->ps = -1;
+
+  info->aot = read_aot(&br);
+  info->sample_rate = read_sample_rate(&br);
+  info->channel_config = read_bits(&br, 4);
+  info->ext_sample_rate = info->sample_rate;
+
+  // Explicit, non backward compatible signaling of SBR and PS
+  if (info->aot == AAC_COMMON_AOT_HE || info->aot == AAC_COMMON_AOT_HEv2) {
+    info->sbr = 1;
+    info->ps = info->aot == AAC_COMMON_AOT_HEv2;
+    info->ext_sample_rate = read_sample_rate(&br);
+    info->aot = read_aot(&br);
+  }
+
+  if (info->aot == AAC_COMMON_AOT_ELD) {
+    info->frame_length = read_bits(&br, 1) ? 480 : 512;
+    read_bits(&br, 3);  // resilience flags
+    info->sbr = read_bits(&br, 1);
+    info->ps = 0;
+    if (info->sbr && read_bits(&br, 1)) {
+      // ldSbrSamplingRate, dual rate SBR
+      info->ext_sample_rate = info->sample_rate * 2;
+    }
+    return info->sample_rate > 0 ? 0 : -1;
+  }
+
+  if (info->aot == AAC_COMMON_AOT_LD) {
+    info->frame_length = read_bits(&br, 1) ? 480 : 512;
+    info->sbr = 0;
+    info->ps = 0;
+    return info->sample_rate > 0 ? 0 : -1;
+  }
+
+  if (info->aot != AAC_COMMON_AOT_LC) {
+    // Other object types are only named
+    return info->sample_rate > 0 ? 0 : -1;
+  }
+
+  // GASpecificConfig
+  info->frame_length = read_bits(&br, 1) ? 960 : 1024;
+  if (read_bits(&br, 1)) {
+    read_bits(&br, 14);  // coreCoderDelay
+  }
+  int32_t extension_flag = read_bits(&br, 1);
+
+  // Backward compatible signaling in a sync extension, only reachable
+  // without a program config element.
+  if (info->sbr < 0 && info->channel_config != 0 && !extension_flag &&
+      bits_left(&br) >= 16 && read_bits(&br, 11) == 0x2b7) {
+    if (read_aot(&br) == AAC_COMMON_AOT_HE) {
+      info->sbr = read_bits(&br, 1);
+      info->ps = 0;
+      if (info->sbr) {
+        info->ext_sample_rate = read_sample_rate(&br);
+        if (bits_left(&br) >= 12 && read_bits(&br, 11) == 0x548) {
+          info->ps = read_bits(&br, 1);
+        }
+      }
+    }
+  }
+
+  return info->sample_rate > 0 ? 0 : -1;
+}
+
+const struct preset_info* get_preset_info(int32_t preset) {
+  for (int32_t i = 0; i < aac_enc_presets_size; ++i) {
+    if (aac_enc_presets[i].preset == preset) {
+      return &aac_enc_presets[i];
+    }
+  }
+  return NULL;
+}
+
+const char* get_error_name(int32_t code) {
+  switch (code) {
+    case AAC_COMMON_ERROR_NONE:
+      return "No error";
+    case AAC_COMMON_ERROR_INVALID_HANDLE:
+      return "Invalid handle";
+    case AAC_COMMON_ERROR_INVALID_PARAM:
+      return "Invalid params";
+    case AAC_COMMON_ERROR_ENCODE_EOF:
+      return "EOF";
+    case AAC_COMMON_ERROR_ENCODE:
+      return "Encoding failed";
+    case AAC_COMMON_ERROR_DECODE_FILL:
+      return "aacDecoder_Fill failed";
+    case AAC_COMMON_ERROR_DECODE:
+      return "aacDecoder_DecodeFrame failed";
+    case AAC_COMMON_ERROR_SET_PARAM:
+      return "aacEncoder_SetParam failed";
+    case AAC_COMMON_ERROR_DECODE_FRAME:
+      return "Corrupted frame concealed";
+    default:
+      break;
+  }
+  return "NA";
+}
+
+int32_t get_aac_lib_version(char* buf, int32_t size) {
+  if (buf == NULL || size <= 0) {
+    return -1;
+  }
+
+  const char* enc_version = "";
+  const char* dec_version = "";
+  LIB_INFO enc_info[FDK_MODULE_LAST];
+  LIB_INFO dec_info[FDK_MODULE_LAST];
+  memset(enc_info, 0, sizeof(enc_info));
+  memset(dec_info, 0, sizeof(dec_info));
+
+  if (aacEncGetLibInfo(enc_info) || aacDecoder_GetLibInfo(dec_info)) {
+    return -1;
+  }
+
+  for (int32_t i = 0; i < FDK_MODULE_LAST; ++i) {
+    if (FDK_AACENC == enc_info[i].module_id) {
+      enc_version = enc_info[i].versionStr;
+    }
+    if (FDK_AACDEC == dec_info[i].module_id) {
+      dec_version = dec_info[i].versionStr;
+    }
+  }
+
+  snprintf(buf, size, "%s/%s", enc_version, dec_version);
+  return 0;
+}
+
 void print_aac_lib_info() {
   LIB_INFO lib_info[FDK_MODULE_LAST];
   memset(lib_info, 0, sizeof(lib_info));
@@ -65,3 +267,18 @@ void print_aac_lib_info() {
     }
   }
 }
+
+int64_t get_heap_in_use() {
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+  return static_cast<int64_t>(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+  // The int fields of mallinfo() wrap beyond 2 GiB
+  struct mallinfo info = mallinfo();
+  return static_cast<uint32_t>(info.uordblks) +
+         static_cast<int64_t>(static_cast<uint32_t>(info.hblkhd));
+#else
+  return 0;
+#endif
+}
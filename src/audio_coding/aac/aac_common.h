@@ -16,6 +16,34 @@
 #define AAC_COMMON_AOT_LD 23
 #define AAC_COMMON_AOT_ELD 39
 
+// The afterburner is the only switch of fdk-aac that trades CPU for quality
+// with every AOT and bitrate mode, so there is a preset for each of its
+// settings. The values are part of the encode cache keys, 1 stays unused.
+#define AAC_COMMON_PRESET_FAST 0
+#define AAC_COMMON_PRESET_QUALITY 2
+#define AAC_COMMON_PRESET_DEFAULT AAC_COMMON_PRESET_QUALITY
+
+// AAC_CONCEAL_METHOD of fdk-aac, interpolation delays the output one frame
+#define AAC_COMMON_CONCEAL_MUTE 0
+#define AAC_COMMON_CONCEAL_NOISE 1
+#define AAC_COMMON_CONCEAL_INTERPOLATE 2
+
+// The fast profile decodes SBR with the real valued(low power) QMF and
+// downmixes to mono inside the decoder, for previews and analytics. PS needs
+// the complex QMF, HEv2 is decoded as HE.
+#define AAC_COMMON_DECODE_PROFILE_DEFAULT 0
+#define AAC_COMMON_DECODE_PROFILE_FAST 1
+
+#define AAC_COMMON_ERROR_NONE 0
+#define AAC_COMMON_ERROR_INVALID_HANDLE 1
+#define AAC_COMMON_ERROR_INVALID_PARAM 2
+#define AAC_COMMON_ERROR_ENCODE_EOF 3
+#define AAC_COMMON_ERROR_ENCODE 4
+#define AAC_COMMON_ERROR_DECODE_FILL 5
+#define AAC_COMMON_ERROR_DECODE 6
+#define AAC_COMMON_ERROR_SET_PARAM 7
+#define AAC_COMMON_ERROR_DECODE_FRAME 8
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,8 +55,43 @@ struct aot_info {
 extern struct aot_info aac_enc_aots[];
 extern int32_t aac_enc_aots_size;
 
+struct preset_info {
+  int32_t preset;
+  const char* friendly_name;
+  int32_t afterburner;
+};
+extern struct preset_info aac_enc_presets[];
+extern int32_t aac_enc_presets_size;
+
+// Parsed AudioSpecificConfig(ISO/IEC 14496-3 1.6.2.1)
+struct asc_info {
+  int32_t aot;               // of the core coder
+  int32_t sample_rate;       // of the core coder
+  int32_t ext_sample_rate;   // output rate with SBR, else sample_rate
+  int32_t channel_config;    // 0 means a program config element
+  int32_t frame_length;      // samples per channel of the core coder
+  int32_t sbr;               // 1 present, 0 absent, -1 may be implicit
+  int32_t ps;                // same as sbr
+};
+
 const char* get_aot_name(int32_t aot, int32_t flag);
+// Sample rate of a sampling frequency index, 0 if reserved
+int32_t get_sample_rate(int32_t index);
+int32_t parse_audio_specific_config(const uint8_t* conf,
+                                    int32_t conf_size,
+                                    struct asc_info* info);
+const struct preset_info* get_preset_info(int32_t preset);
+const char* get_error_name(int32_t code);
+// Copy "<encoder version>/<decoder version>" to |buf|, -1 on failure.
+int32_t get_aac_lib_version(char* buf, int32_t size);
 void print_aac_lib_info();
+// Bytes of heap in use by the process, from mallinfo2(). It only sees the
+// main arena of glibc and mmapped chunks, not the arenas of other threads.
+// The codecs report the growth across their Init() as their memory usage,
+// which is a process-wide delta and so only an estimate: right for a codec
+// opened on the main thread while no other thread allocates, too low for one
+// opened on another thread. 0 where the C library has no such statistics.
+int64_t get_heap_in_use();
 
 #ifdef __cplusplus
 }
@@ -4,9 +4,12 @@
 
 #include "aac_decoder.h"
 #include <stdio.h>
+#include <string.h>
 #include "aacdecoder_lib.h"
 
-AacDecoder::AacDecoder() : aac_decoder_handle_(nullptr) {}
+AacDecoder::AacDecoder() : aac_decoder_handle_(nullptr), memory_bytes_(0) {
+  memset(&config_, 0, sizeof(config_));
+}
 
 AacDecoder::~AacDecoder() {
   if (aac_decoder_handle_) {
@@ -15,8 +18,19 @@ AacDecoder::~AacDecoder() {
 }
 
 int32_t AacDecoder::Init(int32_t transport_type) {
+  AacDecoderConfig config = {0};
+  config.transport_type = transport_type;
+  config.conceal_method = AAC_COMMON_CONCEAL_MUTE;
+  config.profile = AAC_COMMON_DECODE_PROFILE_DEFAULT;
+  config.max_output_channels = 0;
+  return Init(config);
+}
+
+int32_t AacDecoder::Init(const AacDecoderConfig& config) {
+  const int32_t transport_type = config.transport_type;
   HANDLE_AACDECODER aac_decoder_handle = nullptr;
   AAC_DECODER_ERROR err = AAC_DEC_OK;
+  const int64_t heap_before = get_heap_in_use();
 
   do {
     TRANSPORT_TYPE transmux = TT_UNKNOWN;
@@ -30,15 +44,22 @@ int32_t AacDecoder::Init(int32_t transport_type) {
       break;
     }
 
+    if (config.profile != AAC_COMMON_DECODE_PROFILE_DEFAULT &&
+        config.profile != AAC_COMMON_DECODE_PROFILE_FAST) {
+      printf("Unsupported decode profile, %d\n", config.profile);
+      break;
+    }
+
     aac_decoder_handle = aacDecoder_Open(transmux, 1);
     if (aac_decoder_handle == nullptr) {
       printf("Unable to initialize decoder\n");
       break;
     }
 
-    err = aacDecoder_SetParam(aac_decoder_handle, AAC_CONCEAL_METHOD, 0);
+    err = aacDecoder_SetParam(aac_decoder_handle, AAC_CONCEAL_METHOD,
+                              config.conceal_method);
     if (err) {
-      printf("Unable to set concealment(0)\n");
+      printf("Unable to set concealment(%d)\n", config.conceal_method);
       break;
     }
 
@@ -48,7 +69,36 @@ int32_t AacDecoder::Init(int32_t transport_type) {
       break;
     }
 
+    const bool fast = (config.profile == AAC_COMMON_DECODE_PROFILE_FAST);
+    if (fast) {
+      err = aacDecoder_SetParam(aac_decoder_handle, AAC_QMF_LOWPOWER, 1);
+      if (err) {
+        printf("Unable to set low power QMF(1)\n");
+        break;
+      }
+    }
+
+    int32_t max_output_channels = config.max_output_channels;
+    if (max_output_channels == 0 && fast) {
+      max_output_channels = 1;
+    }
+    if (max_output_channels > 0) {
+      err = aacDecoder_SetParam(aac_decoder_handle,
+                                AAC_PCM_MAX_OUTPUT_CHANNELS,
+                                max_output_channels);
+      if (err) {
+        printf("Unable to set max output channels(%d)\n",
+               max_output_channels);
+        break;
+      }
+    }
+
     aac_decoder_handle_ = aac_decoder_handle;
+    config_ = config;
+    memory_bytes_ = get_heap_in_use() - heap_before;
+    if (memory_bytes_ < 0) {
+      memory_bytes_ = 0;
+    }
   } while (0);
 
   if (err || aac_decoder_handle_ == nullptr) {
@@ -61,6 +111,35 @@ int32_t AacDecoder::Init(int32_t transport_type) {
   return (aac_decoder_handle_ != nullptr ? 0 : -1);
 }
 
+int32_t AacDecoder::ConfigRaw(uint8_t* conf, int32_t conf_size) {
+  HANDLE_AACDECODER aac_decoder_handle =
+      static_cast<HANDLE_AACDECODER>(aac_decoder_handle_);
+  if (!aac_decoder_handle) {
+    printf("Invalid aac decoder\n");
+    return -1;
+  }
+
+  if (!conf || conf_size <= 0) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  UCHAR* conf_ptr = conf;
+  UINT length = conf_size;
+  const int64_t heap_before = get_heap_in_use();
+  AAC_DECODER_ERROR err =
+      aacDecoder_ConfigRaw(aac_decoder_handle, &conf_ptr, &length);
+  if (err) {
+    printf("aacDecoder_ConfigRaw failed, %d\n", err);
+    return -1;
+  }
+  int64_t grown = get_heap_in_use() - heap_before;
+  if (grown > 0) {
+    memory_bytes_ += grown;
+  }
+  return 0;
+}
+
 int32_t AacDecoder::GetDecoded(uint8_t* in_buffer,
                                int32_t in_size_bytes,
                                uint8_t* out_buffer,
@@ -68,13 +147,13 @@ int32_t AacDecoder::GetDecoded(uint8_t* in_buffer,
   HANDLE_AACDECODER aac_decoder_handle =
       static_cast<HANDLE_AACDECODER>(aac_decoder_handle_);
   if (!aac_decoder_handle) {
-    printf("Invalid aac decoder\n");
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
     return -1;
   }
 
   if (!in_buffer || !in_size_bytes || !out_buffer || !out_size_bytes ||
       !*out_size_bytes) {
-    printf("Invalid params\n");
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
     return -1;
   }
 
@@ -84,22 +163,62 @@ int32_t AacDecoder::GetDecoded(uint8_t* in_buffer,
   AAC_DECODER_ERROR err = aacDecoder_Fill(aac_decoder_handle, &in_buf_ptr,
                                           &in_buf_size, &bytes_valid);
   if (err) {
-    printf("aacDecoder_Fill failed.\n");
+    error_ring_.Push(AAC_COMMON_ERROR_DECODE_FILL, err);
     return -1;
   }
 
+  // timeDataSize is counted in samples, not in bytes.
   err = aacDecoder_DecodeFrame(aac_decoder_handle, (INT_PCM*)out_buffer,
-                               *out_size_bytes, 0);
+                               *out_size_bytes / sizeof(INT_PCM), 0);
   if (err == AAC_DEC_NOT_ENOUGH_BITS) {
     *out_size_bytes = 0;
+  } else if (IS_DECODE_ERROR(err)) {
+    // Bad frame(CRC, bitstream), the output is still filled by concealment.
+    error_ring_.Push(AAC_COMMON_ERROR_DECODE_FRAME, err);
+    CStreamInfo* stream_info = aacDecoder_GetStreamInfo(aac_decoder_handle);
+    *out_size_bytes =
+        stream_info->frameSize * stream_info->numChannels * sizeof(INT_PCM);
   } else if (err) {
-    printf("aacDecoder_DecodeFrame failed %d\n", err);
+    error_ring_.Push(AAC_COMMON_ERROR_DECODE, err);
     return -1;
+  } else {
+    CStreamInfo* stream_info = aacDecoder_GetStreamInfo(aac_decoder_handle);
+    *out_size_bytes =
+        stream_info->frameSize * stream_info->numChannels * sizeof(INT_PCM);
   }
 
   return 0;
 }
 
+int32_t AacDecoder::GetConcealed(uint8_t* out_buffer,
+                                 int32_t* out_size_bytes) {
+  HANDLE_AACDECODER aac_decoder_handle =
+      static_cast<HANDLE_AACDECODER>(aac_decoder_handle_);
+  if (!aac_decoder_handle) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
+    return -1;
+  }
+
+  if (!out_buffer || !out_size_bytes || !*out_size_bytes) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
+    return -1;
+  }
+
+  // No input is filled, the flag makes the decoder conceal the next frame
+  AAC_DECODER_ERROR err = aacDecoder_DecodeFrame(
+      aac_decoder_handle, (INT_PCM*)out_buffer,
+      *out_size_bytes / sizeof(INT_PCM), AACDEC_CONCEAL);
+  if (err && !IS_DECODE_ERROR(err)) {
+    error_ring_.Push(AAC_COMMON_ERROR_DECODE, err);
+    return -1;
+  }
+
+  CStreamInfo* stream_info = aacDecoder_GetStreamInfo(aac_decoder_handle);
+  *out_size_bytes =
+      stream_info->frameSize * stream_info->numChannels * sizeof(INT_PCM);
+  return 0;
+}
+
 int32_t AacDecoder::GetInfo(AacDecoderInfo* info) {
   HANDLE_AACDECODER aac_decoder_handle =
       static_cast<HANDLE_AACDECODER>(aac_decoder_handle_);
@@ -121,6 +240,8 @@ int32_t AacDecoder::GetInfo(AacDecoderInfo* info) {
 
   info->aot = stream_info->aot;
   info->aot_flags = stream_info->flags;
+  info->sbr = (stream_info->flags & AC_SBR_PRESENT) ? 1 : 0;
+  info->ps = (stream_info->flags & AC_PS_PRESENT) ? 1 : 0;
   info->sample_rate = stream_info->sampleRate;
   info->aac_sample_rate = stream_info->aacSampleRate;
   info->channels = stream_info->numChannels;
@@ -132,6 +253,29 @@ int32_t AacDecoder::GetInfo(AacDecoderInfo* info) {
   return 0;
 }
 
+int32_t AacDecoder::Reset() {
+  if (!aac_decoder_handle_) {
+    printf("Invalid aac decoder\n");
+    return -1;
+  }
+
+  // Clearing the transport buffer, or a flush, keeps the stream config and
+  // the concealment history of the last stream. A pooled decoder gets a new
+  // handle, as a new stream would.
+  AacDecoderConfig config = config_;
+  Uninit();
+  int32_t ret = Init(config);
+
+  AacError error;
+  while (error_ring_.Pop(&error) == 0) {
+  }
+  return ret;
+}
+
+int32_t AacDecoder::PopError(AacError* error) {
+  return error_ring_.Pop(error);
+}
+
 void AacDecoder::Uninit() {
   HANDLE_AACDECODER aac_decoder_handle =
       static_cast<HANDLE_AACDECODER>(aac_decoder_handle_);
@@ -139,4 +283,9 @@ void AacDecoder::Uninit() {
     aacDecoder_Close(aac_decoder_handle);
   }
   aac_decoder_handle_ = nullptr;
+  memory_bytes_ = 0;
+}
+
+int64_t AacDecoder::GetMemoryUsage() {
+  return memory_bytes_;
 }
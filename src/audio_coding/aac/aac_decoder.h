@@ -7,10 +7,13 @@
 
 #include <stdint.h>
 #include "aac_common.h"
+#include "aac_error_ring.h"
 
 struct AacDecoderInfo {
   int32_t aot;
   int32_t aot_flags;
+  int32_t sbr;  // 1 if SBR is present, also when signaled implicitly
+  int32_t ps;   // 1 if PS is present
   int32_t sample_rate;
   int32_t aac_sample_rate;
   int32_t channels;
@@ -20,21 +23,54 @@ struct AacDecoderInfo {
   int32_t output_delay;
 };
 
+struct AacDecoderConfig {
+  int32_t transport_type;  // AAC_TRANSPORT_TYPE_XXX
+  int32_t conceal_method;  // AAC_COMMON_CONCEAL_XXX
+  int32_t profile;         // AAC_COMMON_DECODE_PROFILE_XXX
+  // Channels are downmixed to at most this many, 0: as coded, or mono for the
+  // fast profile
+  int32_t max_output_channels;
+};
+
 class AacDecoder {
  public:
   AacDecoder();
   ~AacDecoder();
 
+  // Concealment by spectral muting
   int32_t Init(int32_t transport_type);
+  int32_t Init(const AacDecoderConfig& config);
+  // AudioSpecificConfig of a raw stream, e.g. from an M4A track
+  int32_t ConfigRaw(uint8_t* conf, int32_t conf_size);
+  // Real-time safe: no allocation and no stdio, errors go to PopError().
+  // On success |out_size_bytes| is updated to the size of decoded PCM. A
+  // corrupted frame is concealed and still succeeds, with an
+  // AAC_COMMON_ERROR_DECODE_FRAME error queued.
   int32_t GetDecoded(uint8_t* in_buffer,
                      int32_t in_size_bytes,
                      uint8_t* out_buffer,
                      int32_t* out_size_bytes);
+  // One frame in place of a lost one, extrapolated by the concealment from
+  // the frames decoded before. Real-time safe like GetDecoded().
+  int32_t GetConcealed(uint8_t* out_buffer, int32_t* out_size_bytes);
   int32_t GetInfo(AacDecoderInfo* info);
+  // Back to the state right after Init(), before decoding another stream.
+  // The AudioSpecificConfig of a raw stream has to be given again.
+  int32_t Reset();
+  int32_t PopError(AacError* error);
+  // Estimated heap bytes allocated by Init() and ConfigRaw(), valid only if
+  // they ran on the main thread with no other thread allocating, see
+  // get_heap_in_use(). fdk-aac allocates the channel states on the stream
+  // config, which an ADTS stream only brings with its first frame and
+  // GetDecoded() does not measure, so only raw streams are fully accounted.
+  int64_t GetMemoryUsage();
   void Uninit();
 
  private:
   void* aac_decoder_handle_;
+  AacDecoderConfig config_;  // of Init(), for Reset()
+  int64_t memory_bytes_;
+  AacErrorRing error_ring_;
 };
 
 #endif  // AAC_DECODER_H_
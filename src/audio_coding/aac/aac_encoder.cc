@@ -7,7 +7,37 @@
 #include <string.h>
 #include "aacenc_lib.h"
 
-AacEncoder::AacEncoder() : aac_encoder_handle_(nullptr) {}
+// Modules of aacEncOpen(), 0 would allocate all of them
+#define AAC_ENCODER_MODULE_AAC 0x01
+#define AAC_ENCODER_MODULE_SBR 0x02
+#define AAC_ENCODER_MODULE_PS 0x04
+
+// Only the tools |aot| runs: SBR for HE and ELD(always enabled by Init()),
+// PS for HEv2. MPEG Surround and metadata are never used.
+static UINT EncoderModules(int32_t aot) {
+  switch (aot) {
+    case AAC_COMMON_AOT_HE:
+    case AAC_COMMON_AOT_ELD:
+      return AAC_ENCODER_MODULE_AAC | AAC_ENCODER_MODULE_SBR;
+    case AAC_COMMON_AOT_HEv2:
+      return AAC_ENCODER_MODULE_AAC | AAC_ENCODER_MODULE_SBR |
+             AAC_ENCODER_MODULE_PS;
+    default:
+      return AAC_ENCODER_MODULE_AAC;
+  }
+}
+
+AacEncoder::AacEncoder()
+    : aac_encoder_handle_(nullptr),
+      memory_bytes_(0),
+      telemetry_(nullptr),
+      sample_rate_(0),
+      bitrate_(0),
+      bitrate_stale_(false),
+      bitrate_mode_(0),
+      frame_length_(0),
+      max_out_bytes_(0),
+      frame_index_(0) {}
 
 AacEncoder::~AacEncoder() {
   if (aac_encoder_handle_) {
@@ -20,9 +50,29 @@ int32_t AacEncoder::Init(int32_t transport_type,
                          int32_t sample_rate,
                          int32_t channels,
                          int32_t bitrate) {
+  AacEncoderConfig config = {0};
+  config.transport_type = transport_type;
+  config.aot = aot;
+  config.sample_rate = sample_rate;
+  config.channels = channels;
+  config.bitrate = bitrate;
+  config.bitrate_mode = 0;
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+  config.frame_length = 0;
+  return Init(config);
+}
+
+int32_t AacEncoder::Init(const AacEncoderConfig& config) {
   HANDLE_AACENCODER aac_encoder_handle = nullptr;
   AACENC_ERROR err = AACENC_OK;
 
+  const int32_t transport_type = config.transport_type;
+  const int32_t aot = config.aot;
+  const int32_t sample_rate = config.sample_rate;
+  const int32_t channels = config.channels;
+  const int32_t bitrate = config.bitrate;
+  const int64_t heap_before = get_heap_in_use();
+
   do {
     TRANSPORT_TYPE transmux = TT_UNKNOWN;
     if (transport_type == AAC_TRANSPORT_TYPE_RAW) {
@@ -35,13 +85,20 @@ int32_t AacEncoder::Init(int32_t transport_type,
       break;
     }
 
+    const struct preset_info* preset = get_preset_info(config.preset);
+    if (preset == nullptr) {
+      printf("Unsupported preset, %d\n", config.preset);
+      break;
+    }
+
     int32_t mode = ChannelMode(channels);
     if (mode == MODE_INVALID) {
       printf("Unsupported channels %d\n", channels);
       break;
     }
 
-    err = aacEncOpen(&aac_encoder_handle, 0, channels);
+    // Sized for the real channel count instead of the maximum of the library
+    err = aacEncOpen(&aac_encoder_handle, EncoderModules(aot), channels);
     if (err) {
       printf("Unable to open encoder, %d\n", err);
       break;
@@ -61,6 +118,16 @@ int32_t AacEncoder::Init(int32_t transport_type,
       }
     }
 
+    if (config.frame_length > 0) {
+      err = aacEncoder_SetParam(aac_encoder_handle, AACENC_GRANULE_LENGTH,
+                                config.frame_length);
+      if (err) {
+        printf("Unable to set the frame length(%d), %d\n", config.frame_length,
+               err);
+        break;
+      }
+    }
+
     err =
         aacEncoder_SetParam(aac_encoder_handle, AACENC_SAMPLERATE, sample_rate);
     if (err) {
@@ -80,21 +147,32 @@ int32_t AacEncoder::Init(int32_t transport_type,
       break;
     }
 
-    err = aacEncoder_SetParam(aac_encoder_handle, AACENC_BITRATE, bitrate);
+    err = aacEncoder_SetParam(aac_encoder_handle, AACENC_BITRATEMODE,
+                              config.bitrate_mode);
     if (err) {
-      printf("Unable to set the bitrate, %d\n", err);
+      printf("Unable to set the bitrate mode(%d), %d\n", config.bitrate_mode,
+             err);
       break;
     }
 
+    if (config.bitrate_mode == 0) {
+      err = aacEncoder_SetParam(aac_encoder_handle, AACENC_BITRATE, bitrate);
+      if (err) {
+        printf("Unable to set the bitrate, %d\n", err);
+        break;
+      }
+    }
+
     err = aacEncoder_SetParam(aac_encoder_handle, AACENC_TRANSMUX, transmux);
     if (err) {
       printf("Unable to set the transport type, %d\n", err);
       break;
     }
 
-    err = aacEncoder_SetParam(aac_encoder_handle, AACENC_AFTERBURNER, 1);
+    err = aacEncoder_SetParam(aac_encoder_handle, AACENC_AFTERBURNER,
+                              preset->afterburner);
     if (err) {
-      printf("Unable to enable afterburner, %d\n", err);
+      printf("Unable to set afterburner(%d), %d\n", preset->afterburner, err);
       break;
     }
 
@@ -104,7 +182,28 @@ int32_t AacEncoder::Init(int32_t transport_type,
       break;
     }
 
+    AACENC_InfoStruct enc_info = {0};
+    err = aacEncInfo(aac_encoder_handle, &enc_info);
+    if (err) {
+      printf("Unable to get encoder info, %d\n", err);
+      break;
+    }
+
     aac_encoder_handle_ = static_cast<void*>(aac_encoder_handle);
+    memory_bytes_ = get_heap_in_use() - heap_before;
+    if (memory_bytes_ < 0) {
+      memory_bytes_ = 0;
+    }
+
+    sample_rate_ = sample_rate;
+    // What the encoder settled on, VBR derives it from the mode
+    bitrate_ = static_cast<int32_t>(
+        aacEncoder_GetParam(aac_encoder_handle, AACENC_BITRATE));
+    bitrate_stale_ = false;
+    bitrate_mode_ = config.bitrate_mode;
+    frame_length_ = enc_info.frameLength;
+    max_out_bytes_ = enc_info.maxOutBufBytes;
+    frame_index_ = 0;
   } while (0);
 
   if (err || aac_encoder_handle_ == nullptr) {
@@ -153,12 +252,12 @@ int32_t AacEncoder::GetEncoded(uint8_t* in_buffer,
   HANDLE_AACENCODER aac_encoder_handle =
       static_cast<HANDLE_AACENCODER>(aac_encoder_handle_);
   if (!aac_encoder_handle) {
-    printf("Invalid aac encoder\n");
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
     return -1;
   }
 
   if (!in_buffer || !out_buffer || !out_size_bytes || !*out_size_bytes) {
-    printf("Invalid params\n");
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
     return -1;
   }
 
@@ -191,17 +290,110 @@ int32_t AacEncoder::GetEncoded(uint8_t* in_buffer,
       aacEncEncode(aac_encoder_handle, &in_buf, &out_buf, &in_args, &out_args);
   if (err != AACENC_OK) {
     if (err == AACENC_ENCODE_EOF) {
-      printf("EOF\n");
+      error_ring_.Push(AAC_COMMON_ERROR_ENCODE_EOF, err);
     } else {
-      printf("Encoding failed, %d\n", err);
+      error_ring_.Push(AAC_COMMON_ERROR_ENCODE, err);
+      if (telemetry_ != nullptr) {
+        RecordFrame(0, -1, out_size, true);
+      }
     }
     return -1;
   }
 
+  if (telemetry_ != nullptr && out_args.numOutBytes > 0) {
+    RecordFrame(out_args.numOutBytes, out_args.bitResState, out_size, false);
+  }
   *out_size_bytes = out_args.numOutBytes;
   return 0;
 }
 
+int32_t AacEncoder::SetBitrate(int32_t bitrate) {
+  HANDLE_AACENCODER aac_encoder_handle =
+      static_cast<HANDLE_AACENCODER>(aac_encoder_handle_);
+  if (!aac_encoder_handle) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
+    return -1;
+  }
+
+  if (bitrate <= 0) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
+    return -1;
+  }
+
+  // Only the configuration is flagged for re-init inside fdk-aac, which is
+  // done by the next aacEncEncode() call. Input buffer and states are kept.
+  AACENC_ERROR err =
+      aacEncoder_SetParam(aac_encoder_handle, AACENC_BITRATE, bitrate);
+  if (err) {
+    error_ring_.Push(AAC_COMMON_ERROR_SET_PARAM, err);
+    return -1;
+  }
+
+  bitrate_stale_ = true;
+  return 0;
+}
+
+int32_t AacEncoder::SetBitrateMode(int32_t bitrate_mode) {
+  HANDLE_AACENCODER aac_encoder_handle =
+      static_cast<HANDLE_AACENCODER>(aac_encoder_handle_);
+  if (!aac_encoder_handle) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
+    return -1;
+  }
+
+  if (bitrate_mode < 0 || bitrate_mode > 5) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
+    return -1;
+  }
+
+  AACENC_ERROR err =
+      aacEncoder_SetParam(aac_encoder_handle, AACENC_BITRATEMODE, bitrate_mode);
+  if (err) {
+    error_ring_.Push(AAC_COMMON_ERROR_SET_PARAM, err);
+    return -1;
+  }
+
+  bitrate_mode_ = bitrate_mode;
+  bitrate_stale_ = true;
+  return 0;
+}
+
+int32_t AacEncoder::Reset() {
+  HANDLE_AACENCODER aac_encoder_handle =
+      static_cast<HANDLE_AACENCODER>(aac_encoder_handle_);
+  if (!aac_encoder_handle) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
+    return -1;
+  }
+
+  AACENC_ERROR err = aacEncoder_SetParam(aac_encoder_handle,
+                                         AACENC_CONTROL_STATE, AACENC_INIT_ALL);
+  if (err) {
+    error_ring_.Push(AAC_COMMON_ERROR_SET_PARAM, err);
+    return -1;
+  }
+
+  AacError error;
+  while (error_ring_.Pop(&error) == 0) {
+  }
+  frame_index_ = 0;
+  return 0;
+}
+
+int32_t AacEncoder::PopError(AacError* error) {
+  return error_ring_.Pop(error);
+}
+
+int32_t AacEncoder::SetTelemetry(AacTelemetryRing* ring) {
+  if (!aac_encoder_handle_) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_HANDLE, 0);
+    return -1;
+  }
+
+  telemetry_ = ring;
+  return 0;
+}
+
 void AacEncoder::Uninit() {
   HANDLE_AACENCODER aac_encoder_handle =
       static_cast<HANDLE_AACENCODER>(aac_encoder_handle_);
@@ -209,6 +401,12 @@ void AacEncoder::Uninit() {
     aacEncClose(&aac_encoder_handle);
   }
   aac_encoder_handle_ = nullptr;
+  memory_bytes_ = 0;
+  telemetry_ = nullptr;
+}
+
+int64_t AacEncoder::GetMemoryUsage() {
+  return memory_bytes_;
 }
 
 int32_t AacEncoder::ChannelMode(int32_t channels) {
@@ -225,3 +423,49 @@ int32_t AacEncoder::ChannelMode(int32_t channels) {
   }
   return static_cast<int32_t>(mode);
 }
+
+void AacEncoder::RecordFrame(int32_t out_bytes,
+                             int32_t bit_res_state,
+                             int32_t out_size,
+                             bool failed) {
+  // A new bitrate or mode is applied by the aacEncEncode() that output this
+  // frame, only then the encoder reports what it settled on.
+  if (bitrate_stale_ && !failed) {
+    bitrate_ = static_cast<int32_t>(aacEncoder_GetParam(
+        static_cast<HANDLE_AACENCODER>(aac_encoder_handle_), AACENC_BITRATE));
+    bitrate_stale_ = false;
+  }
+
+  AacFrameStats stats;
+  stats.frame = frame_index_;
+  stats.bytes = out_bytes;
+  stats.flags = 0;
+  stats.target_bitrate = bitrate_;
+  stats.bitrate = static_cast<int32_t>(static_cast<int64_t>(out_bytes) * 8 *
+                                      sample_rate_ / frame_length_);
+  stats.reservoir_bits = -1;
+
+  if (failed) {
+    // Only a buffer below the largest frame can fail on its size
+    stats.flags |= AAC_TELEMETRY_FLAG_ERROR;
+    if (out_size < max_out_bytes_) {
+      stats.flags |= AAC_TELEMETRY_FLAG_LIMIT;
+    }
+    telemetry_->Push(stats);
+    return;
+  }
+
+  if (out_bytes >= out_size) {
+    stats.flags |= AAC_TELEMETRY_FLAG_LIMIT;
+  }
+
+  if (bitrate_mode_ != 0) {
+    stats.flags |= AAC_TELEMETRY_FLAG_VBR;
+  } else {
+    // Same for every transport, the encoder reports it after each frame
+    stats.reservoir_bits = bit_res_state;
+  }
+
+  frame_index_ += 1;
+  telemetry_->Push(stats);
+}
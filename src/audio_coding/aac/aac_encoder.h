@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 #include "aac_common.h"
+#include "aac_error_ring.h"
+#include "aac_telemetry.h"
 
 struct AacEncoderInfo {
   int32_t frame_length;  // samples per channel
@@ -16,6 +18,17 @@ struct AacEncoderInfo {
   int32_t conf_size;
 };
 
+struct AacEncoderConfig {
+  int32_t transport_type;  // AAC_TRANSPORT_TYPE_XXX
+  int32_t aot;             // AAC_COMMON_AOT_XXX
+  int32_t sample_rate;
+  int32_t channels;
+  int32_t bitrate;       // bps, ignored by VBR
+  int32_t bitrate_mode;  // 0: CBR, 1~5: VBR
+  int32_t preset;        // AAC_COMMON_PRESET_XXX
+  int32_t frame_length;  // 0: default of the AOT, 480 or 512 for LD/ELD
+};
+
 class AacEncoder {
  public:
   AacEncoder();
@@ -26,18 +39,53 @@ class AacEncoder {
                int32_t sample_rate,
                int32_t channels,
                int32_t bitrate);
+  int32_t Init(const AacEncoderConfig& config);
   int32_t GetInfo(AacEncoderInfo* info);
+  // Real-time safe: no allocation and no stdio, errors go to PopError().
   int32_t GetEncoded(uint8_t* in_buffer,
                      int32_t in_size_bytes,
                      uint8_t* out_buffer,
                      int32_t* out_size_bytes);
+  // Reconfigure the running encoder, applied from the next frame on without
+  // resetting the encoder states. Real-time safe.
+  int32_t SetBitrate(int32_t bitrate);
+  // 0: CBR, 1~5: VBR
+  int32_t SetBitrateMode(int32_t bitrate_mode);
+  // Start a new stream with the same config, without reallocating. Pending
+  // input is dropped and the next GetEncoded() re-initializes all states.
+  int32_t Reset();
+  int32_t PopError(AacError* error);
+  // Push the stats of every output frame into |ring|, nullptr stops it. The
+  // ring is owned by the caller, who drains it from one thread.
+  int32_t SetTelemetry(AacTelemetryRing* ring);
+  // Estimated heap bytes allocated by Init(), valid only if it ran on the
+  // main thread with no other thread allocating, see get_heap_in_use(). 0
+  // before Init().
+  int64_t GetMemoryUsage();
   void Uninit();
 
  private:
   int32_t ChannelMode(int32_t channels);
+  void RecordFrame(int32_t out_bytes,
+                   int32_t bit_res_state,
+                   int32_t out_size,
+                   bool failed);
 
  private:
   void* aac_encoder_handle_;
+  int64_t memory_bytes_;
+  AacErrorRing error_ring_;
+
+  // Telemetry, the config is kept for the bitrate of a frame
+  AacTelemetryRing* telemetry_;
+  int32_t sample_rate_;
+  int32_t bitrate_;
+  // Set by SetBitrate()/SetBitrateMode() until the encoder applied it
+  bool bitrate_stale_;
+  int32_t bitrate_mode_;
+  int32_t frame_length_;
+  int32_t max_out_bytes_;
+  uint32_t frame_index_;
 };
 
 #endif  // AAC_ENCODER_H_
@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_error_ring.h"
+#include <string.h>
+
+AacErrorRing::AacErrorRing() : head_(0), tail_(0), dropped_(0) {
+  memset(errors_, 0, sizeof(errors_));
+}
+
+AacErrorRing::~AacErrorRing() {}
+
+void AacErrorRing::Push(int32_t code, int32_t detail) {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t tail = tail_.load(std::memory_order_acquire);
+  if (head - tail >= kCapacity) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  AacError& error = errors_[head & (kCapacity - 1)];
+  error.code = code;
+  error.detail = detail;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+int32_t AacErrorRing::Pop(AacError* error) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  uint32_t head = head_.load(std::memory_order_acquire);
+  if (tail == head || error == nullptr) {
+    return -1;
+  }
+
+  *error = errors_[tail & (kCapacity - 1)];
+  tail_.store(tail + 1, std::memory_order_release);
+  return 0;
+}
+
+uint32_t AacErrorRing::Dropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_ERROR_RING_H_
+#define AAC_ERROR_RING_H_
+
+#include <stdint.h>
+#include <atomic>
+
+struct AacError {
+  int32_t code;    // AAC_COMMON_ERROR_XXX
+  int32_t detail;  // error code of fdk-aac, if any
+};
+
+// Single-producer/single-consumer ring for diagnostics raised on the codec
+// hot path. Push() never blocks, allocates or touches stdio, so it is safe to
+// call from an audio callback; errors are dropped (and counted) when full.
+class AacErrorRing {
+ public:
+  AacErrorRing();
+  ~AacErrorRing();
+
+  void Push(int32_t code, int32_t detail);
+  int32_t Pop(AacError* error);
+  uint32_t Dropped() const;
+
+ private:
+  static const uint32_t kCapacity = 64;  // power of 2
+
+  AacError errors_[kCapacity];
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  std::atomic<uint32_t> dropped_;
+};
+
+#endif  // AAC_ERROR_RING_H_
@@ -0,0 +1,211 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_telemetry.h"
+#include <string.h>
+
+#define AAC_TELEMETRY_HEADER_SIZE 36
+#define AAC_TELEMETRY_RECORD_SIZE 20
+
+static uint8_t* PutU32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  p[2] = (value >> 16) & 0xff;
+  p[3] = (value >> 24) & 0xff;
+  return p + 4;
+}
+
+static uint8_t* PutU16(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xff;
+  p[1] = (value >> 8) & 0xff;
+  return p + 2;
+}
+
+static uint32_t GetU32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint16_t GetU16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+AacTelemetryRing::AacTelemetryRing() : head_(0), tail_(0), dropped_(0) {
+  memset(records_, 0, sizeof(records_));
+}
+
+AacTelemetryRing::~AacTelemetryRing() {}
+
+void AacTelemetryRing::Push(const AacFrameStats& stats) {
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t tail = tail_.load(std::memory_order_acquire);
+  if (head - tail >= kCapacity) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  records_[head & (kCapacity - 1)] = stats;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+int32_t AacTelemetryRing::Pop(AacFrameStats* stats) {
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  uint32_t head = head_.load(std::memory_order_acquire);
+  if (tail == head || stats == nullptr) {
+    return -1;
+  }
+
+  *stats = records_[tail & (kCapacity - 1)];
+  tail_.store(tail + 1, std::memory_order_release);
+  return 0;
+}
+
+uint32_t AacTelemetryRing::Dropped() const {
+  return dropped_.load(std::memory_order_relaxed);
+}
+
+AacTelemetryWriter::AacTelemetryWriter() : file_(nullptr), failed_(false) {}
+
+AacTelemetryWriter::~AacTelemetryWriter() {
+  if (file_ != nullptr) {
+    Close();
+  }
+}
+
+int32_t AacTelemetryWriter::Open(const char* filename,
+                                 const AacTelemetryHeader& header) {
+  FILE* file = fopen(filename, "wb");
+  if (file == nullptr) {
+    printf("Unable to open telemetry log '%s'\n", filename);
+    return -1;
+  }
+
+  uint8_t buf[AAC_TELEMETRY_HEADER_SIZE];
+  memcpy(buf, "AACT", 4);
+  uint8_t* p = PutU32(buf + 4, AAC_TELEMETRY_VERSION);
+  p = PutU32(p, header.sample_rate);
+  p = PutU32(p, header.channels);
+  p = PutU32(p, header.frame_length);
+  p = PutU32(p, header.aot);
+  p = PutU32(p, header.transport_type);
+  p = PutU32(p, header.bitrate_mode);
+  PutU32(p, header.bitrate);
+  if (fwrite(buf, 1, sizeof(buf), file) != sizeof(buf)) {
+    printf("Unable to write telemetry log '%s'\n", filename);
+    fclose(file);
+    return -1;
+  }
+
+  file_ = file;
+  failed_ = false;
+  return 0;
+}
+
+int32_t AacTelemetryWriter::Drain(AacTelemetryRing* ring) {
+  if (file_ == nullptr || ring == nullptr || failed_) {
+    return -1;
+  }
+
+  int32_t num_records = 0;
+  AacFrameStats stats;
+  while (ring->Pop(&stats) == 0) {
+    uint8_t buf[AAC_TELEMETRY_RECORD_SIZE];
+    uint8_t* p = PutU32(buf, stats.frame);
+    p = PutU16(p, stats.bytes);
+    p = PutU16(p, stats.flags);
+    p = PutU32(p, stats.reservoir_bits);
+    p = PutU32(p, stats.target_bitrate);
+    PutU32(p, stats.bitrate);
+    // Buffered by stdio, a write per record costs a copy
+    if (fwrite(buf, 1, sizeof(buf), file_) != sizeof(buf)) {
+      printf("Write telemetry log failed\n");
+      failed_ = true;
+      return -1;
+    }
+    num_records += 1;
+  }
+  return num_records;
+}
+
+int32_t AacTelemetryWriter::Close() {
+  int32_t ret = failed_ ? -1 : 0;
+  if (file_ != nullptr && fclose(file_)) {
+    printf("Close telemetry log failed\n");
+    ret = -1;
+  }
+  file_ = nullptr;
+  failed_ = false;
+  return ret;
+}
+
+AacTelemetryReader::AacTelemetryReader() : file_(nullptr) {}
+
+AacTelemetryReader::~AacTelemetryReader() {
+  if (file_ != nullptr) {
+    Close();
+  }
+}
+
+int32_t AacTelemetryReader::Open(const char* filename,
+                                 AacTelemetryHeader* header) {
+  if (header == nullptr) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  FILE* file = fopen(filename, "rb");
+  if (file == nullptr) {
+    printf("Unable to open telemetry log '%s'\n", filename);
+    return -1;
+  }
+
+  uint8_t buf[AAC_TELEMETRY_HEADER_SIZE];
+  if (fread(buf, 1, sizeof(buf), file) != sizeof(buf) ||
+      memcmp(buf, "AACT", 4) != 0) {
+    printf("Not a telemetry log, '%s'\n", filename);
+    fclose(file);
+    return -1;
+  }
+  uint32_t version = GetU32(buf + 4);
+  if (version != AAC_TELEMETRY_VERSION) {
+    printf("Unsupported telemetry log version, %u\n", version);
+    fclose(file);
+    return -1;
+  }
+
+  header->sample_rate = GetU32(buf + 8);
+  header->channels = GetU32(buf + 12);
+  header->frame_length = GetU32(buf + 16);
+  header->aot = GetU32(buf + 20);
+  header->transport_type = GetU32(buf + 24);
+  header->bitrate_mode = GetU32(buf + 28);
+  header->bitrate = GetU32(buf + 32);
+  file_ = file;
+  return 0;
+}
+
+int32_t AacTelemetryReader::Read(AacFrameStats* stats) {
+  if (file_ == nullptr || stats == nullptr) {
+    return -1;
+  }
+
+  uint8_t buf[AAC_TELEMETRY_RECORD_SIZE];
+  if (fread(buf, 1, sizeof(buf), file_) != sizeof(buf)) {
+    return -1;
+  }
+  stats->frame = GetU32(buf);
+  stats->bytes = GetU16(buf + 4);
+  stats->flags = GetU16(buf + 6);
+  stats->reservoir_bits = GetU32(buf + 8);
+  stats->target_bitrate = GetU32(buf + 12);
+  stats->bitrate = GetU32(buf + 16);
+  return 0;
+}
+
+void AacTelemetryReader::Close() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+  file_ = nullptr;
+}
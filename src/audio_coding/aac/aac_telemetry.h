@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_TELEMETRY_H_
+#define AAC_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+#define AAC_TELEMETRY_VERSION 1
+
+// Output reached |out_size_bytes| of GetEncoded(), or encoding failed with an
+// output buffer smaller than the largest frame.
+#define AAC_TELEMETRY_FLAG_LIMIT 0x01
+// VBR, there is no reservoir and the target is the nominal bitrate
+#define AAC_TELEMETRY_FLAG_VBR 0x04
+// Encoding failed, nothing was output
+#define AAC_TELEMETRY_FLAG_ERROR 0x08
+
+// One frame output by AacEncoder::GetEncoded()
+struct AacFrameStats {
+  uint32_t frame;          // since Init() or Reset(), gaps are dropped frames
+  uint16_t bytes;          // numOutBytes
+  uint16_t flags;          // AAC_TELEMETRY_FLAG_XXX
+  int32_t reservoir_bits;  // bitResState of the encoder, -1 for VBR
+  int32_t target_bitrate;  // bps, as set up by the encoder
+  int32_t bitrate;         // bps, of this frame alone
+};
+
+// Stream parameters at the start of a log
+struct AacTelemetryHeader {
+  int32_t sample_rate;
+  int32_t channels;
+  int32_t frame_length;  // samples per channel
+  int32_t aot;
+  int32_t transport_type;
+  int32_t bitrate_mode;
+  int32_t bitrate;
+};
+
+// Single-producer/single-consumer ring the encoder fills on its hot path, like
+// AacErrorRing: Push() never blocks or allocates, records are dropped (and
+// counted) when the consumer falls behind.
+class AacTelemetryRing {
+ public:
+  AacTelemetryRing();
+  ~AacTelemetryRing();
+
+  void Push(const AacFrameStats& stats);
+  int32_t Pop(AacFrameStats* stats);
+  uint32_t Dropped() const;
+
+ private:
+  static const uint32_t kCapacity = 1024;  // power of 2
+
+  AacFrameStats records_[kCapacity];
+  std::atomic<uint32_t> head_;
+  std::atomic<uint32_t> tail_;
+  std::atomic<uint32_t> dropped_;
+};
+
+// Binary log: "AACT", the version and the header as little-endian int32,
+// then 20 bytes per record in the field order of AacFrameStats.
+class AacTelemetryWriter {
+ public:
+  AacTelemetryWriter();
+  ~AacTelemetryWriter();
+
+  int32_t Open(const char* filename, const AacTelemetryHeader& header);
+  // Write everything pending in |ring|, returns the number of records. -1
+  // once a write failed, the log is then incomplete and no longer written.
+  int32_t Drain(AacTelemetryRing* ring);
+  // -1 if a write or flushing the log failed
+  int32_t Close();
+
+ private:
+  FILE* file_;
+  bool failed_;
+};
+
+class AacTelemetryReader {
+ public:
+  AacTelemetryReader();
+  ~AacTelemetryReader();
+
+  int32_t Open(const char* filename, AacTelemetryHeader* header);
+  // -1 at the end of the log
+  int32_t Read(AacFrameStats* stats);
+  void Close();
+
+ private:
+  FILE* file_;
+};
+
+#endif  // AAC_TELEMETRY_H_
@@ -0,0 +1,266 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_verifier.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "pcm_kernels.h"
+
+#define AAC_VERIFIER_MSG_SOURCE 0
+#define AAC_VERIFIER_MSG_FRAME 1
+#define AAC_VERIFIER_MSG_END 2
+
+#define AAC_VERIFIER_MAX_CHANNELS 8
+// Compared source is dropped from the front once this much has piled up
+#define AAC_VERIFIER_COMPACT_SAMPLES 65536
+
+// Encoding a frame takes longer than this, so neither side spins for long
+static const std::chrono::microseconds kPollInterval(100);
+
+AacVerifier::AacVerifier()
+    : slot_size_(0),
+      head_(0),
+      tail_(0),
+      source_pos_(0),
+      decoded_samples_(0),
+      delay_(-1),
+      decoded_channels_(0),
+      signal_(0),
+      error_(0) {
+  memset(&config_, 0, sizeof(config_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+AacVerifier::~AacVerifier() {
+  if (thread_.joinable()) {
+    AacVerifierStats stats;
+    Finish(&stats);
+  }
+}
+
+int32_t AacVerifier::Init(const AacVerifierConfig& config) {
+  if (thread_.joinable() || config.sample_rate <= 0 ||
+      config.channels <= 0 || config.channels > AAC_VERIFIER_MAX_CHANNELS ||
+      config.frame_length <= 0 || config.delay < 0 ||
+      config.conf_size < 0 ||
+      config.conf_size > static_cast<int32_t>(sizeof(config.conf))) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  if (decoder_.Init(config.transport_type)) {
+    printf("Init aac decoder for verification failed\n");
+    return -1;
+  }
+  if (config.transport_type == AAC_TRANSPORT_TYPE_RAW) {
+    uint8_t conf[sizeof(config.conf)];
+    memcpy(conf, config.conf, config.conf_size);
+    if (decoder_.ConfigRaw(conf, config.conf_size)) {
+      printf("Config aac decoder for verification failed\n");
+      return -1;
+    }
+  }
+
+  config_ = config;
+  // A frame of PCM, or an encoded frame, fits into one slot
+  slot_size_ = std::max(config.frame_length * config.channels * 2, 8192);
+  headers_.assign(kNumSlots, SlotHeader());
+  slots_.assign(static_cast<size_t>(kNumSlots) * slot_size_, 0);
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+
+  // A decoded frame, twice the frame length covers the output of SBR
+  pcm_.assign(static_cast<size_t>(config.frame_length) * 2 *
+                  AAC_VERIFIER_MAX_CHANNELS * 2,
+              0);
+  source_.clear();
+  source_pos_ = 0;
+  decoded_samples_ = 0;
+  delay_ = -1;
+  decoded_channels_ = 0;
+  signal_ = 0;
+  error_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+
+  thread_ = std::thread(&AacVerifier::Run, this);
+  return 0;
+}
+
+int32_t AacVerifier::PushSource(const uint8_t* pcm, int32_t size_in_bytes) {
+  if (pcm == nullptr || size_in_bytes < 0) {
+    return -1;
+  }
+
+  // Whole samples per slot
+  const int32_t block_align = config_.channels * 2;
+  const int32_t chunk = slot_size_ - slot_size_ % block_align;
+  for (int32_t offset = 0; offset < size_in_bytes; offset += chunk) {
+    int32_t size = std::min(chunk, size_in_bytes - offset);
+    if (Push(AAC_VERIFIER_MSG_SOURCE, pcm + offset, size)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int32_t AacVerifier::PushFrame(const uint8_t* data, int32_t size_in_bytes) {
+  if (data == nullptr || size_in_bytes <= 0) {
+    return -1;
+  }
+  return Push(AAC_VERIFIER_MSG_FRAME, data, size_in_bytes);
+}
+
+int32_t AacVerifier::Finish(AacVerifierStats* stats) {
+  if (!thread_.joinable() || stats == nullptr) {
+    return -1;
+  }
+
+  Push(AAC_VERIFIER_MSG_END, nullptr, 0);
+  thread_.join();
+
+  *stats = stats_;
+  stats->delay = delay_;
+  if (error_ == 0) {
+    stats->snr = HUGE_VAL;
+  } else {
+    stats->snr = 10 * log10(signal_ / error_);
+  }
+  return 0;
+}
+
+int32_t AacVerifier::Push(int32_t type,
+                          const uint8_t* data,
+                          int32_t size_in_bytes) {
+  if (!thread_.joinable() || size_in_bytes > slot_size_) {
+    return -1;
+  }
+
+  uint32_t head = head_.load(std::memory_order_relaxed);
+  while (head - tail_.load(std::memory_order_acquire) >= kNumSlots) {
+    std::this_thread::sleep_for(kPollInterval);
+  }
+
+  uint32_t index = head & (kNumSlots - 1);
+  headers_[index].type = type;
+  headers_[index].size = size_in_bytes;
+  if (size_in_bytes > 0) {
+    memcpy(&slots_[static_cast<size_t>(index) * slot_size_], data,
+           size_in_bytes);
+  }
+  head_.store(head + 1, std::memory_order_release);
+  return 0;
+}
+
+void AacVerifier::Run() {
+  while (1) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(kPollInterval);
+      continue;
+    }
+
+    uint32_t index = tail & (kNumSlots - 1);
+    const SlotHeader header = headers_[index];
+    uint8_t* data = &slots_[static_cast<size_t>(index) * slot_size_];
+    if (header.type == AAC_VERIFIER_MSG_SOURCE) {
+      size_t size = source_.size();
+      source_.resize(size + header.size / 2);
+      memcpy(&source_[size], data, header.size / 2 * 2);
+    } else if (header.type == AAC_VERIFIER_MSG_FRAME) {
+      Decode(data, header.size);
+    }
+    tail_.store(tail + 1, std::memory_order_release);
+
+    if (header.type == AAC_VERIFIER_MSG_END) {
+      break;
+    }
+  }
+}
+
+void AacVerifier::Decode(uint8_t* data, int32_t size_in_bytes) {
+  int32_t out_size_bytes = pcm_.size();
+  int32_t ret =
+      decoder_.GetDecoded(data, size_in_bytes, pcm_.data(), &out_size_bytes);
+
+  // Concealed frames succeed, but the stream is damaged all the same
+  bool failed = ret != 0;
+  AacError error;
+  while (decoder_.PopError(&error) == 0) {
+    failed = true;
+  }
+  if (failed) {
+    stats_.decode_errors += 1;
+  }
+  if (ret || out_size_bytes <= 0) {
+    return;
+  }
+  stats_.frames += 1;
+
+  if (delay_ < 0) {
+    AacDecoderInfo info;
+    if (decoder_.GetInfo(&info)) {
+      stats_.decode_errors += 1;
+      return;
+    }
+    // What the decoded stream lags the source, as aac_latency measures it
+    delay_ = config_.delay + info.output_delay;
+    decoded_channels_ = info.channels;
+  }
+  if (decoded_channels_ != config_.channels) {
+    // Nothing to compare with
+    stats_.decode_errors += 1;
+    return;
+  }
+
+  Compare(reinterpret_cast<const int16_t*>(pcm_.data()),
+          out_size_bytes / (2 * config_.channels));
+}
+
+void AacVerifier::Compare(const int16_t* decoded, int64_t num_samples) {
+  const int32_t channels = config_.channels;
+
+  // The decoded stream starts with the delay of the codec, and ends with
+  // padding beyond the source.
+  int64_t skip = std::min(
+      num_samples, std::max<int64_t>(0, delay_ - decoded_samples_));
+  int64_t available =
+      static_cast<int64_t>(source_.size() - source_pos_) / channels;
+  int64_t count = std::min(num_samples - skip, available);
+  decoded_samples_ += num_samples;
+  if (count <= 0) {
+    return;
+  }
+
+  const int16_t* ref = &source_[source_pos_];
+  const int16_t* test = decoded + skip * channels;
+  int32_t num_values = static_cast<int32_t>(count * channels);
+  if (config_.downmix && channels == 2) {
+    mid_source_.resize(count);
+    mid_decoded_.resize(count);
+    for (int64_t i = 0; i < count; ++i) {
+      mid_source_[i] = (ref[2 * i] + ref[2 * i + 1]) / 2;
+      mid_decoded_[i] = (test[2 * i] + test[2 * i + 1]) / 2;
+    }
+    ref = mid_source_.data();
+    test = mid_decoded_.data();
+    num_values = static_cast<int32_t>(count);
+  }
+
+  int32_t max_abs_err = 0;
+  // Exact per block, the sums of a frame fit int64
+  signal_ += static_cast<double>(pcm_sum_squares_s16(ref, num_values));
+  error_ += static_cast<double>(
+      pcm_diff_s16(ref, test, num_values, &max_abs_err));
+  stats_.max_abs_err = std::max(stats_.max_abs_err, max_abs_err);
+  stats_.num_samples += count;
+
+  source_pos_ += count * channels;
+  if (source_pos_ >= AAC_VERIFIER_COMPACT_SAMPLES) {
+    source_.erase(source_.begin(), source_.begin() + source_pos_);
+    source_pos_ = 0;
+  }
+}
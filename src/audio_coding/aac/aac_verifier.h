@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_VERIFIER_H_
+#define AAC_VERIFIER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "aac_decoder.h"
+
+struct AacVerifierConfig {
+  int32_t transport_type;  // AAC_TRANSPORT_TYPE_XXX of the encoded frames
+  uint8_t conf[64];        // AudioSpecificConfig of raw frames
+  int32_t conf_size;
+  int32_t sample_rate;
+  int32_t channels;
+  int32_t frame_length;  // of the encoder, samples per channel
+  int32_t delay;         // of the encoder, samples per channel
+  // Compare the mid channel of stereo, for PS which only keeps the downmix
+  // close to the waveform
+  bool downmix;
+};
+
+struct AacVerifierStats {
+  int64_t frames;         // decoded
+  int64_t decode_errors;  // frames that failed or were concealed
+  int64_t num_samples;    // compared, per channel
+  double snr;             // dB, HUGE_VAL if identical
+  int32_t max_abs_err;
+  int32_t delay;  // of encoder and decoder, samples per channel
+};
+
+// Decodes the frames of an encoder on its own thread while encoding goes on,
+// and compares the output with the source delayed by the codec delay.
+//
+// The encoding thread pushes its source PCM and every encoded frame into a
+// single-producer/single-consumer ring of fixed size slots. A push only
+// copies into a free slot and waits only while the decoder is a whole ring
+// behind; the decoder thread polls the ring and keeps just the source that
+// has not been decoded yet.
+class AacVerifier {
+ public:
+  AacVerifier();
+  ~AacVerifier();
+
+  int32_t Init(const AacVerifierConfig& config);
+  // Interleaved 16-bit PCM, as fed to the encoder
+  int32_t PushSource(const uint8_t* pcm, int32_t size_in_bytes);
+  int32_t PushFrame(const uint8_t* data, int32_t size_in_bytes);
+  // End of the stream, waits for the decoder thread.
+  int32_t Finish(AacVerifierStats* stats);
+
+ private:
+  struct SlotHeader {
+    int32_t type;
+    int32_t size;
+  };
+
+  int32_t Push(int32_t type, const uint8_t* data, int32_t size_in_bytes);
+  void Run();
+  void Decode(uint8_t* data, int32_t size_in_bytes);
+  void Compare(const int16_t* decoded, int64_t num_samples);
+
+ private:
+  static const uint32_t kNumSlots = 64;  // power of 2
+
+  AacVerifierConfig config_;
+  int32_t slot_size_;
+  std::vector<SlotHeader> headers_;
+  std::vector<uint8_t> slots_;
+  alignas(64) std::atomic<uint32_t> head_;  // written by the producer
+  alignas(64) std::atomic<uint32_t> tail_;  // written by the decoder thread
+  std::thread thread_;
+
+  // Decoder thread only
+  AacDecoder decoder_;
+  std::vector<uint8_t> pcm_;
+  std::vector<int16_t> source_;  // not compared yet
+  std::vector<int16_t> mid_source_;
+  std::vector<int16_t> mid_decoded_;
+  size_t source_pos_;
+  int64_t decoded_samples_;  // per channel, including the codec delay
+  int32_t delay_;            // -1 until the decoder has reported its delay
+  int32_t decoded_channels_;
+  // Sums of squares over the whole encode, in double as int64 overflows
+  // after about a day of full scale stereo at 48 kHz
+  double signal_;
+  double error_;
+  AacVerifierStats stats_;
+};
+
+#endif  // AAC_VERIFIER_H_
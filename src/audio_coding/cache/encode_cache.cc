@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "encode_cache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <memory>
+#include <vector>
+#include "aac_common.h"
+#include "hash64.h"
+#include "loudness_meter.h"
+#include "wav_reader.h"
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+#define ENCODE_CACHE_TMP_SUFFIX ".tmp"
+#define ENCODE_CACHE_TMP_EXPIRY_SEC 3600
+
+struct CacheEntry {
+  std::string path;
+  int64_t size;
+  time_t mtime;
+};
+
+static bool EndsWith(const std::string& str, const char* suffix) {
+  std::string s(suffix);
+  return str.size() >= s.size() &&
+         str.compare(str.size() - s.size(), s.size(), s) == 0;
+}
+
+EncodeCache::EncodeCache() : max_size_in_bytes_(0) {}
+
+EncodeCache::~EncodeCache() {}
+
+int32_t EncodeCache::Open(const char* dir, int64_t max_size_in_bytes) {
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+    printf("Unable to create cache directory '%s'\n", dir);
+    return -1;
+  }
+
+  struct stat st;
+  if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+    printf("Invalid cache directory '%s'\n", dir);
+    return -1;
+  }
+
+  dir_ = dir;
+  max_size_in_bytes_ = max_size_in_bytes;
+  return 0;
+}
+
+int32_t EncodeCache::Lookup(const std::string& key, const char* filename) {
+  if (dir_.empty()) {
+    return -1;
+  }
+
+  std::string path = dir_ + "/" + key;
+  if (access(path.c_str(), R_OK) != 0) {
+    return -1;
+  }
+
+  // An entry evicted by another process right now just turns into a miss.
+  if (CopyFile(path.c_str(), filename)) {
+    return -1;
+  }
+
+  // Most recently used
+  utimes(path.c_str(), nullptr);
+  return 0;
+}
+
+int32_t EncodeCache::Insert(const std::string& key, const char* filename) {
+  if (dir_.empty()) {
+    return -1;
+  }
+
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), ".%d.%zu" ENCODE_CACHE_TMP_SUFFIX,
+           static_cast<int32_t>(getpid()),
+           std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::string path = dir_ + "/" + key;
+  std::string tmp_path = dir_ + "/." + key + suffix;
+
+  if (CopyFile(filename, tmp_path.c_str())) {
+    unlink(tmp_path.c_str());
+    return -1;
+  }
+
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    printf("Unable to insert cache entry '%s'\n", path.c_str());
+    unlink(tmp_path.c_str());
+    return -1;
+  }
+
+  Evict();
+  return 0;
+}
+
+int32_t EncodeCache::Encode(const char* infile,
+                            const char* outfile,
+                            const EncodeCacheParams& params,
+                            const char* report,
+                            const std::function<int32_t()>& encode) {
+  std::string key;
+  int32_t ret = MakeKey(infile, params, report, &key);
+  if (ret) {
+    return -1;
+  }
+
+  if (Lookup(key, outfile) == 0) {
+    printf("Cache hit: '%s' -> '%s'\n", key.c_str(), outfile);
+    return 0;
+  }
+
+  ret = encode();
+  if (ret == 0 && Insert(key, outfile) == 0) {
+    printf("Cache insert: '%s'\n", key.c_str());
+  }
+  return ret;
+}
+
+int32_t EncodeCache::MakeKey(const char* infile,
+                             const EncodeCacheParams& params,
+                             const char* report,
+                             std::string* key) {
+  auto wav_reader = std::make_unique<WavReader>();
+  int32_t ret = wav_reader->Open(infile);
+  if (ret) {
+    printf("Open wav file failed, %s\n", infile);
+    return -1;
+  }
+
+  WavFileInfo wav_file_info = {0};
+  ret = wav_reader->GetInfo(&wav_file_info);
+  if (ret) {
+    printf("Get info of wav file failed\n");
+    return -1;
+  }
+
+  std::unique_ptr<LoudnessMeter> loudness_meter;
+  if (report != nullptr) {
+    loudness_meter = std::make_unique<LoudnessMeter>();
+    ret = loudness_meter->Init(wav_file_info.sample_rate,
+                               wav_file_info.channels);
+    if (ret) {
+      printf("Init loudness meter failed\n");
+      return -1;
+    }
+  }
+
+  char lib_version[128] = {0};
+  get_aac_lib_version(lib_version, sizeof(lib_version));
+
+  // Bitrate is ignored by VBR, so it is not part of the key there.
+  char key_params[256] = {0};
+  snprintf(key_params, sizeof(key_params),
+           "%s;%s;aot=%d;bitrate=%d;mode=%d;preset=%d;dtx=%d,%.2f,%d;"
+           "rate=%d;ch=%d;bits=%d",
+           lib_version, params.format, params.aot,
+           params.bitrate_mode == 0 ? params.bitrate : 0,
+           params.bitrate_mode, params.preset, params.dtx ? 1 : 0,
+           params.dtx ? params.dtx_threshold : 0.0,
+           params.dtx ? params.dtx_hangover : 0, wav_file_info.sample_rate,
+           wav_file_info.channels, wav_file_info.bits_per_sample);
+
+  Hash64 hash;
+  hash.Update(key_params, strlen(key_params));
+
+  const int32_t buf_size = 64 * 1024;
+  auto buf = std::make_unique<uint8_t[]>(buf_size);
+  while (1) {
+    int32_t read_bytes = wav_reader->Read(buf.get(), buf_size);
+    if (read_bytes < 0) {
+      printf("Read wav file failed\n");
+      return -1;
+    } else if (read_bytes == 0) {
+      break;
+    }
+
+    hash.Update(buf.get(), read_bytes);
+    if (loudness_meter) {
+      loudness_meter->Process(buf.get(), read_bytes);
+    }
+  }
+
+  if (loudness_meter) {
+    if (loudness_meter->WriteReport(report, infile) == 0) {
+      printf("Analysis: '%s'\n", report);
+    }
+  }
+
+  char digest[32] = {0};
+  snprintf(digest, sizeof(digest), "%016llx",
+           static_cast<unsigned long long>(hash.Digest()));
+  *key = std::string(digest) + "." + params.format;
+  return 0;
+}
+
+int32_t EncodeCache::CopyFile(const char* from, const char* to) {
+  int in_fd = open(from, O_RDONLY);
+  if (in_fd < 0) {
+    return -1;
+  }
+
+  int out_fd = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out_fd < 0) {
+    printf("Unable to open '%s'\n", to);
+    close(in_fd);
+    return -1;
+  }
+
+  int32_t ret = -1;
+#if defined(__linux__) && defined(FICLONE)
+  // Share the extents on CoW filesystems(btrfs, xfs), no data is copied.
+  if (ioctl(out_fd, FICLONE, in_fd) == 0) {
+    ret = 0;
+  }
+#endif
+
+  if (ret != 0) {
+    ret = 0;
+    char buf[64 * 1024];
+    while (1) {
+      ssize_t n = read(in_fd, buf, sizeof(buf));
+      if (n == 0) {
+        break;
+      } else if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        ret = -1;
+        break;
+      }
+
+      ssize_t written = 0;
+      while (written < n) {
+        ssize_t m = write(out_fd, buf + written, n - written);
+        if (m < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          ret = -1;
+          break;
+        }
+        written += m;
+      }
+      if (ret) {
+        break;
+      }
+    }
+  }
+
+  close(in_fd);
+  if (close(out_fd) != 0) {
+    ret = -1;
+  }
+  return ret;
+}
+
+void EncodeCache::Evict() {
+  if (max_size_in_bytes_ <= 0) {
+    return;
+  }
+
+  DIR* dir = opendir(dir_.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+
+  std::vector<CacheEntry> entries;
+  int64_t total_size = 0;
+  time_t now = time(nullptr);
+  struct dirent* ent = nullptr;
+  while ((ent = readdir(dir)) != nullptr) {
+    std::string name(ent->d_name);
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    std::string path = dir_ + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+
+    if (EndsWith(name, ENCODE_CACHE_TMP_SUFFIX)) {
+      // Left behind by a worker that died while inserting
+      if (now - st.st_mtime > ENCODE_CACHE_TMP_EXPIRY_SEC) {
+        unlink(path.c_str());
+      }
+      continue;
+    }
+
+    entries.push_back({path, static_cast<int64_t>(st.st_size), st.st_mtime});
+    total_size += st.st_size;
+  }
+  closedir(dir);
+
+  if (total_size <= max_size_in_bytes_) {
+    return;
+  }
+
+  std::sort(entries.begin(), entries.end(),
+            [](const CacheEntry& a, const CacheEntry& b) {
+              return a.mtime < b.mtime;
+            });
+  for (const auto& entry : entries) {
+    if (total_size <= max_size_in_bytes_) {
+      break;
+    }
+    // Racing evictions of other processes are fine, ENOENT is ignored.
+    unlink(entry.path.c_str());
+    total_size -= entry.size;
+  }
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef ENCODE_CACHE_H_
+#define ENCODE_CACHE_H_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+// Everything besides the PCM samples that changes the encoded bytes
+struct EncodeCacheParams {
+  const char* format;  // "aac" or "m4a", also the extension of the entry
+  int32_t aot;
+  int32_t bitrate;  // ignored by VBR
+  int32_t bitrate_mode;
+  int32_t preset;
+  bool dtx;
+  double dtx_threshold;  // dBFS
+  int32_t dtx_hangover;  // frames
+};
+
+// Content addressed on-disk cache of encoded outputs, one file per key.
+// Inserts are atomic renames and the LRU order is kept in file mtimes, so
+// several processes can share one directory without locking.
+class EncodeCache {
+ public:
+  EncodeCache();
+  ~EncodeCache();
+
+  int32_t Open(const char* dir, int64_t max_size_in_bytes);
+  // Copy(or reflink) the entry of |key| to |filename|, -1 if there is none.
+  int32_t Lookup(const std::string& key, const char* filename);
+  // Store a copy of |filename| as the entry of |key|, then trim the cache.
+  int32_t Insert(const std::string& key, const char* filename);
+  // |outfile| from the entry of |infile| and |params|, or from |encode|,
+  // whose output is then inserted. The loudness report of |infile| goes to
+  // |report| unless it is nullptr, |encode| should not write it again.
+  int32_t Encode(const char* infile,
+                 const char* outfile,
+                 const EncodeCacheParams& params,
+                 const char* report,
+                 const std::function<int32_t()>& encode);
+
+  // Key of the entry of |infile| encoded with |params|, a digest of the PCM
+  // samples and of |params|. The samples are read anyway, so the loudness
+  // report is produced by this pass as well.
+  static int32_t MakeKey(const char* infile,
+                         const EncodeCacheParams& params,
+                         const char* report,
+                         std::string* key);
+
+ private:
+  int32_t CopyFile(const char* from, const char* to);
+  void Evict();
+
+ private:
+  std::string dir_;
+  int64_t max_size_in_bytes_;
+};
+
+#endif  // ENCODE_CACHE_H_
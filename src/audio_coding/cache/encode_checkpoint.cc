@@ -0,0 +1,199 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "encode_checkpoint.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "aac_common.h"
+
+#define ENCODE_CHECKPOINT_MAGIC "fdk_aac_example checkpoint 1"
+#define ENCODE_CHECKPOINT_TMP_SUFFIX ".tmp"
+
+static int32_t SyncFile(FILE* file) {
+  if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+// Value of the line "<key> <value>", without the line break
+static bool ParseLine(const char* line, const char* key, std::string* value) {
+  size_t key_size = strlen(key);
+  if (strncmp(line, key, key_size) != 0 || line[key_size] != ' ') {
+    return false;
+  }
+  value->assign(line + key_size + 1);
+  while (!value->empty() &&
+         (value->back() == '\n' || value->back() == '\r')) {
+    value->pop_back();
+  }
+  return true;
+}
+
+EncodeCheckpoint::EncodeCheckpoint() {}
+
+EncodeCheckpoint::~EncodeCheckpoint() {}
+
+int32_t EncodeCheckpoint::Open(const char* filename,
+                               const std::string& params) {
+  if (filename == nullptr || params.find('\n') != std::string::npos) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  filename_ = filename;
+  params_ = params;
+  return 0;
+}
+
+int32_t EncodeCheckpoint::Load(EncodeCheckpointState* state) {
+  if (filename_.empty() || state == nullptr) {
+    return -1;
+  }
+
+  FILE* file = fopen(filename_.c_str(), "r");
+  if (file == nullptr) {
+    return -1;
+  }
+
+  std::string magic;
+  std::string params;
+  std::string input_samples;
+  std::string frames;
+  std::string output_bytes;
+  char line[4096];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    if (strncmp(line, ENCODE_CHECKPOINT_MAGIC,
+                strlen(ENCODE_CHECKPOINT_MAGIC)) == 0) {
+      magic = line;
+    } else if (!ParseLine(line, "params", &params) &&
+               !ParseLine(line, "input_samples", &input_samples) &&
+               !ParseLine(line, "frames", &frames)) {
+      ParseLine(line, "output_bytes", &output_bytes);
+    }
+  }
+  fclose(file);
+
+  if (magic.empty() || input_samples.empty() || frames.empty() ||
+      output_bytes.empty()) {
+    printf("Invalid checkpoint '%s'\n", filename_.c_str());
+    return -1;
+  } else if (params != params_) {
+    printf("Checkpoint '%s' is of another encode\n", filename_.c_str());
+    return -1;
+  }
+
+  state->input_samples = strtoll(input_samples.c_str(), nullptr, 10);
+  state->frames = strtoll(frames.c_str(), nullptr, 10);
+  state->output_bytes = strtoll(output_bytes.c_str(), nullptr, 10);
+  if (state->input_samples < 0 || state->frames < 0 ||
+      state->output_bytes < 0) {
+    printf("Invalid checkpoint '%s'\n", filename_.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int32_t EncodeCheckpoint::Save(FILE* output,
+                               const EncodeCheckpointState& state) {
+  if (filename_.empty() || output == nullptr) {
+    return -1;
+  }
+
+  // The checkpoint must not get to the disk before the output it covers
+  if (SyncFile(output)) {
+    printf("Unable to sync the output\n");
+    return -1;
+  }
+
+  std::string tmp_filename = filename_ + ENCODE_CHECKPOINT_TMP_SUFFIX;
+  FILE* file = fopen(tmp_filename.c_str(), "w");
+  if (file == nullptr) {
+    printf("Unable to open '%s'\n", tmp_filename.c_str());
+    return -1;
+  }
+
+  fprintf(file, "%s\n", ENCODE_CHECKPOINT_MAGIC);
+  fprintf(file, "params %s\n", params_.c_str());
+  fprintf(file, "input_samples %lld\n",
+          static_cast<long long>(state.input_samples));
+  fprintf(file, "frames %lld\n", static_cast<long long>(state.frames));
+  fprintf(file, "output_bytes %lld\n",
+          static_cast<long long>(state.output_bytes));
+  int32_t ret = SyncFile(file);
+  fclose(file);
+
+  if (ret || rename(tmp_filename.c_str(), filename_.c_str()) != 0) {
+    printf("Unable to write checkpoint '%s'\n", filename_.c_str());
+    unlink(tmp_filename.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+void EncodeCheckpoint::Remove() {
+  if (!filename_.empty()) {
+    unlink(filename_.c_str());
+  }
+}
+
+void EncodeCheckpoint::ResumePoint(int64_t frames,
+                                   int32_t frame_length,
+                                   int32_t delay,
+                                   int32_t preroll_frames,
+                                   int64_t* input_sample,
+                                   int32_t* drop_frames) {
+  // Output frame j of an encoder fed from sample s covers the input from
+  // s + j * frame_length - delay on.
+  int64_t drop = (delay + frame_length - 1) / frame_length + preroll_frames;
+  if (drop > frames) {
+    // Close to the start, encoding from sample 0 again is the same
+    drop = frames;
+  }
+  *input_sample = (frames - drop) * frame_length;
+  *drop_frames = static_cast<int32_t>(drop);
+}
+
+int32_t EncodeCheckpoint::MakeParams(
+    const char* infile,
+    const EncodeCheckpointParams& encode_params,
+    std::string* params) {
+  struct stat st;
+  if (stat(infile, &st) != 0) {
+    printf("Unable to stat '%s'\n", infile);
+    return -1;
+  }
+
+  char lib_version[128] = {0};
+  get_aac_lib_version(lib_version, sizeof(lib_version));
+
+  char buf[512] = {0};
+  snprintf(buf, sizeof(buf),
+           "%s;%s;aot=%d;bitrate=%d;mode=%d;preset=%d;rate=%d;ch=%d;bits=%d;"
+           "size=%lld;mtime=%lld.%09ld;input=",
+           lib_version, encode_params.format, encode_params.aot,
+           encode_params.bitrate_mode == 0 ? encode_params.bitrate : 0,
+           encode_params.bitrate_mode, encode_params.preset,
+           encode_params.sample_rate, encode_params.channels,
+           encode_params.bits_per_sample, static_cast<long long>(st.st_size),
+           static_cast<long long>(st.st_mtim.tv_sec), st.st_mtim.tv_nsec);
+  *params = std::string(buf) + infile;
+  return 0;
+}
+
+FILE* EncodeCheckpoint::OpenForResume(const char* filename, int64_t size) {
+  FILE* file = fopen(filename, "r+b");
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  if (fseeko(file, 0, SEEK_END) != 0 || ftello(file) < size ||
+      ftruncate(fileno(file), size) != 0 || fseeko(file, size, SEEK_SET) != 0) {
+    fclose(file);
+    return nullptr;
+  }
+  return file;
+}
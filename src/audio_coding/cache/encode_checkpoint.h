@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef ENCODE_CHECKPOINT_H_
+#define ENCODE_CHECKPOINT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// Frames a resumed encoder runs ahead of the checkpoint besides its delay
+#define ENCODE_CHECKPOINT_PREROLL_FRAMES 8
+
+// What changes the encoded bytes of an input file
+struct EncodeCheckpointParams {
+  const char* format;  // "aac" or "m4a"
+  int32_t aot;
+  int32_t bitrate;  // ignored by VBR
+  int32_t bitrate_mode;
+  int32_t preset;
+  int32_t sample_rate;
+  int32_t channels;
+  int32_t bits_per_sample;
+};
+
+struct EncodeCheckpointState {
+  int64_t input_samples;  // per channel, read from the input so far
+  int64_t frames;         // output frames in the partial output
+  int64_t output_bytes;   // size of the partial output
+};
+
+// Progress of an encode, kept next to its partial output so that an encode
+// that was killed continues from the last checkpoint instead of sample 0.
+// The checkpoint is replaced atomically and never points past output data
+// that has not reached the disk.
+class EncodeCheckpoint {
+ public:
+  EncodeCheckpoint();
+  ~EncodeCheckpoint();
+
+  // |params| identify the input and everything that changes the encoded
+  // bytes, a checkpoint taken with other params is not resumed.
+  int32_t Open(const char* filename, const std::string& params);
+  // -1 if there is no checkpoint to resume.
+  int32_t Load(EncodeCheckpointState* state);
+  // Flush and sync |output| first, then replace the checkpoint with |state|.
+  int32_t Save(FILE* output, const EncodeCheckpointState& state);
+  // The encode has completed.
+  void Remove();
+
+  // |params| for Open(), of |infile| encoded with |encode_params|. The file
+  // is identified by its size and mtime as well, so a changed input is
+  // encoded from the start.
+  static int32_t MakeParams(const char* infile,
+                            const EncodeCheckpointParams& encode_params,
+                            std::string* params);
+  // The partial output |filename| cut back to the |size| a checkpoint
+  // recorded and positioned at its end, nullptr if it is shorter.
+  static FILE* OpenForResume(const char* filename, int64_t size);
+
+  // A new encoder resumes at output frame |frames| from |input_sample|, and
+  // the first |drop_frames| it outputs are dropped. They cover its delay and
+  // |preroll_frames| more, for the transform overlap, SBR and the rate
+  // control to settle to what the killed encoder had.
+  static void ResumePoint(int64_t frames,
+                          int32_t frame_length,
+                          int32_t delay,
+                          int32_t preroll_frames,
+                          int64_t* input_sample,
+                          int32_t* drop_frames);
+
+ private:
+  std::string filename_;
+  std::string params_;
+};
+
+#endif  // ENCODE_CHECKPOINT_H_
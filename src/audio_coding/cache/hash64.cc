@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "hash64.h"
+#include <string.h>
+
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t Rotl(uint64_t x, int32_t r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Read64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));  // little endian hosts only
+  return value;
+}
+
+static inline uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = Rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value) {
+  acc ^= Round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+
+Hash64::Hash64(uint64_t seed) {
+  Reset(seed);
+}
+
+Hash64::~Hash64() {}
+
+void Hash64::Reset(uint64_t seed) {
+  acc_[0] = seed + kPrime1 + kPrime2;
+  acc_[1] = seed + kPrime2;
+  acc_[2] = seed;
+  acc_[3] = seed - kPrime1;
+  seed_ = seed;
+  total_size_ = 0;
+  buffer_size_ = 0;
+}
+
+void Hash64::Update(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  total_size_ += size;
+
+  if (buffer_size_ + size < sizeof(buffer_)) {
+    memcpy(buffer_ + buffer_size_, p, size);
+    buffer_size_ += size;
+    return;
+  }
+
+  if (buffer_size_ > 0) {
+    size_t fill = sizeof(buffer_) - buffer_size_;
+    memcpy(buffer_ + buffer_size_, p, fill);
+    for (int32_t i = 0; i < 4; ++i) {
+      acc_[i] = Round(acc_[i], Read64(buffer_ + 8 * i));
+    }
+    p += fill;
+    size -= fill;
+    buffer_size_ = 0;
+  }
+
+  while (size >= 32) {
+    acc_[0] = Round(acc_[0], Read64(p));
+    acc_[1] = Round(acc_[1], Read64(p + 8));
+    acc_[2] = Round(acc_[2], Read64(p + 16));
+    acc_[3] = Round(acc_[3], Read64(p + 24));
+    p += 32;
+    size -= 32;
+  }
+
+  memcpy(buffer_, p, size);
+  buffer_size_ = size;
+}
+
+uint64_t Hash64::Digest() const {
+  uint64_t h = 0;
+  if (total_size_ >= 32) {
+    h = Rotl(acc_[0], 1) + Rotl(acc_[1], 7) + Rotl(acc_[2], 12) +
+        Rotl(acc_[3], 18);
+    for (int32_t i = 0; i < 4; ++i) {
+      h = MergeRound(h, acc_[i]);
+    }
+  } else {
+    h = seed_ + kPrime5;
+  }
+  h += total_size_;
+
+  const uint8_t* p = buffer_;
+  size_t size = buffer_size_;
+  while (size >= 8) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+    p += 8;
+    size -= 8;
+  }
+  if (size >= 4) {
+    h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+    h = Rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+    size -= 4;
+  }
+  while (size > 0) {
+    h ^= (*p) * kPrime5;
+    h = Rotl(h, 11) * kPrime1;
+    p += 1;
+    size -= 1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
@@ -0,0 +1,29 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef HASH64_H_
+#define HASH64_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming XXH64, so data can be hashed while it is being read.
+class Hash64 {
+ public:
+  explicit Hash64(uint64_t seed = 0);
+  ~Hash64();
+
+  void Reset(uint64_t seed = 0);
+  void Update(const void* data, size_t size);
+  uint64_t Digest() const;
+
+ private:
+  uint64_t acc_[4];
+  uint64_t seed_;
+  uint64_t total_size_;
+  uint8_t buffer_[32];
+  size_t buffer_size_;
+};
+
+#endif  // HASH64_H_
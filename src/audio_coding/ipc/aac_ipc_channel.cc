@@ -0,0 +1,311 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_ipc_channel.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  ATOMIC_INT_LOCK_FREE == 2,
+              "futex words must be plain 32-bit integers");
+
+// Sleeps are cut into slices, so a close that races with going to sleep is
+// noticed without a wake up.
+static const int32_t kWaitSliceMs = 100;
+
+static void FutexWait(std::atomic<uint32_t>* word,
+                      uint32_t value,
+                      int32_t timeout_ms) {
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  // Not FUTEX_PRIVATE_FLAG, the word is shared between processes
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, value, &ts,
+          nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr,
+          nullptr, 0);
+}
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+AacIpcChannel::AacIpcChannel()
+    : fd_(-1),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      num_slots_(0),
+      slot_size_(0),
+      slot_stride_(0),
+      spin_count_(0) {
+  // Spinning only pays off when the other side runs on another CPU, on a
+  // single CPU it burns the time slice the other side needs.
+  spin_count_ = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? kSpinCount : 0;
+}
+
+AacIpcChannel::~AacIpcChannel() {
+  Close();
+}
+
+size_t AacIpcChannel::GetSlotStride(uint32_t slot_size) {
+  // Slots on their own cache lines
+  return (sizeof(AacIpcSlot) + slot_size + 63) & ~static_cast<size_t>(63);
+}
+
+int32_t AacIpcChannel::Create(uint32_t num_slots, uint32_t slot_size) {
+  Close();
+  if (num_slots == 0 || (num_slots & (num_slots - 1)) != 0 || slot_size == 0) {
+    printf("Invalid param, %u slots of %u bytes\n", num_slots, slot_size);
+    return -1;
+  }
+
+  slot_stride_ = GetSlotStride(slot_size);
+  mapping_size_ = sizeof(AacIpcShmHeader) + 2 * num_slots * slot_stride_;
+
+  do {
+    fd_ = memfd_create("aac_ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd_ < 0) {
+      printf("memfd_create failed, %s\n", strerror(errno));
+      break;
+    }
+    if (ftruncate(fd_, mapping_size_)) {
+      printf("ftruncate failed, %s\n", strerror(errno));
+      break;
+    }
+    // The fd is passed to the client, which must not be able to shrink the
+    // memory under a mapping of the service, that would be SIGBUS here.
+    if (fcntl(fd_, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+      printf("Seal shared memory failed, %s\n", strerror(errno));
+      break;
+    }
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      printf("mmap failed, %s\n", strerror(errno));
+      break;
+    }
+
+    // A new memfd reads as zeros, which is a valid empty state for the rings
+    header_ = new (mapping_) AacIpcShmHeader;
+    header_->magic = AAC_IPC_MAGIC;
+    header_->version = AAC_IPC_VERSION;
+    header_->num_slots = num_slots;
+    header_->slot_size = slot_size;
+    num_slots_ = num_slots;
+    slot_size_ = slot_size;
+    return 0;
+  } while (0);
+
+  Close();
+  return -1;
+}
+
+int32_t AacIpcChannel::Attach(int32_t fd) {
+  Close();
+  fd_ = fd;
+
+  do {
+    struct stat st;
+    if (fstat(fd_, &st) ||
+        st.st_size < static_cast<off_t>(sizeof(AacIpcShmHeader))) {
+      printf("Invalid shared memory\n");
+      break;
+    }
+    mapping_size_ = st.st_size;
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      printf("mmap failed, %s\n", strerror(errno));
+      break;
+    }
+
+    // The geometry is read once and only the checked copy is used
+    header_ = static_cast<AacIpcShmHeader*>(mapping_);
+    const volatile AacIpcShmHeader* shared = header_;
+    uint32_t magic = shared->magic;
+    uint32_t version = shared->version;
+    uint32_t num_slots = shared->num_slots;
+    uint32_t slot_size = shared->slot_size;
+    size_t slot_stride = GetSlotStride(slot_size);
+    if (magic != AAC_IPC_MAGIC || version != AAC_IPC_VERSION ||
+        num_slots == 0 || (num_slots & (num_slots - 1)) != 0 ||
+        slot_size == 0 ||
+        slot_stride > (mapping_size_ - sizeof(AacIpcShmHeader)) /
+                          (2 * static_cast<size_t>(num_slots))) {
+      printf("Invalid shared memory header\n");
+      break;
+    }
+    num_slots_ = num_slots;
+    slot_size_ = slot_size;
+    slot_stride_ = slot_stride;
+    return 0;
+  } while (0);
+
+  Close();
+  return -1;
+}
+
+AacIpcSlot* AacIpcChannel::GetSlot(int32_t ring, uint32_t index) const {
+  uint8_t* slots = static_cast<uint8_t*>(mapping_) + sizeof(AacIpcShmHeader) +
+                   ring * num_slots_ * slot_stride_;
+  slots += (index & (num_slots_ - 1)) * slot_stride_;
+  return reinterpret_cast<AacIpcSlot*>(slots);
+}
+
+void AacIpcChannel::Wait(std::atomic<uint32_t>* word,
+                         std::atomic<uint32_t>* waiting,
+                         uint32_t value,
+                         int32_t timeout_ms) {
+  // The flag is raised before the last check, so the other side either sees
+  // it after publishing or this side sees the new value.
+  waiting->store(1);
+  if (word->load() == value && !IsClosed()) {
+    FutexWait(word, value, std::min(timeout_ms, kWaitSliceMs));
+  }
+  waiting->store(0, std::memory_order_relaxed);
+}
+
+AacIpcSlot* AacIpcChannel::BeginWrite(int32_t ring, int32_t timeout_ms) {
+  if (header_ == nullptr) {
+    return nullptr;
+  }
+
+  AacIpcRingHeader* r = &header_->rings[ring];
+  uint32_t head = r->head.load(std::memory_order_relaxed);
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  int32_t spins = 0;
+  while (1) {
+    uint32_t tail = r->tail.load(std::memory_order_acquire);
+    if (head - tail < num_slots_) {
+      return GetSlot(ring, head);
+    }
+    if (IsClosed()) {
+      return nullptr;
+    }
+    if (spins < spin_count_) {
+      spins += 1;
+      CpuRelax();
+      continue;
+    }
+
+    int32_t remaining = kWaitSliceMs;
+    if (timeout_ms >= 0) {
+      remaining = static_cast<int32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              deadline - std::chrono::steady_clock::now())
+              .count());
+      if (remaining <= 0) {
+        return nullptr;
+      }
+    }
+    Wait(&r->tail, &r->tail_waiting, tail, remaining);
+  }
+}
+
+void AacIpcChannel::EndWrite(int32_t ring) {
+  AacIpcRingHeader* r = &header_->rings[ring];
+  r->head.store(r->head.load(std::memory_order_relaxed) + 1);
+  if (r->head_waiting.load()) {
+    FutexWake(&r->head);
+  }
+}
+
+AacIpcSlot* AacIpcChannel::BeginRead(int32_t ring, int32_t timeout_ms) {
+  if (header_ == nullptr) {
+    return nullptr;
+  }
+
+  AacIpcRingHeader* r = &header_->rings[ring];
+  uint32_t tail = r->tail.load(std::memory_order_relaxed);
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  int32_t spins = 0;
+  while (1) {
+    uint32_t head = r->head.load(std::memory_order_acquire);
+    if (head != tail) {
+      return GetSlot(ring, tail);
+    }
+    if (IsClosed()) {
+      return nullptr;
+    }
+    if (spins < spin_count_) {
+      spins += 1;
+      CpuRelax();
+      continue;
+    }
+
+    int32_t remaining = kWaitSliceMs;
+    if (timeout_ms >= 0) {
+      remaining = static_cast<int32_t>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              deadline - std::chrono::steady_clock::now())
+              .count());
+      if (remaining <= 0) {
+        return nullptr;
+      }
+    }
+    Wait(&r->head, &r->head_waiting, head, remaining);
+  }
+}
+
+void AacIpcChannel::EndRead(int32_t ring) {
+  AacIpcRingHeader* r = &header_->rings[ring];
+  r->tail.store(r->tail.load(std::memory_order_relaxed) + 1);
+  if (r->tail_waiting.load()) {
+    FutexWake(&r->tail);
+  }
+}
+
+void AacIpcChannel::SetClosed() {
+  if (header_ == nullptr) {
+    return;
+  }
+  header_->closed.store(1);
+  for (auto& r : header_->rings) {
+    FutexWake(&r.head);
+    FutexWake(&r.tail);
+  }
+}
+
+bool AacIpcChannel::IsClosed() const {
+  return header_ == nullptr || header_->closed.load() != 0;
+}
+
+void AacIpcChannel::Close() {
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  fd_ = -1;
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  header_ = nullptr;
+  num_slots_ = 0;
+  slot_size_ = 0;
+  slot_stride_ = 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_IPC_CHANNEL_H_
+#define AAC_IPC_CHANNEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define AAC_IPC_MAGIC 0x31434141  // "AAC1"
+#define AAC_IPC_VERSION 2
+
+#define AAC_IPC_RING_REQUEST 0   // client to server
+#define AAC_IPC_RING_RESPONSE 1  // server to client
+
+#define AAC_IPC_MSG_ENCODE 1
+#define AAC_IPC_MSG_DECODE 2
+#define AAC_IPC_MSG_CONFIG_RAW 3
+#define AAC_IPC_MSG_GET_INFO 4
+#define AAC_IPC_MSG_ECHO 5  // payload sent back, for measuring the transport
+
+struct AacIpcSlot {
+  int32_t type;    // AAC_IPC_MSG_XXX
+  int32_t status;  // responses: 0, AAC_COMMON_ERROR_XXX or -1
+  int32_t size;    // bytes in data()
+  int32_t detail;  // error code of fdk-aac, if any
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+};
+
+// Lives in shared memory, so only lock-free, address-free atomics. A side
+// that is about to sleep on |head| or |tail| raises the matching waiting flag
+// and the other side only pays for FUTEX_WAKE when it is set.
+struct AacIpcRingHeader {
+  alignas(64) std::atomic<uint32_t> head;  // written by the producer
+  std::atomic<uint32_t> head_waiting;
+  alignas(64) std::atomic<uint32_t> tail;  // written by the consumer
+  std::atomic<uint32_t> tail_waiting;
+};
+
+struct AacIpcShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+  uint32_t slot_size;  // max bytes in AacIpcSlot::data()
+  std::atomic<uint32_t> closed;
+  AacIpcRingHeader rings[2];
+};
+
+// Two single-producer/single-consumer rings of fixed size slots in one memfd
+// mapping shared by a client and the service. Only the descriptor is passed
+// over the socket, payloads are written once into a slot and read in place.
+class AacIpcChannel {
+ public:
+  AacIpcChannel();
+  ~AacIpcChannel();
+
+  // Service side, allocates a new memfd
+  int32_t Create(uint32_t num_slots, uint32_t slot_size);
+  // Client side, takes the ownership of |fd|
+  int32_t Attach(int32_t fd);
+  int32_t GetFd() const { return fd_; }
+  uint32_t GetSlotSize() const { return slot_size_; }
+
+  // Producer of |ring|: a free slot, waiting up to |timeout_ms| (-1 forever).
+  // nullptr on timeout or once the channel is closed.
+  AacIpcSlot* BeginWrite(int32_t ring, int32_t timeout_ms);
+  void EndWrite(int32_t ring);
+  // Consumer of |ring|: the oldest message, same waiting rules.
+  AacIpcSlot* BeginRead(int32_t ring, int32_t timeout_ms);
+  void EndRead(int32_t ring);
+
+  // Wakes up both sides, all later waits fail
+  void SetClosed();
+  bool IsClosed() const;
+  void Close();
+
+ private:
+  AacIpcSlot* GetSlot(int32_t ring, uint32_t index) const;
+  void Wait(std::atomic<uint32_t>* word,
+            std::atomic<uint32_t>* waiting,
+            uint32_t value,
+            int32_t timeout_ms);
+  static size_t GetSlotStride(uint32_t slot_size);
+
+ private:
+  static const int32_t kSpinCount = 1000;
+
+  int32_t fd_;
+  void* mapping_;
+  size_t mapping_size_;
+  AacIpcShmHeader* header_;
+  // Of the header as checked against the mapping, the header itself can be
+  // rewritten by the other side at any time.
+  uint32_t num_slots_;
+  uint32_t slot_size_;
+  size_t slot_stride_;
+  int32_t spin_count_;
+};
+
+#endif  // AAC_IPC_CHANNEL_H_
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_ipc_client.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// How often a blocked call checks that the service is still there
+static const int32_t kPollMs = 1000;
+
+AacIpcSession::AacIpcSession() : socket_fd_(-1) {}
+
+AacIpcSession::~AacIpcSession() {
+  Close();
+}
+
+int32_t AacIpcSession::Open(const char* socket_path,
+                            const AacIpcOpenRequest& request) {
+  Close();
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path == nullptr || strlen(socket_path) >= sizeof(addr.sun_path)) {
+    printf("Invalid socket path\n");
+    return -1;
+  }
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+  do {
+    socket_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (socket_fd_ < 0 ||
+        connect(socket_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+                sizeof(addr))) {
+      printf("Connect to %s failed\n", socket_path);
+      break;
+    }
+
+    AacIpcOpenResponse response;
+    int32_t fd = -1;
+    if (aac_ipc_send(socket_fd_, &request, sizeof(request), -1) ||
+        aac_ipc_recv(socket_fd_, &response, sizeof(response), &fd)) {
+      printf("Open session failed\n");
+      break;
+    }
+    if (response.status || fd < 0) {
+      printf("Session rejected by the service\n");
+      if (fd >= 0) {
+        close(fd);
+      }
+      break;
+    }
+    if (channel_.Attach(fd)) {
+      break;
+    }
+    return 0;
+  } while (0);
+
+  Close();
+  return -1;
+}
+
+int32_t AacIpcSession::Call(int32_t type,
+                            const uint8_t* in,
+                            int32_t in_size,
+                            uint8_t* out,
+                            int32_t* out_size,
+                            int32_t* detail) {
+  if (detail) {
+    *detail = 0;
+  }
+  if (socket_fd_ < 0 || in_size < 0 ||
+      static_cast<uint32_t>(in_size) > channel_.GetSlotSize()) {
+    return -1;
+  }
+
+  AacIpcSlot* request = nullptr;
+  while ((request = channel_.BeginWrite(AAC_IPC_RING_REQUEST, kPollMs)) ==
+         nullptr) {
+    if (channel_.IsClosed() || aac_ipc_peer_closed(socket_fd_)) {
+      return -1;
+    }
+  }
+  request->type = type;
+  request->status = 0;
+  request->size = in_size;
+  request->detail = 0;
+  if (in_size > 0) {
+    memcpy(request->data(), in, in_size);
+  }
+  channel_.EndWrite(AAC_IPC_RING_REQUEST);
+
+  AacIpcSlot* response = nullptr;
+  while ((response = channel_.BeginRead(AAC_IPC_RING_RESPONSE, kPollMs)) ==
+         nullptr) {
+    if (channel_.IsClosed() || aac_ipc_peer_closed(socket_fd_)) {
+      return -1;
+    }
+  }
+
+  int32_t status = response->status;
+  if (detail) {
+    *detail = response->detail;
+  }
+  if (status == 0 && out_size) {
+    if (response->size > *out_size) {
+      status = -1;
+    } else {
+      memcpy(out, response->data(), response->size);
+      *out_size = response->size;
+    }
+  }
+  channel_.EndRead(AAC_IPC_RING_RESPONSE);
+  return status;
+}
+
+void AacIpcSession::Close() {
+  // The service ends the session as soon as it sees the flag
+  channel_.SetClosed();
+  channel_.Close();
+  if (socket_fd_ >= 0) {
+    close(socket_fd_);
+  }
+  socket_fd_ = -1;
+}
+
+AacIpcEncoder::AacIpcEncoder() {}
+
+AacIpcEncoder::~AacIpcEncoder() {
+  Uninit();
+}
+
+int32_t AacIpcEncoder::Init(const char* socket_path,
+                            const AacEncoderConfig& config) {
+  AacIpcOpenRequest request;
+  memset(&request, 0, sizeof(request));
+  request.magic = AAC_IPC_MAGIC;
+  request.version = AAC_IPC_VERSION;
+  request.kind = AAC_IPC_KIND_ENCODER;
+  request.transport_type = config.transport_type;
+  request.encoder_config = config;
+  return session_.Open(socket_path, request);
+}
+
+int32_t AacIpcEncoder::GetInfo(AacEncoderInfo* info) {
+  if (!info) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  int32_t size = sizeof(*info);
+  if (session_.Call(AAC_IPC_MSG_GET_INFO, nullptr, 0,
+                    reinterpret_cast<uint8_t*>(info), &size, nullptr) ||
+      size != sizeof(*info)) {
+    printf("Get info of aac encoder failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+int32_t AacIpcEncoder::GetEncoded(uint8_t* in_buffer,
+                                  int32_t in_size_bytes,
+                                  uint8_t* out_buffer,
+                                  int32_t* out_size_bytes) {
+  if (!out_buffer || !out_size_bytes) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
+    return -1;
+  }
+
+  int32_t detail = 0;
+  int32_t status = session_.Call(AAC_IPC_MSG_ENCODE, in_buffer, in_size_bytes,
+                                 out_buffer, out_size_bytes, &detail);
+  if (status) {
+    error_ring_.Push(status > 0 ? status : AAC_COMMON_ERROR_INVALID_HANDLE,
+                     detail);
+    return -1;
+  }
+  return 0;
+}
+
+int32_t AacIpcEncoder::Echo(uint8_t* data, int32_t size_in_bytes) {
+  int32_t out_size = size_in_bytes;
+  return session_.Call(AAC_IPC_MSG_ECHO, data, size_in_bytes, data, &out_size,
+                       nullptr);
+}
+
+int32_t AacIpcEncoder::PopError(AacError* error) {
+  return error_ring_.Pop(error);
+}
+
+void AacIpcEncoder::Uninit() {
+  session_.Close();
+}
+
+AacIpcDecoder::AacIpcDecoder() {}
+
+AacIpcDecoder::~AacIpcDecoder() {
+  Uninit();
+}
+
+int32_t AacIpcDecoder::Init(const char* socket_path, int32_t transport_type) {
+  AacIpcOpenRequest request;
+  memset(&request, 0, sizeof(request));
+  request.magic = AAC_IPC_MAGIC;
+  request.version = AAC_IPC_VERSION;
+  request.kind = AAC_IPC_KIND_DECODER;
+  request.transport_type = transport_type;
+  return session_.Open(socket_path, request);
+}
+
+int32_t AacIpcDecoder::ConfigRaw(uint8_t* conf, int32_t conf_size) {
+  if (!conf || conf_size <= 0) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  if (session_.Call(AAC_IPC_MSG_CONFIG_RAW, conf, conf_size, nullptr, nullptr,
+                    nullptr)) {
+    printf("Config of aac decoder failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+int32_t AacIpcDecoder::GetDecoded(uint8_t* in_buffer,
+                                  int32_t in_size_bytes,
+                                  uint8_t* out_buffer,
+                                  int32_t* out_size_bytes) {
+  if (!in_buffer || !in_size_bytes || !out_buffer || !out_size_bytes ||
+      !*out_size_bytes) {
+    error_ring_.Push(AAC_COMMON_ERROR_INVALID_PARAM, 0);
+    return -1;
+  }
+
+  int32_t detail = 0;
+  int32_t status = session_.Call(AAC_IPC_MSG_DECODE, in_buffer, in_size_bytes,
+                                 out_buffer, out_size_bytes, &detail);
+  if (status) {
+    error_ring_.Push(status > 0 ? status : AAC_COMMON_ERROR_INVALID_HANDLE,
+                     detail);
+    return -1;
+  }
+  // Concealed frames succeed, the error is still reported
+  if (detail) {
+    error_ring_.Push(AAC_COMMON_ERROR_DECODE_FRAME, detail);
+  }
+  return 0;
+}
+
+int32_t AacIpcDecoder::GetInfo(AacDecoderInfo* info) {
+  if (!info) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  int32_t size = sizeof(*info);
+  if (session_.Call(AAC_IPC_MSG_GET_INFO, nullptr, 0,
+                    reinterpret_cast<uint8_t*>(info), &size, nullptr) ||
+      size != sizeof(*info)) {
+    printf("Get info of aac decoder failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+int32_t AacIpcDecoder::PopError(AacError* error) {
+  return error_ring_.Pop(error);
+}
+
+void AacIpcDecoder::Uninit() {
+  session_.Close();
+}
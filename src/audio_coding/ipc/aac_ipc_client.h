@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_IPC_CLIENT_H_
+#define AAC_IPC_CLIENT_H_
+
+#include <stdint.h>
+#include "aac_decoder.h"
+#include "aac_encoder.h"
+#include "aac_error_ring.h"
+#include "aac_ipc_channel.h"
+#include "aac_ipc_protocol.h"
+
+// One session with aac_service: the socket of the handshake, kept open so
+// either side notices when the other goes away, and the shared channel.
+class AacIpcSession {
+ public:
+  AacIpcSession();
+  ~AacIpcSession();
+
+  int32_t Open(const char* socket_path, const AacIpcOpenRequest& request);
+  // Sends one request and waits for its response. |out| may be nullptr when
+  // no payload is expected. Returns the status of the response, or -1.
+  int32_t Call(int32_t type,
+               const uint8_t* in,
+               int32_t in_size,
+               uint8_t* out,
+               int32_t* out_size,
+               int32_t* detail);
+  uint32_t GetSlotSize() const { return channel_.GetSlotSize(); }
+  void Close();
+
+ private:
+  int32_t socket_fd_;
+  AacIpcChannel channel_;
+};
+
+// AacEncoder with the encoder running in aac_service
+class AacIpcEncoder {
+ public:
+  AacIpcEncoder();
+  ~AacIpcEncoder();
+
+  int32_t Init(const char* socket_path, const AacEncoderConfig& config);
+  int32_t GetInfo(AacEncoderInfo* info);
+  int32_t GetEncoded(uint8_t* in_buffer,
+                     int32_t in_size_bytes,
+                     uint8_t* out_buffer,
+                     int32_t* out_size_bytes);
+  // Round trip of |size_in_bytes| through the service without encoding, for
+  // measuring the transport alone
+  int32_t Echo(uint8_t* data, int32_t size_in_bytes);
+  int32_t PopError(AacError* error);
+  void Uninit();
+
+ private:
+  AacIpcSession session_;
+  AacErrorRing error_ring_;
+};
+
+// AacDecoder with the decoder running in aac_service
+class AacIpcDecoder {
+ public:
+  AacIpcDecoder();
+  ~AacIpcDecoder();
+
+  int32_t Init(const char* socket_path, int32_t transport_type);
+  int32_t ConfigRaw(uint8_t* conf, int32_t conf_size);
+  int32_t GetDecoded(uint8_t* in_buffer,
+                     int32_t in_size_bytes,
+                     uint8_t* out_buffer,
+                     int32_t* out_size_bytes);
+  int32_t GetInfo(AacDecoderInfo* info);
+  int32_t PopError(AacError* error);
+  void Uninit();
+
+ private:
+  AacIpcSession session_;
+  AacErrorRing error_ring_;
+};
+
+#endif  // AAC_IPC_CLIENT_H_
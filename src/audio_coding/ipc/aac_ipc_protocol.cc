@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_ipc_protocol.h"
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+int32_t aac_ipc_send(int32_t socket_fd,
+                     const void* data,
+                     int32_t size,
+                     int32_t fd) {
+  struct iovec iov;
+  iov.iov_base = const_cast<void*>(data);
+  iov.iov_len = size;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  char control[CMSG_SPACE(sizeof(int))];
+  if (fd >= 0) {
+    memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  ssize_t sent = 0;
+  do {
+    sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  return sent == size ? 0 : -1;
+}
+
+int32_t aac_ipc_recv(int32_t socket_fd, void* data, int32_t size, int32_t* fd) {
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = size;
+
+  char control[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  if (fd) {
+    *fd = -1;
+  }
+
+  ssize_t received = 0;
+  do {
+    received = recvmsg(socket_fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received < 0) {
+    return -1;
+  }
+
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      int passed_fd = -1;
+      memcpy(&passed_fd, CMSG_DATA(cmsg), sizeof(int));
+      if (fd) {
+        *fd = passed_fd;
+      } else {
+        close(passed_fd);
+      }
+    }
+  }
+
+  // A truncated message is a protocol error
+  if (received != size || (msg.msg_flags & MSG_TRUNC)) {
+    if (fd && *fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+    return -1;
+  }
+  return 0;
+}
+
+bool aac_ipc_peer_closed(int32_t socket_fd) {
+  struct pollfd pfd;
+  pfd.fd = socket_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if (poll(&pfd, 1, 0) <= 0) {
+    return false;
+  }
+  // Nothing else is sent after the open handshake, so readable means EOF
+  return (pfd.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
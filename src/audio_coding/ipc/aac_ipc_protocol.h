@@ -0,0 +1,45 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_IPC_PROTOCOL_H_
+#define AAC_IPC_PROTOCOL_H_
+
+#include <stdint.h>
+#include "aac_encoder.h"
+#include "aac_ipc_channel.h"
+
+#define AAC_IPC_KIND_ENCODER 1
+#define AAC_IPC_KIND_DECODER 2
+
+#define AAC_IPC_NUM_SLOTS 4
+#define AAC_IPC_MIN_SLOT_SIZE 8192
+// Decoded PCM of one frame, up to 8 channels of 2048 samples
+#define AAC_IPC_DECODER_SLOT_SIZE (8 * 2048 * 2)
+
+// The only messages on the Unix socket. The response carries the memfd of the
+// session channel as SCM_RIGHTS, everything after goes through the channel.
+struct AacIpcOpenRequest {
+  uint32_t magic;  // AAC_IPC_MAGIC
+  uint32_t version;
+  int32_t kind;            // AAC_IPC_KIND_XXX
+  int32_t transport_type;  // decoder only
+  AacEncoderConfig encoder_config;
+};
+
+struct AacIpcOpenResponse {
+  int32_t status;  // 0 or -1
+  uint32_t slot_size;
+};
+
+// SOCK_SEQPACKET, one call per message. |fd| is passed along if >= 0.
+int32_t aac_ipc_send(int32_t socket_fd,
+                     const void* data,
+                     int32_t size,
+                     int32_t fd);
+// |fd| receives a passed descriptor, or -1
+int32_t aac_ipc_recv(int32_t socket_fd, void* data, int32_t size, int32_t* fd);
+// True once the peer has closed or reset its end
+bool aac_ipc_peer_closed(int32_t socket_fd);
+
+#endif  // AAC_IPC_PROTOCOL_H_
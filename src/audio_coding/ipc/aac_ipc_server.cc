@@ -0,0 +1,463 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_ipc_server.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+
+// How often idle waits check for Stop() and for clients that went away
+static const int32_t kPollMs = 1000;
+
+// The slots are shared with the client, a plain read could be repeated by the
+// compiler and see another value.
+static int32_t ReadOnce(const int32_t& value) {
+  return *static_cast<const volatile int32_t*>(&value);
+}
+
+static void SetError(int32_t code, int32_t detail, AacIpcSlot* response) {
+  response->status = code;
+  response->detail = detail;
+  response->size = 0;
+}
+
+// |type| and |size| are the header of |request| as checked by the caller, the
+// slot itself is shared with the client and may change under the call.
+static void HandleEncoderRequest(AacEncoder* encoder,
+                                 int32_t type,
+                                 int32_t size,
+                                 AacIpcSlot* request,
+                                 AacIpcSlot* response,
+                                 int32_t slot_size) {
+  switch (type) {
+    case AAC_IPC_MSG_ENCODE: {
+      int32_t out_size = slot_size;
+      if (encoder->GetEncoded(request->data(), size, response->data(),
+                              &out_size) == 0) {
+        response->size = out_size;
+        break;
+      }
+      AacError error = {-1, 0};
+      encoder->PopError(&error);
+      SetError(error.code, error.detail, response);
+      break;
+    }
+    case AAC_IPC_MSG_GET_INFO: {
+      AacEncoderInfo info;
+      if (encoder->GetInfo(&info)) {
+        SetError(-1, 0, response);
+        break;
+      }
+      memcpy(response->data(), &info, sizeof(info));
+      response->size = sizeof(info);
+      break;
+    }
+    case AAC_IPC_MSG_ECHO:
+      memcpy(response->data(), request->data(), size);
+      response->size = size;
+      break;
+    default:
+      SetError(AAC_COMMON_ERROR_INVALID_PARAM, 0, response);
+      break;
+  }
+
+  // Only the first error of a call is forwarded
+  AacError error;
+  while (encoder->PopError(&error) == 0) {
+  }
+}
+
+static void HandleDecoderRequest(AacDecoder* decoder,
+                                 int32_t type,
+                                 int32_t size,
+                                 AacIpcSlot* request,
+                                 AacIpcSlot* response,
+                                 int32_t slot_size) {
+  switch (type) {
+    case AAC_IPC_MSG_DECODE: {
+      int32_t out_size = slot_size;
+      int32_t ret = decoder->GetDecoded(request->data(), size,
+                                        response->data(), &out_size);
+      AacError error = {-1, 0};
+      int32_t popped = decoder->PopError(&error);
+      if (ret) {
+        SetError(error.code, error.detail, response);
+        break;
+      }
+      response->size = out_size;
+      if (popped == 0 && error.code == AAC_COMMON_ERROR_DECODE_FRAME) {
+        // Concealed, the client raises the error again on its side
+        response->detail = error.detail ? error.detail : -1;
+      }
+      break;
+    }
+    case AAC_IPC_MSG_CONFIG_RAW:
+      if (decoder->ConfigRaw(request->data(), size)) {
+        SetError(-1, 0, response);
+      }
+      break;
+    case AAC_IPC_MSG_GET_INFO: {
+      AacDecoderInfo info;
+      if (decoder->GetInfo(&info)) {
+        SetError(-1, 0, response);
+        break;
+      }
+      memcpy(response->data(), &info, sizeof(info));
+      response->size = sizeof(info);
+      break;
+    }
+    case AAC_IPC_MSG_ECHO:
+      memcpy(response->data(), request->data(), size);
+      response->size = size;
+      break;
+    default:
+      SetError(AAC_COMMON_ERROR_INVALID_PARAM, 0, response);
+      break;
+  }
+
+  AacError error;
+  while (decoder->PopError(&error) == 0) {
+  }
+}
+
+AacIpcServer::AacIpcServer() : listen_fd_(-1), max_idle_(0), stop_(false) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+AacIpcServer::~AacIpcServer() {
+  Uninit();
+}
+
+int32_t AacIpcServer::Init(const char* socket_path, int32_t max_idle) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path == nullptr || strlen(socket_path) >= sizeof(addr.sun_path) ||
+      max_idle < 0) {
+    printf("Invalid param\n");
+    return -1;
+  }
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+  do {
+    listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+      printf("socket failed, %s\n", strerror(errno));
+      break;
+    }
+
+    // A socket file nobody listens on is left over by a crashed service
+    if (connect(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+                sizeof(addr)) == 0) {
+      printf("Service already running on %s\n", socket_path);
+      break;
+    }
+    unlink(socket_path);
+
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) ||
+        listen(listen_fd_, 64)) {
+      printf("Listen on %s failed, %s\n", socket_path, strerror(errno));
+      break;
+    }
+
+    socket_path_ = socket_path;
+    max_idle_ = max_idle;
+    stop_ = false;
+    return 0;
+  } while (0);
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+  listen_fd_ = -1;
+  return -1;
+}
+
+int32_t AacIpcServer::Run() {
+  if (listen_fd_ < 0) {
+    return -1;
+  }
+
+  while (!stop_) {
+    struct pollfd pfd;
+    pfd.fd = listen_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int32_t ret = poll(&pfd, 1, kPollMs);
+    ReapSessions(false);
+    if (ret <= 0) {
+      continue;
+    }
+
+    int32_t fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stats_.sessions += 1;
+      stats_.active_sessions += 1;
+    }
+    sessions_.emplace_back(new Session);
+    Session* session = sessions_.back().get();
+    session->done = false;
+    session->thread = std::thread(&AacIpcServer::RunSession, this, fd, session);
+  }
+
+  ReapSessions(true);
+  return 0;
+}
+
+void AacIpcServer::Stop() {
+  stop_ = true;
+}
+
+void AacIpcServer::RunSession(int32_t socket_fd, Session* session) {
+  AacIpcOpenRequest request;
+  AacIpcOpenResponse response = {-1, 0};
+  std::unique_ptr<AacEncoder> encoder;
+  std::unique_ptr<AacDecoder> decoder;
+  AacIpcChannel channel;
+
+  do {
+    // A client that connects and sends nothing must not hold the session
+    // past Stop(), Run() joins it.
+    if (WaitReadable(socket_fd)) {
+      break;
+    }
+    if (aac_ipc_recv(socket_fd, &request, sizeof(request), nullptr) ||
+        request.magic != AAC_IPC_MAGIC || request.version != AAC_IPC_VERSION) {
+      printf("Invalid session request\n");
+      break;
+    }
+
+    uint32_t slot_size = 0;
+    if (request.kind == AAC_IPC_KIND_ENCODER) {
+      encoder = AcquireEncoder(request.encoder_config);
+      AacEncoderInfo info;
+      if (encoder == nullptr || encoder->GetInfo(&info)) {
+        break;
+      }
+      slot_size = std::max<uint32_t>(
+          AAC_IPC_MIN_SLOT_SIZE,
+          info.frame_length * request.encoder_config.channels * 2);
+    } else if (request.kind == AAC_IPC_KIND_DECODER) {
+      decoder = AcquireDecoder(request.transport_type);
+      if (decoder == nullptr) {
+        break;
+      }
+      slot_size = AAC_IPC_DECODER_SLOT_SIZE;
+    } else {
+      printf("Unsupported session kind, %d\n", request.kind);
+      break;
+    }
+
+    if (channel.Create(AAC_IPC_NUM_SLOTS, slot_size)) {
+      break;
+    }
+    response.status = 0;
+    response.slot_size = slot_size;
+  } while (0);
+
+  if (aac_ipc_send(socket_fd, &response, sizeof(response),
+                   response.status == 0 ? channel.GetFd() : -1) == 0 &&
+      response.status == 0) {
+    Serve(socket_fd, &channel, encoder.get(), decoder.get());
+  }
+
+  if (encoder) {
+    ReleaseEncoder(request.encoder_config, std::move(encoder));
+  }
+  if (decoder) {
+    ReleaseDecoder(request.transport_type, std::move(decoder));
+  }
+  channel.SetClosed();
+  channel.Close();
+  close(socket_fd);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.active_sessions -= 1;
+  }
+  session->done = true;
+}
+
+int32_t AacIpcServer::WaitReadable(int32_t socket_fd) {
+  while (!stop_) {
+    struct pollfd pfd;
+    pfd.fd = socket_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int32_t ret = poll(&pfd, 1, kPollMs);
+    if (ret > 0) {
+      // A hang up is readable too, the recv then fails
+      return 0;
+    } else if (ret < 0 && errno != EINTR) {
+      return -1;
+    }
+  }
+  return -1;
+}
+
+void AacIpcServer::Serve(int32_t socket_fd,
+                         AacIpcChannel* channel,
+                         AacEncoder* encoder,
+                         AacDecoder* decoder) {
+  const int32_t slot_size = static_cast<int32_t>(channel->GetSlotSize());
+
+  while (!stop_) {
+    AacIpcSlot* request = channel->BeginRead(AAC_IPC_RING_REQUEST, kPollMs);
+    if (request == nullptr) {
+      if (channel->IsClosed() || aac_ipc_peer_closed(socket_fd)) {
+        return;
+      }
+      continue;
+    }
+
+    AacIpcSlot* response = nullptr;
+    while ((response = channel->BeginWrite(AAC_IPC_RING_RESPONSE, kPollMs)) ==
+           nullptr) {
+      if (stop_ || channel->IsClosed() || aac_ipc_peer_closed(socket_fd)) {
+        return;
+      }
+    }
+
+    // The request is read in place and the result written straight into the
+    // response slot, the codec never sees a private copy. The header is read
+    // once though, the client could rewrite it after the check.
+    const int32_t type = ReadOnce(request->type);
+    const int32_t size = ReadOnce(request->size);
+    response->type = type;
+    response->status = 0;
+    response->size = 0;
+    response->detail = 0;
+    if (size < 0 || size > slot_size) {
+      SetError(AAC_COMMON_ERROR_INVALID_PARAM, 0, response);
+    } else if (encoder) {
+      HandleEncoderRequest(encoder, type, size, request, response, slot_size);
+    } else {
+      HandleDecoderRequest(decoder, type, size, request, response, slot_size);
+    }
+
+    channel->EndRead(AAC_IPC_RING_REQUEST);
+    channel->EndWrite(AAC_IPC_RING_RESPONSE);
+  }
+}
+
+std::unique_ptr<AacEncoder> AacIpcServer::AcquireEncoder(
+    const AacEncoderConfig& config) {
+  std::unique_ptr<AacEncoder> encoder;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_encoders_.begin(); it != idle_encoders_.end(); ++it) {
+      if (memcmp(&it->config, &config, sizeof(config)) == 0) {
+        encoder = std::move(it->encoder);
+        idle_encoders_.erase(it);
+        stats_.pool_hits += 1;
+        break;
+      }
+    }
+  }
+
+  if (encoder && encoder->Reset() == 0) {
+    return encoder;
+  }
+
+  // Outside the lock, opening fdk-aac is the slow part
+  encoder.reset(new AacEncoder);
+  if (encoder->Init(config)) {
+    printf("Init aac encoder failed\n");
+    return nullptr;
+  }
+  return encoder;
+}
+
+void AacIpcServer::ReleaseEncoder(const AacEncoderConfig& config,
+                                  std::unique_ptr<AacEncoder> encoder) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<int32_t>(idle_encoders_.size()) < max_idle_) {
+    IdleEncoder idle;
+    idle.config = config;
+    idle.encoder = std::move(encoder);
+    idle_encoders_.push_back(std::move(idle));
+  }
+}
+
+std::unique_ptr<AacDecoder> AacIpcServer::AcquireDecoder(
+    int32_t transport_type) {
+  std::unique_ptr<AacDecoder> decoder;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_decoders_.begin(); it != idle_decoders_.end(); ++it) {
+      if (it->transport_type == transport_type) {
+        decoder = std::move(it->decoder);
+        idle_decoders_.erase(it);
+        stats_.pool_hits += 1;
+        break;
+      }
+    }
+  }
+
+  if (decoder && decoder->Reset() == 0) {
+    return decoder;
+  }
+
+  decoder.reset(new AacDecoder);
+  if (decoder->Init(transport_type)) {
+    printf("Init aac decoder failed\n");
+    return nullptr;
+  }
+  return decoder;
+}
+
+void AacIpcServer::ReleaseDecoder(int32_t transport_type,
+                                  std::unique_ptr<AacDecoder> decoder) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<int32_t>(idle_decoders_.size()) < max_idle_) {
+    IdleDecoder idle;
+    idle.transport_type = transport_type;
+    idle.decoder = std::move(decoder);
+    idle_decoders_.push_back(std::move(idle));
+  }
+}
+
+void AacIpcServer::ReapSessions(bool wait) {
+  for (auto it = sessions_.begin(); it != sessions_.end();) {
+    if (wait || (*it)->done) {
+      (*it)->thread.join();
+      it = sessions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void AacIpcServer::GetStats(AacIpcServerStats* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *stats = stats_;
+  stats->idle_encoders = idle_encoders_.size();
+  stats->idle_decoders = idle_decoders_.size();
+}
+
+void AacIpcServer::Uninit() {
+  stop_ = true;
+  ReapSessions(true);
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+  }
+  listen_fd_ = -1;
+  socket_path_.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_encoders_.clear();
+  idle_decoders_.clear();
+}
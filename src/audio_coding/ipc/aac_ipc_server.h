@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_IPC_SERVER_H_
+#define AAC_IPC_SERVER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_decoder.h"
+#include "aac_encoder.h"
+#include "aac_ipc_channel.h"
+#include "aac_ipc_protocol.h"
+
+struct AacIpcServerStats {
+  int64_t sessions;
+  int64_t active_sessions;
+  int64_t pool_hits;  // sessions served by an idle, already opened codec
+  int64_t idle_encoders;
+  int64_t idle_decoders;
+};
+
+// Accepts sessions on a Unix socket and serves each one from its own thread.
+// Codecs of finished sessions are reset and kept in a pool keyed by their
+// config, so the next session with the same config skips the open and
+// memory allocation of fdk-aac.
+class AacIpcServer {
+ public:
+  AacIpcServer();
+  ~AacIpcServer();
+
+  // |max_idle| codecs of each kind are kept at most
+  int32_t Init(const char* socket_path, int32_t max_idle);
+  // Returns after Stop(), which may be called from a signal handler
+  int32_t Run();
+  void Stop();
+  void GetStats(AacIpcServerStats* stats);
+  void Uninit();
+
+ private:
+  struct Session {
+    std::thread thread;
+    std::atomic<bool> done;
+  };
+
+  struct IdleEncoder {
+    AacEncoderConfig config;
+    std::unique_ptr<AacEncoder> encoder;
+  };
+
+  struct IdleDecoder {
+    int32_t transport_type;
+    std::unique_ptr<AacDecoder> decoder;
+  };
+
+  void RunSession(int32_t socket_fd, Session* session);
+  // 0 once |socket_fd| is readable, -1 after Stop() or on error
+  int32_t WaitReadable(int32_t socket_fd);
+  // Exactly one of |encoder| and |decoder| is set
+  void Serve(int32_t socket_fd,
+             AacIpcChannel* channel,
+             AacEncoder* encoder,
+             AacDecoder* decoder);
+  std::unique_ptr<AacEncoder> AcquireEncoder(const AacEncoderConfig& config);
+  void ReleaseEncoder(const AacEncoderConfig& config,
+                      std::unique_ptr<AacEncoder> encoder);
+  std::unique_ptr<AacDecoder> AcquireDecoder(int32_t transport_type);
+  void ReleaseDecoder(int32_t transport_type,
+                      std::unique_ptr<AacDecoder> decoder);
+  void ReapSessions(bool wait);
+
+ private:
+  int32_t listen_fd_;
+  std::string socket_path_;
+  int32_t max_idle_;
+  std::atomic<bool> stop_;
+
+  std::mutex mutex_;  // pools and stats
+  std::vector<IdleEncoder> idle_encoders_;
+  std::vector<IdleDecoder> idle_decoders_;
+  AacIpcServerStats stats_;
+
+  std::list<std::unique_ptr<Session>> sessions_;
+};
+
+#endif  // AAC_IPC_SERVER_H_
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "m4a_reader.h"
+#include <stdio.h>
+#include <string.h>
+#include "mp4v2/mp4v2.h"
+
+M4aReader::M4aReader()
+    : m4a_file_(MP4_INVALID_FILE_HANDLE), track_id_(MP4_INVALID_TRACK_ID) {
+  memset(&m4a_file_info_, 0, sizeof(m4a_file_info_));
+}
+
+M4aReader::~M4aReader() {
+  if (m4a_file_ != MP4_INVALID_FILE_HANDLE) {
+    Close();
+  }
+}
+
+int32_t M4aReader::Open(const char* filename) {
+  MP4FileHandle m4a_file = MP4_INVALID_FILE_HANDLE;
+
+  do {
+    m4a_file = MP4Read(filename);
+    if (m4a_file == MP4_INVALID_FILE_HANDLE) {
+      printf("Unable to open mp4 file '%s'\n", filename);
+      return -1;
+    }
+
+    MP4TrackId track_id = MP4FindTrackId(m4a_file, 0, MP4_AUDIO_TRACK_TYPE);
+    if (track_id == MP4_INVALID_TRACK_ID) {
+      printf("No audio track in '%s'\n", filename);
+      break;
+    }
+
+    M4aFileInfo info;
+    memset(&info, 0, sizeof(info));
+    info.timescale = MP4GetTrackTimeScale(m4a_file, track_id);
+    info.duration = MP4GetTrackDuration(m4a_file, track_id);
+    info.num_samples = MP4GetTrackNumberOfSamples(m4a_file, track_id);
+
+    uint8_t* conf = nullptr;
+    uint32_t conf_size = 0;
+    if (MP4GetTrackESConfiguration(m4a_file, track_id, &conf, &conf_size) &&
+        conf != nullptr) {
+      if (conf_size <= sizeof(info.conf)) {
+        memcpy(info.conf, conf, conf_size);
+        info.conf_size = conf_size;
+      }
+      MP4Free(conf);
+    }
+    if (info.conf_size == 0) {
+      printf("No AudioSpecificConfig in '%s'\n", filename);
+      break;
+    }
+
+    m4a_file_ = m4a_file;
+    track_id_ = track_id;
+    m4a_file_info_ = info;
+  } while (0);
+
+  if (m4a_file_ == MP4_INVALID_FILE_HANDLE) {
+    MP4Close(m4a_file);
+    return -1;
+  }
+
+  return 0;
+}
+
+int32_t M4aReader::GetInfo(M4aFileInfo* info) {
+  if (info == nullptr) {
+    printf("Invalid param, %p", info);
+    return -1;
+  }
+
+  memcpy(info, &m4a_file_info_, sizeof(m4a_file_info_));
+  return 0;
+}
+
+int32_t M4aReader::GetSampleSize(int32_t index) {
+  if (m4a_file_ == MP4_INVALID_FILE_HANDLE) {
+    return -1;
+  }
+  return MP4GetSampleSize(m4a_file_, track_id_, index + 1);
+}
+
+int64_t M4aReader::GetSampleDuration(int32_t index) {
+  if (m4a_file_ == MP4_INVALID_FILE_HANDLE) {
+    return -1;
+  }
+  return MP4GetSampleDuration(m4a_file_, track_id_, index + 1);
+}
+
+int32_t M4aReader::ReadSample(int32_t index,
+                              uint8_t* data,
+                              int32_t* size_in_bytes) {
+  if (m4a_file_ == MP4_INVALID_FILE_HANDLE) {
+    return -1;
+  }
+
+  if (!data || !size_in_bytes || *size_in_bytes <= 0) {
+    printf("Invalid param");
+    return -1;
+  }
+
+  // mp4v2 fills a buffer given by the caller, up to |num_bytes|.
+  uint8_t* bytes = data;
+  uint32_t num_bytes = *size_in_bytes;
+  bool ret =
+      MP4ReadSample(m4a_file_, track_id_, index + 1, &bytes, &num_bytes);
+  if (!ret) {
+    return -1;
+  }
+
+  *size_in_bytes = num_bytes;
+  return 0;
+}
+
+void M4aReader::Close() {
+  MP4Close(m4a_file_);
+  m4a_file_ = MP4_INVALID_FILE_HANDLE;
+  track_id_ = MP4_INVALID_TRACK_ID;
+}
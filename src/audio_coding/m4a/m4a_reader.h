@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef M4A_READER_H_
+#define M4A_READER_H_
+
+#include <stdint.h>
+
+#define M4A_READER_MAX_CONF_SIZE 64
+
+struct M4aFileInfo {
+  int32_t timescale;  // of the audio track, usually the sample rate
+  int64_t duration;   // in timescale units
+  int32_t num_samples;
+  uint8_t conf[M4A_READER_MAX_CONF_SIZE];  // AudioSpecificConfig
+  int32_t conf_size;
+};
+
+// Reads the first audio track. Sizes and durations come from the sample
+// tables, which are loaded on Open(), so they are cheap to query.
+class M4aReader {
+ public:
+  M4aReader();
+  ~M4aReader();
+
+  int32_t Open(const char* filename);
+  int32_t GetInfo(M4aFileInfo* info);
+  // |index| starts from 0
+  int32_t GetSampleSize(int32_t index);
+  int64_t GetSampleDuration(int32_t index);
+  int32_t ReadSample(int32_t index, uint8_t* data, int32_t* size_in_bytes);
+  void Close();
+
+ private:
+  void* m4a_file_;
+  uint32_t track_id_;
+  M4aFileInfo m4a_file_info_;
+};
+
+#endif  // M4A_READER_H_
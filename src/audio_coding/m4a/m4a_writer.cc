@@ -4,10 +4,23 @@
 
 #include "m4a_writer.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "mp4v2/mp4v2.h"
 
 M4aWriter::M4aWriter()
-    : m4a_file_(MP4_INVALID_FILE_HANDLE), track_id_(MP4_INVALID_TRACK_ID) {}
+    : m4a_file_(MP4_INVALID_FILE_HANDLE),
+      track_id_(MP4_INVALID_TRACK_ID),
+      sample_rate_(0),
+      frame_length_(0),
+      total_bytes_(0),
+      num_samples_(0),
+      total_duration_(0),
+      window_bytes_(0),
+      max_window_bytes_(0),
+      gapless_(false),
+      priming_(0),
+      padding_(0) {}
 
 M4aWriter::~M4aWriter() {
   if (m4a_file_ != MP4_INVALID_FILE_HANDLE) {
@@ -24,7 +37,7 @@ int32_t M4aWriter::Open(const char* filename,
   MP4FileHandle m4a_file = MP4_INVALID_FILE_HANDLE;
 
   do {
-    MP4FileHandle m4a_file = MP4Create(filename);
+    m4a_file = MP4Create(filename);
     if (m4a_file == MP4_INVALID_FILE_HANDLE) {
       printf("Unable to open mp4 file '%s'\n", filename);
       return -1;
@@ -46,6 +59,18 @@ int32_t M4aWriter::Open(const char* filename,
 
     m4a_file_ = m4a_file;
     track_id_ = track_id;
+
+    sample_rate_ = sample_rate;
+    frame_length_ = frame_length;
+    total_bytes_ = 0;
+    num_samples_ = 0;
+    total_duration_ = 0;
+    window_.clear();
+    window_bytes_ = 0;
+    max_window_bytes_ = 0;
+    gapless_ = false;
+    priming_ = 0;
+    padding_ = 0;
   } while (0);
 
   if (m4a_file_ == MP4_INVALID_FILE_HANDLE &&
@@ -57,14 +82,108 @@ int32_t M4aWriter::Open(const char* filename,
   return 0;
 }
 
-int32_t M4aWriter::Write(uint8_t* data, int32_t size_in_bytes) {
-  bool ret = MP4WriteSample(m4a_file_, track_id_, data, size_in_bytes);
-  return ret ? 0 : -1;
+int32_t M4aWriter::Write(uint8_t* data,
+                         int32_t size_in_bytes,
+                         int32_t duration) {
+  if (duration <= 0) {
+    duration = frame_length_;
+  }
+
+  bool ret =
+      MP4WriteSample(m4a_file_, track_id_, data, size_in_bytes, duration);
+  if (!ret) {
+    return -1;
+  }
+
+  // By time, a sample extended by DTX covers more than one frame
+  window_.push_back({total_duration_, size_in_bytes});
+  window_bytes_ += size_in_bytes;
+  total_bytes_ += size_in_bytes;
+  num_samples_ += 1;
+  total_duration_ += duration;
+  while (!window_.empty() &&
+         window_.front().first + sample_rate_ < total_duration_) {
+    window_bytes_ -= window_.front().second;
+    window_.pop_front();
+  }
+  if (window_bytes_ > max_window_bytes_) {
+    max_window_bytes_ = window_bytes_;
+  }
+  return 0;
+}
+
+void M4aWriter::SetGapless(int64_t priming, int64_t padding) {
+  gapless_ = true;
+  priming_ = priming;
+  padding_ = padding;
 }
 
 void M4aWriter::Close() {
   if (m4a_file_ != MP4_INVALID_FILE_HANDLE) {
-    MP4Close(m4a_file_);
+    UpdateBitrate();
+    WriteGapless();
+    // mp4v2 would otherwise recompute the bitrates of the esds on close,
+    // from the chunk sizes, over what UpdateBitrate() set.
+    MP4Close(m4a_file_, MP4_CLOSE_DO_NOT_COMPUTE_BITRATE);
   }
   m4a_file_ = MP4_INVALID_FILE_HANDLE;
 }
+
+void M4aWriter::UpdateBitrate() {
+  if (num_samples_ == 0) {
+    return;
+  }
+
+  int64_t avg_bitrate = total_bytes_ * 8 * sample_rate_ / total_duration_;
+  // A track shorter than 1 second peaks at its average
+  int64_t max_bitrate = max_window_bytes_ * 8;
+  if (max_bitrate < avg_bitrate) {
+    max_bitrate = avg_bitrate;
+  }
+
+  MP4SetTrackIntegerProperty(
+      m4a_file_, track_id_,
+      "mdia.minf.stbl.stsd.mp4a.esds.decConfigDescr.avgBitrate", avg_bitrate);
+  MP4SetTrackIntegerProperty(
+      m4a_file_, track_id_,
+      "mdia.minf.stbl.stsd.mp4a.esds.decConfigDescr.maxBitrate", max_bitrate);
+}
+
+void M4aWriter::WriteGapless() {
+  int64_t valid = total_duration_ - priming_ - padding_;
+  if (!gapless_ || priming_ < 0 || padding_ < 0 || valid <= 0) {
+    return;
+  }
+
+  // Media time in the track timescale, duration in the movie timescale
+  uint32_t movie_timescale = MP4GetTimeScale(m4a_file_);
+  MP4Duration duration =
+      (valid * movie_timescale + sample_rate_ - 1) / sample_rate_;
+  if (MP4AddTrackEdit(m4a_file_, track_id_, MP4_INVALID_EDIT_ID, priming_,
+                      duration) == MP4_INVALID_EDIT_ID) {
+    printf("Add edit list failed\n");
+  }
+
+  char smpb[128] = {0};
+  snprintf(smpb, sizeof(smpb),
+           " 00000000 %08X %08X %016llX 00000000 00000000 00000000 00000000 "
+           "00000000 00000000 00000000 00000000",
+           static_cast<uint32_t>(priming_), static_cast<uint32_t>(padding_),
+           static_cast<unsigned long long>(valid));
+  MP4ItmfItem* item = MP4ItmfItemAlloc("----", 1);
+  if (item == nullptr) {
+    return;
+  }
+  // Freed by MP4ItmfItemFree()
+  item->mean = strdup("com.apple.iTunes");
+  item->name = strdup("iTunSMPB");
+  MP4ItmfData* data = &item->dataList.elements[0];
+  data->typeCode = MP4_ITMF_BT_UTF8;
+  data->valueSize = strlen(smpb);
+  data->value = static_cast<uint8_t*>(malloc(data->valueSize));
+  memcpy(data->value, smpb, data->valueSize);
+  if (!MP4ItmfAddItem(m4a_file_, item)) {
+    printf("Add iTunSMPB failed\n");
+  }
+  MP4ItmfItemFree(item);
+}
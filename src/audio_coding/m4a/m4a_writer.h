@@ -6,6 +6,8 @@
 #define M4A_WRITER_H_
 
 #include <stdint.h>
+#include <deque>
+#include <utility>
 
 class M4aWriter {
  public:
@@ -18,12 +20,37 @@ class M4aWriter {
                int32_t frame_length,
                uint8_t* conf,
                int32_t conf_size);
-  int32_t Write(uint8_t* data, int32_t size_in_bytes);
+  // |duration| in samples, 0 means one frame. A longer duration covers frames
+  // skipped by DTX.
+  int32_t Write(uint8_t* data, int32_t size_in_bytes, int32_t duration = 0);
+  // Gapless playback, |priming| samples at the start and |padding| at the end
+  // of the decoded track are not audio. Written on Close() as an edit list,
+  // and as iTunSMPB for players that only read that.
+  void SetGapless(int64_t priming, int64_t padding);
   void Close();
 
+ private:
+  void UpdateBitrate();
+  void WriteGapless();
+
  private:
   void* m4a_file_;
   uint32_t track_id_;
+
+  // For average and max(over any 1 second) bitrate, VBR frames vary in size.
+  int32_t sample_rate_;
+  int32_t frame_length_;
+  int64_t total_bytes_;
+  int64_t num_samples_;
+  int64_t total_duration_;
+  // Start time and size of the samples that started within the last second
+  std::deque<std::pair<int64_t, int32_t>> window_;
+  int64_t window_bytes_;
+  int64_t max_window_bytes_;
+
+  bool gapless_;
+  int64_t priming_;
+  int64_t padding_;
 };
 
 #endif  // M4A_WRITER_H_
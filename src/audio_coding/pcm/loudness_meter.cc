@@ -0,0 +1,317 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "loudness_meter.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double ToDb(double value, double reference) {
+  return value > 0 ? 20.0 * log10(value / reference) : -HUGE_VAL;
+}
+
+static void PrintJsonNumber(FILE* file, double value) {
+  if (isfinite(value)) {
+    fprintf(file, "%.2f", value);
+  } else {
+    fprintf(file, "null");
+  }
+}
+
+static void PrintJsonString(FILE* file, const char* value) {
+  fputc('"', file);
+  for (const char* c = value; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(file, "\\%c", *c);
+    } else if (static_cast<unsigned char>(*c) < 0x20) {
+      fprintf(file, "\\u%04x", *c);
+    } else {
+      fputc(*c, file);
+    }
+  }
+  fputc('"', file);
+}
+
+LoudnessMeter::LoudnessMeter()
+    : sample_rate_(0),
+      channels_(0),
+      sub_block_length_(0),
+      sub_block_filled_(0),
+      num_sub_blocks_(0),
+      num_samples_(0) {
+  memset(stages_, 0, sizeof(stages_));
+  memset(taps_, 0, sizeof(taps_));
+  memset(states_, 0, sizeof(states_));
+  memset(sub_blocks_, 0, sizeof(sub_blocks_));
+}
+
+LoudnessMeter::~LoudnessMeter() {}
+
+int32_t LoudnessMeter::Init(int32_t sample_rate, int32_t channels) {
+  if (sample_rate < 8000 || channels <= 0 ||
+      channels > LOUDNESS_METER_MAX_CHANNELS) {
+    printf("Invalid param, %d Hz, %d ch(s)\n", sample_rate, channels);
+    return -1;
+  }
+
+  sample_rate_ = sample_rate;
+  channels_ = channels;
+
+  // K-weighting filter of BS.1770 for any sample rate: a high shelf followed
+  // by a high pass, derived from their analog prototypes.
+  double f0 = 1681.974450955533;
+  double gain = 3.999843853973347;
+  double q = 0.7071752369554196;
+  double k = tan(M_PI * f0 / sample_rate);
+  double vh = pow(10.0, gain / 20.0);
+  double vb = pow(vh, 0.4996667741545416);
+  double a0 = 1.0 + k / q + k * k;
+  stages_[0].b0 = (vh + vb * k / q + k * k) / a0;
+  stages_[0].b1 = 2.0 * (k * k - vh) / a0;
+  stages_[0].b2 = (vh - vb * k / q + k * k) / a0;
+  stages_[0].a1 = 2.0 * (k * k - 1.0) / a0;
+  stages_[0].a2 = (1.0 - k / q + k * k) / a0;
+
+  f0 = 38.13547087602444;
+  q = 0.5003270373238773;
+  k = tan(M_PI * f0 / sample_rate);
+  a0 = 1.0 + k / q + k * k;
+  stages_[1].b0 = 1.0;
+  stages_[1].b1 = -2.0;
+  stages_[1].b2 = 1.0;
+  stages_[1].a1 = 2.0 * (k * k - 1.0) / a0;
+  stages_[1].a2 = (1.0 - k / q + k * k) / a0;
+
+  // Blackman windowed sinc interpolator, each phase normalized to unity gain.
+  const int32_t num_taps = PCM_UPSAMPLE4_TAPS * 4;
+  for (int32_t p = 0; p < 4; ++p) {
+    double sum = 0;
+    double phase[PCM_UPSAMPLE4_TAPS];
+    for (int32_t i = 0; i < PCM_UPSAMPLE4_TAPS; ++i) {
+      int32_t n = 4 * i + p;
+      double x = (n - (num_taps - 1) / 2.0) / 4.0;
+      double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+      double window = 0.42 - 0.5 * cos(2.0 * M_PI * n / (num_taps - 1)) +
+                      0.08 * cos(4.0 * M_PI * n / (num_taps - 1));
+      phase[i] = sinc * window;
+      sum += phase[i];
+    }
+    for (int32_t i = 0; i < PCM_UPSAMPLE4_TAPS; ++i) {
+      taps_[4 * i + p] = static_cast<float>(phase[i] / sum);
+    }
+  }
+
+  memset(states_, 0, sizeof(states_));
+  scratch_.assign(PCM_UPSAMPLE4_TAPS - 1 + kChunkSize, 0);
+
+  sub_block_length_ = sample_rate / 10;
+  sub_block_filled_ = 0;
+  memset(sub_blocks_, 0, sizeof(sub_blocks_));
+  num_sub_blocks_ = 0;
+  blocks_.clear();
+  // An hour of gating blocks, to avoid growing on the way.
+  blocks_.reserve(36000);
+  num_samples_ = 0;
+  return 0;
+}
+
+int32_t LoudnessMeter::Process(const uint8_t* data, int32_t size_in_bytes) {
+  if (channels_ == 0 || data == nullptr) {
+    return -1;
+  }
+
+  const int16_t* samples = reinterpret_cast<const int16_t*>(data);
+  int32_t count = size_in_bytes / (2 * channels_);
+  while (count > 0) {
+    int32_t n = sub_block_length_ - sub_block_filled_;
+    if (n > kChunkSize) {
+      n = kChunkSize;
+    }
+    if (n > count) {
+      n = count;
+    }
+
+    ProcessChunk(samples, n);
+    samples += n * channels_;
+    count -= n;
+
+    sub_block_filled_ += n;
+    if (sub_block_filled_ == sub_block_length_) {
+      FinishSubBlock();
+    }
+  }
+  return 0;
+}
+
+void LoudnessMeter::ProcessChunk(const int16_t* samples, int32_t count) {
+  const int32_t history = PCM_UPSAMPLE4_TAPS - 1;
+  float* buf = scratch_.data();
+
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    ChannelState& state = states_[ch];
+
+    memcpy(buf, state.history, sizeof(state.history));
+    for (int32_t i = 0; i < count; ++i) {
+      int32_t sample = samples[i * channels_ + ch];
+      int32_t magnitude = sample < 0 ? -sample : sample;
+      if (magnitude > state.sample_peak) {
+        state.sample_peak = magnitude;
+      }
+      if (sample >= 32767 || sample <= -32768) {
+        state.clipped_samples += 1;
+      }
+      buf[history + i] = sample / 32768.0f;
+    }
+    memcpy(state.history, buf + count, sizeof(state.history));
+
+    float* x = buf + history;
+    float peak = pcm_upsample4_peak_f32(x, count, taps_);
+    if (peak > state.true_peak) {
+      state.true_peak = peak;
+    }
+    state.total_energy += pcm_sum_squares_f32(x, count);
+
+    // K-weighting in place, transposed direct form II.
+    for (int32_t s = 0; s < 2; ++s) {
+      const Biquad& bq = stages_[s];
+      double z1 = state.z1[s];
+      double z2 = state.z2[s];
+      for (int32_t i = 0; i < count; ++i) {
+        double in = x[i];
+        double out = bq.b0 * in + z1;
+        z1 = bq.b1 * in - bq.a1 * out + z2;
+        z2 = bq.b2 * in - bq.a2 * out;
+        x[i] = static_cast<float>(out);
+      }
+      state.z1[s] = z1;
+      state.z2[s] = z2;
+    }
+    state.sub_block_energy += pcm_sum_squares_f32(x, count);
+  }
+
+  num_samples_ += count;
+}
+
+void LoudnessMeter::FinishSubBlock() {
+  // All channel weights are 1.0, surround and LFE channels are not told apart.
+  double energy = 0;
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    energy += states_[ch].sub_block_energy;
+    states_[ch].sub_block_energy = 0;
+  }
+  sub_blocks_[num_sub_blocks_ % 4] = energy / sub_block_length_;
+  num_sub_blocks_ += 1;
+  sub_block_filled_ = 0;
+
+  if (num_sub_blocks_ >= 4) {
+    double block = (sub_blocks_[0] + sub_blocks_[1] + sub_blocks_[2] +
+                    sub_blocks_[3]) /
+                   4.0;
+    blocks_.push_back(block);
+  }
+}
+
+int32_t LoudnessMeter::GetResult(LoudnessResult* result) {
+  if (result == nullptr || channels_ == 0) {
+    return -1;
+  }
+  memset(result, 0, sizeof(*result));
+
+  result->channels = channels_;
+  result->num_samples = num_samples_;
+
+  // Absolute gate at -70 LUFS, then relative gate 10 LU below the mean.
+  const double abs_gate = pow(10.0, (-70.0 + 0.691) / 10.0);
+  double sum = 0;
+  int64_t n = 0;
+  for (double block : blocks_) {
+    if (block > abs_gate) {
+      sum += block;
+      n += 1;
+    }
+  }
+
+  result->integrated_loudness = -HUGE_VAL;
+  if (n > 0) {
+    double rel_gate = sum / n * pow(10.0, -10.0 / 10.0);
+    double gated_sum = 0;
+    int64_t gated_n = 0;
+    for (double block : blocks_) {
+      if (block > abs_gate && block > rel_gate) {
+        gated_sum += block;
+        gated_n += 1;
+      }
+    }
+    if (gated_n > 0) {
+      result->integrated_loudness =
+          -0.691 + 10.0 * log10(gated_sum / gated_n);
+    }
+  }
+
+  result->true_peak = -HUGE_VAL;
+  for (int32_t ch = 0; ch < channels_; ++ch) {
+    const ChannelState& state = states_[ch];
+    // The oversampled peak is never below the sample peak.
+    double peak = state.sample_peak / 32768.0;
+    if (state.true_peak > peak) {
+      peak = state.true_peak;
+    }
+    result->ch_true_peak[ch] = ToDb(peak, 1.0);
+    result->ch_sample_peak[ch] = ToDb(state.sample_peak, 32768.0);
+    result->ch_rms[ch] =
+        num_samples_ > 0 ? ToDb(sqrt(state.total_energy / num_samples_), 1.0)
+                         : -HUGE_VAL;
+    result->ch_clipped_samples[ch] = state.clipped_samples;
+    if (result->ch_true_peak[ch] > result->true_peak) {
+      result->true_peak = result->ch_true_peak[ch];
+    }
+  }
+  return 0;
+}
+
+int32_t LoudnessMeter::WriteReport(const char* filename, const char* source) {
+  LoudnessResult result;
+  if (GetResult(&result)) {
+    return -1;
+  }
+
+  FILE* file = fopen(filename, "w");
+  if (file == nullptr) {
+    printf("Unable to open report file '%s'\n", filename);
+    return -1;
+  }
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"source\": ");
+  PrintJsonString(file, source);
+  fprintf(file, ",\n");
+  fprintf(file, "  \"sample_rate\": %d,\n", sample_rate_);
+  fprintf(file, "  \"channels\": %d,\n", result.channels);
+  fprintf(file, "  \"duration\": %.3f,\n",
+          static_cast<double>(result.num_samples) / sample_rate_);
+  fprintf(file, "  \"integrated_loudness\": ");
+  PrintJsonNumber(file, result.integrated_loudness);
+  fprintf(file, ",\n  \"true_peak\": ");
+  PrintJsonNumber(file, result.true_peak);
+  fprintf(file, ",\n  \"channel\": [\n");
+  for (int32_t ch = 0; ch < result.channels; ++ch) {
+    fprintf(file, "    {\"true_peak\": ");
+    PrintJsonNumber(file, result.ch_true_peak[ch]);
+    fprintf(file, ", \"sample_peak\": ");
+    PrintJsonNumber(file, result.ch_sample_peak[ch]);
+    fprintf(file, ", \"rms\": ");
+    PrintJsonNumber(file, result.ch_rms[ch]);
+    fprintf(file, ", \"clipped_samples\": %lld}%s\n",
+            static_cast<long long>(result.ch_clipped_samples[ch]),
+            ch < result.channels - 1 ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  fclose(file);
+  return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef LOUDNESS_METER_H_
+#define LOUDNESS_METER_H_
+
+#include <stdint.h>
+#include <vector>
+#include "pcm_kernels.h"
+
+#define LOUDNESS_METER_MAX_CHANNELS 8
+
+struct LoudnessResult {
+  int32_t channels;
+  int64_t num_samples;          // samples per channel
+  double integrated_loudness;   // LUFS, -HUGE_VAL if everything is gated
+  double true_peak;             // dBTP, max of all channels
+  double ch_true_peak[LOUDNESS_METER_MAX_CHANNELS];   // dBTP
+  double ch_sample_peak[LOUDNESS_METER_MAX_CHANNELS]; // dBFS
+  double ch_rms[LOUDNESS_METER_MAX_CHANNELS];         // dBFS
+  int64_t ch_clipped_samples[LOUDNESS_METER_MAX_CHANNELS];
+};
+
+// Single pass EBU R128 / ITU-R BS.1770 analysis of 16-bit interleaved PCM:
+// K-weighted gated integrated loudness, 4x oversampled true peak, sample peak,
+// RMS and clipped samples per channel.
+class LoudnessMeter {
+ public:
+  LoudnessMeter();
+  ~LoudnessMeter();
+
+  int32_t Init(int32_t sample_rate, int32_t channels);
+  int32_t Process(const uint8_t* data, int32_t size_in_bytes);
+  int32_t GetResult(LoudnessResult* result);
+  // JSON sidecar
+  int32_t WriteReport(const char* filename, const char* source);
+
+ private:
+  struct Biquad {
+    double b0, b1, b2, a1, a2;
+  };
+
+  struct ChannelState {
+    double z1[2];  // K-weighting states, one pair per stage
+    double z2[2];
+    double sub_block_energy;
+    double total_energy;
+    float true_peak;
+    int32_t sample_peak;
+    int64_t clipped_samples;
+    float history[PCM_UPSAMPLE4_TAPS - 1];
+  };
+
+  void ProcessChunk(const int16_t* samples, int32_t count);
+  void FinishSubBlock();
+
+ private:
+  static const int32_t kChunkSize = 1024;
+
+  int32_t sample_rate_;
+  int32_t channels_;
+  Biquad stages_[2];
+  float taps_[PCM_UPSAMPLE4_TAPS * 4];
+  ChannelState states_[LOUDNESS_METER_MAX_CHANNELS];
+  std::vector<float> scratch_;
+
+  // 400 ms gating blocks overlapped by 75%, i.e. 4 sub-blocks of 100 ms.
+  int32_t sub_block_length_;
+  int32_t sub_block_filled_;
+  double sub_blocks_[4];
+  int64_t num_sub_blocks_;
+  std::vector<double> blocks_;
+  int64_t num_samples_;
+};
+
+#endif  // LOUDNESS_METER_H_
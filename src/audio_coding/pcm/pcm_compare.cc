@@ -0,0 +1,324 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "pcm_compare.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include "pcm_kernels.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Frames below -60 dBFS do not count towards the segmental SNR
+static const double kSilenceMeanSquare = 32768.0 * 32768.0 * 1e-6;
+static const double kSegSnrMin = -10.0;
+static const double kSegSnrMax = 35.0;
+
+static const int32_t kBandEdges[] = {
+    250, 500, 1000, 2000, 4000, 8000, 12000, 16000, 20000,
+};
+
+static double PowerRatioDb(double num, double den) {
+  if (den <= 0) {
+    return num > 0 ? HUGE_VAL : NAN;
+  }
+  return num > 0 ? 10.0 * log10(num / den) : -HUGE_VAL;
+}
+
+PcmComparer::PcmComparer()
+    : sample_rate_(0), channels_(0), num_threads_(1), num_bands_(0) {
+  memset(band_upper_hz_, 0, sizeof(band_upper_hz_));
+}
+
+PcmComparer::~PcmComparer() {}
+
+int32_t PcmComparer::Init(int32_t sample_rate,
+                          int32_t channels,
+                          int32_t num_threads) {
+  if (sample_rate < 8000 || channels <= 0 ||
+      channels > PCM_COMPARE_MAX_CHANNELS) {
+    printf("Invalid param, %d Hz, %d ch(s)\n", sample_rate, channels);
+    return -1;
+  }
+  if (fft_.Init(kFftSize)) {
+    return -1;
+  }
+
+  sample_rate_ = sample_rate;
+  channels_ = channels;
+  num_threads_ = std::max(1, num_threads);
+
+  int32_t nyquist = sample_rate / 2;
+  num_bands_ = 0;
+  for (int32_t edge : kBandEdges) {
+    if (edge >= nyquist) {
+      break;
+    }
+    band_upper_hz_[num_bands_++] = edge;
+  }
+  band_upper_hz_[num_bands_++] = nyquist;
+
+  bin_band_.resize(kFftSize / 2);
+  int32_t band = 0;
+  for (int32_t k = 0; k < kFftSize / 2; ++k) {
+    int64_t hz = static_cast<int64_t>(k) * sample_rate / kFftSize;
+    while (band < num_bands_ - 1 && hz >= band_upper_hz_[band]) {
+      band += 1;
+    }
+    bin_band_[k] = static_cast<int8_t>(band);
+  }
+
+  window_.resize(kFftSize);
+  for (int32_t i = 0; i < kFftSize; ++i) {
+    window_[i] = static_cast<float>(0.5 - 0.5 * cos(2 * M_PI * i / kFftSize));
+  }
+  return 0;
+}
+
+void PcmComparer::DownmixBlock(const int16_t* samples,
+                               int64_t begin,
+                               int64_t end,
+                               int64_t total,
+                               float* out) const {
+  const float scale = 1.0f / (32768.0f * channels_);
+  for (int64_t i = begin; i < end; ++i, ++out) {
+    if (i < 0 || i >= total) {
+      *out = 0;
+      continue;
+    }
+    int32_t sum = 0;
+    for (int32_t c = 0; c < channels_; ++c) {
+      sum += samples[i * channels_ + c];
+    }
+    *out = sum * scale;
+  }
+}
+
+int32_t PcmComparer::FindDelay(const int16_t* ref,
+                               int64_t ref_samples,
+                               const int16_t* test,
+                               int64_t test_samples,
+                               int32_t max_delay,
+                               int32_t* delay,
+                               double* confidence) {
+  if (channels_ == 0 || ref == NULL || test == NULL || delay == NULL ||
+      max_delay < 0 || ref_samples <= 0 || test_samples <= 0) {
+    return -1;
+  }
+
+  // Correlate the loudest block only, its peak is the sharpest and the cost
+  // no longer depends on the file length.
+  int64_t length = std::min<int64_t>(kSearchLength, ref_samples);
+  int64_t start = 0;
+  int64_t hop = std::max<int64_t>(1, length / 2);
+  int64_t best_energy = -1;
+  for (int64_t pos = 0; pos + length <= ref_samples; pos += hop) {
+    int64_t energy = pcm_sum_squares_s16(ref + pos * channels_,
+                                         static_cast<int32_t>(length) *
+                                             channels_);
+    if (energy > best_energy) {
+      best_energy = energy;
+      start = pos;
+    }
+  }
+
+  // Linear correlation of |length| reference samples over 2 * max_delay + 1
+  // lags, padded so the circular FFT product never wraps.
+  int64_t span = length + 2 * static_cast<int64_t>(max_delay);
+  int32_t size = 2;
+  while (size < span) {
+    size <<= 1;
+  }
+  PcmFft fft;
+  if (fft.Init(size)) {
+    return -1;
+  }
+
+  // Reference in the real part, test in the imaginary part, one transform.
+  std::vector<float> re(size, 0.0f);
+  std::vector<float> im(size, 0.0f);
+  DownmixBlock(ref, start, start + length, ref_samples, re.data());
+  DownmixBlock(test, start - max_delay, start + length + max_delay,
+               test_samples, im.data());
+
+  double ref_energy =
+      pcm_sum_squares_f32(re.data(), static_cast<int32_t>(length));
+  std::vector<float> test_block(im.begin(), im.begin() + span);
+
+  fft.Forward(re.data(), im.data());
+  // With Z = FFT(x + iy): X[k] = (Z[k] + Z*[N-k]) / 2 and
+  // Y[k] = (Z[k] - Z*[N-k]) / 2i. The cross spectrum is X*[k] Y[k].
+  std::vector<float> cr(size);
+  std::vector<float> ci(size);
+  for (int32_t k = 0; k < size; ++k) {
+    int32_t n = (size - k) & (size - 1);
+    float xr = 0.5f * (re[k] + re[n]);
+    float xi = 0.5f * (im[k] - im[n]);
+    float yr = 0.5f * (im[k] + im[n]);
+    float yi = -0.5f * (re[k] - re[n]);
+    cr[k] = xr * yr + xi * yi;
+    ci[k] = xr * yi - xi * yr;
+  }
+  fft.Inverse(cr.data(), ci.data());
+
+  int32_t best_lag = 0;
+  for (int32_t k = 1; k <= 2 * max_delay; ++k) {
+    if (cr[k] > cr[best_lag]) {
+      best_lag = k;
+    }
+  }
+
+  *delay = best_lag - max_delay;
+  if (confidence) {
+    double test_energy =
+        pcm_sum_squares_f32(test_block.data() + best_lag,
+                            static_cast<int32_t>(length));
+    double norm = sqrt(ref_energy * test_energy);
+    *confidence = norm > 0 ? cr[best_lag] / norm : 0;
+  }
+  return 0;
+}
+
+void PcmComparer::CompareSegment(const int16_t* ref,
+                                 const int16_t* test,
+                                 int64_t num_samples,
+                                 Partial* partial) const {
+  memset(partial, 0, sizeof(*partial));
+
+  for (int64_t pos = 0; pos < num_samples; pos += kSegFrame) {
+    int32_t count = static_cast<int32_t>(
+        std::min<int64_t>(kSegFrame, num_samples - pos) * channels_);
+    const int16_t* r = ref + pos * channels_;
+    const int16_t* t = test + pos * channels_;
+    int32_t max_abs = 0;
+    int64_t signal = pcm_sum_squares_s16(r, count);
+    int64_t error = pcm_diff_s16(r, t, count, &max_abs);
+
+    partial->signal += signal;
+    partial->error += error;
+    partial->max_abs_err = std::max(partial->max_abs_err, max_abs);
+    if (signal > kSilenceMeanSquare * count) {
+      double seg = error > 0 ? 10.0 * log10(static_cast<double>(signal) / error)
+                             : kSegSnrMax;
+      partial->seg_snr_sum += std::min(kSegSnrMax, std::max(kSegSnrMin, seg));
+      partial->seg_frames += 1;
+    }
+  }
+
+  // Non overlapping Hann windowed blocks, reference and test transformed
+  // together as the real and imaginary parts of one complex input.
+  std::vector<float> re(kFftSize);
+  std::vector<float> im(kFftSize);
+  for (int64_t pos = 0; pos + kFftSize <= num_samples; pos += kFftSize) {
+    for (int32_t c = 0; c < channels_; ++c) {
+      const int16_t* r = ref + pos * channels_ + c;
+      const int16_t* t = test + pos * channels_ + c;
+      for (int32_t i = 0; i < kFftSize; ++i) {
+        re[i] = r[i * channels_] * window_[i];
+        im[i] = t[i * channels_] * window_[i];
+      }
+      fft_.Forward(re.data(), im.data());
+
+      for (int32_t k = 1; k < kFftSize / 2; ++k) {
+        int32_t n = kFftSize - k;
+        double xr = 0.5 * (re[k] + re[n]);
+        double xi = 0.5 * (im[k] - im[n]);
+        double yr = 0.5 * (im[k] + im[n]);
+        double yi = -0.5 * (re[k] - re[n]);
+        int32_t band = bin_band_[k];
+        partial->band_ref[band] += xr * xr + xi * xi;
+        partial->band_test[band] += yr * yr + yi * yi;
+        double er = yr - xr;
+        double ei = yi - xi;
+        partial->band_err[band] += er * er + ei * ei;
+      }
+    }
+  }
+}
+
+int32_t PcmComparer::Compare(const int16_t* ref,
+                             int64_t ref_samples,
+                             const int16_t* test,
+                             int64_t test_samples,
+                             int32_t delay,
+                             PcmCompareResult* result) {
+  if (channels_ == 0 || ref == NULL || test == NULL || result == NULL) {
+    return -1;
+  }
+
+  int64_t ref_start = delay < 0 ? -static_cast<int64_t>(delay) : 0;
+  int64_t test_start = ref_start + delay;
+  int64_t num_samples =
+      std::min(ref_samples - ref_start, test_samples - test_start);
+  if (num_samples <= 0) {
+    printf("No overlap at delay %d\n", delay);
+    return -1;
+  }
+  ref += ref_start * channels_;
+  test += test_start * channels_;
+
+  // Segments are whole FFT blocks so splitting does not change the result
+  int64_t per_thread = (num_samples + num_threads_ - 1) / num_threads_;
+  per_thread = (per_thread + kFftSize - 1) / kFftSize * kFftSize;
+  int32_t num_segments =
+      static_cast<int32_t>((num_samples + per_thread - 1) / per_thread);
+
+  std::vector<Partial> partials(num_segments);
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < num_segments; ++i) {
+    int64_t begin = i * per_thread;
+    int64_t length = std::min(per_thread, num_samples - begin);
+    Partial* partial = &partials[i];
+    auto run = [this, ref, test, begin, length, partial]() {
+      CompareSegment(ref + begin * channels_, test + begin * channels_,
+                     length, partial);
+    };
+    if (i == num_segments - 1) {
+      run();
+    } else {
+      threads.emplace_back(run);
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  Partial total;
+  memset(&total, 0, sizeof(total));
+  for (const Partial& partial : partials) {
+    total.signal += partial.signal;
+    total.error += partial.error;
+    total.max_abs_err = std::max(total.max_abs_err, partial.max_abs_err);
+    total.seg_snr_sum += partial.seg_snr_sum;
+    total.seg_frames += partial.seg_frames;
+    for (int32_t b = 0; b < num_bands_; ++b) {
+      total.band_ref[b] += partial.band_ref[b];
+      total.band_test[b] += partial.band_test[b];
+      total.band_err[b] += partial.band_err[b];
+    }
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->delay = delay;
+  result->num_samples = num_samples;
+  result->snr = PowerRatioDb(static_cast<double>(total.signal),
+                             static_cast<double>(total.error));
+  result->seg_snr =
+      total.seg_frames > 0 ? total.seg_snr_sum / total.seg_frames : NAN;
+  result->max_abs_err = total.max_abs_err;
+  result->num_bands = num_bands_;
+  for (int32_t b = 0; b < num_bands_; ++b) {
+    result->band_upper_hz[b] = band_upper_hz_[b];
+    result->band_snr[b] = PowerRatioDb(total.band_ref[b], total.band_err[b]);
+    result->band_level_diff[b] =
+        total.band_ref[b] > 0 && total.band_test[b] > 0
+            ? 10.0 * log10(total.band_test[b] / total.band_ref[b])
+            : NAN;
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef PCM_COMPARE_H_
+#define PCM_COMPARE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "pcm_fft.h"
+
+#define PCM_COMPARE_MAX_BANDS 10
+#define PCM_COMPARE_MAX_CHANNELS 8
+
+struct PcmCompareResult {
+  int32_t delay;               // samples per channel, test lags reference
+  int64_t num_samples;         // compared samples per channel
+  double snr;                  // dB, HUGE_VAL if identical
+  double seg_snr;              // dB, mean over non silent 1024 sample frames
+  int32_t max_abs_err;
+  int32_t num_bands;
+  int32_t band_upper_hz[PCM_COMPARE_MAX_BANDS];
+  double band_snr[PCM_COMPARE_MAX_BANDS];         // dB
+  double band_level_diff[PCM_COMPARE_MAX_BANDS];  // dB, test - reference
+};
+
+// Compares 16-bit interleaved PCM of a decoded file against its source.
+// The delay between them is found by FFT cross-correlation on the loudest
+// part of the reference; the aligned overlap is then split into segments that
+// are measured in parallel with the pcm_kernels helpers.
+class PcmComparer {
+ public:
+  PcmComparer();
+  ~PcmComparer();
+
+  int32_t Init(int32_t sample_rate, int32_t channels, int32_t num_threads);
+  // Searches |delay| in [-max_delay, max_delay], |confidence| is the
+  // normalized correlation at that lag. Sample counts are per channel.
+  int32_t FindDelay(const int16_t* ref,
+                    int64_t ref_samples,
+                    const int16_t* test,
+                    int64_t test_samples,
+                    int32_t max_delay,
+                    int32_t* delay,
+                    double* confidence);
+  int32_t Compare(const int16_t* ref,
+                  int64_t ref_samples,
+                  const int16_t* test,
+                  int64_t test_samples,
+                  int32_t delay,
+                  PcmCompareResult* result);
+
+ private:
+  struct Partial {
+    int64_t signal;
+    int64_t error;
+    int32_t max_abs_err;
+    double seg_snr_sum;
+    int64_t seg_frames;
+    double band_ref[PCM_COMPARE_MAX_BANDS];
+    double band_test[PCM_COMPARE_MAX_BANDS];
+    double band_err[PCM_COMPARE_MAX_BANDS];
+  };
+
+  void CompareSegment(const int16_t* ref,
+                      const int16_t* test,
+                      int64_t num_samples,
+                      Partial* partial) const;
+  void DownmixBlock(const int16_t* samples,
+                    int64_t begin,
+                    int64_t end,
+                    int64_t total,
+                    float* out) const;
+
+ private:
+  static const int32_t kSegFrame = 1024;
+  static const int32_t kFftSize = 2048;
+  static const int32_t kSearchLength = 1 << 16;
+
+  int32_t sample_rate_;
+  int32_t channels_;
+  int32_t num_threads_;
+  int32_t num_bands_;
+  int32_t band_upper_hz_[PCM_COMPARE_MAX_BANDS];
+  std::vector<int8_t> bin_band_;
+  std::vector<float> window_;
+  PcmFft fft_;
+};
+
+#endif  // PCM_COMPARE_H_
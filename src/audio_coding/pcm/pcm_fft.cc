@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "pcm_fft.h"
+#include <math.h>
+#include <stdio.h>
+#include <utility>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+PcmFft::PcmFft() : size_(0) {}
+
+PcmFft::~PcmFft() {}
+
+int32_t PcmFft::Init(int32_t size) {
+  if (size < 2 || (size & (size - 1)) != 0) {
+    printf("Invalid fft size, %d\n", size);
+    return -1;
+  }
+
+  int32_t bits = 0;
+  while ((1 << bits) < size) {
+    bits += 1;
+  }
+
+  bit_reverse_.resize(size);
+  for (int32_t i = 0; i < size; ++i) {
+    int32_t r = 0;
+    for (int32_t b = 0; b < bits; ++b) {
+      r |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    bit_reverse_[i] = r;
+  }
+
+  cos_.resize(size / 2);
+  sin_.resize(size / 2);
+  for (int32_t i = 0; i < size / 2; ++i) {
+    cos_[i] = static_cast<float>(cos(2 * M_PI * i / size));
+    sin_[i] = static_cast<float>(sin(2 * M_PI * i / size));
+  }
+
+  size_ = size;
+  return 0;
+}
+
+void PcmFft::Forward(float* re, float* im) const {
+  Transform(re, im, -1.0f);
+}
+
+void PcmFft::Inverse(float* re, float* im) const {
+  Transform(re, im, 1.0f);
+  float scale = 1.0f / size_;
+  for (int32_t i = 0; i < size_; ++i) {
+    re[i] *= scale;
+    im[i] *= scale;
+  }
+}
+
+void PcmFft::Transform(float* re, float* im, float sign) const {
+  for (int32_t i = 0; i < size_; ++i) {
+    int32_t r = bit_reverse_[i];
+    if (r > i) {
+      std::swap(re[i], re[r]);
+      std::swap(im[i], im[r]);
+    }
+  }
+
+  for (int32_t half = 1; half < size_; half <<= 1) {
+    int32_t step = size_ / (half * 2);
+    for (int32_t start = 0; start < size_; start += half * 2) {
+      for (int32_t k = 0; k < half; ++k) {
+        float wr = cos_[k * step];
+        float wi = sign * sin_[k * step];
+        int32_t a = start + k;
+        int32_t b = a + half;
+        float tr = re[b] * wr - im[b] * wi;
+        float ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
@@ -0,0 +1,36 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef PCM_FFT_H_
+#define PCM_FFT_H_
+
+#include <stdint.h>
+#include <vector>
+
+// In-place radix-2 complex FFT on split real/imaginary arrays. Twiddles and
+// the bit reversal table are computed once by Init(), so one instance can
+// transform any number of blocks of the same size.
+class PcmFft {
+ public:
+  PcmFft();
+  ~PcmFft();
+
+  // |size| must be a power of 2
+  int32_t Init(int32_t size);
+  void Forward(float* re, float* im) const;
+  // Scaled by 1/size, so Inverse(Forward(x)) == x
+  void Inverse(float* re, float* im) const;
+  int32_t GetSize() const { return size_; }
+
+ private:
+  void Transform(float* re, float* im, float sign) const;
+
+ private:
+  int32_t size_;
+  std::vector<int32_t> bit_reverse_;
+  std::vector<float> cos_;
+  std::vector<float> sin_;
+};
+
+#endif  // PCM_FFT_H_
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "pcm_kernels.h"
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+int64_t pcm_sum_squares_s16(const int16_t* samples, int32_t count) {
+  int64_t sum = 0;
+  int32_t i = 0;
+
+#if defined(__SSE2__)
+  // A pair of (-32768)^2 is 2^31 and only fits in an unsigned 32-bit lane,
+  // so the products are zero extended before accumulating in 64 bits.
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+    __m128i sq = _mm_madd_epi16(x, x);
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+  }
+  int64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+  sum = lanes[0] + lanes[1];
+#elif defined(__aarch64__)
+  int64x2_t acc = vdupq_n_s64(0);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t x = vld1q_s16(samples + i);
+    acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(x), vget_low_s16(x)));
+    acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(x), vget_high_s16(x)));
+  }
+  sum = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+#endif
+
+  for (; i < count; ++i) {
+    sum += static_cast<int32_t>(samples[i]) * samples[i];
+  }
+  return sum;
+}
+
+double pcm_sum_squares_f32(const float* samples, int32_t count) {
+  double sum = 0;
+  int32_t i = 0;
+
+#if defined(__SSE2__)
+  __m128 acc = _mm_setzero_ps();
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(samples + i);
+    acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, acc);
+  sum = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__aarch64__)
+  float32x4_t acc = vdupq_n_f32(0);
+  for (; i + 4 <= count; i += 4) {
+    float32x4_t x = vld1q_f32(samples + i);
+    acc = vmlaq_f32(acc, x, x);
+  }
+  sum = vaddvq_f32(acc);
+#endif
+
+  for (; i < count; ++i) {
+    sum += samples[i] * samples[i];
+  }
+  return sum;
+}
+
+int64_t pcm_diff_s16(const int16_t* ref,
+                     const int16_t* test,
+                     int32_t count,
+                     int32_t* max_abs_diff) {
+  int64_t sum = 0;
+  int32_t max_abs = 0;
+  int32_t i = 0;
+
+#if defined(__SSE2__)
+  // |diff| <= 65535, so diff^2 fits in an unsigned 32x32->64 multiply.
+  __m128i acc = _mm_setzero_si128();
+  __m128i max4 = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ref + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(test + i));
+    __m128i d[2];
+    d[0] = _mm_sub_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(a, a), 16),
+                         _mm_srai_epi32(_mm_unpacklo_epi16(b, b), 16));
+    d[1] = _mm_sub_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(a, a), 16),
+                         _mm_srai_epi32(_mm_unpackhi_epi16(b, b), 16));
+    for (int32_t k = 0; k < 2; ++k) {
+      __m128i sign = _mm_srai_epi32(d[k], 31);
+      __m128i abs = _mm_sub_epi32(_mm_xor_si128(d[k], sign), sign);
+      __m128i gt = _mm_cmpgt_epi32(abs, max4);
+      max4 = _mm_or_si128(_mm_and_si128(gt, abs), _mm_andnot_si128(gt, max4));
+      acc = _mm_add_epi64(acc, _mm_mul_epu32(abs, abs));
+      abs = _mm_srli_epi64(abs, 32);
+      acc = _mm_add_epi64(acc, _mm_mul_epu32(abs, abs));
+    }
+  }
+  int64_t lanes[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+  sum = lanes[0] + lanes[1];
+  int32_t max_lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(max_lanes), max4);
+  for (int32_t k = 0; k < 4; ++k) {
+    max_abs = max_lanes[k] > max_abs ? max_lanes[k] : max_abs;
+  }
+#elif defined(__aarch64__)
+  int64x2_t acc = vdupq_n_s64(0);
+  int32x4_t max4 = vdupq_n_s32(0);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t a = vld1q_s16(ref + i);
+    int16x8_t b = vld1q_s16(test + i);
+    int32x4_t d_lo = vsubl_s16(vget_low_s16(a), vget_low_s16(b));
+    int32x4_t d_hi = vsubl_s16(vget_high_s16(a), vget_high_s16(b));
+    max4 = vmaxq_s32(max4, vabsq_s32(d_lo));
+    max4 = vmaxq_s32(max4, vabsq_s32(d_hi));
+    acc = vmlal_s32(acc, vget_low_s32(d_lo), vget_low_s32(d_lo));
+    acc = vmlal_s32(acc, vget_high_s32(d_lo), vget_high_s32(d_lo));
+    acc = vmlal_s32(acc, vget_low_s32(d_hi), vget_low_s32(d_hi));
+    acc = vmlal_s32(acc, vget_high_s32(d_hi), vget_high_s32(d_hi));
+  }
+  sum = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+  max_abs = vmaxvq_s32(max4);
+#endif
+
+  for (; i < count; ++i) {
+    int32_t diff = static_cast<int32_t>(ref[i]) - test[i];
+    int32_t abs = diff < 0 ? -diff : diff;
+    max_abs = abs > max_abs ? abs : max_abs;
+    sum += static_cast<int64_t>(diff) * diff;
+  }
+
+  if (max_abs_diff) {
+    *max_abs_diff = max_abs;
+  }
+  return sum;
+}
+
+float pcm_upsample4_peak_f32(const float* samples,
+                             int32_t count,
+                             const float* taps) {
+  float peak = 0;
+  int32_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 taps4[PCM_UPSAMPLE4_TAPS];
+  for (int32_t k = 0; k < PCM_UPSAMPLE4_TAPS; ++k) {
+    taps4[k] = _mm_loadu_ps(taps + 4 * k);
+  }
+  __m128 max4 = _mm_setzero_ps();
+  for (; i < count; ++i) {
+    __m128 acc = _mm_setzero_ps();
+    for (int32_t k = 0; k < PCM_UPSAMPLE4_TAPS; ++k) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(samples[i - k]), taps4[k]));
+    }
+    max4 = _mm_max_ps(max4, _mm_and_ps(acc, abs_mask));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, max4);
+  peak = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+#elif defined(__aarch64__)
+  float32x4_t taps4[PCM_UPSAMPLE4_TAPS];
+  for (int32_t k = 0; k < PCM_UPSAMPLE4_TAPS; ++k) {
+    taps4[k] = vld1q_f32(taps + 4 * k);
+  }
+  float32x4_t max4 = vdupq_n_f32(0);
+  for (; i < count; ++i) {
+    float32x4_t acc = vdupq_n_f32(0);
+    for (int32_t k = 0; k < PCM_UPSAMPLE4_TAPS; ++k) {
+      acc = vmlaq_n_f32(acc, taps4[k], samples[i - k]);
+    }
+    max4 = vmaxq_f32(max4, vabsq_f32(acc));
+  }
+  peak = vmaxvq_f32(max4);
+#endif
+
+  for (; i < count; ++i) {
+    for (int32_t p = 0; p < 4; ++p) {
+      float acc = 0;
+      for (int32_t k = 0; k < PCM_UPSAMPLE4_TAPS; ++k) {
+        acc += samples[i - k] * taps[4 * k + p];
+      }
+      peak = fmaxf(peak, fabsf(acc));
+    }
+  }
+  return peak;
+}
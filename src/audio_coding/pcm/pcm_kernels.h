@@ -0,0 +1,38 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef PCM_KERNELS_H_
+#define PCM_KERNELS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PCM_UPSAMPLE4_TAPS 12  // taps per phase
+
+// Sum of squares of |count| 16-bit samples, SSE2/NEON when available.
+int64_t pcm_sum_squares_s16(const int16_t* samples, int32_t count);
+double pcm_sum_squares_f32(const float* samples, int32_t count);
+
+// Sum of squared differences and max absolute difference of |count| 16-bit
+// sample pairs. Differences are exact, they are computed in 32 bits.
+int64_t pcm_diff_s16(const int16_t* ref,
+                     const int16_t* test,
+                     int32_t count,
+                     int32_t* max_abs_diff);
+
+// Max absolute value of |samples| upsampled by 4 with a polyphase FIR.
+// |taps| holds PCM_UPSAMPLE4_TAPS x 4 coefficients, tap major. |samples| must
+// be preceded by PCM_UPSAMPLE4_TAPS - 1 samples of history.
+float pcm_upsample4_peak_f32(const float* samples,
+                             int32_t count,
+                             const float* taps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PCM_KERNELS_H_
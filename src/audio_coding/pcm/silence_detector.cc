@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "silence_detector.h"
+#include <math.h>
+#include <stdio.h>
+#include "pcm_kernels.h"
+
+SilenceDetector::SilenceDetector()
+    : threshold_(0), hangover_(0), hangover_left_(0), last_level_(-200) {}
+
+SilenceDetector::~SilenceDetector() {}
+
+int32_t SilenceDetector::Init(double threshold_dbfs, int32_t hangover) {
+  if (threshold_dbfs > 0 || hangover < 0) {
+    printf("Invalid param, threshold %.1f dBFS, hangover %d\n", threshold_dbfs,
+           hangover);
+    return -1;
+  }
+
+  double amplitude = 32768.0 * pow(10.0, threshold_dbfs / 20.0);
+  threshold_ = amplitude * amplitude;
+  hangover_ = hangover;
+  // Start active, so the encoder is primed before anything is skipped.
+  hangover_left_ = hangover;
+  last_level_ = -200;
+  return 0;
+}
+
+bool SilenceDetector::IsActive(const uint8_t* data, int32_t size_in_bytes) {
+  int32_t count = size_in_bytes / 2;
+  if (count <= 0) {
+    return true;
+  }
+
+  int64_t sum = pcm_sum_squares_s16(reinterpret_cast<const int16_t*>(data),
+                                    count);
+  double mean_square = static_cast<double>(sum) / count;
+  last_level_ = mean_square > 0
+                    ? 10.0 * log10(mean_square / (32768.0 * 32768.0))
+                    : -200;
+
+  if (mean_square >= threshold_) {
+    hangover_left_ = hangover_;
+    return true;
+  }
+
+  if (hangover_left_ > 0) {
+    hangover_left_ -= 1;
+    return true;
+  }
+  return false;
+}
+
+double SilenceDetector::GetLastLevel() const {
+  return last_level_;
+}
@@ -0,0 +1,29 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef SILENCE_DETECTOR_H_
+#define SILENCE_DETECTOR_H_
+
+#include <stdint.h>
+
+// Energy based DTX decision ahead of the encoder. A frame is inactive once its
+// mean energy stays below the threshold for more than |hangover| frames.
+class SilenceDetector {
+ public:
+  SilenceDetector();
+  ~SilenceDetector();
+
+  int32_t Init(double threshold_dbfs, int32_t hangover);
+  // 16-bit interleaved PCM. Returns true if the frame has to be encoded.
+  bool IsActive(const uint8_t* data, int32_t size_in_bytes);
+  double GetLastLevel() const;  // dBFS
+
+ private:
+  double threshold_;  // mean square of a 16-bit sample
+  int32_t hangover_;
+  int32_t hangover_left_;
+  double last_level_;
+};
+
+#endif  // SILENCE_DETECTOR_H_
@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_jitter_buffer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// Frames held at most, a timestamp further away restarts the stream
+static const int32_t kNumSlots = 256;
+// Gain of the jitter estimate, RFC 3550 A.8
+static const double kJitterGain = 1.0 / 16;
+// Delay the target keeps per unit of jitter
+static const double kJitterFactor = 4.0;
+// Pops the buffer level must stay beyond the target before a frame is skipped,
+// reordering alone makes the level swing by a frame or two
+static const int32_t kSkipWindow = 50;
+
+AacJitterBuffer::AacJitterBuffer()
+    : started_(false),
+      base_timestamp_(0),
+      last_timestamp_(-1),
+      next_index_(0),
+      highest_index_(-1),
+      min_level_(INT64_MAX),
+      window_pops_(0),
+      last_arrival_us_(-1),
+      last_transit_us_(0),
+      jitter_us_(0) {
+  memset(&config_, 0, sizeof(config_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+AacJitterBuffer::~AacJitterBuffer() {}
+
+int32_t AacJitterBuffer::Init(const AacJitterBufferConfig& config) {
+  if (config.sample_rate <= 0 || config.frame_length <= 0 ||
+      config.min_delay_ms < 0 || config.max_delay_ms < config.min_delay_ms) {
+    printf("Invalid param\n");
+    return -1;
+  }
+  int64_t max_frames = static_cast<int64_t>(config.max_delay_ms) *
+                       config.sample_rate / 1000 / config.frame_length;
+  if (max_frames >= kNumSlots) {
+    printf("Max delay too long, %d ms\n", config.max_delay_ms);
+    return -1;
+  }
+
+  config_ = config;
+  slots_.clear();
+  slots_.resize(kNumSlots);
+  for (auto& slot : slots_) {
+    slot.index = -1;
+  }
+  started_ = false;
+  last_timestamp_ = -1;
+  last_arrival_us_ = -1;
+  jitter_us_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+  return 0;
+}
+
+void AacJitterBuffer::Reset(int64_t timestamp) {
+  for (auto& slot : slots_) {
+    slot.index = -1;
+  }
+  started_ = false;
+  base_timestamp_ = timestamp;
+  last_timestamp_ = timestamp;
+  next_index_ = 0;
+  highest_index_ = -1;
+  min_level_ = INT64_MAX;
+  window_pops_ = 0;
+  // Transit times of the old stream say nothing about the new one
+  last_arrival_us_ = -1;
+}
+
+int32_t AacJitterBuffer::Put(uint32_t timestamp,
+                             const uint8_t* au,
+                             int32_t size,
+                             int64_t arrival_us,
+                             int64_t send_time_us) {
+  if (slots_.empty() || au == nullptr || size <= 0) {
+    return -1;
+  }
+  stats_.received += 1;
+
+  if (last_timestamp_ < 0) {
+    Reset(timestamp);
+  }
+  uint32_t last = static_cast<uint32_t>(last_timestamp_);
+  int64_t unwrapped = last_timestamp_ + static_cast<int32_t>(timestamp - last);
+  int64_t offset = unwrapped - base_timestamp_;
+  int64_t index = offset >= 0 ? offset / config_.frame_length
+                              : -((-offset + config_.frame_length - 1) /
+                                  config_.frame_length);
+  if (index >= next_index_ + kNumSlots || index < next_index_ - kNumSlots) {
+    stats_.resets += 1;
+    Reset(timestamp);
+    unwrapped = timestamp;
+    index = 0;
+  }
+  last_timestamp_ = std::max(last_timestamp_, unwrapped);
+
+  // Relative transit times, AUs of one packet share the arrival and only
+  // the first one is measured.
+  if (arrival_us != last_arrival_us_) {
+    int64_t transit_us =
+        arrival_us - unwrapped * 1000000 / config_.sample_rate;
+    if (last_arrival_us_ >= 0) {
+      double d = fabs(static_cast<double>(transit_us - last_transit_us_));
+      jitter_us_ += (d - jitter_us_) * kJitterGain;
+    }
+    last_transit_us_ = transit_us;
+    last_arrival_us_ = arrival_us;
+  }
+
+  if (index < next_index_) {
+    stats_.late += 1;
+    return 0;
+  }
+  Slot& slot = slots_[index % kNumSlots];
+  if (slot.index == index) {
+    stats_.duplicates += 1;
+    return 0;
+  }
+  slot.index = index;
+  slot.send_time_us = send_time_us;
+  slot.au.assign(au, au + size);
+  highest_index_ = std::max(highest_index_, index);
+  return 0;
+}
+
+int32_t AacJitterBuffer::TargetFrames() {
+  const double period_us =
+      config_.frame_length * 1000000.0 / config_.sample_rate;
+  double delay_us = std::max(config_.min_delay_ms * 1000.0,
+                             jitter_us_ * kJitterFactor);
+  delay_us = std::min(delay_us, config_.max_delay_ms * 1000.0);
+  return std::max(1, static_cast<int32_t>(ceil(delay_us / period_us)));
+}
+
+int32_t AacJitterBuffer::Pop(uint8_t* au,
+                             int32_t* size,
+                             int64_t* send_time_us) {
+  if (slots_.empty() || au == nullptr || size == nullptr ||
+      send_time_us == nullptr || last_timestamp_ < 0) {
+    return AAC_JITTER_NONE;
+  }
+
+  const int32_t target = TargetFrames();
+  const int64_t level = highest_index_ - next_index_ + 1;
+  if (!started_) {
+    if (level < target) {
+      return AAC_JITTER_NONE;
+    }
+    started_ = true;
+  }
+  min_level_ = std::min(min_level_, level);
+  window_pops_ += 1;
+
+  Slot& slot = slots_[next_index_ % kNumSlots];
+  if (slot.index != next_index_) {
+    if (level <= 0) {
+      // Waiting for the frame is what a longer delay means
+      stats_.underruns += 1;
+      return AAC_JITTER_CONCEAL;
+    }
+    stats_.lost += 1;
+    next_index_ += 1;
+    return AAC_JITTER_CONCEAL;
+  }
+
+  if (static_cast<int32_t>(slot.au.size()) > *size) {
+    // |au| too small, the frame is lost
+    slot.index = -1;
+    stats_.lost += 1;
+    next_index_ += 1;
+    return AAC_JITTER_CONCEAL;
+  }
+  memcpy(au, slot.au.data(), slot.au.size());
+  *size = slot.au.size();
+  *send_time_us = slot.send_time_us;
+  slot.index = -1;
+  next_index_ += 1;
+
+  if (window_pops_ >= kSkipWindow) {
+    const bool skip = min_level_ > target + 1;
+    min_level_ = INT64_MAX;
+    window_pops_ = 0;
+    if (skip) {
+      stats_.skipped += 1;
+      return AAC_JITTER_SKIP;
+    }
+  }
+  return AAC_JITTER_FRAME;
+}
+
+void AacJitterBuffer::GetStats(AacJitterBufferStats* stats) {
+  *stats = stats_;
+  stats->target_frames = TargetFrames();
+  stats->buffered_frames =
+      std::max<int64_t>(0, highest_index_ - next_index_ + 1);
+  stats->jitter_ms = jitter_us_ / 1000.0;
+}
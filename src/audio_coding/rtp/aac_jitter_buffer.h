@@ -0,0 +1,87 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_JITTER_BUFFER_H_
+#define AAC_JITTER_BUFFER_H_
+
+#include <stdint.h>
+#include <vector>
+
+// What Pop() returns for the current frame
+#define AAC_JITTER_NONE 0     // playout not started yet, nothing to output
+#define AAC_JITTER_FRAME 1    // decode the AU and play it
+#define AAC_JITTER_SKIP 2     // decode the AU, drop the PCM and pop again
+#define AAC_JITTER_CONCEAL 3  // the AU is missing, play a concealed frame
+
+struct AacJitterBufferConfig {
+  int32_t sample_rate;   // of the RTP timestamps
+  int32_t frame_length;  // samples per AU
+  int32_t min_delay_ms;
+  int32_t max_delay_ms;
+};
+
+struct AacJitterBufferStats {
+  int64_t received;
+  int64_t duplicates;
+  int64_t late;       // arrived after their frame was played or concealed
+  int64_t lost;       // concealed while later frames were there
+  int64_t underruns;  // concealed on an empty buffer, adds a frame of delay
+  int64_t skipped;    // dropped to bring the delay down
+  int64_t resets;     // timestamp jumps, the stream restarted
+  int32_t target_frames;
+  int32_t buffered_frames;
+  double jitter_ms;  // interarrival jitter of RFC 3550
+};
+
+// Reorders the AUs of an RTP stream by timestamp for a playout clock that
+// pops one frame per frame duration. Playout starts once the target delay is
+// buffered. The target follows four times the interarrival jitter within
+// [min_delay_ms, max_delay_ms]: an underrun conceals a frame without moving
+// on, which adds a frame of delay, and a buffer that stayed beyond the target
+// plus one frame for a while skips a frame to take one away.
+class AacJitterBuffer {
+ public:
+  AacJitterBuffer();
+  ~AacJitterBuffer();
+
+  int32_t Init(const AacJitterBufferConfig& config);
+  // |arrival_us| on the local steady clock, the same for all AUs of a
+  // packet. |send_time_us| is returned with the AU by Pop(), -1 if unknown.
+  int32_t Put(uint32_t timestamp,
+              const uint8_t* au,
+              int32_t size,
+              int64_t arrival_us,
+              int64_t send_time_us);
+  // |size| is the capacity of |au| on input, the AU is copied for
+  // AAC_JITTER_FRAME and AAC_JITTER_SKIP.
+  int32_t Pop(uint8_t* au, int32_t* size, int64_t* send_time_us);
+  void GetStats(AacJitterBufferStats* stats);
+
+ private:
+  struct Slot {
+    int64_t index;  // frame number since the first timestamp, -1 if empty
+    int64_t send_time_us;
+    std::vector<uint8_t> au;
+  };
+
+  void Reset(int64_t timestamp);
+  int32_t TargetFrames();
+
+ private:
+  AacJitterBufferConfig config_;
+  std::vector<Slot> slots_;
+  bool started_;
+  int64_t base_timestamp_;  // unwrapped, of frame 0
+  int64_t last_timestamp_;  // unwrapped, to unwrap the next one
+  int64_t next_index_;      // frame to play next
+  int64_t highest_index_;
+  int64_t min_level_;  // lowest buffer level of the current skip window
+  int32_t window_pops_;
+  int64_t last_arrival_us_;
+  int64_t last_transit_us_;
+  double jitter_us_;
+  AacJitterBufferStats stats_;
+};
+
+#endif  // AAC_JITTER_BUFFER_H_
@@ -0,0 +1,248 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "rtp_aac.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RTP_VERSION 2
+#define RTP_EXT_PROFILE_ONE_BYTE 0xBEDE
+#define RTP_AU_HEADER_SIZE 2
+
+static void WriteBe16(uint8_t* p, uint32_t v) {
+  p[0] = (v >> 8) & 0xFF;
+  p[1] = v & 0xFF;
+}
+
+static void WriteBe32(uint8_t* p, uint32_t v) {
+  WriteBe16(p, v >> 16);
+  WriteBe16(p + 2, v);
+}
+
+static uint32_t ReadBe16(const uint8_t* p) {
+  return (p[0] << 8) | p[1];
+}
+
+static uint32_t ReadBe32(const uint8_t* p) {
+  return (ReadBe16(p) << 16) | ReadBe16(p + 2);
+}
+
+static int32_t HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+int32_t rtp_aac_pack(const struct rtp_aac_packet* packet,
+                     uint8_t* buf,
+                     int32_t buf_size) {
+  if (packet == NULL || buf == NULL || packet->num_aus <= 0 ||
+      packet->num_aus > RTP_AAC_MAX_AUS) {
+    return -1;
+  }
+
+  const bool has_ext = packet->send_time_us >= 0;
+  // Element header, 8 bytes of time, padded to 32 bits
+  const int32_t ext_size = has_ext ? 4 + 12 : 0;
+  int32_t size = RTP_AAC_HEADER_SIZE + ext_size + 2 +
+                 RTP_AU_HEADER_SIZE * packet->num_aus;
+  for (int32_t i = 0; i < packet->num_aus; ++i) {
+    if (packet->au_sizes[i] <= 0 ||
+        packet->au_sizes[i] > RTP_AAC_MAX_AU_SIZE) {
+      return -1;
+    }
+    size += packet->au_sizes[i];
+  }
+  if (size > buf_size) {
+    return -1;
+  }
+
+  uint8_t* p = buf;
+  p[0] = (RTP_VERSION << 6) | (has_ext ? 0x10 : 0);
+  p[1] = ((packet->marker ? 1 : 0) << 7) | (packet->payload_type & 0x7F);
+  WriteBe16(p + 2, packet->seq);
+  WriteBe32(p + 4, packet->timestamp);
+  WriteBe32(p + 8, packet->ssrc);
+  p += RTP_AAC_HEADER_SIZE;
+
+  if (has_ext) {
+    WriteBe16(p, RTP_EXT_PROFILE_ONE_BYTE);
+    WriteBe16(p + 2, 3);
+    p[4] = (RTP_AAC_EXT_SEND_TIME_ID << 4) | (8 - 1);
+    uint64_t send_time = packet->send_time_us;
+    WriteBe32(p + 5, send_time >> 32);
+    WriteBe32(p + 9, send_time);
+    memset(p + 13, 0, 3);
+    p += ext_size;
+  }
+
+  // AU-headers-length counts bits
+  WriteBe16(p, RTP_AU_HEADER_SIZE * 8 * packet->num_aus);
+  p += 2;
+  for (int32_t i = 0; i < packet->num_aus; ++i) {
+    // AU-Index and AU-Index-delta 0, the AUs are consecutive
+    WriteBe16(p, packet->au_sizes[i] << 3);
+    p += RTP_AU_HEADER_SIZE;
+  }
+  for (int32_t i = 0; i < packet->num_aus; ++i) {
+    memcpy(p, packet->aus[i], packet->au_sizes[i]);
+    p += packet->au_sizes[i];
+  }
+  return size;
+}
+
+int32_t rtp_aac_parse(const uint8_t* buf,
+                      int32_t size,
+                      struct rtp_aac_packet* packet) {
+  if (buf == NULL || packet == NULL || size < RTP_AAC_HEADER_SIZE ||
+      (buf[0] >> 6) != RTP_VERSION) {
+    return -1;
+  }
+
+  const int32_t csrc_count = buf[0] & 0x0F;
+  const bool has_ext = (buf[0] & 0x10) != 0;
+  int32_t end = size;
+  if (buf[0] & 0x20) {
+    end -= buf[size - 1];
+  }
+
+  packet->marker = buf[1] >> 7;
+  packet->payload_type = buf[1] & 0x7F;
+  packet->seq = ReadBe16(buf + 2);
+  packet->timestamp = ReadBe32(buf + 4);
+  packet->ssrc = ReadBe32(buf + 8);
+  packet->send_time_us = -1;
+  packet->num_aus = 0;
+
+  int32_t pos = RTP_AAC_HEADER_SIZE + 4 * csrc_count;
+  if (has_ext) {
+    if (pos + 4 > end) {
+      return -1;
+    }
+    const int32_t ext_end = pos + 4 + 4 * ReadBe16(buf + pos + 2);
+    if (ext_end > end) {
+      return -1;
+    }
+    if (ReadBe16(buf + pos) == RTP_EXT_PROFILE_ONE_BYTE) {
+      int32_t i = pos + 4;
+      while (i < ext_end) {
+        int32_t id = buf[i] >> 4;
+        int32_t len = (buf[i] & 0x0F) + 1;
+        if (id == 0) {
+          // Padding
+          i += 1;
+          continue;
+        } else if (id == 15 || i + 1 + len > ext_end) {
+          break;
+        }
+        if (id == RTP_AAC_EXT_SEND_TIME_ID && len == 8) {
+          uint64_t send_time = ReadBe32(buf + i + 1);
+          send_time = (send_time << 32) | ReadBe32(buf + i + 5);
+          packet->send_time_us = send_time;
+        }
+        i += 1 + len;
+      }
+    }
+    pos = ext_end;
+  }
+
+  if (pos + 2 > end) {
+    return -1;
+  }
+  const int32_t headers_bits = ReadBe16(buf + pos);
+  const int32_t num_aus = headers_bits / (RTP_AU_HEADER_SIZE * 8);
+  if (headers_bits % (RTP_AU_HEADER_SIZE * 8) || num_aus <= 0 ||
+      num_aus > RTP_AAC_MAX_AUS) {
+    return -1;
+  }
+  pos += 2;
+  int32_t data_pos = pos + RTP_AU_HEADER_SIZE * num_aus;
+  if (data_pos > end) {
+    return -1;
+  }
+  for (int32_t i = 0; i < num_aus; ++i) {
+    int32_t au_size = ReadBe16(buf + pos + RTP_AU_HEADER_SIZE * i) >> 3;
+    // A fragmented AU is larger than what is left, not supported
+    if (au_size <= 0 || data_pos + au_size > end) {
+      return -1;
+    }
+    packet->aus[i] = buf + data_pos;
+    packet->au_sizes[i] = au_size;
+    data_pos += au_size;
+  }
+  packet->num_aus = num_aus;
+  return 0;
+}
+
+int32_t rtp_aac_format_sdp(int32_t payload_type,
+                           int32_t sample_rate,
+                           int32_t channels,
+                           const uint8_t* conf,
+                           int32_t conf_size,
+                           int32_t port,
+                           char* buf,
+                           int32_t buf_size) {
+  if (conf == NULL || conf_size <= 0 || conf_size > 64 || buf == NULL) {
+    return -1;
+  }
+
+  char conf_hex[64 * 2 + 1] = {0};
+  for (int32_t i = 0; i < conf_size; ++i) {
+    snprintf(conf_hex + i * 2, 3, "%02x", conf[i]);
+  }
+  // The URI of the send time extension is private to these tools
+  int32_t ret = snprintf(
+      buf, buf_size,
+      "v=0\r\n"
+      "o=- 0 0 IN IP4 127.0.0.1\r\n"
+      "s=AAC\r\n"
+      "c=IN IP4 127.0.0.1\r\n"
+      "t=0 0\r\n"
+      "m=audio %d RTP/AVP %d\r\n"
+      "a=rtpmap:%d mpeg4-generic/%d/%d\r\n"
+      "a=fmtp:%d streamtype=5; profile-level-id=15; mode=AAC-hbr; "
+      "config=%s; sizeLength=13; indexLength=3; indexDeltaLength=3\r\n"
+      "a=extmap:%d urn:fdk-aac-example:send-time\r\n",
+      port, payload_type, payload_type, sample_rate, channels, payload_type,
+      conf_hex, RTP_AAC_EXT_SEND_TIME_ID);
+  return (ret > 0 && ret < buf_size) ? 0 : -1;
+}
+
+int32_t rtp_aac_parse_sdp(const char* sdp,
+                          int32_t* payload_type,
+                          uint8_t* conf,
+                          int32_t* conf_size) {
+  if (sdp == NULL || payload_type == NULL || conf == NULL ||
+      conf_size == NULL) {
+    return -1;
+  }
+
+  const char* fmtp = strstr(sdp, "a=fmtp:");
+  if (fmtp == NULL || strstr(fmtp, "mode=AAC-hbr") == NULL) {
+    return -1;
+  }
+  *payload_type = atoi(fmtp + strlen("a=fmtp:"));
+
+  const char* hex = strstr(fmtp, "config=");
+  if (hex == NULL) {
+    return -1;
+  }
+  hex += strlen("config=");
+  int32_t size = 0;
+  while (HexValue(hex[0]) >= 0 && HexValue(hex[1]) >= 0) {
+    if (size == *conf_size) {
+      return -1;
+    }
+    conf[size++] = (HexValue(hex[0]) << 4) | HexValue(hex[1]);
+    hex += 2;
+  }
+  *conf_size = size;
+  return size > 0 ? 0 : -1;
+}
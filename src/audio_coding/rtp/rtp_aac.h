@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef RTP_AAC_H_
+#define RTP_AAC_H_
+
+#include <stdint.h>
+
+// RTP(RFC 3550) carrying raw AAC access units in the AAC-hbr mode of
+// RFC 3640: 13 bits AU size, 3 bits AU index(-delta) per AU header, and AUs
+// of one packet follow each other without gaps.
+#define RTP_AAC_HEADER_SIZE 12
+#define RTP_AAC_MAX_AUS 16
+#define RTP_AAC_MAX_AU_SIZE 8191
+#define RTP_AAC_MAX_PACKET_SIZE 1500
+
+// One-byte header extension(RFC 8285) element with the capture time of the
+// first AU on the steady clock of the sender, in microseconds. Latency is
+// only meaningful when sender and receiver share the clock, i.e. on one host.
+#define RTP_AAC_EXT_SEND_TIME_ID 1
+
+struct rtp_aac_packet {
+  int32_t payload_type;
+  int32_t marker;
+  uint16_t seq;
+  uint32_t timestamp;  // of the first AU, in samples
+  uint32_t ssrc;
+  int64_t send_time_us;  // -1 if absent
+  int32_t num_aus;
+  const uint8_t* aus[RTP_AAC_MAX_AUS];  // point into the packet
+  int32_t au_sizes[RTP_AAC_MAX_AUS];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packs the AUs of |packet| into |buf|, with the send time extension unless
+// send_time_us < 0. Returns the packet size, -1 if it does not fit.
+int32_t rtp_aac_pack(const struct rtp_aac_packet* packet,
+                     uint8_t* buf,
+                     int32_t buf_size);
+// -1 if |buf| is not an RTP packet with AAC-hbr payload
+int32_t rtp_aac_parse(const uint8_t* buf,
+                      int32_t size,
+                      struct rtp_aac_packet* packet);
+// Session description with the rtpmap and fmtp of the stream, the receiver
+// gets the AudioSpecificConfig from it.
+int32_t rtp_aac_format_sdp(int32_t payload_type,
+                           int32_t sample_rate,
+                           int32_t channels,
+                           const uint8_t* conf,
+                           int32_t conf_size,
+                           int32_t port,
+                           char* buf,
+                           int32_t buf_size);
+// |conf_size| is the capacity of |conf| on input
+int32_t rtp_aac_parse_sdp(const char* sdp,
+                          int32_t* payload_type,
+                          uint8_t* conf,
+                          int32_t* conf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // RTP_AAC_H_
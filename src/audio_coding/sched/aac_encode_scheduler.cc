@@ -0,0 +1,444 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "aac_encode_scheduler.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+static const int32_t kDefaultQueueFrames = 4;
+// Frames encoded to measure a new config, the first ones warm the caches
+static const int32_t kCalibrationFrames = 16;
+static const int32_t kCalibrationWarmup = 4;
+// Weight of one frame in the running cost of a config
+static const double kCostAlpha = 1.0 / 64;
+
+static int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool AacEncodeScheduler::ReadyKey::operator<(const ReadyKey& other) const {
+  if (sched_class != other.sched_class) {
+    return sched_class < other.sched_class;
+  }
+  if (deadline_us != other.deadline_us) {
+    return deadline_us < other.deadline_us;
+  }
+  return seq < other.seq;
+}
+
+AacEncodeScheduler::AacEncodeScheduler()
+    : num_cpus_(0), max_load_(0), stop_(false), seq_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+AacEncodeScheduler::~AacEncodeScheduler() {
+  Uninit();
+}
+
+int32_t AacEncodeScheduler::Init(int32_t num_workers,
+                                 bool pin_workers,
+                                 double max_load) {
+  if (num_workers <= 0 || max_load <= 0 || max_load > 1 || !workers_.empty()) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  std::vector<int32_t> cpus;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    for (int32_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpu_set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if (cpus.empty()) {
+    cpus.push_back(0);
+    pin_workers = false;
+  }
+
+  // Workers beyond the CPUs only add context switches, not capacity
+  num_cpus_ = std::min<int32_t>(num_workers, cpus.size());
+  max_load_ = max_load;
+  stop_ = false;
+  for (int32_t i = 0; i < num_workers; ++i) {
+    int32_t cpu = pin_workers ? cpus[i % cpus.size()] : -1;
+    workers_.emplace_back(&AacEncodeScheduler::RunWorker, this, i, cpu);
+  }
+  return 0;
+}
+
+double AacEncodeScheduler::Calibrate(AacEncoder* encoder,
+                                     const AacEncoderConfig& config,
+                                     int32_t frame_length) {
+  const int32_t samples = frame_length * config.channels;
+  std::vector<int16_t> pcm(samples);
+  std::vector<uint8_t> out(std::max(samples * 2, 8192));
+
+  // Noise costs more bits and time than silence, the estimate errs high
+  uint32_t seed = 1;
+  for (int32_t i = 0; i < samples; ++i) {
+    seed = seed * 1664525 + 1013904223;
+    pcm[i] = static_cast<int16_t>(seed >> 16) / 8;
+  }
+
+  int64_t total_us = 0;
+  for (int32_t i = 0; i < kCalibrationFrames; ++i) {
+    int32_t out_size = out.size();
+    int64_t start = NowUs();
+    encoder->GetEncoded(reinterpret_cast<uint8_t*>(pcm.data()), samples * 2,
+                        out.data(), &out_size);
+    if (i >= kCalibrationWarmup) {
+      total_us += NowUs() - start;
+    }
+  }
+  encoder->Reset();
+  return static_cast<double>(total_us) /
+         (kCalibrationFrames - kCalibrationWarmup);
+}
+
+int32_t AacEncodeScheduler::AddSession(const AacSchedSessionConfig& config,
+                                       const AacFrameSink& sink,
+                                       AacEncoderInfo* info) {
+  if ((config.sched_class != AAC_SCHED_CLASS_LIVE &&
+       config.sched_class != AAC_SCHED_CLASS_BATCH) ||
+      config.max_latency_us < 0 || config.queue_frames < 0 || !sink) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  // Opened outside the lock, fdk-aac allocates and initializes a lot
+  std::unique_ptr<Session> session(new Session);
+  AacEncoderInfo encoder_info;
+  session->encoder.reset(new AacEncoder);
+  if (session->encoder->Init(config.encoder_config) ||
+      session->encoder->GetInfo(&encoder_info)) {
+    printf("Init aac encoder failed\n");
+    return -1;
+  }
+
+  const AacEncoderConfig& encoder_config = config.encoder_config;
+  const int32_t queue_frames =
+      config.queue_frames > 0 ? config.queue_frames : kDefaultQueueFrames;
+  session->config = config;
+  session->config.queue_frames = queue_frames;
+  session->sink = sink;
+  session->period_us = static_cast<int64_t>(encoder_info.frame_length) *
+                       1000000 / encoder_config.sample_rate;
+  if (session->config.max_latency_us == 0) {
+    session->config.max_latency_us = session->period_us;
+  }
+  session->frame_bytes =
+      encoder_info.frame_length * encoder_config.channels * 2;
+  session->frames.reset(new uint8_t[queue_frames * session->frame_bytes]);
+  session->sizes.resize(queue_frames);
+  session->deadlines.resize(queue_frames);
+  session->head = 0;
+  session->count = 0;
+  session->out_buf_size = std::max(session->frame_bytes, 8192);
+  session->out_buf.reset(new uint8_t[session->out_buf_size]);
+  session->queued = false;
+  session->running = false;
+  session->removed = false;
+
+  int32_t cost_index = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < costs_.size(); ++i) {
+      if (memcmp(&costs_[i].config, &encoder_config, sizeof(encoder_config)) ==
+          0) {
+        cost_index = i;
+        break;
+      }
+    }
+  }
+  double calibrated_us = 0;
+  if (cost_index < 0) {
+    calibrated_us = Calibrate(session->encoder.get(), encoder_config,
+                              encoder_info.frame_length);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cost_index < 0) {
+    // Another session of the config may have been added meanwhile
+    for (size_t i = 0; i < costs_.size(); ++i) {
+      if (memcmp(&costs_[i].config, &encoder_config, sizeof(encoder_config)) ==
+          0) {
+        cost_index = i;
+        break;
+      }
+    }
+    if (cost_index < 0) {
+      Cost cost;
+      cost.config = encoder_config;
+      cost.frame_us = calibrated_us;
+      costs_.push_back(cost);
+      cost_index = costs_.size() - 1;
+    }
+  }
+  session->cost_index = cost_index;
+
+  if (config.sched_class == AAC_SCHED_CLASS_LIVE) {
+    double load = costs_[cost_index].frame_us / session->period_us;
+    if (LiveLoad() + load > num_cpus_ * max_load_) {
+      stats_.rejected_sessions += 1;
+      return -1;
+    }
+    stats_.live_sessions += 1;
+  } else {
+    stats_.batch_sessions += 1;
+  }
+
+  int32_t session_id = sessions_.size();
+  if (!free_ids_.empty()) {
+    session_id = free_ids_.back();
+    free_ids_.pop_back();
+    sessions_[session_id] = std::move(session);
+  } else {
+    sessions_.push_back(std::move(session));
+  }
+  if (info) {
+    *info = encoder_info;
+  }
+  return session_id;
+}
+
+int32_t AacEncodeScheduler::SubmitFrame(int32_t session_id,
+                                        const uint8_t* pcm,
+                                        int32_t size_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (session_id < 0 || session_id >= static_cast<int32_t>(sessions_.size()) ||
+      sessions_[session_id] == nullptr) {
+    return -1;
+  }
+  Session* session = sessions_[session_id].get();
+  if (session->removed) {
+    // RemoveSession() waits for a running frame with the lock released
+    return -1;
+  }
+  if (size_bytes < 0 || size_bytes > session->frame_bytes ||
+      (size_bytes > 0 && pcm == nullptr)) {
+    return -1;
+  }
+  if (session->count == session->config.queue_frames) {
+    // A full batch queue is only back pressure
+    if (session->config.sched_class == AAC_SCHED_CLASS_LIVE) {
+      stats_.overruns += 1;
+    }
+    return -1;
+  }
+
+  int32_t index =
+      (session->head + session->count) % session->config.queue_frames;
+  if (size_bytes > 0) {
+    memcpy(session->frames.get() + index * session->frame_bytes, pcm,
+           size_bytes);
+  }
+  session->sizes[index] = size_bytes;
+  // Batch frames are due on submission, which orders them first come first
+  // served behind all live frames.
+  int64_t now = NowUs();
+  session->deadlines[index] =
+      session->config.sched_class == AAC_SCHED_CLASS_LIVE
+          ? now + session->config.max_latency_us
+          : now;
+  session->count += 1;
+
+  if (!session->queued && !session->running) {
+    Enqueue(session_id, session);
+    ready_cv_.notify_one();
+  }
+  return 0;
+}
+
+void AacEncodeScheduler::Enqueue(int32_t session_id, Session* session) {
+  ReadyKey key;
+  key.sched_class = session->config.sched_class;
+  key.deadline_us = session->deadlines[session->head];
+  key.seq = seq_++;
+  key.session_id = session_id;
+  session->ready_key = key;
+  session->queued = true;
+  ready_.insert(key);
+}
+
+void AacEncodeScheduler::RunWorker(int32_t index, int32_t cpu) {
+  if (cpu >= 0) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set)) {
+      printf("Pin worker %d to cpu %d failed\n", index, cpu);
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (1) {
+    ready_cv_.wait(lock, [this]() { return stop_ || !ready_.empty(); });
+    if (stop_) {
+      break;
+    }
+
+    ReadyKey key = *ready_.begin();
+    ready_.erase(ready_.begin());
+    Session* session = sessions_[key.session_id].get();
+    session->queued = false;
+    session->running = true;
+
+    // Only the worker touches the head frame, submissions go behind it
+    lock.unlock();
+    int64_t encode_us = 0;
+    int64_t late_us = 0;
+    int32_t ret = EncodeFrame(key.session_id, session, &encode_us, &late_us);
+    lock.lock();
+
+    if (ret) {
+      stats_.errors += 1;
+    } else if (session->sizes[session->head] > 0) {
+      Cost* cost = &costs_[session->cost_index];
+      cost->frame_us += (encode_us - cost->frame_us) * kCostAlpha;
+    }
+    if (session->config.sched_class == AAC_SCHED_CLASS_LIVE) {
+      stats_.live_frames += 1;
+      if (late_us > 0) {
+        stats_.deadline_misses += 1;
+        stats_.max_late_us = std::max(stats_.max_late_us, late_us);
+      }
+    } else {
+      stats_.batch_frames += 1;
+    }
+
+    session->head = (session->head + 1) % session->config.queue_frames;
+    session->count -= 1;
+    session->running = false;
+    if (session->removed) {
+      idle_cv_.notify_all();
+    } else if (session->count > 0) {
+      Enqueue(key.session_id, session);
+    }
+  }
+}
+
+int32_t AacEncodeScheduler::EncodeFrame(int32_t session_id,
+                                        Session* session,
+                                        int64_t* encode_us,
+                                        int64_t* late_us) {
+  AacEncoder* encoder = session->encoder.get();
+  const int32_t size = session->sizes[session->head];
+  const int64_t deadline_us = session->deadlines[session->head];
+  uint8_t* pcm = session->frames.get() + session->head * session->frame_bytes;
+
+  if (size == 0) {
+    // End of stream, the flush returns the frames held back by the delay
+    while (1) {
+      int32_t out_size = session->out_buf_size;
+      if (encoder->GetEncoded(pcm, 0, session->out_buf.get(), &out_size)) {
+        break;
+      }
+      if (out_size > 0) {
+        session->sink(session_id, session->out_buf.get(), out_size, 0);
+      }
+    }
+    encoder->Reset();
+    session->sink(session_id, nullptr, 0, 0);
+    return 0;
+  }
+
+  int32_t out_size = session->out_buf_size;
+  int64_t start = NowUs();
+  int32_t ret =
+      encoder->GetEncoded(pcm, size, session->out_buf.get(), &out_size);
+  int64_t end = NowUs();
+  *encode_us = end - start;
+  if (session->config.sched_class == AAC_SCHED_CLASS_LIVE &&
+      end > deadline_us) {
+    *late_us = end - deadline_us;
+  }
+  if (ret) {
+    AacError error;
+    while (encoder->PopError(&error) == 0) {
+    }
+    return -1;
+  }
+  // The first frames of a stream fill the encoder delay and output nothing
+  if (out_size > 0) {
+    session->sink(session_id, session->out_buf.get(), out_size, *late_us);
+  }
+  return 0;
+}
+
+void AacEncodeScheduler::RemoveSession(int32_t session_id) {
+  std::unique_ptr<Session> session;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (session_id < 0 ||
+        session_id >= static_cast<int32_t>(sessions_.size()) ||
+        sessions_[session_id] == nullptr) {
+      return;
+    }
+    Session* removing = sessions_[session_id].get();
+    removing->removed = true;
+    if (removing->queued) {
+      ready_.erase(removing->ready_key);
+      removing->queued = false;
+    }
+    idle_cv_.wait(lock, [removing]() { return !removing->running; });
+    // The worker may have queued the session again before it saw |removed|
+    if (removing->queued) {
+      ready_.erase(removing->ready_key);
+      removing->queued = false;
+    }
+
+    if (removing->config.sched_class == AAC_SCHED_CLASS_LIVE) {
+      stats_.live_sessions -= 1;
+    } else {
+      stats_.batch_sessions -= 1;
+    }
+    session = std::move(sessions_[session_id]);
+    free_ids_.push_back(session_id);
+  }
+  // The encoder is closed outside the lock
+}
+
+double AacEncodeScheduler::LiveLoad() {
+  double load = 0;
+  for (const auto& session : sessions_) {
+    if (session && session->config.sched_class == AAC_SCHED_CLASS_LIVE) {
+      load += costs_[session->cost_index].frame_us / session->period_us;
+    }
+  }
+  return load;
+}
+
+void AacEncodeScheduler::GetStats(AacSchedStats* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *stats = stats_;
+  stats->live_load = LiveLoad();
+  stats->capacity = num_cpus_ * max_load_;
+}
+
+void AacEncodeScheduler::Uninit() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  ready_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+
+  sessions_.clear();
+  free_ids_.clear();
+  ready_.clear();
+  costs_.clear();
+  memset(&stats_, 0, sizeof(stats_));
+}
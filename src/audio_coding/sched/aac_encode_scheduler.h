@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef AAC_ENCODE_SCHEDULER_H_
+#define AAC_ENCODE_SCHEDULER_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include "aac_encoder.h"
+
+// Live frames are due |max_latency_us| after their submission and always run
+// before batch frames, which are served in submission order.
+#define AAC_SCHED_CLASS_LIVE 0
+#define AAC_SCHED_CLASS_BATCH 1
+
+struct AacSchedSessionConfig {
+  AacEncoderConfig encoder_config;
+  int32_t sched_class;     // AAC_SCHED_CLASS_XXX
+  int32_t max_latency_us;  // live only, 0 means one frame duration
+  int32_t queue_frames;    // pending frames at most, 0 means 4
+};
+
+struct AacSchedStats {
+  int64_t live_sessions;
+  int64_t batch_sessions;
+  int64_t rejected_sessions;  // live sessions refused by admission control
+  int64_t live_frames;
+  int64_t batch_frames;
+  int64_t deadline_misses;  // live frames finished after their deadline
+  int64_t max_late_us;
+  int64_t overruns;  // live frames refused, the session queue was full
+  int64_t errors;    // frames the encoder failed on
+  double live_load;  // admitted live work, in busy workers
+  double capacity;   // live work admitted at most, in busy workers
+};
+
+// Called on a worker thread for every encoded frame of a session. |late_us|
+// is how long a live frame finished after its deadline, 0 if in time. After
+// an end of stream is flushed the sink gets |size| 0. Must not block.
+typedef std::function<void(int32_t session_id,
+                           const uint8_t* data,
+                           int32_t size,
+                           int64_t late_us)>
+    AacFrameSink;
+
+// Runs many AacEncoder sessions on a fixed pool of worker threads instead of
+// a thread per stream. Every session with pending input is queued by the
+// deadline of its oldest frame; a worker takes the earliest one, encodes a
+// single frame and queues the session again, so a frame of a live session
+// waits for at most one frame of batch work per worker.
+//
+// Live sessions are admitted while the sum of their measured cost per frame
+// over their frame duration stays within |max_load| of the workers that can
+// run in parallel. The cost of a config is calibrated on its first session
+// and then follows the encode times of all its sessions.
+class AacEncodeScheduler {
+ public:
+  AacEncodeScheduler();
+  ~AacEncodeScheduler();
+
+  // Workers are pinned round robin to the CPUs the process may run on when
+  // |pin_workers| is set.
+  int32_t Init(int32_t num_workers, bool pin_workers, double max_load);
+  // Session id >= 0, -1 when the encoder can not be opened or a live session
+  // does not fit. |info| may be null.
+  int32_t AddSession(const AacSchedSessionConfig& config,
+                     const AacFrameSink& sink,
+                     AacEncoderInfo* info);
+  // Copies one frame of interleaved PCM, -1 when the session queue is full.
+  // |size_bytes| 0 ends the stream: the encoder is flushed and reset, and the
+  // session may start another stream right after.
+  int32_t SubmitFrame(int32_t session_id,
+                      const uint8_t* pcm,
+                      int32_t size_bytes);
+  // Drops pending frames, waits for a frame being encoded. Not to be called
+  // from a sink.
+  void RemoveSession(int32_t session_id);
+  void GetStats(AacSchedStats* stats);
+  void Uninit();
+
+ private:
+  struct ReadyKey {
+    int32_t sched_class;
+    int64_t deadline_us;
+    int64_t seq;
+    int32_t session_id;
+    bool operator<(const ReadyKey& other) const;
+  };
+
+  struct Session {
+    AacSchedSessionConfig config;
+    AacFrameSink sink;
+    std::unique_ptr<AacEncoder> encoder;
+    int32_t cost_index;  // into costs_
+    int64_t period_us;   // frame duration
+    int32_t frame_bytes;
+    std::unique_ptr<uint8_t[]> frames;  // queue_frames * frame_bytes
+    std::vector<int32_t> sizes;
+    std::vector<int64_t> deadlines;
+    int32_t head;
+    int32_t count;
+    std::unique_ptr<uint8_t[]> out_buf;
+    int32_t out_buf_size;
+    bool queued;  // |ready_key| is in ready_
+    bool running;
+    bool removed;
+    ReadyKey ready_key;
+  };
+
+  struct Cost {
+    AacEncoderConfig config;
+    double frame_us;
+  };
+
+  void RunWorker(int32_t index, int32_t cpu);
+  // Encodes the frame at the head of |session| outside the lock and hands
+  // the output to its sink
+  int32_t EncodeFrame(int32_t session_id,
+                      Session* session,
+                      int64_t* encode_us,
+                      int64_t* late_us);
+  void Enqueue(int32_t session_id, Session* session);
+  double LiveLoad();
+  // Average time per frame of |encoder|, which is reset afterwards
+  double Calibrate(AacEncoder* encoder,
+                   const AacEncoderConfig& config,
+                   int32_t frame_length);
+
+ private:
+  std::vector<std::thread> workers_;
+  int32_t num_cpus_;
+  double max_load_;
+  bool stop_;
+  int64_t seq_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;  // ready_ got an entry, or stop_
+  std::condition_variable idle_cv_;   // a session stopped running
+  std::vector<std::unique_ptr<Session>> sessions_;
+  std::vector<int32_t> free_ids_;
+  std::set<ReadyKey> ready_;
+  std::vector<Cost> costs_;
+  AacSchedStats stats_;
+};
+
+#endif  // AAC_ENCODE_SCHEDULER_H_
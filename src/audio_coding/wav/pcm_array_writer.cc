@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#include "pcm_array_writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string>
+
+#define PCM_ARRAY_NPY_MAGIC "\x93NUMPY"
+#define PCM_ARRAY_NPY_MAGIC_SIZE 6
+// Magic, version and the size of the header dict
+#define PCM_ARRAY_NPY_PREFIX_SIZE 10
+// The data starts aligned to this, as numpy writes it
+#define PCM_ARRAY_NPY_ALIGN 64
+
+// Version 1.0 header of a C order |num_rows| x |channels| array
+static std::string MakeNpyHeader(int32_t sample_type,
+                                 int64_t num_rows,
+                                 int32_t channels) {
+  char dict[128];
+  snprintf(dict, sizeof(dict),
+           "{'descr': '%s', 'fortran_order': False, 'shape': (%lld, %d), }",
+           sample_type == PCM_ARRAY_TYPE_F32 ? "<f4" : "<i2",
+           static_cast<long long>(num_rows), channels);
+
+  // Padded with spaces, and a line break at the end
+  size_t size = PCM_ARRAY_NPY_PREFIX_SIZE + strlen(dict) + 1;
+  size_t padded_size = (size + PCM_ARRAY_NPY_ALIGN - 1) /
+                       PCM_ARRAY_NPY_ALIGN * PCM_ARRAY_NPY_ALIGN;
+  std::string header(PCM_ARRAY_NPY_MAGIC, PCM_ARRAY_NPY_MAGIC_SIZE);
+  uint16_t dict_size = padded_size - PCM_ARRAY_NPY_PREFIX_SIZE;
+  header.push_back(1);
+  header.push_back(0);
+  header.push_back(dict_size & 0xff);
+  header.push_back(dict_size >> 8);
+  header += dict;
+  header.append(padded_size - size, ' ');
+  header.push_back('\n');
+  return header;
+}
+
+PcmArrayWriter::PcmArrayWriter()
+    : fd_(-1),
+      mapping_(nullptr),
+      mapping_size_(0),
+      data_(nullptr),
+      sample_type_(PCM_ARRAY_TYPE_S16),
+      num_rows_(0),
+      channels_(0) {}
+
+PcmArrayWriter::~PcmArrayWriter() {
+  if (fd_ >= 0) {
+    Close();
+  }
+}
+
+int32_t PcmArrayWriter::Open(const char* filename,
+                             int32_t format,
+                             int32_t sample_type,
+                             int64_t num_rows,
+                             int32_t channels) {
+  if (fd_ >= 0 || filename == nullptr ||
+      (format != PCM_ARRAY_FORMAT_RAW && format != PCM_ARRAY_FORMAT_NPY) ||
+      (sample_type != PCM_ARRAY_TYPE_S16 &&
+       sample_type != PCM_ARRAY_TYPE_F32) ||
+      num_rows < 0 || channels <= 0) {
+    printf("Invalid param\n");
+    return -1;
+  }
+
+  sample_type_ = sample_type;
+  num_rows_ = num_rows;
+  channels_ = channels;
+  std::string header;
+  if (format == PCM_ARRAY_FORMAT_NPY) {
+    header = MakeNpyHeader(sample_type, num_rows, channels);
+  }
+  mapping_size_ = header.size() + num_rows * GetRowSize();
+
+  fd_ = open(filename, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    printf("Unable to open '%s', %s\n", filename, strerror(errno));
+    return -1;
+  }
+
+  do {
+    // Allocated now, so that running out of disk fails here rather than
+    // with SIGBUS on a write to the mapping. Without support for it from
+    // the file system, the file is extended sparse.
+    int32_t err = mapping_size_ > 0 ? posix_fallocate(fd_, 0, mapping_size_)
+                                    : 0;
+    if (err == EINVAL || err == EOPNOTSUPP) {
+      err = ftruncate(fd_, mapping_size_) ? errno : 0;
+    }
+    if (err) {
+      printf("Unable to allocate %lld bytes for '%s', %s\n",
+             static_cast<long long>(mapping_size_), filename, strerror(err));
+      break;
+    }
+    if (mapping_size_ == 0) {
+      return 0;
+    }
+
+    void* mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) {
+      printf("mmap failed, %s\n", strerror(errno));
+      break;
+    }
+    mapping_ = static_cast<uint8_t*>(mapping);
+    memcpy(mapping_, header.data(), header.size());
+    data_ = mapping_ + header.size();
+    return 0;
+  } while (0);
+
+  close(fd_);
+  fd_ = -1;
+  unlink(filename);
+  return -1;
+}
+
+int32_t PcmArrayWriter::Write(int64_t row,
+                              const int16_t* pcm,
+                              int32_t num_rows) {
+  if (data_ == nullptr || pcm == nullptr || row < 0 || num_rows < 0 ||
+      row + num_rows > num_rows_) {
+    return -1;
+  }
+
+  int64_t count = static_cast<int64_t>(num_rows) * channels_;
+  uint8_t* dst = data_ + row * GetRowSize();
+  if (sample_type_ == PCM_ARRAY_TYPE_S16) {
+    memcpy(dst, pcm, count * sizeof(int16_t));
+    return 0;
+  }
+
+  // Straight into the mapping, a loop the compiler vectorizes
+  float* samples = reinterpret_cast<float*>(dst);
+  const float scale = 1.0f / 32768;
+  for (int64_t i = 0; i < count; ++i) {
+    samples[i] = pcm[i] * scale;
+  }
+  return 0;
+}
+
+int32_t PcmArrayWriter::GetRowSize() {
+  int32_t sample_size =
+      sample_type_ == PCM_ARRAY_TYPE_F32 ? sizeof(float) : sizeof(int16_t);
+  return sample_size * channels_;
+}
+
+int32_t PcmArrayWriter::Close() {
+  int32_t ret = 0;
+  if (mapping_ != nullptr && munmap(mapping_, mapping_size_)) {
+    printf("munmap failed, %s\n", strerror(errno));
+    ret = -1;
+  }
+  if (fd_ >= 0 && close(fd_)) {
+    printf("close failed, %s\n", strerror(errno));
+    ret = -1;
+  }
+  fd_ = -1;
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  data_ = nullptr;
+  return ret;
+}
@@ -0,0 +1,48 @@
+/**
+ * Copyright (c) 2022 Russell. All rights reserved.
+ */
+
+#ifndef PCM_ARRAY_WRITER_H_
+#define PCM_ARRAY_WRITER_H_
+
+#include <stdint.h>
+
+#define PCM_ARRAY_FORMAT_RAW 0  // samples only
+#define PCM_ARRAY_FORMAT_NPY 1  // NumPy .npy, loadable with mmap_mode
+
+#define PCM_ARRAY_TYPE_S16 0  // int16, little endian
+#define PCM_ARRAY_TYPE_F32 1  // float32 in [-1, 1), little endian
+
+// An array of |num_rows| x |channels| samples in a file that is allocated at
+// its full size up front and mapped for writing. Rows are written in place
+// without locks or I/O calls, so threads may fill disjoint rows of the same
+// array in parallel. Rows never written read as zeros.
+class PcmArrayWriter {
+ public:
+  PcmArrayWriter();
+  ~PcmArrayWriter();
+
+  int32_t Open(const char* filename,
+               int32_t format,
+               int32_t sample_type,
+               int64_t num_rows,
+               int32_t channels);
+  // |num_rows| rows of interleaved 16-bit PCM from |row| on, converted to
+  // the sample type of the array.
+  int32_t Write(int64_t row, const int16_t* pcm, int32_t num_rows);
+  // Bytes of a row
+  int32_t GetRowSize();
+  // Unmaps the array, everything written stays in the file.
+  int32_t Close();
+
+ private:
+  int32_t fd_;
+  uint8_t* mapping_;
+  int64_t mapping_size_;
+  uint8_t* data_;  // row 0, behind the header
+  int32_t sample_type_;
+  int64_t num_rows_;
+  int32_t channels_;
+};
+
+#endif  // PCM_ARRAY_WRITER_H_
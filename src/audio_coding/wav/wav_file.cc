@@ -25,8 +25,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 
 #define WAV_FILE_HEADER_SIZE 44
+// Payload of 'ds64' without a chunk size table, reserved as 'JUNK' in the
+// header so that a file growing past 4 GiB can be turned into RF64 in place.
+#define WAV_FILE_DS64_SIZE 28
+#define WAV_FILE_MAX_RIFF_LENGTH 0xFFFFFFFEu
+// Size of a chunk that is still being streamed
+#define WAV_FILE_UNKNOWN_LENGTH 0xFFFFFFFF
 #define TAG(a, b, c, d) (((a) << 24) | ((b) << 16) | ((c) << 8) | (d))
 
 struct wav_handler {
@@ -37,7 +44,12 @@ struct wav_handler {
   int32_t channels;
   int32_t byte_rate;
   int32_t block_align;
-  int32_t data_length;
+  int64_t data_length;
+  int32_t follow;
+  int32_t seekable;
+  int32_t unbounded;  // data runs until the end of the stream
+  int64_t data_pos;   // file offset of the samples, seekable files only
+  int64_t data_size;  // data_length before any read
 };
 
 static uint32_t read_tag(struct wav_handler* wh) {
@@ -58,6 +70,12 @@ static uint32_t read_uint32(struct wav_handler* wh) {
   return value;
 }
 
+static uint64_t read_uint64(struct wav_handler* wh) {
+  uint64_t value = read_uint32(wh);
+  value |= (uint64_t)read_uint32(wh) << 32;
+  return value;
+}
+
 static uint16_t read_uint16(struct wav_handler* wh) {
   uint16_t value = 0;
   value |= fgetc(wh->wav) << 0;
@@ -65,6 +83,27 @@ static uint16_t read_uint16(struct wav_handler* wh) {
   return value;
 }
 
+static void skip_bytes(struct wav_handler* wh, uint64_t length) {
+  if (wh->seekable) {
+    fseeko(wh->wav, (off_t)length, SEEK_CUR);
+    return;
+  }
+
+  // Pipes can only be read forward
+  char buf[1024];
+  while (length > 0) {
+    size_t n = length < sizeof(buf) ? length : sizeof(buf);
+    if (fread(buf, 1, n, wh->wav) != n) {
+      break;
+    }
+    length -= n;
+  }
+}
+
+static int32_t is_seekable(FILE* file) {
+  return ftello(file) >= 0 && fseeko(file, 0, SEEK_CUR) == 0;
+}
+
 static void write_tag(struct wav_handler* wh, uint32_t tag) {
   fputc((tag & 0xFF000000) >> 24, wh->wav);
   fputc((tag & 0xFF0000) >> 16, wh->wav);
@@ -83,6 +122,11 @@ static void write_uint32(struct wav_handler* wh, uint32_t value) {
   value >>= 8;
 }
 
+static void write_uint64(struct wav_handler* wh, uint64_t value) {
+  write_uint32(wh, (uint32_t)(value & 0xFFFFFFFF));
+  write_uint32(wh, (uint32_t)(value >> 32));
+}
+
 static void write_uint16(struct wav_handler* wh, uint16_t value) {
   fputc(value & 0xFF, wh->wav);
   value >>= 8;
@@ -91,16 +135,46 @@ static void write_uint16(struct wav_handler* wh, uint16_t value) {
 }
 
 static void wav_write_header(struct wav_handler* wh) {
-  int32_t chunk_size = wh->data_length + WAV_FILE_HEADER_SIZE - 8;
   int32_t block_align = (wh->bits_per_sample >> 3) * wh->channels;
   int32_t avg_bytes_per_sec = wh->sample_rate * block_align;
   uint16_t format_code = (wh->bits_per_sample == 16 ? 1 : 3);
+  uint64_t header_size = WAV_FILE_HEADER_SIZE;
+  if (wh->seekable) {
+    header_size += 8 + WAV_FILE_DS64_SIZE;
+  }
+  uint64_t riff_length = wh->data_length + header_size - 8;
+  int32_t rf64 = riff_length > WAV_FILE_MAX_RIFF_LENGTH;
 
-  fseek(wh->wav, 0, SEEK_SET);
+  if (wh->seekable) {
+    fseeko(wh->wav, 0, SEEK_SET);
+  }
+
+  if (!wh->seekable) {
+    // Written once and never rewritten, the reader has to read until EOF.
+    write_tag(wh, TAG('R', 'I', 'F', 'F'));
+    write_uint32(wh, WAV_FILE_UNKNOWN_LENGTH);
+    write_tag(wh, TAG('W', 'A', 'V', 'E'));
+  } else if (rf64) {
+    write_tag(wh, TAG('R', 'F', '6', '4'));
+    write_uint32(wh, WAV_FILE_UNKNOWN_LENGTH);
+    write_tag(wh, TAG('W', 'A', 'V', 'E'));
+    write_tag(wh, TAG('d', 's', '6', '4'));
+    write_uint32(wh, WAV_FILE_DS64_SIZE);
+    write_uint64(wh, riff_length);
+    write_uint64(wh, wh->data_length);
+    write_uint64(wh, block_align > 0 ? wh->data_length / block_align : 0);
+    write_uint32(wh, 0);  // no chunk size table
+  } else {
+    write_tag(wh, TAG('R', 'I', 'F', 'F'));
+    write_uint32(wh, (uint32_t)riff_length);
+    write_tag(wh, TAG('W', 'A', 'V', 'E'));
+    write_tag(wh, TAG('J', 'U', 'N', 'K'));
+    write_uint32(wh, WAV_FILE_DS64_SIZE);
+    for (int32_t i = 0; i < WAV_FILE_DS64_SIZE; ++i) {
+      fputc(0, wh->wav);
+    }
+  }
 
-  write_tag(wh, TAG('R', 'I', 'F', 'F'));
-  write_uint32(wh, chunk_size);
-  write_tag(wh, TAG('W', 'A', 'V', 'E'));
   write_tag(wh, TAG('f', 'm', 't', ' '));
   write_uint32(wh, 16);
   write_uint16(wh, format_code);
@@ -110,7 +184,11 @@ static void wav_write_header(struct wav_handler* wh) {
   write_uint16(wh, block_align);
   write_uint16(wh, wh->bits_per_sample);
   write_tag(wh, TAG('d', 'a', 't', 'a'));
-  write_uint32(wh, wh->data_length);
+  if (!wh->seekable || rf64) {
+    write_uint32(wh, WAV_FILE_UNKNOWN_LENGTH);
+  } else {
+    write_uint32(wh, (uint32_t)wh->data_length);
+  }
 }
 
 void* wav_read_open(const char* filename) {
@@ -120,34 +198,50 @@ void* wav_read_open(const char* filename) {
   }
   memset(wh, 0, sizeof(*wh));
 
-  wh->wav = fopen(filename, "rb");
+  if (strcmp(filename, "-") == 0) {
+    wh->wav = stdin;
+  } else {
+    wh->wav = fopen(filename, "rb");
+  }
   if (wh->wav == NULL) {
     free(wh);
     return NULL;
   }
-
-  long data_pos = 0;
-  while (1) {
+  wh->seekable = is_seekable(wh->wav);
+
+  // Chunks are parsed forward only and parsing stops at the start of the
+  // samples, so the input may be a pipe.
+  off_t data_pos = -1;
+  uint64_t data_length = 0;
+  uint64_t ds64_data_length = 0;
+  int32_t got_ds64 = 0;
+  int32_t got_fmt = 0;
+  while (!got_fmt || data_pos < 0) {
     uint32_t tag = read_tag(wh);
     if (feof(wh->wav)) {
       break;
     }
 
+    // RF64 and BW64 carry the real sizes in 'ds64'
     uint32_t length = read_uint32(wh);
-    if (tag != TAG('R', 'I', 'F', 'F') || length < 4) {
-      fseek(wh->wav, length, SEEK_CUR);
+    int32_t riff = tag == TAG('R', 'I', 'F', 'F') ||
+                   tag == TAG('R', 'F', '6', '4') ||
+                   tag == TAG('B', 'W', '6', '4');
+    if (!riff || length < 4) {
+      skip_bytes(wh, length);
       continue;
     }
 
     uint32_t tag2 = read_tag(wh);
     length -= 4;
     if (tag2 != TAG('W', 'A', 'V', 'E')) {
-      fseek(wh->wav, length, SEEK_CUR);
+      skip_bytes(wh, length);
       continue;
     }
 
-    // RIFF chunk found, iterate through it
-    while (length >= 8) {
+    // RIFF chunk found, iterate through it. A streamed RIFF length is not
+    // trusted, the data chunk ends the header anyway.
+    while (!got_fmt || data_pos < 0) {
       uint32_t subtag, sublength;
       subtag = read_tag(wh);
       if (feof(wh->wav)) {
@@ -155,12 +249,15 @@ void* wav_read_open(const char* filename) {
       }
 
       sublength = read_uint32(wh);
-      length -= 8;
-      if (length < sublength) {
-        break;
-      }
-
-      if (subtag == TAG('f', 'm', 't', ' ')) {
+      if (subtag == TAG('d', 's', '6', '4')) {
+        if (sublength < 24) {
+          break;
+        }
+        read_uint64(wh);  // RIFF size
+        ds64_data_length = read_uint64(wh);
+        got_ds64 = 1;
+        skip_bytes(wh, sublength - 16 + (sublength & 1));
+      } else if (subtag == TAG('f', 'm', 't', ' ')) {
         if (sublength < 16) {
           // Insufficient data for 'fmt '
           break;
@@ -171,32 +268,58 @@ void* wav_read_open(const char* filename) {
         wh->byte_rate = read_uint32(wh);
         wh->block_align = read_uint16(wh);
         wh->bits_per_sample = read_uint16(wh);
-        fseek(wh->wav, sublength - 16, SEEK_CUR);
+        skip_bytes(wh, sublength - 16 + (sublength & 1));
+        got_fmt = 1;
       } else if (subtag == TAG('d', 'a', 't', 'a')) {
-        data_pos = ftell(wh->wav);
-        wh->data_length = sublength;
-        fseek(wh->wav, sublength, SEEK_CUR);
+        data_pos = wh->seekable ? ftello(wh->wav) : 0;
+        data_length = sublength;
+        if (got_ds64 && sublength == WAV_FILE_UNKNOWN_LENGTH) {
+          data_length = ds64_data_length;
+        }
+        if (got_fmt) {
+          break;
+        } else if (!wh->seekable) {
+          // 'fmt ' after the samples can not be reached in a pipe
+          break;
+        }
+        fseeko(wh->wav, (off_t)(data_length + (data_length & 1)), SEEK_CUR);
       } else {
-        fseek(wh->wav, sublength, SEEK_CUR);
+        skip_bytes(wh, sublength + (sublength & 1));
       }
-
-      length -= sublength;
     }
 
-    if (length > 0) {
-      // Bad chunk?
-      fseek(wh->wav, length, SEEK_CUR);
+    if (data_pos >= 0) {
+      break;
     }
   }
 
-  fseek(wh->wav, data_pos, SEEK_SET);
+  if (data_pos >= 0 && wh->seekable) {
+    fseeko(wh->wav, data_pos, SEEK_SET);
+  }
+
+  if (data_pos >= 0 &&
+      (data_length == 0 || data_length == WAV_FILE_UNKNOWN_LENGTH)) {
+    // Written by a streaming writer, or by a recorder that is still running
+    if (wh->seekable) {
+      fseeko(wh->wav, 0, SEEK_END);
+      off_t end = ftello(wh->wav);
+      fseeko(wh->wav, data_pos, SEEK_SET);
+      data_length = (uint64_t)(end - data_pos);
+    } else {
+      wh->unbounded = 1;
+      data_length = 0;
+    }
+  }
+  wh->data_length = (int64_t)data_length;
+  wh->data_pos = (int64_t)data_pos;
+  wh->data_size = (int64_t)data_length;
   return wh;
 }
 
 void wav_read_close(void* obj) {
   struct wav_handler* wh = (struct wav_handler*)obj;
   if (wh != NULL) {
-    if (wh->wav != NULL) {
+    if (wh->wav != NULL && wh->wav != stdin) {
       fclose(wh->wav);
     }
     free(wh);
@@ -208,7 +331,7 @@ int32_t wav_get_header(void* obj,
                        int32_t* sample_rate,
                        int32_t* channels,
                        int32_t* bits_per_sample,
-                       int32_t* data_length) {
+                       int64_t* data_length) {
   struct wav_handler* wh = (struct wav_handler*)obj;
   if (wh == NULL) {
     return -1;
@@ -241,6 +364,14 @@ int32_t wav_read_data(void* obj, void* data, int32_t length) {
   if (wh == NULL || wh->wav == NULL) {
     return -1;
   }
+  if (wh->follow) {
+    // Forget the EOF of the last call, the file may have grown since.
+    clearerr(wh->wav);
+    return (int32_t)fread(data, 1, length, wh->wav);
+  }
+  if (wh->unbounded) {
+    return (int32_t)fread(data, 1, length, wh->wav);
+  }
   if (length > wh->data_length) {
     length = wh->data_length;
   }
@@ -249,6 +380,46 @@ int32_t wav_read_data(void* obj, void* data, int32_t length) {
   return n;
 }
 
+int32_t wav_read_seek(void* obj, int64_t offset) {
+  struct wav_handler* wh = (struct wav_handler*)obj;
+  if (wh == NULL || wh->wav == NULL || !wh->seekable || wh->data_pos < 0 ||
+      offset < 0 || offset > wh->data_size) {
+    return -1;
+  }
+  if (fseeko(wh->wav, (off_t)(wh->data_pos + offset), SEEK_SET) != 0) {
+    return -1;
+  }
+  wh->data_length = wh->data_size - offset;
+  return 0;
+}
+
+void wav_read_set_follow(void* obj, int32_t follow) {
+  struct wav_handler* wh = (struct wav_handler*)obj;
+  if (wh != NULL) {
+    wh->follow = follow;
+  }
+}
+
+static void* wav_write_init(FILE* file,
+                            int32_t sample_rate,
+                            int32_t channels,
+                            int32_t bits_per_sample) {
+  struct wav_handler* wh = (struct wav_handler*)malloc(sizeof(*wh));
+  if (wh == NULL) {
+    return NULL;
+  }
+  memset(wh, 0, sizeof(*wh));
+
+  wh->wav = file;
+  wh->seekable = is_seekable(file);
+  wh->sample_rate = sample_rate;
+  wh->channels = channels;
+  wh->bits_per_sample = bits_per_sample;
+
+  wav_write_header(wh);
+  return wh;
+}
+
 void* wav_write_open(const char* filename,
                      int32_t sample_rate,
                      int32_t channels,
@@ -257,23 +428,34 @@ void* wav_write_open(const char* filename,
     return NULL;
   }
 
-  struct wav_handler* wh = (struct wav_handler*)malloc(sizeof(*wh));
-  if (wh == NULL) {
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) {
     return NULL;
   }
-  memset(wh, 0, sizeof(*wh));
 
-  wh->wav = fopen(filename, "wb");
-  if (wh->wav == NULL) {
-    free(wh);
-    return NULL;
+  void* wh = wav_write_init(file, sample_rate, channels, bits_per_sample);
+  if (wh == NULL) {
+    fclose(file);
   }
+  return wh;
+}
 
-  wh->sample_rate = sample_rate;
-  wh->channels = channels;
-  wh->bits_per_sample = bits_per_sample;
+void* wav_write_open_stream(FILE* file,
+                            int32_t sample_rate,
+                            int32_t channels,
+                            int32_t bits_per_sample) {
+  if (file == NULL) {
+    return NULL;
+  }
 
-  wav_write_header(wh);
+  void* wh = NULL;
+  if (bits_per_sample == 16 || bits_per_sample == 32) {
+    wh = wav_write_init(file, sample_rate, channels, bits_per_sample);
+  }
+  if (wh == NULL) {
+    // Owned from here on, like on success
+    fclose(file);
+  }
   return wh;
 }
 
@@ -281,7 +463,9 @@ void wav_write_close(void* obj) {
   struct wav_handler* wh = (struct wav_handler*)obj;
   if (wh != NULL) {
     if (wh->wav != NULL) {
-      wav_write_header(wh);
+      if (wh->seekable) {
+        wav_write_header(wh);
+      }
       fclose(wh->wav);
     }
     free(wh);
@@ -24,11 +24,14 @@
 #define WAV_FILE_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// "-" reads from stdin. RF64 and BW64 are read as well. A data length of 0
+// or 0xFFFFFFFF in a stream means the samples run until EOF.
 void* wav_read_open(const char* filename);
 void wav_read_close(void* obj);
 int32_t wav_get_header(void* obj,
@@ -36,13 +39,26 @@ int32_t wav_get_header(void* obj,
                        int32_t* sample_rate,
                        int32_t* channels,
                        int32_t* bits_per_sample,
-                       int32_t* data_length);
+                       int64_t* data_length);
 int32_t wav_read_data(void* obj, void* data, int32_t length);
+// Move to |offset| bytes into the samples, files only.
+int32_t wav_read_seek(void* obj, int64_t offset);
+// Ignore the data length of the header and read up to the current end of a
+// file that is still being written, the data chunk has to be the last one.
+void wav_read_set_follow(void* obj, int32_t follow);
 
+// Files that can seek are turned into RF64 on close once they pass 4 GiB.
 void* wav_write_open(const char* filename,
                      int32_t sample_rate,
                      int32_t channels,
                      int32_t bits_per_sample);
+// Write to an already open |file|, which is closed by wav_write_close(), or
+// right away if opening fails. If it can not seek, e.g. a pipe, the header is
+// written once with unknown lengths and never rewritten.
+void* wav_write_open_stream(FILE* file,
+                            int32_t sample_rate,
+                            int32_t channels,
+                            int32_t bits_per_sample);
 void wav_write_close(void* obj);
 int32_t wav_write_data(void* obj, void* data, int32_t length);
 
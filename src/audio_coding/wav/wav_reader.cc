@@ -5,9 +5,22 @@
 #include "wav_reader.h"
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <chrono>
 #include "wav_file.h"
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
 
-WavReader::WavReader() : wav_file_(nullptr) {
+#define WAV_READER_POLL_INTERVAL_MS 10
+
+WavReader::WavReader()
+    : wav_file_(nullptr),
+      follow_(false),
+      writer_closed_(false),
+      idle_timeout_ms_(0),
+      inotify_fd_(-1) {
   memset(&wav_file_info_, 0, sizeof(wav_file_info_));
 }
 
@@ -36,6 +49,7 @@ int32_t WavReader::Open(const char* filename) {
 
   wav_file_ = wav_file;
   wav_file_info_ = info;
+  filename_ = filename;
   return 0;
 }
 
@@ -53,10 +67,123 @@ int32_t WavReader::Read(uint8_t* data, int32_t size_in_bytes) {
   if (wav_file_ == nullptr) {
     return -1;
   }
+  if (follow_) {
+    return ReadFollow(data, size_in_bytes);
+  }
   return wav_read_data(wav_file_, data, size_in_bytes);
 }
 
+int32_t WavReader::Seek(int64_t sample) {
+  int32_t block_align =
+      wav_file_info_.channels * (wav_file_info_.bits_per_sample >> 3);
+  if (wav_file_ == nullptr || sample < 0 || block_align <= 0) {
+    printf("Invalid param, %lld\n", static_cast<long long>(sample));
+    return -1;
+  }
+
+  if (wav_read_seek(wav_file_, sample * block_align)) {
+    printf("Unable to seek to sample %lld of '%s'\n",
+           static_cast<long long>(sample), filename_.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int32_t WavReader::SetFollow(bool follow, int32_t idle_timeout_ms) {
+  if (wav_file_ == nullptr || idle_timeout_ms < 0) {
+    printf("Invalid param, %d\n", idle_timeout_ms);
+    return -1;
+  }
+
+#if defined(__linux__)
+  if (follow && inotify_fd_ < 0) {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ >= 0 &&
+        inotify_add_watch(inotify_fd_, filename_.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+      close(inotify_fd_);
+      inotify_fd_ = -1;
+    }
+    if (inotify_fd_ < 0) {
+      printf("inotify unavailable, polling '%s'\n", filename_.c_str());
+    }
+  }
+#endif
+
+  wav_read_set_follow(wav_file_, follow ? 1 : 0);
+  follow_ = follow;
+  writer_closed_ = false;
+  idle_timeout_ms_ = idle_timeout_ms;
+  return 0;
+}
+
 void WavReader::Close() {
   wav_read_close(wav_file_);
   wav_file_ = nullptr;
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+  }
+  follow_ = false;
+}
+
+int32_t WavReader::ReadFollow(uint8_t* data, int32_t size_in_bytes) {
+  using Clock = std::chrono::steady_clock;
+  auto last_growth = Clock::now();
+  int32_t total = 0;
+  while (total < size_in_bytes) {
+    int32_t n = wav_read_data(wav_file_, data + total, size_in_bytes - total);
+    if (n < 0) {
+      return -1;
+    } else if (n > 0) {
+      total += n;
+      last_growth = Clock::now();
+      continue;
+    }
+
+    int64_t idle_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          Clock::now() - last_growth)
+                          .count();
+    if (writer_closed_ || idle_ms >= idle_timeout_ms_) {
+      break;
+    }
+    WaitForChange(static_cast<int32_t>(idle_timeout_ms_ - idle_ms));
+  }
+
+  // The recording may have stopped in the middle of a sample.
+  int32_t block_align =
+      wav_file_info_.channels * (wav_file_info_.bits_per_sample >> 3);
+  if (block_align > 0) {
+    total -= total % block_align;
+  }
+  return total;
+}
+
+void WavReader::WaitForChange(int32_t timeout_ms) {
+#if defined(__linux__)
+  if (inotify_fd_ >= 0) {
+    struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) {
+      return;
+    }
+
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len = 0;
+    while ((len = read(inotify_fd_, buf, sizeof(buf))) > 0) {
+      for (char* p = buf; p < buf + len;) {
+        struct inotify_event* event = reinterpret_cast<inotify_event*>(p);
+        if (event->mask & IN_CLOSE_WRITE) {
+          writer_closed_ = true;
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    return;
+  }
+#endif
+
+  if (timeout_ms > WAV_READER_POLL_INTERVAL_MS) {
+    timeout_ms = WAV_READER_POLL_INTERVAL_MS;
+  }
+  usleep(timeout_ms * 1000);
 }
@@ -6,13 +6,14 @@
 #define WAV_READER_H_
 
 #include <stdint.h>
+#include <string>
 
 struct WavFileInfo {
   int32_t format;
   int32_t sample_rate;
   int32_t channels;
   int32_t bits_per_sample;
-  int32_t data_length;
+  int64_t data_length;
 };
 
 class WavReader {
@@ -23,11 +24,27 @@ class WavReader {
   int32_t Open(const char* filename);
   int32_t GetInfo(WavFileInfo* info);
   int32_t Read(uint8_t* data, int32_t size_in_bytes);
+  // Continue reading at |sample| per channel, -1 for pipes.
+  int32_t Seek(int64_t sample);
+  // Keep reading a file that another process is still appending to. Read()
+  // then blocks until |size_in_bytes| are available, and returns less only
+  // when the writer has closed the file or it stopped growing for
+  // |idle_timeout_ms|.
+  int32_t SetFollow(bool follow, int32_t idle_timeout_ms);
   void Close();
 
+ private:
+  int32_t ReadFollow(uint8_t* data, int32_t size_in_bytes);
+  void WaitForChange(int32_t timeout_ms);
+
  private:
   void* wav_file_;
   WavFileInfo wav_file_info_;
+  std::string filename_;
+  bool follow_;
+  bool writer_closed_;
+  int32_t idle_timeout_ms_;
+  int32_t inotify_fd_;
 };
 
 #endif  // WAV_READER_H_
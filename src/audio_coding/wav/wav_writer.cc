@@ -29,6 +29,21 @@ int32_t WavWriter::Open(const char* filename,
   return 0;
 }
 
+int32_t WavWriter::Open(FILE* file,
+                        int32_t sample_rate,
+                        int32_t channels,
+                        int32_t bits_per_sample) {
+  void* wav_file =
+      wav_write_open_stream(file, sample_rate, channels, bits_per_sample);
+  if (wav_file == nullptr) {
+    printf("Unable to open wav stream\n");
+    return -1;
+  }
+
+  wav_file_ = wav_file;
+  return 0;
+}
+
 int32_t WavWriter::Write(uint8_t* data, int32_t size_in_bytes) {
   if (wav_file_ == nullptr) {
     return -1;
@@ -6,6 +6,7 @@
 #define WAV_WRITER_H_
 
 #include <stdint.h>
+#include <stdio.h>
 
 class WavWriter {
  public:
@@ -16,6 +17,11 @@ class WavWriter {
                int32_t sample_rate,
                int32_t channels,
                int32_t bits_per_sample);
+  // Takes ownership of |file|, a pipe is written without seeking.
+  int32_t Open(FILE* file,
+               int32_t sample_rate,
+               int32_t channels,
+               int32_t bits_per_sample);
   int32_t Write(uint8_t* data, int32_t size_in_bytes);
   void Close();
 
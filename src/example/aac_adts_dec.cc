@@ -4,6 +4,8 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -11,6 +13,7 @@
 #include "aac_common.h"
 #include "aac_decoder.h"
 #include "args.hxx"
+#include "example_common.h"
 #include "wav_writer.h"
 
 #define AAC_ADTS_HEADER_SIZE 7
@@ -24,7 +27,7 @@ static void PrintDecoderInfo(const char* infile,
          aac_decoder_info.sample_rate, aac_decoder_info.channels,
          aac_decoder_info.bitrate,
          get_aot_name(aac_decoder_info.aot, aac_decoder_info.aot_flags));
-  printf("Output: '%s'\n", outfile);
+  printf("Output: '%s'\n", outfile != nullptr ? outfile : "(none)");
   printf("Frame length: %d samples/channel\n", aac_decoder_info.frame_length);
   printf("Output delay: %u samples/channel\n", aac_decoder_info.output_delay);
   printf("Aac sample rate: %d, aac channels: %d\n",
@@ -33,9 +36,35 @@ static void PrintDecoderInfo(const char* infile,
          encoder_delay);
 }
 
+// Returns the number of corrupted frames among the errors
+static int32_t PrintDecoderErrors(AacDecoder* aac_decoder) {
+  int32_t bad_frames = 0;
+  AacError error;
+  while (aac_decoder->PopError(&error) == 0) {
+    if (error.code == AAC_COMMON_ERROR_DECODE_FRAME) {
+      bad_frames += 1;
+      continue;
+    }
+    printf("%s, %d\n", get_error_name(error.code), error.detail);
+  }
+  return bad_frames;
+}
+
+// Nothing is written if |outfile| is nullptr, for the decoding speed
 static int32_t DecodeAacAdts(const char* infile,
                              const char* outfile,
-                             const int32_t encoder_delay) {
+                             const int32_t encoder_delay,
+                             const AacDecoderConfig& config) {
+  std::unique_ptr<FILE, decltype(&fclose)> out(nullptr, &fclose);
+  if (outfile != nullptr && strcmp(outfile, "-") == 0) {
+    // Before anything is printed
+    out.reset(TakeStdout());
+    if (out == nullptr) {
+      printf("Open stdout failed\n");
+      return -1;
+    }
+  }
+
   auto aac_adts_reader = std::make_unique<AacAdtsReader>();
   int32_t ret = aac_adts_reader->Open(infile);
   if (ret) {
@@ -44,7 +73,7 @@ static int32_t DecodeAacAdts(const char* infile,
   }
 
   auto aac_decoder = std::make_unique<AacDecoder>();
-  ret = aac_decoder->Init(AAC_TRANSPORT_TYPE_ADTS);
+  ret = aac_decoder->Init(config);
   if (ret) {
     printf("Init aac adts decoder failed\n");
     return -1;
@@ -58,20 +87,30 @@ static int32_t DecodeAacAdts(const char* infile,
   int32_t total_delay_in_bytes = 0;
   int32_t pcm_frame_size_in_bytes = 0;
 
+  const int32_t in_buf_capacity = 8192;
+  const int32_t out_buf_capacity = 8 * 2048 * 2;
+  auto in_buf = std::make_unique<uint8_t[]>(in_buf_capacity);
+  auto out_buf = std::make_unique<uint8_t[]>(out_buf_capacity);
+
+  int64_t bad_frames = 0;
+  int64_t decoded_samples = 0;
+  auto start = std::chrono::steady_clock::now();
   while (1) {
-    uint8_t in_buf[8192];
-    int32_t in_buf_size = sizeof(in_buf);
-    ret = aac_adts_reader->ReadOneFrame(in_buf, &in_buf_size);
+    int32_t in_buf_size = in_buf_capacity;
+    ret = aac_adts_reader->ReadOneFrame(in_buf.get(), &in_buf_size);
     if (ret) {
       break;
     }
 
-    uint8_t out_buf[8 * 2048];
-    int32_t out_buf_size = sizeof(out_buf);
-    ret = aac_decoder->GetDecoded(in_buf, in_buf_size, out_buf, &out_buf_size);
+    int32_t out_buf_size = out_buf_capacity;
+    ret = aac_decoder->GetDecoded(in_buf.get(), in_buf_size, out_buf.get(),
+                                  &out_buf_size);
+    bad_frames += PrintDecoderErrors(aac_decoder.get());
     if (ret) {
+      // The frame is lost, decoding goes on with the next one.
       printf("Decode error\n");
-      break;
+      bad_frames += 1;
+      continue;
     } else if (out_buf_size == 0) {
       // not enough bits
       continue;
@@ -86,8 +125,15 @@ static int32_t DecodeAacAdts(const char* infile,
       }
       PrintDecoderInfo(infile, outfile, encoder_delay, aac_decoder_info);
 
-      ret = wav_writer->Open(outfile, aac_decoder_info.sample_rate,
-                             aac_decoder_info.channels, 16);
+      if (outfile == nullptr) {
+        ret = 0;
+      } else if (out) {
+        ret = wav_writer->Open(out.release(), aac_decoder_info.sample_rate,
+                               aac_decoder_info.channels, 16);
+      } else {
+        ret = wav_writer->Open(outfile, aac_decoder_info.sample_rate,
+                               aac_decoder_info.channels, 16);
+      }
       if (ret) {
         printf("Open wav file failed, %s\n", outfile);
         break;
@@ -97,13 +143,17 @@ static int32_t DecodeAacAdts(const char* infile,
       pcm_frame_size_in_bytes =
           aac_decoder_info.frame_length * aac_decoder_info.channels * 2;
     }
+    decoded_samples += aac_decoder_info.frame_length;
+    if (outfile == nullptr) {
+      continue;
+    }
 
     if (total_delay_in_bytes >= pcm_frame_size_in_bytes) {
       total_delay_in_bytes -= pcm_frame_size_in_bytes;
       continue;
     }
 
-    uint8_t* write_buf = out_buf;
+    uint8_t* write_buf = out_buf.get();
     int32_t write_size = pcm_frame_size_in_bytes;
     if (total_delay_in_bytes > 0) {
       write_buf += total_delay_in_bytes;
@@ -114,6 +164,22 @@ static int32_t DecodeAacAdts(const char* infile,
     wav_writer->Write(write_buf, write_size);
   }
 
+  AacAdtsReaderStats stats;
+  aac_adts_reader->GetStats(&stats);
+  printf("Frames: %lld, bad: %lld, resyncs: %lld, skipped: %lld bytes\n",
+         static_cast<long long>(stats.frames),
+         static_cast<long long>(bad_frames),
+         static_cast<long long>(stats.resyncs),
+         static_cast<long long>(stats.skipped_bytes));
+  if (outfile == nullptr && got_stream_info) {
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    double duration =
+        static_cast<double>(decoded_samples) / aac_decoder_info.sample_rate;
+    printf("Decoded %.2f s in %.3f s, %.1fx real time\n", duration, seconds,
+           seconds > 0 ? duration / seconds : 0);
+  }
   return 0;
 }
 
@@ -126,14 +192,26 @@ int main(int argc, char* argv[]) {
   parser.helpParams.addChoices = true;
   parser.helpParams.useValueNameOnce = true;
 
-  args::Positional<std::string> aac_file(parser, "Input", "AAC file",
-                                         args::Options::Required);
-  args::Positional<std::string> wav_file(parser, "Output", "WAV file",
-                                         args::Options::Required);
+  args::Positional<std::string> aac_file(
+      parser, "Input", "AAC file, - for stdin", args::Options::Required);
+  args::Positional<std::string> wav_file(
+      parser, "Output", "WAV file, - for stdout, not needed with --null");
   args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
   args::ValueFlag<int32_t> encoder_delay(
       parser, "delay", "Encoder delay(samples/channel) to prune",
       {'d', "delay"}, 0);
+  args::Flag fast(parser, "fast",
+                  "Fast profile, low power SBR and downmixed to mono, for "
+                  "previews and analytics",
+                  {"fast"});
+  args::ValueFlag<int32_t> max_channels(
+      parser, "max-channels",
+      "Downmix to at most this many channels, 0 for as coded or mono with "
+      "--fast",
+      {"max-channels"}, 0);
+  args::Flag null_output(parser, "null",
+                         "Decode without writing, and report the speed",
+                         {"null"});
 
   bool ret = parser.ParseCLI(argc, argv);
   if (!ret) {
@@ -153,9 +231,22 @@ int main(int argc, char* argv[]) {
   } else if (wav_file.GetError() != args::Error::None) {
     std::cout << wav_file.GetErrorMsg() << std::endl;
     return -1;
+  } else if (!null_output.Get() && wav_file.Get().empty()) {
+    std::cout << "Output is required without --null" << std::endl;
+    return -1;
+  } else if (max_channels.Get() < 0) {
+    std::cout << "Invalid max channels, " << max_channels.Get() << std::endl;
+    return -1;
   }
 
-  DecodeAacAdts(aac_file.Get().c_str(), wav_file.Get().c_str(),
-                encoder_delay.Get());
+  AacDecoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_ADTS;
+  config.conceal_method = AAC_COMMON_CONCEAL_MUTE;
+  config.profile = fast.Get() ? AAC_COMMON_DECODE_PROFILE_FAST
+                              : AAC_COMMON_DECODE_PROFILE_DEFAULT;
+  config.max_output_channels = max_channels.Get();
+  DecodeAacAdts(aac_file.Get().c_str(),
+                null_output.Get() ? nullptr : wav_file.Get().c_str(),
+                encoder_delay.Get(), config);
   return 0;
 }
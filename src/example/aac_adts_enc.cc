@@ -4,24 +4,64 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
 #include "aac_encoder.h"
+#include "aac_telemetry.h"
+#include "aac_verifier.h"
 #include "args.hxx"
+#include "encode_cache.h"
+#include "encode_checkpoint.h"
+#include "example_common.h"
+#include "loudness_meter.h"
+#include "silence_detector.h"
 #include "wav_reader.h"
 
+// Frames encoded past the delay to find the silent frame of DTX
+#define AAC_ADTS_ENC_SILENT_FRAMES 4
+
+struct EncodeOptions {
+  int32_t aot;
+  int32_t bitrate;
+  int32_t bitrate_mode;
+  int32_t preset;
+  bool dtx;
+  double dtx_threshold;    // dBFS
+  int32_t dtx_hangover;    // frames
+  bool analyze;            // loudness and peak report next to the output
+  bool follow;             // input is a recording that is still growing
+  int32_t follow_timeout;  // ms without growth that ends the recording
+  const char* telemetry;   // per-frame log, nullptr for none
+  int32_t checkpoint;      // seconds of audio between checkpoints, 0: none
+  bool verify;             // decode the output while encoding
+  double verify_snr;       // dB, lowest SNR of the decoded output
+};
+
 static void PrintEncoderInfo(const char* infile,
                              const char* outfile,
-                             int32_t aot,
-                             int32_t bitrate,
+                             const EncodeOptions& options,
                              WavFileInfo& wav_file_info,
                              AacEncoderInfo& aac_encoder_info) {
   print_aac_lib_info();
   printf("Input: '%s', %d Hz, %d ch(s), %d bits/sample\n", infile,
          wav_file_info.sample_rate, wav_file_info.channels,
          wav_file_info.bits_per_sample);
-  printf("Output: '%s', %s, %d bps\n", outfile, get_aot_name(aot, 0), bitrate);
+  const char* aot_name = get_aot_name(options.aot, 0);
+  if (options.bitrate_mode == 0) {
+    printf("Output: '%s', %s, CBR %d bps\n", outfile, aot_name,
+           options.bitrate);
+  } else {
+    printf("Output: '%s', %s, VBR mode %d\n", outfile, aot_name,
+           options.bitrate_mode);
+  }
+  printf("Preset: %s\n", get_preset_info(options.preset)->friendly_name);
+  if (options.dtx) {
+    printf("DTX: threshold %.1f dBFS, hangover %d frames\n",
+           options.dtx_threshold, options.dtx_hangover);
+  }
   printf("Frame length: %u samples/channel\n", aac_encoder_info.frame_length);
   printf("Delay: %u samples/channel\n", aac_encoder_info.delay);
   printf("Delay core: %u samples/channel\n", aac_encoder_info.delay_core);
@@ -35,10 +75,138 @@ static void PrintEncoderInfo(const char* infile,
   printf("}\n");
 }
 
+static void PrintEncoderErrors(AacEncoder* aac_encoder, bool* eof) {
+  AacError error;
+  while (aac_encoder->PopError(&error) == 0) {
+    if (error.code == AAC_COMMON_ERROR_ENCODE_EOF) {
+      *eof = true;
+      continue;
+    }
+    printf("%s, %d\n", get_error_name(error.code), error.detail);
+  }
+}
+
+// Digital silence through a second encoder of the same config, the smallest
+// of its first frames. It stands in for the frames DTX skips, so there is
+// still one ADTS frame per frame duration and the timeline is kept.
+static int32_t EncodeSilentFrame(const AacEncoderConfig& config,
+                                 const AacEncoderInfo& info,
+                                 uint8_t* buf,
+                                 int32_t* size) {
+  auto aac_encoder = std::make_unique<AacEncoder>();
+  int32_t ret = aac_encoder->Init(config);
+  if (ret) {
+    printf("Init aac encoder of the silent frame failed\n");
+    return -1;
+  }
+
+  int32_t frame_size_in_bytes = config.channels * 2 * info.frame_length;
+  auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  memset(input_buf.get(), 0, frame_size_in_bytes);
+  int32_t num_frames =
+      (info.delay + info.frame_length - 1) / info.frame_length +
+      AAC_ADTS_ENC_SILENT_FRAMES;
+  int32_t capacity = *size;
+  *size = 0;
+  for (int32_t i = 0; i < num_frames; ++i) {
+    int32_t out_size_bytes = frame_size_in_bytes;
+    ret = aac_encoder->GetEncoded(input_buf.get(), frame_size_in_bytes,
+                                  output_buf.get(), &out_size_bytes);
+    if (ret) {
+      printf("Encode the silent frame failed\n");
+      return -1;
+    }
+    if (out_size_bytes > 0 && out_size_bytes <= capacity &&
+        (*size == 0 || out_size_bytes < *size)) {
+      memcpy(buf, output_buf.get(), out_size_bytes);
+      *size = out_size_bytes;
+    }
+  }
+  return *size > 0 ? 0 : -1;
+}
+
+// The encoder pushes the stats of every frame into |ring|, which is drained
+// into the log after each frame.
+static int32_t StartTelemetry(const char* filename,
+                              const AacEncoderConfig& config,
+                              const AacEncoderInfo& info,
+                              AacEncoder* aac_encoder,
+                              AacTelemetryRing* ring,
+                              AacTelemetryWriter* writer) {
+  AacTelemetryHeader header;
+  header.sample_rate = config.sample_rate;
+  header.channels = config.channels;
+  header.frame_length = info.frame_length;
+  header.aot = config.aot;
+  header.transport_type = config.transport_type;
+  header.bitrate_mode = config.bitrate_mode;
+  header.bitrate = config.bitrate;
+  if (writer->Open(filename, header)) {
+    return -1;
+  }
+
+  if (aac_encoder->SetTelemetry(ring)) {
+    printf("Enable telemetry failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+// The encoded frames are decoded on another thread while encoding goes on.
+static int32_t StartVerifier(const AacEncoderConfig& config,
+                             const AacEncoderInfo& info,
+                             AacVerifier* verifier) {
+  AacVerifierConfig verifier_config;
+  memset(&verifier_config, 0, sizeof(verifier_config));
+  verifier_config.transport_type = config.transport_type;
+  memcpy(verifier_config.conf, info.conf, info.conf_size);
+  verifier_config.conf_size = info.conf_size;
+  verifier_config.sample_rate = config.sample_rate;
+  verifier_config.channels = config.channels;
+  verifier_config.frame_length = info.frame_length;
+  verifier_config.delay = info.delay;
+  verifier_config.downmix = config.aot == AAC_COMMON_AOT_HEv2;
+  if (verifier->Init(verifier_config)) {
+    printf("Init verifier failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+static int32_t FinishVerifier(AacVerifier* verifier, double min_snr) {
+  AacVerifierStats stats;
+  if (verifier->Finish(&stats)) {
+    printf("Verify failed\n");
+    return -1;
+  }
+
+  printf("Verify: %lld frames, %lld decode error(s), SNR %.1f dB over %lld "
+         "samples/channel, delay %d\n",
+         static_cast<long long>(stats.frames),
+         static_cast<long long>(stats.decode_errors), stats.snr,
+         static_cast<long long>(stats.num_samples), stats.delay);
+  if (stats.decode_errors > 0 || stats.num_samples == 0 ||
+      stats.snr < min_snr) {
+    printf("Verify failed, the output does not decode to the input\n");
+    return -1;
+  }
+  return 0;
+}
+
 static int32_t EncodeAacAdts(const char* infile,
                              const char* outfile,
-                             int32_t aot,
-                             int32_t bitrate) {
+                             const EncodeOptions& options) {
+  std::unique_ptr<FILE, decltype(&fclose)> out(nullptr, &fclose);
+  if (strcmp(outfile, "-") == 0) {
+    // Before anything is printed
+    out.reset(TakeStdout());
+    if (out == nullptr) {
+      printf("Open stdout failed\n");
+      return -1;
+    }
+  }
+
   auto wav_reader = std::make_unique<WavReader>();
   int32_t ret = wav_reader->Open(infile);
   if (ret) {
@@ -53,16 +221,71 @@ static int32_t EncodeAacAdts(const char* infile,
     return -1;
   }
 
-  std::unique_ptr<FILE, decltype(&fclose)> out(fopen(outfile, "wb"), &fclose);
+  if (options.follow) {
+    ret = wav_reader->SetFollow(true, options.follow_timeout);
+    if (ret) {
+      printf("Follow wav file failed\n");
+      return -1;
+    }
+  }
+
+  std::unique_ptr<EncodeCheckpoint> checkpoint;
+  EncodeCheckpointState state = {0};
+  bool resume = false;
+  if (options.checkpoint > 0) {
+    EncodeCheckpointParams encode_params;
+    encode_params.format = "aac";
+    encode_params.aot = options.aot;
+    encode_params.bitrate = options.bitrate;
+    encode_params.bitrate_mode = options.bitrate_mode;
+    encode_params.preset = options.preset;
+    encode_params.sample_rate = wav_file_info.sample_rate;
+    encode_params.channels = wav_file_info.channels;
+    encode_params.bits_per_sample = wav_file_info.bits_per_sample;
+    std::string params;
+    ret = EncodeCheckpoint::MakeParams(infile, encode_params, &params);
+    if (ret) {
+      return -1;
+    }
+
+    std::string filename = std::string(outfile) + ".ckpt";
+    checkpoint = std::make_unique<EncodeCheckpoint>();
+    ret = checkpoint->Open(filename.c_str(), params);
+    if (ret) {
+      return -1;
+    }
+
+    resume = checkpoint->Load(&state) == 0;
+    if (resume) {
+      out.reset(EncodeCheckpoint::OpenForResume(outfile, state.output_bytes));
+      if (out == nullptr) {
+        printf("Partial output '%s' is gone, starting over\n", outfile);
+        resume = false;
+      }
+    }
+    if (!resume) {
+      memset(&state, 0, sizeof(state));
+    }
+  }
+
+  if (out == nullptr) {
+    out.reset(fopen(outfile, "wb"));
+  }
   if (out == nullptr) {
     printf("Open output file failed, %s\n", outfile);
     return -1;
   }
 
   auto aac_encoder = std::make_unique<AacEncoder>();
-  ret =
-      aac_encoder->Init(AAC_TRANSPORT_TYPE_ADTS, aot, wav_file_info.sample_rate,
-                        wav_file_info.channels, bitrate);
+  AacEncoderConfig aac_encoder_config = {0};
+  aac_encoder_config.transport_type = AAC_TRANSPORT_TYPE_ADTS;
+  aac_encoder_config.aot = options.aot;
+  aac_encoder_config.sample_rate = wav_file_info.sample_rate;
+  aac_encoder_config.channels = wav_file_info.channels;
+  aac_encoder_config.bitrate = options.bitrate;
+  aac_encoder_config.bitrate_mode = options.bitrate_mode;
+  aac_encoder_config.preset = options.preset;
+  ret = aac_encoder->Init(aac_encoder_config);
   if (ret) {
     printf("Init aac adts encoder failed\n");
     return -1;
@@ -75,8 +298,52 @@ static int32_t EncodeAacAdts(const char* infile,
     return -1;
   }
 
-  PrintEncoderInfo(infile, outfile, aot, bitrate, wav_file_info,
-                   aac_encoder_info);
+  PrintEncoderInfo(infile, outfile, options, wav_file_info, aac_encoder_info);
+
+  // A new encoder goes back a few frames before the checkpoint, and its
+  // output up to the checkpoint is dropped.
+  int32_t drop_frames = 0;
+  if (resume) {
+    int64_t input_sample = 0;
+    EncodeCheckpoint::ResumePoint(
+        state.frames, aac_encoder_info.frame_length, aac_encoder_info.delay,
+        ENCODE_CHECKPOINT_PREROLL_FRAMES, &input_sample, &drop_frames);
+    ret = wav_reader->Seek(input_sample);
+    if (ret) {
+      return -1;
+    }
+    state.input_samples = input_sample;
+    printf("Resume: frame %lld, %d frame(s) of pre-roll from sample %lld\n",
+           static_cast<long long>(state.frames), drop_frames,
+           static_cast<long long>(input_sample));
+  }
+  int64_t checkpoint_frames =
+      std::max<int64_t>(1, static_cast<int64_t>(options.checkpoint) *
+                               wav_file_info.sample_rate /
+                               aac_encoder_info.frame_length);
+  int64_t next_checkpoint = state.frames + checkpoint_frames;
+
+  std::unique_ptr<AacTelemetryRing> telemetry_ring;
+  std::unique_ptr<AacTelemetryWriter> telemetry_writer;
+  if (options.telemetry != nullptr) {
+    telemetry_ring = std::make_unique<AacTelemetryRing>();
+    telemetry_writer = std::make_unique<AacTelemetryWriter>();
+    ret = StartTelemetry(options.telemetry, aac_encoder_config,
+                         aac_encoder_info, aac_encoder.get(),
+                         telemetry_ring.get(), telemetry_writer.get());
+    if (ret) {
+      return -1;
+    }
+  }
+
+  std::unique_ptr<AacVerifier> verifier;
+  if (options.verify) {
+    verifier = std::make_unique<AacVerifier>();
+    ret = StartVerifier(aac_encoder_config, aac_encoder_info, verifier.get());
+    if (ret) {
+      return -1;
+    }
+  }
 
   int32_t frame_size_in_bytes =
       wav_file_info.channels * 2 * aac_encoder_info.frame_length;
@@ -84,25 +351,138 @@ static int32_t EncodeAacAdts(const char* infile,
   auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
   auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
 
+  std::unique_ptr<SilenceDetector> silence_detector;
+  if (options.dtx) {
+    silence_detector = std::make_unique<SilenceDetector>();
+    ret = silence_detector->Init(options.dtx_threshold, options.dtx_hangover);
+    if (ret) {
+      printf("Init silence detector failed\n");
+      return -1;
+    }
+  }
+
+  // Frames skipped by DTX are replaced by an encoded silent frame
+  auto silent_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  int32_t silent_size = frame_size_in_bytes;
+  if (options.dtx) {
+    ret = EncodeSilentFrame(aac_encoder_config, aac_encoder_info,
+                            silent_buf.get(), &silent_size);
+    if (ret) {
+      return -1;
+    }
+  }
+  int64_t num_frames = 0;
+  int64_t num_skipped_frames = 0;
+
+  std::unique_ptr<LoudnessMeter> loudness_meter;
+  if (options.analyze) {
+    loudness_meter = std::make_unique<LoudnessMeter>();
+    ret = loudness_meter->Init(wav_file_info.sample_rate,
+                               wav_file_info.channels);
+    if (ret) {
+      printf("Init loudness meter failed\n");
+      return -1;
+    }
+  }
+
+  int32_t status = 0;
   while (1) {
     int32_t read_bytes = wav_reader->Read(input_buf.get(), frame_size_in_bytes);
     if (read_bytes < 0) {
       printf("Read wav file failed\n");
+      status = -1;
       break;
     }
+    state.input_samples += read_bytes / (wav_file_info.channels * 2);
+    if (verifier) {
+      verifier->PushSource(input_buf.get(), read_bytes);
+    }
+
+    if (loudness_meter) {
+      loudness_meter->Process(input_buf.get(), read_bytes);
+    }
+
+    if (silence_detector && read_bytes > 0) {
+      num_frames += 1;
+      bool active = silence_detector->IsActive(input_buf.get(), read_bytes);
+      if (!active && read_bytes == frame_size_in_bytes) {
+        fwrite(silent_buf.get(), 1, silent_size, out.get());
+        if (options.follow) {
+          fflush(out.get());
+        }
+        num_skipped_frames += 1;
+        continue;
+      }
+    }
 
     int32_t out_size_bytes = frame_size_in_bytes;
     int32_t ret = aac_encoder->GetEncoded(input_buf.get(), read_bytes,
                                           output_buf.get(), &out_size_bytes);
+    if (telemetry_writer) {
+      telemetry_writer->Drain(telemetry_ring.get());
+    }
     if (ret) {
+      // The flushed encoder ends the input with EOF
+      bool eof = false;
+      PrintEncoderErrors(aac_encoder.get(), &eof);
+      if (!eof) {
+        status = -1;
+      }
       break;
     } else if (out_size_bytes == 0) {
       continue;
     }
+    if (verifier) {
+      verifier->PushFrame(output_buf.get(), out_size_bytes);
+    }
+    if (drop_frames > 0) {
+      drop_frames -= 1;
+      continue;
+    }
     fwrite(output_buf.get(), 1, out_size_bytes, out.get());
+    if (options.follow) {
+      // Frames are available to readers of the output right away.
+      fflush(out.get());
+    }
+    state.frames += 1;
+    state.output_bytes += out_size_bytes;
+    if (checkpoint && state.frames >= next_checkpoint) {
+      // A failed checkpoint only costs the work since the last one
+      checkpoint->Save(out.get(), state);
+      next_checkpoint = state.frames + checkpoint_frames;
+    }
   }
 
-  return 0;
+  if (silence_detector) {
+    printf("DTX: %lld of %lld frames skipped\n",
+           static_cast<long long>(num_skipped_frames),
+           static_cast<long long>(num_frames));
+  }
+
+  if (loudness_meter) {
+    std::string report = std::string(outfile) + ".json";
+    if (loudness_meter->WriteReport(report.c_str(), infile) == 0) {
+      printf("Analysis: '%s'\n", report.c_str());
+    }
+  }
+
+  if (verifier && FinishVerifier(verifier.get(), options.verify_snr)) {
+    status = -1;
+  }
+
+  if (checkpoint && status == 0) {
+    checkpoint->Remove();
+  }
+
+  if (telemetry_writer) {
+    if (telemetry_writer->Close()) {
+      status = -1;
+    }
+    printf("Telemetry: '%s', %u records dropped\n", options.telemetry,
+           telemetry_ring->Dropped());
+  }
+
+  return status;
 }
 
 int main(int argc, char* argv[]) {
@@ -113,10 +493,10 @@ int main(int argc, char* argv[]) {
   parser.helpParams.addChoices = true;
   parser.helpParams.useValueNameOnce = true;
 
-  args::Positional<std::string> wav_file(parser, "Input", "WAV file",
-                                         args::Options::Required);
-  args::Positional<std::string> aac_file(parser, "Output", "AAC file",
-                                         args::Options::Required);
+  args::Positional<std::string> wav_file(
+      parser, "Input", "WAV file, - for stdin", args::Options::Required);
+  args::Positional<std::string> aac_file(
+      parser, "Output", "AAC file, - for stdout", args::Options::Required);
   args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
 
   args::MapFlag<std::string, int> aot(
@@ -132,6 +512,56 @@ int main(int argc, char* argv[]) {
 
   args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
                                    {'b', "bitrate"}, 64000);
+  args::ValueFlag<int32_t> bitrate_mode(
+      parser, "mode", "Bitrate mode, 0: CBR, 1~5: VBR(low to high quality)",
+      {'m', "bitrate-mode"}, 0);
+
+  args::MapFlag<std::string, int> preset(
+      parser, "preset", "Speed/quality preset", {'p', "preset"},
+      {{"fast", AAC_COMMON_PRESET_FAST},
+       {"quality", AAC_COMMON_PRESET_QUALITY}},
+      AAC_COMMON_PRESET_DEFAULT);
+  preset.HelpChoices({"fast", "quality"});
+  preset.HelpDefault(get_preset_info(AAC_COMMON_PRESET_DEFAULT)->friendly_name);
+
+  args::Flag dtx(parser, "dtx", "Skip encoding of silent frames", {"dtx"});
+  args::ValueFlag<double> dtx_threshold(parser, "dBFS",
+                                        "Level below which a frame is silent",
+                                        {"dtx-threshold"}, -60.0);
+  args::ValueFlag<int32_t> dtx_hangover(
+      parser, "frames", "Frames still encoded after the level drops",
+      {"dtx-hangover"}, 8);
+  args::Flag analyze(parser, "analyze",
+                     "Write loudness, true peak and RMS to <Output>.json",
+                     {"analyze"});
+  args::Flag follow(parser, "follow",
+                    "Keep encoding while the input is still being written",
+                    {'f', "follow"});
+  args::ValueFlag<int32_t> follow_timeout(
+      parser, "seconds", "End of input once it has not grown for this long",
+      {"follow-timeout"}, 10);
+  args::ValueFlag<std::string> cache_dir(
+      parser, "dir", "Reuse outputs of identical encodes from this directory",
+      {"cache-dir"});
+  args::ValueFlag<int64_t> cache_size(parser, "MB", "Size limit of the cache",
+                                      {"cache-size"}, 1024);
+  args::ValueFlag<std::string> telemetry(
+      parser, "file",
+      "Log bytes, bit reservoir and bitrate of every frame, see "
+      "aac_telemetry_csv",
+      {"telemetry"});
+  args::ValueFlag<int32_t> checkpoint(
+      parser, "seconds",
+      "Save progress to <Output>.ckpt this often, a killed encode run again "
+      "continues from there",
+      {"checkpoint"}, 0);
+  args::Flag verify(parser, "verify",
+                    "Decode the output while encoding, fail on decode errors "
+                    "or a low SNR against the input",
+                    {"verify"});
+  args::ValueFlag<double> verify_snr(parser, "dB",
+                                     "Lowest SNR the output may decode to",
+                                     {"verify-snr"}, 8.0);
 
   bool ret = parser.ParseCLI(argc, argv);
   if (!ret) {
@@ -154,9 +584,99 @@ int main(int argc, char* argv[]) {
   } else if (aot.GetError() != args::Error::None) {
     std::cout << aot.GetErrorMsg() << std::endl;
     return -1;
+  } else if (preset.GetError() != args::Error::None) {
+    std::cout << preset.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (follow_timeout.Get() <= 0) {
+    std::cout << "Invalid follow timeout, " << follow_timeout.Get()
+              << std::endl;
+    return -1;
+  } else if (follow.Get() && wav_file.Get() == "-") {
+    std::cout << "--follow needs a file as input" << std::endl;
+    return -1;
+  } else if (analyze.Get() && aac_file.Get() == "-") {
+    std::cout << "--analyze needs a file as output" << std::endl;
+    return -1;
+  } else if (cache_dir && (wav_file.Get() == "-" || aac_file.Get() == "-")) {
+    std::cout << "--cache-dir needs files as input and output" << std::endl;
+    return -1;
+  } else if (follow.Get() && cache_dir) {
+    std::cout << "--follow can not be used with --cache-dir" << std::endl;
+    return -1;
+  } else if (cache_dir && (verify.Get() || telemetry)) {
+    // A cache hit does not encode, there is nothing to verify or log
+    std::cout << "--cache-dir can not be used with --verify or --telemetry"
+              << std::endl;
+    return -1;
+  } else if (cache_size.Get() <= 0) {
+    std::cout << "Invalid cache size, " << cache_size.Get() << std::endl;
+    return -1;
+  } else if (bitrate_mode.Get() < 0 || bitrate_mode.Get() > 5) {
+    std::cout << "Invalid bitrate mode, " << bitrate_mode.Get() << std::endl;
+    return -1;
+  } else if (checkpoint.Get() < 0) {
+    std::cout << "Invalid checkpoint interval, " << checkpoint.Get()
+              << std::endl;
+    return -1;
+  } else if (checkpoint.Get() > 0 &&
+             (wav_file.Get() == "-" || aac_file.Get() == "-")) {
+    std::cout << "--checkpoint needs files as input and output" << std::endl;
+    return -1;
+  } else if (checkpoint.Get() > 0 &&
+             (dtx.Get() || analyze.Get() || follow.Get() || cache_dir)) {
+    std::cout << "--checkpoint can not be used with --dtx, --analyze, "
+                 "--follow or --cache-dir"
+              << std::endl;
+    return -1;
+  } else if (verify.Get() && (dtx.Get() || checkpoint.Get() > 0)) {
+    // A resumed encode has not seen the input before the checkpoint
+    std::cout << "--verify can not be used with --dtx or --checkpoint"
+              << std::endl;
+    return -1;
   }
 
-  EncodeAacAdts(wav_file.Get().c_str(), aac_file.Get().c_str(), aot.Get(),
-                bitrate.Get());
-  return 0;
+  EncodeOptions options;
+  options.aot = aot.Get();
+  options.bitrate = bitrate.Get();
+  options.bitrate_mode = bitrate_mode.Get();
+  options.preset = preset.Get();
+  options.dtx = dtx.Get();
+  options.dtx_threshold = dtx_threshold.Get();
+  options.dtx_hangover = dtx_hangover.Get();
+  options.analyze = analyze.Get();
+  options.follow = follow.Get();
+  options.follow_timeout = follow_timeout.Get() * 1000;
+  options.telemetry = telemetry ? telemetry.Get().c_str() : nullptr;
+  options.checkpoint = checkpoint.Get();
+  options.verify = verify.Get();
+  options.verify_snr = verify_snr.Get();
+
+  const char* infile = wav_file.Get().c_str();
+  const char* outfile = aac_file.Get().c_str();
+  int32_t status = 0;
+  auto encode_cache = std::make_unique<EncodeCache>();
+  if (cache_dir && encode_cache->Open(cache_dir.Get().c_str(),
+                                      cache_size.Get() * 1024 * 1024) == 0) {
+    EncodeCacheParams params;
+    params.format = "aac";
+    params.aot = options.aot;
+    params.bitrate = options.bitrate;
+    params.bitrate_mode = options.bitrate_mode;
+    params.preset = options.preset;
+    params.dtx = options.dtx;
+    params.dtx_threshold = options.dtx_threshold;
+    params.dtx_hangover = options.dtx_hangover;
+    std::string report = std::string(outfile) + ".json";
+
+    // The report is written by the hashing pass of the cache
+    EncodeOptions encode_options = options;
+    encode_options.analyze = false;
+    status = encode_cache->Encode(
+        infile, outfile, params, options.analyze ? report.c_str() : nullptr,
+        [&]() { return EncodeAacAdts(infile, outfile, encode_options); });
+  } else {
+    status = EncodeAacAdts(infile, outfile, options);
+  }
+  // A failed encode, or one that did not verify, fails the job
+  return status;
 }
@@ -0,0 +1,504 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_adts_reader.h"
+#include "aac_common.h"
+#include "aac_decoder.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "pcm_array_writer.h"
+
+#define AAC_BATCH_DEC_MAX_FRAME_SIZE 8192
+#define AAC_BATCH_DEC_OUT_BUF_SIZE (8 * 2048 * 2)
+// Frames fed to the decoder at most for the stream info of a clip
+#define AAC_BATCH_DEC_SCAN_FRAMES 8
+
+struct BatchOptions {
+  AacDecoderConfig config;
+  int32_t encoder_delay;  // samples per channel, pruned from every clip
+  int32_t format;         // PCM_ARRAY_FORMAT_XXX
+  int32_t sample_type;    // PCM_ARRAY_TYPE_XXX
+  int64_t shard_size;     // bytes, 0: a single shard
+};
+
+struct Clip {
+  std::string filename;
+  std::string error;
+
+  // From the scan
+  int64_t frames;
+  int32_t sample_rate;
+  int32_t channels;
+  int32_t frame_length;  // decoded samples per channel of a frame
+
+  // Region of the clip in its shard
+  int32_t shard;
+  int64_t row;
+  int64_t rows;
+
+  // From the decode
+  int64_t decoded_rows;
+  int64_t bad_frames;
+};
+
+struct Shard {
+  std::string filename;
+  int64_t rows;
+  std::unique_ptr<PcmArrayWriter> writer;
+};
+
+// One file per line, empty lines are skipped.
+static int32_t ReadList(const std::string& list,
+                        std::vector<std::string>* files) {
+  std::ifstream in(list);
+  if (!in) {
+    printf("Unable to open list '%s'\n", list.c_str());
+    return -1;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (!line.empty()) {
+      files->push_back(line);
+    }
+  }
+  return 0;
+}
+
+static void RunWorkers(int32_t jobs,
+                       size_t num_clips,
+                       const std::function<void(size_t)>& work) {
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i = 0;
+    while ((i = next.fetch_add(1)) < num_clips) {
+      work(i);
+    }
+  };
+
+  int32_t num_threads =
+      std::min<int32_t>(jobs, std::max<size_t>(1, num_clips));
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// Counts the frames of a clip, and decodes its first frames for the layout
+// of the decoded PCM. Every frame decodes to |frame_length| samples, a lost
+// one included, so this sizes the region of the clip without decoding it.
+static void ScanClip(const BatchOptions& options, Clip* clip) {
+  auto aac_adts_reader = std::make_unique<AacAdtsReader>();
+  if (aac_adts_reader->Open(clip->filename.c_str())) {
+    clip->error = "open failed";
+    return;
+  }
+
+  auto aac_decoder = std::make_unique<AacDecoder>();
+  if (aac_decoder->Init(options.config)) {
+    clip->error = "decoder init failed";
+    return;
+  }
+
+  auto frame = std::make_unique<uint8_t[]>(AAC_BATCH_DEC_MAX_FRAME_SIZE);
+  auto out_buf = std::make_unique<uint8_t[]>(AAC_BATCH_DEC_OUT_BUF_SIZE);
+  int32_t scan_frames = 0;
+  bool got_stream_info = false;
+  while (1) {
+    int32_t size = AAC_BATCH_DEC_MAX_FRAME_SIZE;
+    if (aac_adts_reader->ReadOneFrame(frame.get(), &size)) {
+      break;
+    }
+    clip->frames += 1;
+    if (got_stream_info || scan_frames >= AAC_BATCH_DEC_SCAN_FRAMES) {
+      continue;
+    }
+
+    scan_frames += 1;
+    int32_t out_size = AAC_BATCH_DEC_OUT_BUF_SIZE;
+    AacDecoderInfo info;
+    if (aac_decoder->GetDecoded(frame.get(), size, out_buf.get(),
+                                &out_size) == 0 &&
+        out_size > 0 && aac_decoder->GetInfo(&info) == 0) {
+      got_stream_info = true;
+      clip->sample_rate = info.sample_rate;
+      clip->channels = info.channels;
+      clip->frame_length = info.frame_length;
+    }
+  }
+
+  if (clip->frames == 0) {
+    clip->error = "no ADTS frame";
+  } else if (!got_stream_info) {
+    clip->error = "undecodable";
+  }
+}
+
+static void DecodeClip(const BatchOptions& options,
+                       PcmArrayWriter* writer,
+                       Clip* clip) {
+  auto aac_adts_reader = std::make_unique<AacAdtsReader>();
+  if (aac_adts_reader->Open(clip->filename.c_str())) {
+    clip->error = "open failed";
+    return;
+  }
+
+  auto aac_decoder = std::make_unique<AacDecoder>();
+  if (aac_decoder->Init(options.config)) {
+    clip->error = "decoder init failed";
+    return;
+  }
+
+  auto frame = std::make_unique<uint8_t[]>(AAC_BATCH_DEC_MAX_FRAME_SIZE);
+  auto out_buf = std::make_unique<uint8_t[]>(AAC_BATCH_DEC_OUT_BUF_SIZE);
+  const int32_t pcm_frame_size = clip->frame_length * clip->channels * 2;
+  // Samples per channel of the decoded stream, the encoder delay included
+  int64_t position = 0;
+  while (1) {
+    int32_t size = AAC_BATCH_DEC_MAX_FRAME_SIZE;
+    if (aac_adts_reader->ReadOneFrame(frame.get(), &size)) {
+      break;
+    }
+
+    int32_t out_size = AAC_BATCH_DEC_OUT_BUF_SIZE;
+    int32_t ret =
+        aac_decoder->GetDecoded(frame.get(), size, out_buf.get(), &out_size);
+    AacError error;
+    bool failed = ret != 0;
+    while (aac_decoder->PopError(&error) == 0) {
+      failed = true;
+    }
+    if (failed) {
+      clip->bad_frames += 1;
+    }
+    if (ret) {
+      // The frame is lost, its rows are left silent
+      position += clip->frame_length;
+      continue;
+    } else if (out_size == 0) {
+      // not enough bits
+      continue;
+    } else if (out_size != pcm_frame_size) {
+      // The stream changed since the scan, the region does not fit it
+      clip->error = "stream changed";
+      break;
+    }
+
+    // Rows of this frame that are within the region of the clip
+    int64_t begin = std::max<int64_t>(position, options.encoder_delay);
+    int64_t end = std::min<int64_t>(position + clip->frame_length,
+                                    options.encoder_delay + clip->rows);
+    if (begin < end) {
+      const int16_t* pcm = reinterpret_cast<const int16_t*>(out_buf.get()) +
+                           (begin - position) * clip->channels;
+      writer->Write(clip->row + begin - options.encoder_delay, pcm,
+                    static_cast<int32_t>(end - begin));
+      clip->decoded_rows += end - begin;
+    }
+    position += clip->frame_length;
+  }
+}
+
+// The clips are laid out in order, and a clip never spans two shards.
+// Shards are value initialized, with no rows.
+static void LayoutClips(const BatchOptions& options,
+                        int32_t channels,
+                        std::vector<Clip>* clips,
+                        std::vector<Shard>* shards) {
+  int64_t row_size =
+      (options.sample_type == PCM_ARRAY_TYPE_F32 ? 4 : 2) * channels;
+  shards->resize(1);
+  for (auto& clip : *clips) {
+    if (!clip.error.empty()) {
+      continue;
+    }
+    clip.rows = std::max<int64_t>(
+        0, clip.frames * clip.frame_length - options.encoder_delay);
+
+    Shard* shard = &shards->back();
+    if (options.shard_size > 0 && shard->rows > 0 &&
+        (shard->rows + clip.rows) * row_size > options.shard_size) {
+      shards->emplace_back();
+      shard = &shards->back();
+    }
+    clip.shard = static_cast<int32_t>(shards->size()) - 1;
+    clip.row = shard->rows;
+    shard->rows += clip.rows;
+  }
+}
+
+static std::string QuoteCsv(const std::string& value) {
+  if (value.find_first_of(",\"\n") == std::string::npos) {
+    return value;
+  }
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '"') {
+      quoted.push_back('"');
+    }
+    quoted.push_back(c);
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+static int32_t WriteIndex(const std::string& filename,
+                          const std::vector<Clip>& clips,
+                          const std::vector<Shard>& shards) {
+  std::unique_ptr<FILE, decltype(&fclose)> out(fopen(filename.c_str(), "w"),
+                                               &fclose);
+  if (out == nullptr) {
+    printf("Open index file failed, %s\n", filename.c_str());
+    return -1;
+  }
+
+  // Rows are samples per channel, |row| is the first one of the clip in
+  // its shard. A clip with an error has no rows.
+  fprintf(out.get(),
+          "file,shard,row,rows,sample_rate,channels,bad_frames,error\n");
+  for (const auto& clip : clips) {
+    bool ok = clip.error.empty();
+    std::string shard = ok ? shards[clip.shard].filename : "";
+    size_t pos = shard.rfind('/');
+    if (pos != std::string::npos) {
+      // Next to the index
+      shard = shard.substr(pos + 1);
+    }
+    fprintf(out.get(), "%s,%s,%lld,%lld,%d,%d,%lld,%s\n",
+            QuoteCsv(clip.filename).c_str(), QuoteCsv(shard).c_str(),
+            static_cast<long long>(ok ? clip.row : 0),
+            static_cast<long long>(ok ? clip.rows : 0), clip.sample_rate,
+            clip.channels, static_cast<long long>(clip.bad_frames),
+            QuoteCsv(clip.error).c_str());
+  }
+  return 0;
+}
+
+static int32_t DecodeBatch(const std::vector<std::string>& files,
+                           const std::string& prefix,
+                           const BatchOptions& options,
+                           int32_t jobs) {
+  auto start = std::chrono::steady_clock::now();
+
+  // Value initialized, so the numbers start from 0.
+  std::vector<Clip> clips(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    clips[i].filename = files[i];
+  }
+  RunWorkers(jobs, clips.size(),
+             [&](size_t i) { ScanClip(options, &clips[i]); });
+
+  // One array holds every clip, so they all have the channels of the first
+  int32_t channels = 0;
+  for (auto& clip : clips) {
+    if (!clip.error.empty()) {
+      continue;
+    } else if (channels == 0) {
+      channels = clip.channels;
+    } else if (clip.channels != channels) {
+      clip.error = std::to_string(clip.channels) + " channel(s), not " +
+                   std::to_string(channels) + ", see --max-channels";
+    }
+  }
+  if (channels == 0) {
+    printf("No clip to decode among %zu file(s)\n", files.size());
+    return -1;
+  }
+
+  std::vector<Shard> shards;
+  LayoutClips(options, channels, &clips, &shards);
+
+  const char* ext = options.format == PCM_ARRAY_FORMAT_NPY ? "npy" : "raw";
+  for (size_t i = 0; i < shards.size(); ++i) {
+    char suffix[32];
+    if (shards.size() == 1) {
+      snprintf(suffix, sizeof(suffix), ".%s", ext);
+    } else {
+      snprintf(suffix, sizeof(suffix), ".%05zu.%s", i, ext);
+    }
+    shards[i].filename = prefix + suffix;
+    shards[i].writer = std::make_unique<PcmArrayWriter>();
+    if (shards[i].writer->Open(shards[i].filename.c_str(), options.format,
+                               options.sample_type, shards[i].rows,
+                               channels)) {
+      return -1;
+    }
+  }
+
+  // Each clip owns its rows of the mapping, the workers never overlap.
+  RunWorkers(jobs, clips.size(), [&](size_t i) {
+    Clip& clip = clips[i];
+    if (clip.error.empty()) {
+      DecodeClip(options, shards[clip.shard].writer.get(), &clip);
+    }
+  });
+
+  int32_t status = 0;
+  for (auto& shard : shards) {
+    if (shard.writer->Close()) {
+      status = -1;
+    }
+  }
+  if (WriteIndex(prefix + ".index.csv", clips, shards)) {
+    status = -1;
+  }
+
+  int64_t failed_clips = 0;
+  int64_t bad_frames = 0;
+  double duration = 0;
+  for (const auto& clip : clips) {
+    if (!clip.error.empty()) {
+      failed_clips += 1;
+      printf("'%s': %s\n", clip.filename.c_str(), clip.error.c_str());
+      continue;
+    }
+    bad_frames += clip.bad_frames;
+    duration += static_cast<double>(clip.decoded_rows) / clip.sample_rate;
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  printf("Clips: %zu, failed: %lld, bad frames: %lld, shards: %zu, %d "
+         "ch(s)\n",
+         clips.size(), static_cast<long long>(failed_clips),
+         static_cast<long long>(bad_frames), shards.size(), channels);
+  printf("Decoded %.2f s in %.3f s, %.1fx real time\n", duration, seconds,
+         seconds > 0 ? duration / seconds : 0);
+  if (failed_clips > 0) {
+    status = -1;
+  }
+  return status;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Decode many ADTS clips in parallel into one memory-mapped array of "
+      "samples.\nThe array is a .npy file, or raw shards, with an index of "
+      "where each clip is in <prefix>.index.csv");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::PositionalList<std::string> inputs(parser, "Input",
+                                           "AAC files or directories");
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> output(
+      parser, "prefix",
+      "Output prefix, <prefix>.npy or <prefix>.00000.npy... and "
+      "<prefix>.index.csv",
+      {'o', "output"});
+  args::ValueFlag<std::string> list(parser, "list",
+                                    "File with one input file per line",
+                                    {"list"});
+  int32_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+  args::ValueFlag<int32_t> jobs(parser, "jobs", "Clips decoded in parallel",
+                                {'j', "jobs"}, num_cpus);
+
+  args::MapFlag<std::string, int> format(
+      parser, "format", "Array file format", {"format"},
+      {{"npy", PCM_ARRAY_FORMAT_NPY}, {"raw", PCM_ARRAY_FORMAT_RAW}},
+      PCM_ARRAY_FORMAT_NPY);
+  format.HelpChoices({"npy", "raw"});
+  format.HelpDefault("npy");
+  args::MapFlag<std::string, int> dtype(
+      parser, "dtype", "Sample type", {"dtype"},
+      {{"float32", PCM_ARRAY_TYPE_F32}, {"int16", PCM_ARRAY_TYPE_S16}},
+      PCM_ARRAY_TYPE_F32);
+  dtype.HelpChoices({"float32", "int16"});
+  dtype.HelpDefault("float32");
+  args::ValueFlag<int64_t> shard_size(
+      parser, "MB", "Largest shard, 0 for a single array",
+      {"shard-size"}, 0);
+
+  args::ValueFlag<int32_t> encoder_delay(
+      parser, "delay", "Encoder delay(samples/channel) to prune of each clip",
+      {'d', "delay"}, 0);
+  args::Flag fast(parser, "fast",
+                  "Fast profile, low power SBR and downmixed to mono, for "
+                  "previews and analytics",
+                  {"fast"});
+  args::ValueFlag<int32_t> max_channels(
+      parser, "max-channels",
+      "Downmix to at most this many channels, 0 for as coded or mono with "
+      "--fast",
+      {"max-channels"}, 0);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (inputs.GetError() != args::Error::None) {
+    std::cout << inputs.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (output.Get().empty()) {
+    std::cout << "Output prefix is required" << std::endl;
+    return -1;
+  } else if (jobs.Get() <= 0) {
+    std::cout << "Invalid jobs, " << jobs.Get() << std::endl;
+    return -1;
+  } else if (shard_size.Get() < 0) {
+    std::cout << "Invalid shard size, " << shard_size.Get() << std::endl;
+    return -1;
+  } else if (encoder_delay.Get() < 0) {
+    std::cout << "Invalid delay, " << encoder_delay.Get() << std::endl;
+    return -1;
+  } else if (max_channels.Get() < 0) {
+    std::cout << "Invalid max channels, " << max_channels.Get() << std::endl;
+    return -1;
+  }
+
+  std::vector<std::string> files;
+  for (const auto& input : inputs.Get()) {
+    ListFiles(input, {"aac", "adts"}, &files);
+  }
+  if (list && ReadList(list.Get(), &files)) {
+    return -1;
+  }
+  if (files.empty()) {
+    std::cout << "No input, give files, directories or --list" << std::endl;
+    return -1;
+  }
+
+  BatchOptions options;
+  memset(&options.config, 0, sizeof(options.config));
+  options.config.transport_type = AAC_TRANSPORT_TYPE_ADTS;
+  options.config.conceal_method = AAC_COMMON_CONCEAL_MUTE;
+  options.config.profile = fast.Get() ? AAC_COMMON_DECODE_PROFILE_FAST
+                                      : AAC_COMMON_DECODE_PROFILE_DEFAULT;
+  options.config.max_output_channels = max_channels.Get();
+  options.encoder_delay = encoder_delay.Get();
+  options.format = format.Get();
+  options.sample_type = dtype.Get();
+  options.shard_size = shard_size.Get() * 1024 * 1024;
+
+  return DecodeBatch(files, output.Get(), options, jobs.Get());
+}
@@ -0,0 +1,660 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aac_decoder.h"
+#include "aac_encoder.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "perf_counters.h"
+#include "wav_reader.h"
+
+struct BenchResult {
+  int64_t frames;
+  int64_t out_bytes;
+  double seconds;
+  double max_frame_us;
+  bool has_counters;
+  PerfCounterValues counters;  // summed over all GetEncoded calls
+};
+
+static int32_t BenchEncode(const std::vector<uint8_t>& pcm,
+                           const AacEncoderConfig& config,
+                           int32_t repeat,
+                           PerfCounters* counters,
+                           BenchResult* result) {
+  *result = {0};
+  if (counters) {
+    counters->Reset();
+  }
+
+  for (int32_t i = 0; i < repeat; ++i) {
+    auto aac_encoder = std::make_unique<AacEncoder>();
+    int32_t ret = aac_encoder->Init(config);
+    if (ret) {
+      printf("Init aac encoder failed\n");
+      return -1;
+    }
+
+    AacEncoderInfo aac_encoder_info;
+    ret = aac_encoder->GetInfo(&aac_encoder_info);
+    if (ret) {
+      printf("Get info of aac encoder failed\n");
+      return -1;
+    }
+
+    int32_t frame_size_in_bytes =
+        config.channels * 2 * aac_encoder_info.frame_length;
+    auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+    auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+
+    size_t offset = 0;
+    while (1) {
+      int32_t read_bytes = frame_size_in_bytes;
+      if (offset + read_bytes > pcm.size()) {
+        read_bytes = pcm.size() - offset;
+      }
+      memcpy(input_buf.get(), pcm.data() + offset, read_bytes);
+      offset += read_bytes;
+
+      int32_t out_size_bytes = frame_size_in_bytes;
+      if (counters) {
+        counters->Start();
+      }
+      auto start = std::chrono::steady_clock::now();
+      ret = aac_encoder->GetEncoded(input_buf.get(), read_bytes,
+                                    output_buf.get(), &out_size_bytes);
+      auto end = std::chrono::steady_clock::now();
+      if (counters) {
+        counters->Stop();
+      }
+      if (ret) {
+        break;
+      }
+
+      double frame_us =
+          std::chrono::duration<double, std::micro>(end - start).count();
+      result->seconds += frame_us / 1000000.0;
+      if (frame_us > result->max_frame_us) {
+        result->max_frame_us = frame_us;
+      }
+      result->frames += 1;
+      result->out_bytes += out_size_bytes;
+    }
+  }
+
+  if (counters) {
+    result->has_counters = counters->Read(&result->counters) == 0;
+  }
+  return 0;
+}
+
+// |num| / |den| * |scale|, "-" if a counter is missing
+static std::string FormatRatio(int64_t num, int64_t den, double scale) {
+  if (num < 0 || den <= 0) {
+    return "-";
+  }
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.2f", num * scale / den);
+  return buf;
+}
+
+static void PrintCounters(const BenchResult& result) {
+  if (!result.has_counters) {
+    printf(" %12s %12s %6s %9s %9s %9s", "-", "-", "-", "-", "-", "-");
+    return;
+  }
+
+  const int64_t* values = result.counters.values;
+  int64_t instructions = values[PERF_COUNTER_INSTRUCTIONS];
+  printf(" %12s %12s %6s %9s %9s %9s",
+         FormatRatio(values[PERF_COUNTER_CYCLES], result.frames, 1).c_str(),
+         FormatRatio(instructions, result.frames, 1).c_str(),
+         FormatRatio(instructions, values[PERF_COUNTER_CYCLES], 1).c_str(),
+         FormatRatio(values[PERF_COUNTER_L1D_MISSES], instructions, 1000)
+             .c_str(),
+         FormatRatio(values[PERF_COUNTER_LLC_MISSES], instructions, 1000)
+             .c_str(),
+         FormatRatio(values[PERF_COUNTER_BRANCH_MISSES], instructions, 1000)
+             .c_str());
+}
+
+static void BenchFile(const char* infile,
+                      int32_t aot,
+                      int32_t bitrate,
+                      int32_t repeat,
+                      PerfCounters* counters) {
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(infile, &wav_file_info, &pcm)) {
+    return;
+  }
+
+  AacEncoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  config.aot = aot;
+  config.sample_rate = wav_file_info.sample_rate;
+  config.channels = wav_file_info.channels;
+  config.bitrate = bitrate;
+
+  printf("\n%s, %d Hz, %d ch(s), %s, %d bps\n", infile,
+         wav_file_info.sample_rate, wav_file_info.channels,
+         get_aot_name(aot, 0), bitrate);
+  printf("%-10s %12s %14s %12s %10s", "preset", "frames/sec",
+         "max frame(us)", "bytes", "delta");
+  if (counters) {
+    // Per frame, and misses per 1000 instructions
+    printf(" %12s %12s %6s %9s %9s %9s", "cycles/fr", "instr/fr", "IPC",
+           "L1D MPKI", "LLC MPKI", "BR MPKI");
+  }
+  printf("\n");
+
+  BenchResult reference = {0};
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+  if (BenchEncode(pcm, config, repeat, nullptr, &reference)) {
+    return;
+  }
+
+  for (int32_t i = 0; i < aac_enc_presets_size; ++i) {
+    BenchResult result;
+    config.preset = aac_enc_presets[i].preset;
+    if (BenchEncode(pcm, config, repeat, counters, &result)) {
+      continue;
+    }
+
+    double frames_per_sec =
+        result.seconds > 0 ? result.frames / result.seconds : 0;
+    double delta = reference.out_bytes > 0
+                       ? (result.out_bytes - reference.out_bytes) * 100.0 /
+                             reference.out_bytes
+                       : 0;
+    printf("%-10s %12.1f %14.1f %12lld %+9.2f%%",
+           aac_enc_presets[i].friendly_name, frames_per_sec,
+           result.max_frame_us,
+           static_cast<long long>(result.out_bytes / repeat), delta);
+    if (counters) {
+      PrintCounters(result);
+    }
+    printf("\n");
+  }
+}
+
+// Raw AUs of |pcm| encoded once, for the decode benchmark
+static int32_t EncodeFrames(const std::vector<uint8_t>& pcm,
+                            const AacEncoderConfig& config,
+                            AacEncoderInfo* info,
+                            std::vector<std::vector<uint8_t>>* frames) {
+  auto aac_encoder = std::make_unique<AacEncoder>();
+  if (aac_encoder->Init(config) || aac_encoder->GetInfo(info)) {
+    printf("Init aac encoder failed\n");
+    return -1;
+  }
+
+  int32_t frame_size_in_bytes = config.channels * 2 * info->frame_length;
+  auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  size_t offset = 0;
+  frames->clear();
+  while (1) {
+    int32_t read_bytes = frame_size_in_bytes;
+    if (offset + read_bytes > pcm.size()) {
+      read_bytes = pcm.size() - offset;
+    }
+    memcpy(input_buf.get(), pcm.data() + offset, read_bytes);
+    offset += read_bytes;
+
+    int32_t out_size_bytes = frame_size_in_bytes;
+    if (aac_encoder->GetEncoded(input_buf.get(), read_bytes, output_buf.get(),
+                                &out_size_bytes)) {
+      break;
+    }
+    if (out_size_bytes > 0) {
+      frames->emplace_back(output_buf.get(),
+                           output_buf.get() + out_size_bytes);
+    }
+  }
+  return 0;
+}
+
+static int32_t BenchDecode(const std::vector<std::vector<uint8_t>>& frames,
+                           AacEncoderInfo& info,
+                           const AacDecoderConfig& config,
+                           int32_t repeat,
+                           PerfCounters* counters,
+                           BenchResult* result,
+                           AacDecoderInfo* decoder_info) {
+  *result = {0};
+  *decoder_info = {0};
+  if (counters) {
+    counters->Reset();
+  }
+
+  const int32_t out_buf_capacity = 8 * 2048 * 2;
+  auto out_buf = std::make_unique<uint8_t[]>(out_buf_capacity);
+  for (int32_t i = 0; i < repeat; ++i) {
+    auto aac_decoder = std::make_unique<AacDecoder>();
+    if (aac_decoder->Init(config) ||
+        aac_decoder->ConfigRaw(info.conf, info.conf_size)) {
+      printf("Init aac decoder failed\n");
+      return -1;
+    }
+
+    for (const auto& frame : frames) {
+      int32_t out_size_bytes = out_buf_capacity;
+      if (counters) {
+        counters->Start();
+      }
+      auto start = std::chrono::steady_clock::now();
+      int32_t ret = aac_decoder->GetDecoded(
+          const_cast<uint8_t*>(frame.data()), frame.size(), out_buf.get(),
+          &out_size_bytes);
+      auto end = std::chrono::steady_clock::now();
+      if (counters) {
+        counters->Stop();
+      }
+      if (ret) {
+        break;
+      }
+
+      double frame_us =
+          std::chrono::duration<double, std::micro>(end - start).count();
+      result->seconds += frame_us / 1000000.0;
+      if (frame_us > result->max_frame_us) {
+        result->max_frame_us = frame_us;
+      }
+      result->frames += 1;
+      result->out_bytes += out_size_bytes;
+    }
+    if (decoder_info->sample_rate == 0) {
+      aac_decoder->GetInfo(decoder_info);
+    }
+  }
+
+  if (counters) {
+    result->has_counters = counters->Read(&result->counters) == 0;
+  }
+  return 0;
+}
+
+// Decoding speed of the default profile vs the fast one, on the AUs of |aot|
+// encoded from |infile|
+static void DecodeBenchFile(const char* infile,
+                            int32_t aot,
+                            int32_t bitrate,
+                            int32_t repeat,
+                            PerfCounters* counters) {
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(infile, &wav_file_info, &pcm)) {
+    return;
+  }
+
+  AacEncoderConfig encoder_config = {0};
+  encoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  encoder_config.aot = aot;
+  encoder_config.sample_rate = wav_file_info.sample_rate;
+  encoder_config.channels = wav_file_info.channels;
+  encoder_config.bitrate = bitrate;
+  encoder_config.preset = AAC_COMMON_PRESET_DEFAULT;
+  AacEncoderInfo encoder_info;
+  std::vector<std::vector<uint8_t>> frames;
+  if (EncodeFrames(pcm, encoder_config, &encoder_info, &frames)) {
+    return;
+  }
+
+  printf("\n%s, %d Hz, %d ch(s), %s, %d bps, decoded\n", infile,
+         wav_file_info.sample_rate, wav_file_info.channels,
+         get_aot_name(aot, 0), bitrate);
+  printf("%-10s %12s %12s %14s %6s %10s", "profile", "frames/sec",
+         "x real time", "max frame(us)", "out ch", "speedup");
+  if (counters) {
+    printf(" %12s %12s %6s %9s %9s %9s", "cycles/fr", "instr/fr", "IPC",
+           "L1D MPKI", "LLC MPKI", "BR MPKI");
+  }
+  printf("\n");
+
+  const int32_t profiles[] = {AAC_COMMON_DECODE_PROFILE_DEFAULT,
+                              AAC_COMMON_DECODE_PROFILE_FAST};
+  const char* names[] = {"default", "fast"};
+  double reference_seconds = 0;
+  for (int32_t i = 0; i < 2; ++i) {
+    AacDecoderConfig config = {0};
+    config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+    config.conceal_method = AAC_COMMON_CONCEAL_MUTE;
+    config.profile = profiles[i];
+    BenchResult result;
+    AacDecoderInfo decoder_info;
+    if (BenchDecode(frames, encoder_info, config, repeat, counters, &result,
+                    &decoder_info)) {
+      return;
+    }
+    if (i == 0) {
+      reference_seconds = result.seconds;
+    }
+
+    double frames_per_sec =
+        result.seconds > 0 ? result.frames / result.seconds : 0;
+    double real_time = decoder_info.sample_rate > 0
+                           ? frames_per_sec * decoder_info.frame_length /
+                                 decoder_info.sample_rate
+                           : 0;
+    double speedup =
+        result.seconds > 0 ? reference_seconds / result.seconds : 0;
+    printf("%-10s %12.1f %12.1f %14.1f %6d %9.2fx", names[i], frames_per_sec,
+           real_time, result.max_frame_us, decoder_info.channels, speedup);
+    if (counters) {
+      PrintCounters(result);
+    }
+    printf("\n");
+  }
+}
+
+// Total output bytes of CBR(index 0) and VBR mode 1~5.
+static void VbrReportFile(const char* infile,
+                          int32_t aot,
+                          int32_t bitrate,
+                          int64_t* total_bytes) {
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(infile, &wav_file_info, &pcm)) {
+    return;
+  }
+
+  AacEncoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  config.aot = aot;
+  config.sample_rate = wav_file_info.sample_rate;
+  config.channels = wav_file_info.channels;
+  config.bitrate = bitrate;
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+
+  int64_t bytes[6] = {0};
+  for (int32_t mode = 0; mode <= 5; ++mode) {
+    BenchResult result;
+    config.bitrate_mode = mode;
+    if (BenchEncode(pcm, config, 1, nullptr, &result)) {
+      return;
+    }
+    bytes[mode] = result.out_bytes;
+  }
+
+  printf("%-40s", infile);
+  for (int32_t mode = 0; mode <= 5; ++mode) {
+    printf(" %10lld", static_cast<long long>(bytes[mode]));
+    total_bytes[mode] += bytes[mode];
+  }
+  printf("\n");
+}
+
+static void VbrReport(const std::vector<std::string>& wav_files,
+                      int32_t aot,
+                      int32_t bitrate) {
+  printf("\nOutput bytes, %s, CBR %d bps vs VBR mode 1~5\n",
+         get_aot_name(aot, 0), bitrate);
+  printf("%-40s %10s %10s %10s %10s %10s %10s\n", "file", "CBR", "VBR1",
+         "VBR2", "VBR3", "VBR4", "VBR5");
+
+  int64_t total_bytes[6] = {0};
+  for (const auto& wav_file : wav_files) {
+    VbrReportFile(wav_file.c_str(), aot, bitrate, total_bytes);
+  }
+
+  printf("%-40s", "total");
+  for (int32_t mode = 0; mode <= 5; ++mode) {
+    printf(" %10lld", static_cast<long long>(total_bytes[mode]));
+  }
+  printf("\n%-40s %10s", "vs CBR", "");
+  for (int32_t mode = 1; mode <= 5; ++mode) {
+    double delta = total_bytes[0] > 0 ? (total_bytes[mode] - total_bytes[0]) *
+                                            100.0 / total_bytes[0]
+                                      : 0;
+    printf(" %+9.2f%%", delta);
+  }
+  printf("\n");
+}
+
+// Resident set size of the process, -1 if unknown
+static int64_t ReadRss() {
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp == nullptr) {
+    return -1;
+  }
+  long long size = 0;
+  long long resident = 0;
+  int32_t ret = fscanf(fp, "%lld %lld", &size, &resident);
+  fclose(fp);
+  if (ret != 2) {
+    return -1;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+static void PrintSessionMemory(const char* kind,
+                               int32_t sessions,
+                               int64_t rss,
+                               int64_t heap,
+                               int64_t reported) {
+  printf("%-10s %14lld %14lld %14lld\n", kind,
+         static_cast<long long>(rss / sessions),
+         static_cast<long long>(heap / sessions),
+         static_cast<long long>(reported / sessions));
+}
+
+// Memory of |sessions| encoders and as many decoders held open at once, per
+// session. Every codec runs |kWarmFrames| frames first, RSS only counts the
+// pages touched.
+static void SessionReport(const char* infile,
+                          int32_t aot,
+                          int32_t bitrate,
+                          int32_t sessions) {
+  const int32_t kWarmFrames = 50;
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(infile, &wav_file_info, &pcm)) {
+    return;
+  }
+
+  AacEncoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  config.aot = aot;
+  config.sample_rate = wav_file_info.sample_rate;
+  config.channels = wav_file_info.channels;
+  config.bitrate = bitrate;
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+
+  printf("\n%s, %d Hz, %d ch(s), %s, %d bps, %d sessions\n", infile,
+         wav_file_info.sample_rate, wav_file_info.channels,
+         get_aot_name(aot, 0), bitrate, sessions);
+  printf("%-10s %14s %14s %14s\n", "kind", "RSS/session", "heap/session",
+         "reported");
+
+  // Buffers are allocated before the baseline, so only codecs are counted
+  std::vector<std::unique_ptr<AacEncoder>> encoders;
+  std::vector<std::unique_ptr<AacDecoder>> decoders;
+  encoders.reserve(sessions);
+  decoders.reserve(sessions);
+  const int32_t max_frame_length = 2048;
+  const int32_t pcm_buf_size = max_frame_length * config.channels * 2;
+  auto pcm_buf = std::make_unique<uint8_t[]>(pcm_buf_size);
+  auto out_buf = std::make_unique<uint8_t[]>(pcm_buf_size);
+  std::vector<std::vector<uint8_t>> frames;
+  frames.reserve(kWarmFrames);
+  AacEncoderInfo info;
+
+  int64_t rss_before = ReadRss();
+  int64_t heap_before = get_heap_in_use();
+  int64_t reported = 0;
+  for (int32_t i = 0; i < sessions; ++i) {
+    auto encoder = std::make_unique<AacEncoder>();
+    if (encoder->Init(config) || encoder->GetInfo(&info)) {
+      printf("Init aac encoder failed\n");
+      return;
+    }
+    int32_t frame_size_in_bytes = config.channels * 2 * info.frame_length;
+    size_t offset = 0;
+    for (int32_t frame = 0; frame < kWarmFrames; ++frame) {
+      int32_t read_bytes = frame_size_in_bytes;
+      if (offset + read_bytes > pcm.size()) {
+        read_bytes = pcm.size() - offset;
+      }
+      memcpy(pcm_buf.get(), pcm.data() + offset, read_bytes);
+      offset += read_bytes;
+      int32_t out_size_bytes = pcm_buf_size;
+      if (encoder->GetEncoded(pcm_buf.get(), read_bytes, out_buf.get(),
+                              &out_size_bytes)) {
+        break;
+      }
+      if (i == 0 && out_size_bytes > 0) {
+        frames.emplace_back(out_buf.get(), out_buf.get() + out_size_bytes);
+      }
+    }
+    reported += encoder->GetMemoryUsage();
+    encoders.push_back(std::move(encoder));
+  }
+  int64_t rss_encoders = ReadRss();
+  int64_t heap_encoders = get_heap_in_use();
+  PrintSessionMemory("encoder", sessions, rss_encoders - rss_before,
+                     heap_encoders - heap_before, reported);
+
+  reported = 0;
+  for (int32_t i = 0; i < sessions; ++i) {
+    auto decoder = std::make_unique<AacDecoder>();
+    if (decoder->Init(AAC_TRANSPORT_TYPE_RAW) ||
+        decoder->ConfigRaw(info.conf, info.conf_size)) {
+      printf("Init aac decoder failed\n");
+      return;
+    }
+    for (auto& frame : frames) {
+      int32_t out_size_bytes = pcm_buf_size;
+      decoder->GetDecoded(frame.data(), frame.size(), pcm_buf.get(),
+                          &out_size_bytes);
+    }
+    reported += decoder->GetMemoryUsage();
+    decoders.push_back(std::move(decoder));
+  }
+  PrintSessionMemory("decoder", sessions, ReadRss() - rss_encoders,
+                     get_heap_in_use() - heap_encoders, reported);
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Benchmark AAC encoding of WAV files in memory, or decoding of what "
+      "they encode to.\nOnly support 1 or 2 channel(s)");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::PositionalList<std::string> wav_files(
+      parser, "Input", "WAV files or directories", args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+
+  args::MapFlag<std::string, int> aot(
+      parser, "AOT", "Audio Object Type", {'a', "aot"},
+      {{std::to_string(AAC_COMMON_AOT_LC), AAC_COMMON_AOT_LC},
+       {std::to_string(AAC_COMMON_AOT_HE), AAC_COMMON_AOT_HE},
+       {std::to_string(AAC_COMMON_AOT_HEv2), AAC_COMMON_AOT_HEv2},
+       {std::to_string(AAC_COMMON_AOT_LD), AAC_COMMON_AOT_LD},
+       {std::to_string(AAC_COMMON_AOT_ELD), AAC_COMMON_AOT_ELD}},
+      AAC_COMMON_AOT_LC);
+  aot.HelpChoices({std::to_string(AAC_COMMON_AOT_LC) + "(LC)",
+                   std::to_string(AAC_COMMON_AOT_HE) + "(HE)",
+                   std::to_string(AAC_COMMON_AOT_HEv2) + "(HEv2)",
+                   std::to_string(AAC_COMMON_AOT_LD) + "(LD)",
+                   std::to_string(AAC_COMMON_AOT_ELD) + "(ELD)"});
+  aot.HelpDefault(std::to_string(AAC_COMMON_AOT_LC));
+
+  args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
+                                   {'b', "bitrate"}, 64000);
+  args::ValueFlag<int32_t> repeat(parser, "repeat",
+                                  "Times to encode each file per preset",
+                                  {'r', "repeat"}, 5);
+  args::Flag vbr(parser, "vbr",
+                 "Report output bytes of CBR and each VBR mode instead",
+                 {"vbr"});
+  args::Flag counters(parser, "counters",
+                      "Collect cycles, instructions, L1D/LLC and branch "
+                      "misses of each preset with perf_event_open",
+                      {"counters"});
+  args::ValueFlag<int32_t> sessions(
+      parser, "sessions",
+      "Report the memory per session of N encoders and decoders held open "
+      "instead",
+      {"sessions"}, 0);
+  args::Flag decode(parser, "decode",
+                    "Report the decoding speed of the default and the fast "
+                    "profile instead",
+                    {"decode"});
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_files.GetError() != args::Error::None) {
+    std::cout << wav_files.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (aot.GetError() != args::Error::None) {
+    std::cout << aot.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (repeat.Get() <= 0) {
+    std::cout << "Invalid repeat, " << repeat.Get() << std::endl;
+    return -1;
+  } else if (sessions.Get() < 0) {
+    std::cout << "Invalid sessions, " << sessions.Get() << std::endl;
+    return -1;
+  }
+
+  print_aac_lib_info();
+  std::vector<std::string> inputs;
+  for (const auto& input : wav_files.Get()) {
+    ListFiles(input, {"wav"}, &inputs);
+  }
+  if (sessions.Get() > 0) {
+    for (const auto& wav_file : inputs) {
+      SessionReport(wav_file.c_str(), aot.Get(), bitrate.Get(),
+                    sessions.Get());
+    }
+    return 0;
+  }
+  if (vbr.Get()) {
+    VbrReport(inputs, aot.Get(), bitrate.Get());
+    return 0;
+  }
+
+  // Timings are still reported when the counters can not be opened
+  std::unique_ptr<PerfCounters> perf_counters;
+  if (counters.Get()) {
+    perf_counters = std::make_unique<PerfCounters>();
+    if (perf_counters->Open()) {
+      perf_counters.reset();
+    }
+  }
+
+  for (const auto& wav_file : inputs) {
+    if (decode.Get()) {
+      DecodeBenchFile(wav_file.c_str(), aot.Get(), bitrate.Get(),
+                      repeat.Get(), perf_counters.get());
+    } else {
+      BenchFile(wav_file.c_str(), aot.Get(), bitrate.Get(), repeat.Get(),
+                perf_counters.get());
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "args.hxx"
+#include "example_common.h"
+#include "pcm_compare.h"
+#include "wav_reader.h"
+
+static void AppendJsonNumber(std::string* json, double value) {
+  char buf[32];
+  if (isfinite(value)) {
+    snprintf(buf, sizeof(buf), "%.2f", value);
+  } else {
+    snprintf(buf, sizeof(buf), "null");
+  }
+  json->append(buf);
+}
+
+static std::string FormatJson(const std::string& ref_file,
+                              const std::string& test_file,
+                              double confidence,
+                              const PcmCompareResult& result) {
+  char buf[256];
+  std::string json = "{\"reference\": ";
+  AppendJsonString(&json, ref_file);
+  json += ", \"test\": ";
+  AppendJsonString(&json, test_file);
+  snprintf(buf, sizeof(buf),
+           ", \"delay\": %d, \"samples\": %lld, \"max_abs_err\": %d, ",
+           result.delay, static_cast<long long>(result.num_samples),
+           result.max_abs_err);
+  json += buf;
+  json += "\"delay_confidence\": ";
+  AppendJsonNumber(&json, confidence);
+  // Identical files have an infinite SNR, JSON has no Infinity
+  json += ", \"snr\": ";
+  AppendJsonNumber(&json, result.snr);
+  json += ", \"seg_snr\": ";
+  AppendJsonNumber(&json, result.seg_snr);
+  json += ", \"bands\": [";
+  for (int32_t b = 0; b < result.num_bands; ++b) {
+    snprintf(buf, sizeof(buf), "%s{\"upper_hz\": %d, \"snr\": ", b ? ", " : "",
+             result.band_upper_hz[b]);
+    json += buf;
+    AppendJsonNumber(&json, result.band_snr[b]);
+    json += ", \"level_diff\": ";
+    AppendJsonNumber(&json, result.band_level_diff[b]);
+    json += "}";
+  }
+  json += "]}";
+  return json;
+}
+
+static void PrintResult(double confidence, const PcmCompareResult& result) {
+  printf("delay        : %d samples (confidence %.3f)\n", result.delay,
+         confidence);
+  printf("samples      : %lld\n", static_cast<long long>(result.num_samples));
+  printf("snr          : %.2f dB\n", result.snr);
+  printf("seg snr      : %.2f dB\n", result.seg_snr);
+  printf("max abs err  : %d\n", result.max_abs_err);
+  printf("\n%-12s %10s %12s\n", "band(Hz)", "snr(dB)", "level(dB)");
+  int32_t lower = 0;
+  for (int32_t b = 0; b < result.num_bands; ++b) {
+    char band[32];
+    snprintf(band, sizeof(band), "%d-%d", lower, result.band_upper_hz[b]);
+    printf("%-12s %10.2f %+12.2f\n", band, result.band_snr[b],
+           result.band_level_diff[b]);
+    lower = result.band_upper_hz[b];
+  }
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Compare a decoded WAV against its source. The delay is found by "
+      "cross-correlation unless --delay is given.\nExits with 1 when the SNR "
+      "is below --min-snr");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> ref_file(parser, "Reference", "Source WAV file",
+                                         args::Options::Required);
+  args::Positional<std::string> test_file(parser, "Test", "Decoded WAV file",
+                                          args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<int32_t> max_delay(parser, "max-delay",
+                                     "Largest delay searched, in samples",
+                                     {"max-delay"}, 8192);
+  args::ValueFlag<int32_t> fixed_delay(
+      parser, "delay", "Delay of the test file in samples, skips the search",
+      {"delay"});
+  int32_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+  args::ValueFlag<int32_t> jobs(parser, "jobs", "Segments compared in parallel",
+                                {'j', "jobs"}, num_cpus);
+  args::ValueFlag<double> min_snr(parser, "min-snr",
+                                  "Fail below this SNR in dB", {"min-snr"});
+  args::Flag json(parser, "json", "Print the result as JSON to stdout",
+                  {"json"});
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (ref_file.GetError() != args::Error::None) {
+    std::cout << ref_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (test_file.GetError() != args::Error::None) {
+    std::cout << test_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (max_delay.Get() < 0) {
+    std::cout << "Invalid max delay, " << max_delay.Get() << std::endl;
+    return -1;
+  } else if (jobs.Get() <= 0) {
+    std::cout << "Invalid jobs, " << jobs.Get() << std::endl;
+    return -1;
+  }
+
+  std::unique_ptr<FILE, decltype(&fclose)> out(nullptr, &fclose);
+  if (json.Get()) {
+    out.reset(TakeStdout());
+    if (out == nullptr) {
+      printf("Open stdout failed\n");
+      return -1;
+    }
+  }
+
+  WavFileInfo ref_info;
+  WavFileInfo test_info;
+  std::vector<uint8_t> ref_pcm;
+  std::vector<uint8_t> test_pcm;
+  if (LoadWav(ref_file.Get().c_str(), &ref_info, &ref_pcm) ||
+      LoadWav(test_file.Get().c_str(), &test_info, &test_pcm)) {
+    return -1;
+  }
+  if (ref_info.sample_rate != test_info.sample_rate ||
+      ref_info.channels != test_info.channels) {
+    printf("Format mismatch, %d Hz %d ch(s) vs %d Hz %d ch(s)\n",
+           ref_info.sample_rate, ref_info.channels, test_info.sample_rate,
+           test_info.channels);
+    return -1;
+  }
+
+  PcmComparer comparer;
+  if (comparer.Init(ref_info.sample_rate, ref_info.channels, jobs.Get())) {
+    return -1;
+  }
+
+  const int16_t* ref = reinterpret_cast<const int16_t*>(ref_pcm.data());
+  const int16_t* test = reinterpret_cast<const int16_t*>(test_pcm.data());
+  int32_t frame_size = ref_info.channels * 2;
+  int64_t ref_samples = ref_pcm.size() / frame_size;
+  int64_t test_samples = test_pcm.size() / frame_size;
+
+  int32_t delay = 0;
+  double confidence = NAN;
+  if (fixed_delay) {
+    delay = fixed_delay.Get();
+  } else if (comparer.FindDelay(ref, ref_samples, test, test_samples,
+                                max_delay.Get(), &delay, &confidence)) {
+    printf("Delay search failed\n");
+    return -1;
+  }
+
+  PcmCompareResult result;
+  if (comparer.Compare(ref, ref_samples, test, test_samples, delay, &result)) {
+    return -1;
+  }
+
+  if (out) {
+    fprintf(out.get(), "%s\n",
+            FormatJson(ref_file.Get(), test_file.Get(), confidence, result)
+                .c_str());
+  } else {
+    PrintResult(confidence, result);
+  }
+
+  if (min_snr && !(result.snr >= min_snr.Get())) {
+    printf("SNR %.2f dB is below %.2f dB\n", result.snr, min_snr.Get());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_encoder.h"
+#include "aac_ipc_client.h"
+#include "aac_ipc_server.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "wav_reader.h"
+
+struct IpcBenchResult {
+  int64_t frames;
+  double seconds;
+  double max_frame_us;
+};
+
+typedef std::function<int32_t(uint8_t*, int32_t, uint8_t*, int32_t*)>
+    FrameFunc;
+
+// Feeds |pcm| frame by frame and times each call of |func|, until it fails
+// at the end of the flush.
+static void RunFrames(const std::vector<uint8_t>& pcm,
+                      int32_t frame_size_in_bytes,
+                      int32_t repeat,
+                      const FrameFunc& func,
+                      IpcBenchResult* result) {
+  *result = {0};
+  auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+
+  for (int32_t i = 0; i < repeat; ++i) {
+    size_t offset = 0;
+    while (1) {
+      int32_t read_bytes = frame_size_in_bytes;
+      if (offset + read_bytes > pcm.size()) {
+        read_bytes = pcm.size() - offset;
+      }
+      memcpy(input_buf.get(), pcm.data() + offset, read_bytes);
+      offset += read_bytes;
+
+      int32_t out_size_bytes = frame_size_in_bytes;
+      auto start = std::chrono::steady_clock::now();
+      int32_t ret = func(input_buf.get(), read_bytes, output_buf.get(),
+                         &out_size_bytes);
+      auto end = std::chrono::steady_clock::now();
+      if (ret) {
+        break;
+      }
+
+      double frame_us =
+          std::chrono::duration<double, std::micro>(end - start).count();
+      result->seconds += frame_us / 1000000.0;
+      if (frame_us > result->max_frame_us) {
+        result->max_frame_us = frame_us;
+      }
+      result->frames += 1;
+    }
+  }
+}
+
+static void PrintResult(const char* mode, const IpcBenchResult& result) {
+  double avg_us =
+      result.frames > 0 ? result.seconds * 1000000.0 / result.frames : 0;
+  double frames_per_sec =
+      result.seconds > 0 ? result.frames / result.seconds : 0;
+  printf("%-8s %12.1f %14.2f %14.1f\n", mode, frames_per_sec, avg_us,
+         result.max_frame_us);
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Per frame cost of encoding through aac_service compared with a local "
+      "AacEncoder.\nThe echo row is the shared memory round trip alone");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> wav_file(parser, "Input", "WAV file",
+                                         args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> socket_path(parser, "socket",
+                                           "Unix socket of aac_service",
+                                           {'s', "socket"}, "/tmp/aac.sock");
+  args::Flag inproc(parser, "inproc",
+                    "Run the service on a thread of this process instead",
+                    {"inproc"});
+
+  args::MapFlag<std::string, int> aot(
+      parser, "AOT", "Audio Object Type", {'a', "aot"},
+      {{std::to_string(AAC_COMMON_AOT_LC), AAC_COMMON_AOT_LC},
+       {std::to_string(AAC_COMMON_AOT_HE), AAC_COMMON_AOT_HE},
+       {std::to_string(AAC_COMMON_AOT_HEv2), AAC_COMMON_AOT_HEv2},
+       {std::to_string(AAC_COMMON_AOT_LD), AAC_COMMON_AOT_LD},
+       {std::to_string(AAC_COMMON_AOT_ELD), AAC_COMMON_AOT_ELD}},
+      AAC_COMMON_AOT_LC);
+  aot.HelpChoices({std::to_string(AAC_COMMON_AOT_LC) + "(LC)",
+                   std::to_string(AAC_COMMON_AOT_HE) + "(HE)",
+                   std::to_string(AAC_COMMON_AOT_HEv2) + "(HEv2)",
+                   std::to_string(AAC_COMMON_AOT_LD) + "(LD)",
+                   std::to_string(AAC_COMMON_AOT_ELD) + "(ELD)"});
+  aot.HelpDefault(std::to_string(AAC_COMMON_AOT_LC));
+
+  args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
+                                   {'b', "bitrate"}, 64000);
+  args::ValueFlag<int32_t> repeat(parser, "repeat", "Times to encode the file",
+                                  {'r', "repeat"}, 5);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_file.GetError() != args::Error::None) {
+    std::cout << wav_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (aot.GetError() != args::Error::None) {
+    std::cout << aot.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (repeat.Get() <= 0) {
+    std::cout << "Invalid repeat, " << repeat.Get() << std::endl;
+    return -1;
+  }
+
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(wav_file.Get().c_str(), &wav_file_info, &pcm)) {
+    return -1;
+  }
+
+  AacEncoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  config.aot = aot.Get();
+  config.sample_rate = wav_file_info.sample_rate;
+  config.channels = wav_file_info.channels;
+  config.bitrate = bitrate.Get();
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+
+  std::string path = socket_path.Get();
+  std::unique_ptr<AacIpcServer> server;
+  std::thread server_thread;
+  if (inproc.Get()) {
+    path = "/tmp/aac_ipc_bench." + std::to_string(getpid()) + ".sock";
+    server = std::make_unique<AacIpcServer>();
+    if (server->Init(path.c_str(), 1)) {
+      return -1;
+    }
+    server_thread = std::thread([&server]() { server->Run(); });
+  }
+
+  int32_t status = -1;
+  do {
+    AacEncoder local;
+    AacIpcEncoder remote;
+    AacEncoderInfo info;
+    if (local.Init(config) || local.GetInfo(&info)) {
+      printf("Init aac encoder failed\n");
+      break;
+    }
+    if (remote.Init(path.c_str(), config)) {
+      printf("Is aac_service running on %s?\n", path.c_str());
+      break;
+    }
+
+    int32_t frame_size_in_bytes = config.channels * 2 * info.frame_length;
+    printf("%s, %d Hz, %d ch(s), %s, %d bps, %d bytes per frame\n",
+           wav_file.Get().c_str(), config.sample_rate, config.channels,
+           get_aot_name(config.aot, 0), config.bitrate, frame_size_in_bytes);
+    printf("%-8s %12s %14s %14s\n", "mode", "frames/sec", "avg frame(us)",
+           "max frame(us)");
+
+    // Fresh encoders per repeat would time the open as well, so the flushed
+    // encoders are reset instead.
+    IpcBenchResult local_result;
+    RunFrames(pcm, frame_size_in_bytes, repeat.Get(),
+              [&local](uint8_t* in, int32_t in_size, uint8_t* out,
+                       int32_t* out_size) {
+                if (local.GetEncoded(in, in_size, out, out_size) == 0) {
+                  return 0;
+                }
+                local.Reset();
+                return -1;
+              },
+              &local_result);
+    PrintResult("local", local_result);
+
+    IpcBenchResult remote_result;
+    RunFrames(pcm, frame_size_in_bytes, repeat.Get(),
+              [&remote, &path, &config](uint8_t* in, int32_t in_size,
+                                        uint8_t* out, int32_t* out_size) {
+                if (remote.GetEncoded(in, in_size, out, out_size) == 0) {
+                  return 0;
+                }
+                // A new session gets the pooled encoder back
+                remote.Uninit();
+                remote.Init(path.c_str(), config);
+                return -1;
+              },
+              &remote_result);
+    PrintResult("service", remote_result);
+
+    IpcBenchResult echo_result;
+    RunFrames(pcm, frame_size_in_bytes, repeat.Get(),
+              [&remote, frame_size_in_bytes](uint8_t* in, int32_t in_size,
+                                             uint8_t* out, int32_t* out_size) {
+                // Same number of frames as the encode, full sized payloads
+                if (in_size == 0) {
+                  return -1;
+                }
+                return remote.Echo(in, frame_size_in_bytes);
+              },
+              &echo_result);
+    PrintResult("echo", echo_result);
+
+    if (local_result.frames > 0 && remote_result.frames > 0) {
+      double local_us = local_result.seconds * 1000000.0 / local_result.frames;
+      double remote_us =
+          remote_result.seconds * 1000000.0 / remote_result.frames;
+      printf("\nOverhead %.2f us per frame, %.1f%% of the encode\n",
+             remote_us - local_us, (remote_us - local_us) * 100.0 / local_us);
+    }
+    status = 0;
+  } while (0);
+
+  if (server) {
+    server->Stop();
+    server_thread.join();
+    server->Uninit();
+  }
+  return status;
+}
@@ -0,0 +1,369 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "aac_common.h"
+#include "aac_decoder.h"
+#include "aac_encoder.h"
+#include "args.hxx"
+#include "pcm_compare.h"
+
+// One impulse per interval, longer than any codec delay searched for
+#define AAC_LATENCY_IMPULSE_INTERVAL_MS 500
+#define AAC_LATENCY_IMPULSE_MS 1
+#define AAC_LATENCY_MAX_DELAY_MS 400
+
+struct LatencyCase {
+  int32_t aot;
+  int32_t sample_rate;
+  int32_t frame_length;  // requested, 0 for the default of the AOT
+};
+
+struct LatencyResult {
+  int32_t frame_length;    // input samples per frame
+  int32_t chunk;           // input samples per capture chunk
+  int32_t reported_delay;  // samples, encoder delay + decoder output delay
+  int32_t measured_delay;  // samples, found on the impulses
+  double confidence;
+  double proc_avg_us;  // encode + decode per frame
+  double proc_max_us;
+  double p50_ms;
+  double p99_ms;
+  double max_ms;
+};
+
+// Decoded frame, available from |done_us| on the simulated capture clock
+struct FrameEvent {
+  int64_t out_pos;  // first sample per channel in the decoded stream
+  double done_us;
+};
+
+static double ElapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Silence with a Hann windowed noise burst of 1 ms every 500 ms, the same on
+// all channels. Bursts keep their shape through the codecs, a single sample
+// does not.
+static void MakeImpulses(int32_t sample_rate,
+                         int32_t channels,
+                         int32_t seconds,
+                         std::vector<int16_t>* pcm) {
+  const int64_t num_samples = static_cast<int64_t>(sample_rate) * seconds;
+  const int32_t interval = sample_rate * AAC_LATENCY_IMPULSE_INTERVAL_MS / 1000;
+  const int32_t length = sample_rate * AAC_LATENCY_IMPULSE_MS / 1000;
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(-1, 1);
+
+  pcm->assign(num_samples * channels, 0);
+  // The first one after a frame or two, not into the priming of the encoder
+  for (int64_t pos = interval / 4; pos + length <= num_samples;
+       pos += interval) {
+    for (int32_t i = 0; i < length; ++i) {
+      double window = 0.5 - 0.5 * cos(2 * M_PI * (i + 0.5) / length);
+      int16_t sample = static_cast<int16_t>(16000 * window * uniform(random));
+      for (int32_t ch = 0; ch < channels; ++ch) {
+        (*pcm)[(pos + i) * channels + ch] = sample;
+      }
+    }
+  }
+}
+
+static double Percentile(const std::vector<double>& sorted, int32_t percent) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  int64_t rank = std::max<int64_t>(
+      1, (static_cast<int64_t>(sorted.size()) * percent + 99) / 100);
+  return sorted[rank - 1];
+}
+
+// Encodes and decodes |pcm| as if it were captured in real time in chunks of
+// |chunk_ms|. Each chunk is processed once it is captured and the previous
+// one is done, with the measured encode and decode time; the latency of a
+// frame is from the capture of its first sample until it is decoded.
+static int32_t RunCase(const std::vector<int16_t>& pcm,
+                       int32_t channels,
+                       const LatencyCase& latency_case,
+                       int32_t bitrate,
+                       int32_t chunk_ms,
+                       LatencyResult* result) {
+  const int32_t sample_rate = latency_case.sample_rate;
+  AacEncoderConfig encoder_config = {0};
+  encoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  encoder_config.aot = latency_case.aot;
+  encoder_config.sample_rate = sample_rate;
+  encoder_config.channels = channels;
+  encoder_config.bitrate =
+      bitrate > 0 ? bitrate : sample_rate * channels * 3 / 2;
+  encoder_config.bitrate_mode = 0;
+  encoder_config.preset = AAC_COMMON_PRESET_DEFAULT;
+  encoder_config.frame_length = latency_case.frame_length;
+
+  AacEncoder aac_encoder;
+  AacEncoderInfo encoder_info;
+  if (aac_encoder.Init(encoder_config) ||
+      aac_encoder.GetInfo(&encoder_info)) {
+    return -1;
+  }
+  AacDecoder aac_decoder;
+  if (aac_decoder.Init(AAC_TRANSPORT_TYPE_RAW) ||
+      aac_decoder.ConfigRaw(encoder_info.conf, encoder_info.conf_size)) {
+    printf("Init aac decoder failed\n");
+    return -1;
+  }
+
+  const int32_t frame_length = encoder_info.frame_length;
+  const int32_t chunk =
+      chunk_ms > 0 ? sample_rate * chunk_ms / 1000 : frame_length;
+  const int64_t num_samples = pcm.size() / channels;
+  const int32_t out_capacity = 8 * 2048 * 2;
+  std::vector<uint8_t> out(out_capacity);
+  std::vector<uint8_t> decoded(out_capacity);
+  std::vector<int16_t> output;
+  output.reserve(pcm.size() + 4 * frame_length * channels);
+  std::vector<FrameEvent> events;
+  std::vector<double> proc_us;
+
+  AacDecoderInfo decoder_info = {0};
+  double busy_until_us = 0;
+  int64_t filled = 0;  // samples per channel in the current input frame
+  double frame_us = 0;
+  for (int64_t pos = 0; pos < num_samples; pos += chunk) {
+    const int64_t chunk_end = std::min(num_samples, pos + chunk);
+    double now_us = std::max(busy_until_us,
+                             chunk_end * 1000000.0 / sample_rate);
+
+    // Never past the end of a frame, GetEncoded() outputs one AU at most
+    int64_t piece_pos = pos;
+    while (piece_pos < chunk_end) {
+      int64_t piece =
+          std::min<int64_t>(chunk_end - piece_pos, frame_length - filled);
+      int32_t out_size = out_capacity;
+      auto start = std::chrono::steady_clock::now();
+      int32_t ret = aac_encoder.GetEncoded(
+          reinterpret_cast<uint8_t*>(const_cast<int16_t*>(
+              pcm.data() + piece_pos * channels)),
+          piece * channels * 2, out.data(), &out_size);
+      double us = ElapsedUs(start);
+      now_us += us;
+      frame_us += us;
+      if (ret) {
+        printf("Encode failed\n");
+        return -1;
+      }
+      piece_pos += piece;
+      filled = (filled + piece) % frame_length;
+
+      if (out_size > 0) {
+        int32_t decoded_size = out_capacity;
+        start = std::chrono::steady_clock::now();
+        ret = aac_decoder.GetDecoded(out.data(), out_size, decoded.data(),
+                                     &decoded_size);
+        us = ElapsedUs(start);
+        now_us += us;
+        frame_us += us;
+        if (ret) {
+          printf("Decode failed\n");
+          return -1;
+        }
+        proc_us.push_back(frame_us);
+        frame_us = 0;
+
+        if (decoded_size > 0) {
+          if (decoder_info.sample_rate == 0 &&
+              aac_decoder.GetInfo(&decoder_info)) {
+            return -1;
+          }
+          FrameEvent event;
+          event.out_pos = output.size() / channels;
+          event.done_us = now_us;
+          events.push_back(event);
+          const int16_t* samples =
+              reinterpret_cast<const int16_t*>(decoded.data());
+          output.insert(output.end(), samples, samples + decoded_size / 2);
+        }
+      }
+    }
+    busy_until_us = now_us;
+  }
+  if (decoder_info.sample_rate != sample_rate) {
+    printf("Decoded %d Hz from %d Hz\n", decoder_info.sample_rate,
+           sample_rate);
+    return -1;
+  }
+
+  PcmComparer comparer;
+  int32_t delay = 0;
+  double confidence = 0;
+  if (comparer.Init(sample_rate, channels, 1) ||
+      comparer.FindDelay(pcm.data(), num_samples, output.data(),
+                         output.size() / channels,
+                         sample_rate * AAC_LATENCY_MAX_DELAY_MS / 1000,
+                         &delay, &confidence)) {
+    printf("Delay search failed\n");
+    return -1;
+  }
+
+  std::vector<double> latency_ms;
+  for (const auto& event : events) {
+    // Frames before that are the priming of the codecs
+    int64_t in_pos = event.out_pos - delay;
+    if (in_pos >= 0) {
+      latency_ms.push_back((event.done_us - in_pos * 1000000.0 / sample_rate) /
+                           1000);
+    }
+  }
+  std::sort(latency_ms.begin(), latency_ms.end());
+
+  double proc_sum_us = 0;
+  double proc_max_us = 0;
+  for (double us : proc_us) {
+    proc_sum_us += us;
+    proc_max_us = std::max(proc_max_us, us);
+  }
+
+  result->frame_length = frame_length;
+  result->chunk = chunk;
+  result->reported_delay = encoder_info.delay + decoder_info.output_delay;
+  result->measured_delay = delay;
+  result->confidence = confidence;
+  result->proc_avg_us = proc_us.empty() ? 0 : proc_sum_us / proc_us.size();
+  result->proc_max_us = proc_max_us;
+  result->p50_ms = Percentile(latency_ms, 50);
+  result->p99_ms = Percentile(latency_ms, 99);
+  result->max_ms = Percentile(latency_ms, 100);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Measure the end-to-end latency of encode->decode in process for each "
+      "AOT, frame length and sample rate.\nImpulses are encoded as if "
+      "captured in real time in chunks; the algorithmic delay is found on "
+      "the decoded impulses, and the latency of a frame adds the wait for "
+      "its input and the measured processing time");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlagList<int32_t> aots(
+      parser, "AOT",
+      "Audio Object Types, " + std::to_string(AAC_COMMON_AOT_LD) + "(LD) " +
+          std::to_string(AAC_COMMON_AOT_ELD) + "(ELD) " +
+          std::to_string(AAC_COMMON_AOT_LC) + "(LC)...",
+      {'a', "aot"}, {AAC_COMMON_AOT_LD, AAC_COMMON_AOT_ELD});
+  args::ValueFlagList<int32_t> frame_lengths(
+      parser, "frame-length",
+      "Frame lengths of the core coder, 0 for the default of the AOT",
+      {'f', "frame-length"}, {480, 512});
+  args::ValueFlagList<int32_t> sample_rates(
+      parser, "sample-rate", "Sample rates(Hz)", {'r', "sample-rate"},
+      {16000, 32000, 48000});
+  args::ValueFlag<int32_t> channels(parser, "channels", "Channels",
+                                    {'c', "channels"}, 1);
+  args::ValueFlag<int32_t> bitrate(
+      parser, "bitrate", "Encode bitrate(bps), 0 for 1.5 bits per sample",
+      {'b', "bitrate"}, 0);
+  args::ValueFlag<int32_t> chunk_ms(
+      parser, "chunk", "Capture chunk(ms), 0 for one frame of the encoder",
+      {"chunk"}, 10);
+  args::ValueFlag<int32_t> seconds(parser, "seconds", "Signal per case(s)",
+                                   {'t', "time"}, 10);
+  args::ValueFlag<double> budget(
+      parser, "budget", "Latency budget the p99 is checked against(ms)",
+      {"budget"}, 20);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (channels.Get() <= 0 || channels.Get() > 2) {
+    std::cout << "Invalid channels, " << channels.Get() << std::endl;
+    return -1;
+  } else if (chunk_ms.Get() < 0) {
+    std::cout << "Invalid chunk, " << chunk_ms.Get() << std::endl;
+    return -1;
+  } else if (seconds.Get() <= 0) {
+    std::cout << "Invalid time, " << seconds.Get() << std::endl;
+    return -1;
+  }
+
+  // Frame lengths only apply to the low delay AOTs, the others run once
+  std::vector<LatencyCase> cases;
+  for (int32_t aot : aots.Get()) {
+    bool low_delay = (aot == AAC_COMMON_AOT_LD || aot == AAC_COMMON_AOT_ELD);
+    std::vector<int32_t> lengths = {0};
+    if (low_delay) {
+      lengths = frame_lengths.Get();
+    }
+    for (int32_t frame_length : lengths) {
+      for (int32_t sample_rate : sample_rates.Get()) {
+        LatencyCase latency_case;
+        latency_case.aot = aot;
+        latency_case.sample_rate = sample_rate;
+        latency_case.frame_length = frame_length;
+        cases.push_back(latency_case);
+      }
+    }
+  }
+
+  printf("%-8s %6s %6s %6s %10s %10s %8s %8s %8s %8s %8s %6s\n", "aot",
+         "rate", "frame", "chunk", "codec(ms)", "found(ms)", "avg(us)",
+         "max(us)", "p50(ms)", "p99(ms)", "max(ms)", "budget");
+  int32_t failed = 0;
+  std::vector<int16_t> pcm;
+  for (const auto& latency_case : cases) {
+    MakeImpulses(latency_case.sample_rate, channels.Get(), seconds.Get(),
+                 &pcm);
+    LatencyResult result;
+    memset(&result, 0, sizeof(result));
+    if (RunCase(pcm, channels.Get(), latency_case, bitrate.Get(),
+                chunk_ms.Get(), &result)) {
+      printf("%-8s %6d %6d unsupported\n", get_aot_name(latency_case.aot, 0),
+             latency_case.sample_rate, latency_case.frame_length);
+      failed += 1;
+      continue;
+    }
+
+    const double sample_ms = 1000.0 / latency_case.sample_rate;
+    printf("%-8s %6d %6d %6d %10.2f %10.2f %8.1f %8.1f %8.2f %8.2f %8.2f %6s\n",
+           get_aot_name(latency_case.aot, 0), latency_case.sample_rate,
+           result.frame_length, result.chunk,
+           result.reported_delay * sample_ms,
+           result.measured_delay * sample_ms, result.proc_avg_us,
+           result.proc_max_us, result.p50_ms, result.p99_ms, result.max_ms,
+           result.p99_ms <= budget.Get() ? "ok" : "over");
+    if (result.confidence < 0.5) {
+      printf("  delay found with a low confidence, %.2f\n",
+             result.confidence);
+    }
+    fflush(stdout);
+  }
+  printf("\ncodec: encoder delay + decoder output delay as reported, found: "
+         "measured on the impulses\nLatency is from capture to decoded, the "
+         "input frame is waited for in chunks of the capture\n");
+  return failed == static_cast<int32_t>(cases.size()) ? -1 : 0;
+}
@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_encode_scheduler.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "wav_reader.h"
+
+struct LoadStream {
+  int32_t session_id;
+  int32_t frame_bytes;
+  int64_t period_us;
+  int64_t next_due_us;  // live only
+  size_t offset;        // into the PCM of the WAV file
+};
+
+// Streams loop over the file, each from its own position
+static const uint8_t* NextFrame(const std::vector<uint8_t>& pcm,
+                                LoadStream* stream) {
+  if (stream->offset + stream->frame_bytes > pcm.size()) {
+    stream->offset = 0;
+  }
+  const uint8_t* frame = pcm.data() + stream->offset;
+  stream->offset += stream->frame_bytes;
+  return frame;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Drive AacEncodeScheduler with live streams paced in real time and "
+      "batch streams encoding as fast as they can, all looping over one WAV "
+      "file.\nLive streams are added until admission control refuses one");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> wav_file(parser, "Input", "WAV file",
+                                         args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+
+  args::MapFlag<std::string, int> aot(
+      parser, "AOT", "Audio Object Type", {'a', "aot"},
+      {{std::to_string(AAC_COMMON_AOT_LC), AAC_COMMON_AOT_LC},
+       {std::to_string(AAC_COMMON_AOT_HE), AAC_COMMON_AOT_HE},
+       {std::to_string(AAC_COMMON_AOT_HEv2), AAC_COMMON_AOT_HEv2},
+       {std::to_string(AAC_COMMON_AOT_LD), AAC_COMMON_AOT_LD},
+       {std::to_string(AAC_COMMON_AOT_ELD), AAC_COMMON_AOT_ELD}},
+      AAC_COMMON_AOT_ELD);
+  aot.HelpChoices({std::to_string(AAC_COMMON_AOT_LC) + "(LC)",
+                   std::to_string(AAC_COMMON_AOT_HE) + "(HE)",
+                   std::to_string(AAC_COMMON_AOT_HEv2) + "(HEv2)",
+                   std::to_string(AAC_COMMON_AOT_LD) + "(LD)",
+                   std::to_string(AAC_COMMON_AOT_ELD) + "(ELD)"});
+  aot.HelpDefault(std::to_string(AAC_COMMON_AOT_ELD));
+
+  args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
+                                   {'b', "bitrate"}, 24000);
+  args::ValueFlag<int32_t> live(parser, "live", "Live streams to add",
+                                {"live"}, 100);
+  args::ValueFlag<int32_t> batch(parser, "batch", "Batch streams to add",
+                                 {"batch"}, 0);
+  args::ValueFlag<int32_t> workers(
+      parser, "workers", "Worker threads",
+      {'w', "workers"},
+      static_cast<int32_t>(std::thread::hardware_concurrency()));
+  args::Flag pin(parser, "pin", "Pin the workers to CPUs", {"pin"});
+  args::ValueFlag<double> max_load(
+      parser, "max-load", "Share of the workers live streams may take",
+      {"max-load"}, 0.8);
+  args::ValueFlag<int32_t> latency(
+      parser, "latency",
+      "Deadline of a live frame after its submission(us), 0 means one frame",
+      {"latency"}, 0);
+  args::ValueFlag<int32_t> seconds(parser, "seconds", "Duration of the run",
+                                   {'t', "seconds"}, 10);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_file.GetError() != args::Error::None) {
+    std::cout << wav_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (aot.GetError() != args::Error::None) {
+    std::cout << aot.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (live.Get() < 0 || batch.Get() < 0 ||
+             live.Get() + batch.Get() == 0) {
+    std::cout << "Invalid live/batch, " << live.Get() << "/" << batch.Get()
+              << std::endl;
+    return -1;
+  } else if (workers.Get() <= 0) {
+    std::cout << "Invalid workers, " << workers.Get() << std::endl;
+    return -1;
+  } else if (seconds.Get() <= 0) {
+    std::cout << "Invalid seconds, " << seconds.Get() << std::endl;
+    return -1;
+  }
+
+  WavFileInfo wav_file_info = {0};
+  std::vector<uint8_t> pcm;
+  if (LoadWav(wav_file.Get().c_str(), &wav_file_info, &pcm)) {
+    return -1;
+  }
+
+  AacEncodeScheduler scheduler;
+  if (scheduler.Init(workers.Get(), pin.Get(), max_load.Get())) {
+    return -1;
+  }
+
+  AacSchedSessionConfig config;
+  memset(&config, 0, sizeof(config));
+  config.encoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  config.encoder_config.aot = aot.Get();
+  config.encoder_config.sample_rate = wav_file_info.sample_rate;
+  config.encoder_config.channels = wav_file_info.channels;
+  config.encoder_config.bitrate = bitrate.Get();
+  config.encoder_config.preset = AAC_COMMON_PRESET_DEFAULT;
+  config.max_latency_us = latency.Get();
+
+  std::atomic<int64_t> live_bytes(0);
+  std::atomic<int64_t> batch_bytes(0);
+  AacFrameSink live_sink = [&live_bytes](int32_t, const uint8_t*,
+                                         int32_t size,
+                                         int64_t) { live_bytes += size; };
+  AacFrameSink batch_sink = [&batch_bytes](int32_t, const uint8_t*,
+                                           int32_t size,
+                                           int64_t) { batch_bytes += size; };
+
+  std::vector<LoadStream> live_streams;
+  std::vector<LoadStream> batch_streams;
+  bool live_refused = false;
+  for (int32_t i = 0; i < live.Get() + batch.Get(); ++i) {
+    bool is_live = i < live.Get();
+    // Once admission control refuses a stream it refuses the rest as well
+    if (is_live && live_refused) {
+      continue;
+    }
+    config.sched_class = is_live ? AAC_SCHED_CLASS_LIVE : AAC_SCHED_CLASS_BATCH;
+    AacEncoderInfo info;
+    LoadStream stream;
+    stream.session_id =
+        scheduler.AddSession(config, is_live ? live_sink : batch_sink, &info);
+    if (stream.session_id < 0) {
+      live_refused = is_live;
+      continue;
+    }
+
+    stream.frame_bytes = info.frame_length * wav_file_info.channels * 2;
+    stream.period_us = static_cast<int64_t>(info.frame_length) * 1000000 /
+                       wav_file_info.sample_rate;
+    stream.next_due_us = 0;
+    if (pcm.size() < static_cast<size_t>(stream.frame_bytes)) {
+      printf("WAV file shorter than a frame\n");
+      return -1;
+    }
+    // Spread the streams over the file
+    size_t frames = pcm.size() / stream.frame_bytes;
+    stream.offset = (i * 7 % frames) * stream.frame_bytes;
+    (is_live ? live_streams : batch_streams).push_back(stream);
+  }
+
+  AacSchedStats stats;
+  scheduler.GetStats(&stats);
+  printf("%s, %d Hz, %d ch(s), %s, %d bps, %d workers\n",
+         wav_file.Get().c_str(), wav_file_info.sample_rate,
+         wav_file_info.channels, get_aot_name(aot.Get(), 0), bitrate.Get(),
+         workers.Get());
+  printf("Live streams %zu admitted, %lld refused, load %.2f of %.2f\n",
+         live_streams.size(), static_cast<long long>(stats.rejected_sessions),
+         stats.live_load, stats.capacity);
+  printf("%6s %12s %12s %10s %14s %6s\n", "second", "live fr/s", "batch fr/s",
+         "misses", "max late(us)", "load");
+
+  // Live frames start evenly spread over one frame duration
+  const int64_t start_us = NowUs();
+  for (size_t i = 0; i < live_streams.size(); ++i) {
+    live_streams[i].next_due_us =
+        start_us + live_streams[i].period_us * i / live_streams.size();
+  }
+
+  AacSchedStats last;
+  scheduler.GetStats(&last);
+  int64_t report_us = start_us + 1000000;
+  int64_t end_us = start_us + seconds.Get() * 1000000LL;
+  while (1) {
+    int64_t now = NowUs();
+    if (now >= end_us) {
+      break;
+    }
+
+    for (auto& stream : live_streams) {
+      while (stream.next_due_us <= now) {
+        scheduler.SubmitFrame(stream.session_id, NextFrame(pcm, &stream),
+                              stream.frame_bytes);
+        stream.next_due_us += stream.period_us;
+      }
+    }
+    // Batch streams keep their queues full, a refused frame is retried
+    for (auto& stream : batch_streams) {
+      while (1) {
+        size_t offset = stream.offset;
+        if (scheduler.SubmitFrame(stream.session_id, NextFrame(pcm, &stream),
+                                  stream.frame_bytes)) {
+          stream.offset = offset;
+          break;
+        }
+      }
+    }
+
+    if (now >= report_us) {
+      scheduler.GetStats(&stats);
+      printf("%6lld %12lld %12lld %10lld %14lld %6.2f\n",
+             static_cast<long long>((report_us - start_us) / 1000000),
+             static_cast<long long>(stats.live_frames - last.live_frames),
+             static_cast<long long>(stats.batch_frames - last.batch_frames),
+             static_cast<long long>(stats.deadline_misses -
+                                    last.deadline_misses),
+             static_cast<long long>(stats.max_late_us), stats.live_load);
+      last = stats;
+      report_us += 1000000;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  for (const auto& stream : live_streams) {
+    scheduler.RemoveSession(stream.session_id);
+  }
+  for (const auto& stream : batch_streams) {
+    scheduler.RemoveSession(stream.session_id);
+  }
+
+  scheduler.GetStats(&stats);
+  double run_seconds = (NowUs() - start_us) / 1000000.0;
+  printf("\nLive frames %lld, deadline misses %lld(%.3f%%), max late %lld us, "
+         "overruns %lld\n",
+         static_cast<long long>(stats.live_frames),
+         static_cast<long long>(stats.deadline_misses),
+         stats.live_frames > 0
+             ? stats.deadline_misses * 100.0 / stats.live_frames
+             : 0,
+         static_cast<long long>(stats.max_late_us),
+         static_cast<long long>(stats.overruns));
+  printf("Batch frames %lld, %.1f frames/sec\n",
+         static_cast<long long>(stats.batch_frames),
+         stats.batch_frames / run_seconds);
+  printf("Output %lld live bytes, %lld batch bytes, %lld errors\n",
+         static_cast<long long>(live_bytes),
+         static_cast<long long>(batch_bytes),
+         static_cast<long long>(stats.errors));
+  scheduler.Uninit();
+  return 0;
+}
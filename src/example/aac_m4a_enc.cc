@@ -4,25 +4,62 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
 #include "aac_encoder.h"
+#include "aac_telemetry.h"
+#include "aac_verifier.h"
 #include "args.hxx"
+#include "encode_cache.h"
+#include "encode_checkpoint.h"
+#include "loudness_meter.h"
 #include "m4a_writer.h"
+#include "silence_detector.h"
 #include "wav_reader.h"
 
+struct EncodeOptions {
+  int32_t aot;
+  int32_t bitrate;
+  int32_t bitrate_mode;
+  int32_t preset;
+  bool dtx;
+  double dtx_threshold;    // dBFS
+  int32_t dtx_hangover;    // frames
+  bool analyze;            // loudness and peak report next to the output
+  bool follow;             // input is a recording that is still growing
+  int32_t follow_timeout;  // ms without growth that ends the recording
+  const char* telemetry;   // per-frame log, nullptr for none
+  int32_t checkpoint;      // seconds of audio between checkpoints, 0: none
+  bool verify;             // decode the output while encoding
+  double verify_snr;       // dB, lowest SNR of the decoded output
+};
+
 static void PrintEncoderInfo(const char* infile,
                              const char* outfile,
-                             int32_t aot,
-                             int32_t bitrate,
+                             const EncodeOptions& options,
                              WavFileInfo& wav_file_info,
                              AacEncoderInfo& aac_encoder_info) {
   print_aac_lib_info();
   printf("Input: '%s', %d Hz, %d ch(s), %d bits/sample\n", infile,
          wav_file_info.sample_rate, wav_file_info.channels,
          wav_file_info.bits_per_sample);
-  printf("Output: '%s', %s, %d bps\n", outfile, get_aot_name(aot, 0), bitrate);
+  const char* aot_name = get_aot_name(options.aot, 0);
+  if (options.bitrate_mode == 0) {
+    printf("Output: '%s', %s, CBR %d bps\n", outfile, aot_name,
+           options.bitrate);
+  } else {
+    printf("Output: '%s', %s, VBR mode %d\n", outfile, aot_name,
+           options.bitrate_mode);
+  }
+  printf("Preset: %s\n", get_preset_info(options.preset)->friendly_name);
+  if (options.dtx) {
+    printf("DTX: threshold %.1f dBFS, hangover %d frames\n",
+           options.dtx_threshold, options.dtx_hangover);
+  }
   printf("Frame length: %u samples/channel\n", aac_encoder_info.frame_length);
   printf("Delay: %u samples/channel\n", aac_encoder_info.delay);
   printf("Delay core: %u samples/channel\n", aac_encoder_info.delay_core);
@@ -36,10 +73,129 @@ static void PrintEncoderInfo(const char* infile,
   printf("}\n");
 }
 
+static void PrintEncoderErrors(AacEncoder* aac_encoder, bool* eof) {
+  AacError error;
+  while (aac_encoder->PopError(&error) == 0) {
+    if (error.code == AAC_COMMON_ERROR_ENCODE_EOF) {
+      *eof = true;
+      continue;
+    }
+    printf("%s, %d\n", get_error_name(error.code), error.detail);
+  }
+}
+
+// The encoder pushes the stats of every frame into |ring|, which is drained
+// into the log after each frame.
+static int32_t StartTelemetry(const char* filename,
+                              const AacEncoderConfig& config,
+                              const AacEncoderInfo& info,
+                              AacEncoder* aac_encoder,
+                              AacTelemetryRing* ring,
+                              AacTelemetryWriter* writer) {
+  AacTelemetryHeader header;
+  header.sample_rate = config.sample_rate;
+  header.channels = config.channels;
+  header.frame_length = info.frame_length;
+  header.aot = config.aot;
+  header.transport_type = config.transport_type;
+  header.bitrate_mode = config.bitrate_mode;
+  header.bitrate = config.bitrate;
+  if (writer->Open(filename, header)) {
+    return -1;
+  }
+
+  if (aac_encoder->SetTelemetry(ring)) {
+    printf("Enable telemetry failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+// The encoded frames are decoded on another thread while encoding goes on.
+static int32_t StartVerifier(const AacEncoderConfig& config,
+                             const AacEncoderInfo& info,
+                             AacVerifier* verifier) {
+  AacVerifierConfig verifier_config;
+  memset(&verifier_config, 0, sizeof(verifier_config));
+  verifier_config.transport_type = config.transport_type;
+  memcpy(verifier_config.conf, info.conf, info.conf_size);
+  verifier_config.conf_size = info.conf_size;
+  verifier_config.sample_rate = config.sample_rate;
+  verifier_config.channels = config.channels;
+  verifier_config.frame_length = info.frame_length;
+  verifier_config.delay = info.delay;
+  verifier_config.downmix = config.aot == AAC_COMMON_AOT_HEv2;
+  if (verifier->Init(verifier_config)) {
+    printf("Init verifier failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+static int32_t FinishVerifier(AacVerifier* verifier, double min_snr) {
+  AacVerifierStats stats;
+  if (verifier->Finish(&stats)) {
+    printf("Verify failed\n");
+    return -1;
+  }
+
+  printf("Verify: %lld frames, %lld decode error(s), SNR %.1f dB over %lld "
+         "samples/channel, delay %d\n",
+         static_cast<long long>(stats.frames),
+         static_cast<long long>(stats.decode_errors), stats.snr,
+         static_cast<long long>(stats.num_samples), stats.delay);
+  if (stats.decode_errors > 0 || stats.num_samples == 0 ||
+      stats.snr < min_snr) {
+    printf("Verify failed, the output does not decode to the input\n");
+    return -1;
+  }
+  return 0;
+}
+
+// The MP4 index is only written on close, so a resumable encode collects its
+// frames in a .part file, each after its size as 2 bytes big-endian, and
+// builds the M4A file from that at the end.
+static int32_t WritePartFrame(FILE* part, const uint8_t* data, int32_t size) {
+  uint8_t header[2] = {static_cast<uint8_t>(size >> 8),
+                       static_cast<uint8_t>(size & 0xff)};
+  if (fwrite(header, 1, 2, part) != 2 ||
+      fwrite(data, 1, size, part) != static_cast<size_t>(size)) {
+    return -1;
+  }
+  return 2 + size;
+}
+
+static int32_t MuxPart(const char* part_filename, M4aWriter* m4a_writer) {
+  std::unique_ptr<FILE, decltype(&fclose)> part(fopen(part_filename, "rb"),
+                                                &fclose);
+  if (part == nullptr) {
+    printf("Open %s failed\n", part_filename);
+    return -1;
+  }
+
+  uint8_t buf[64 * 1024];
+  while (1) {
+    uint8_t header[2];
+    size_t n = fread(header, 1, 2, part.get());
+    if (n == 0) {
+      break;
+    }
+    int32_t size = (header[0] << 8) | header[1];
+    if (n != 2 ||
+        fread(buf, 1, size, part.get()) != static_cast<size_t>(size)) {
+      printf("Truncated frame in %s\n", part_filename);
+      return -1;
+    }
+    if (m4a_writer->Write(buf, size)) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
 static int32_t EncodeM4a(const char* infile,
                          const char* outfile,
-                         int32_t aot,
-                         int32_t bitrate) {
+                         const EncodeOptions& options) {
   auto wav_reader = std::make_unique<WavReader>();
   int32_t ret = wav_reader->Open(infile);
   if (ret) {
@@ -54,10 +210,72 @@ static int32_t EncodeM4a(const char* infile,
     return -1;
   }
 
+  if (options.follow) {
+    ret = wav_reader->SetFollow(true, options.follow_timeout);
+    if (ret) {
+      printf("Follow wav file failed\n");
+      return -1;
+    }
+  }
+
+  std::unique_ptr<EncodeCheckpoint> checkpoint;
+  std::unique_ptr<FILE, decltype(&fclose)> part(nullptr, &fclose);
+  std::string part_filename = std::string(outfile) + ".part";
+  EncodeCheckpointState state = {0};
+  bool resume = false;
+  if (options.checkpoint > 0) {
+    EncodeCheckpointParams encode_params;
+    encode_params.format = "m4a";
+    encode_params.aot = options.aot;
+    encode_params.bitrate = options.bitrate;
+    encode_params.bitrate_mode = options.bitrate_mode;
+    encode_params.preset = options.preset;
+    encode_params.sample_rate = wav_file_info.sample_rate;
+    encode_params.channels = wav_file_info.channels;
+    encode_params.bits_per_sample = wav_file_info.bits_per_sample;
+    std::string params;
+    ret = EncodeCheckpoint::MakeParams(infile, encode_params, &params);
+    if (ret) {
+      return -1;
+    }
+
+    std::string filename = std::string(outfile) + ".ckpt";
+    checkpoint = std::make_unique<EncodeCheckpoint>();
+    ret = checkpoint->Open(filename.c_str(), params);
+    if (ret) {
+      return -1;
+    }
+
+    resume = checkpoint->Load(&state) == 0;
+    if (resume) {
+      part.reset(EncodeCheckpoint::OpenForResume(part_filename.c_str(),
+                                                 state.output_bytes));
+      if (part == nullptr) {
+        printf("Partial output '%s' is gone, starting over\n",
+               part_filename.c_str());
+        resume = false;
+      }
+    }
+    if (!resume) {
+      memset(&state, 0, sizeof(state));
+      part.reset(fopen(part_filename.c_str(), "wb"));
+    }
+    if (part == nullptr) {
+      printf("Open %s failed\n", part_filename.c_str());
+      return -1;
+    }
+  }
+
   auto aac_encoder = std::make_unique<AacEncoder>();
-  ret =
-      aac_encoder->Init(AAC_TRANSPORT_TYPE_RAW, aot, wav_file_info.sample_rate,
-                        wav_file_info.channels, bitrate);
+  AacEncoderConfig aac_encoder_config = {0};
+  aac_encoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  aac_encoder_config.aot = options.aot;
+  aac_encoder_config.sample_rate = wav_file_info.sample_rate;
+  aac_encoder_config.channels = wav_file_info.channels;
+  aac_encoder_config.bitrate = options.bitrate;
+  aac_encoder_config.bitrate_mode = options.bitrate_mode;
+  aac_encoder_config.preset = options.preset;
+  ret = aac_encoder->Init(aac_encoder_config);
   if (ret) {
     printf("Init aac raw encoder failed\n");
     return -1;
@@ -71,16 +289,62 @@ static int32_t EncodeM4a(const char* infile,
   }
 
   auto m4a_writer = std::make_unique<M4aWriter>();
-  ret = m4a_writer->Open(outfile, aot, wav_file_info.sample_rate,
-                         aac_encoder_info.frame_length, aac_encoder_info.conf,
-                         aac_encoder_info.conf_size);
-  if (ret) {
-    printf("Open m4a file failed, %s\n", infile);
-    return -1;
+  if (!checkpoint) {
+    ret = m4a_writer->Open(outfile, options.aot, wav_file_info.sample_rate,
+                           aac_encoder_info.frame_length,
+                           aac_encoder_info.conf, aac_encoder_info.conf_size);
+    if (ret) {
+      printf("Open m4a file failed, %s\n", infile);
+      return -1;
+    }
+  }
+
+  PrintEncoderInfo(infile, outfile, options, wav_file_info, aac_encoder_info);
+
+  // A new encoder goes back a few frames before the checkpoint, and its
+  // output up to the checkpoint is dropped.
+  int32_t drop_frames = 0;
+  if (resume) {
+    int64_t input_sample = 0;
+    EncodeCheckpoint::ResumePoint(
+        state.frames, aac_encoder_info.frame_length, aac_encoder_info.delay,
+        ENCODE_CHECKPOINT_PREROLL_FRAMES, &input_sample, &drop_frames);
+    ret = wav_reader->Seek(input_sample);
+    if (ret) {
+      return -1;
+    }
+    state.input_samples = input_sample;
+    printf("Resume: frame %lld, %d frame(s) of pre-roll from sample %lld\n",
+           static_cast<long long>(state.frames), drop_frames,
+           static_cast<long long>(input_sample));
   }
+  int64_t checkpoint_frames =
+      std::max<int64_t>(1, static_cast<int64_t>(options.checkpoint) *
+                               wav_file_info.sample_rate /
+                               aac_encoder_info.frame_length);
+  int64_t next_checkpoint = state.frames + checkpoint_frames;
 
-  PrintEncoderInfo(infile, outfile, aot, bitrate, wav_file_info,
-                   aac_encoder_info);
+  std::unique_ptr<AacTelemetryRing> telemetry_ring;
+  std::unique_ptr<AacTelemetryWriter> telemetry_writer;
+  if (options.telemetry != nullptr) {
+    telemetry_ring = std::make_unique<AacTelemetryRing>();
+    telemetry_writer = std::make_unique<AacTelemetryWriter>();
+    ret = StartTelemetry(options.telemetry, aac_encoder_config,
+                         aac_encoder_info, aac_encoder.get(),
+                         telemetry_ring.get(), telemetry_writer.get());
+    if (ret) {
+      return -1;
+    }
+  }
+
+  std::unique_ptr<AacVerifier> verifier;
+  if (options.verify) {
+    verifier = std::make_unique<AacVerifier>();
+    ret = StartVerifier(aac_encoder_config, aac_encoder_info, verifier.get());
+    if (ret) {
+      return -1;
+    }
+  }
 
   int32_t frame_size_in_bytes =
       wav_file_info.channels * 2 * aac_encoder_info.frame_length;
@@ -88,26 +352,162 @@ static int32_t EncodeM4a(const char* infile,
   auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
   auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
 
+  std::unique_ptr<SilenceDetector> silence_detector;
+  if (options.dtx) {
+    silence_detector = std::make_unique<SilenceDetector>();
+    ret = silence_detector->Init(options.dtx_threshold, options.dtx_hangover);
+    if (ret) {
+      printf("Init silence detector failed\n");
+      return -1;
+    }
+  }
+
+  // With DTX the last encoded frame is held back, frames skipped after it are
+  // added to its sample duration, so the track timeline is kept.
+  auto pending_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  int32_t pending_size = 0;
+  int32_t pending_duration = 0;
+  int64_t num_frames = 0;
+  int64_t num_skipped_frames = 0;
+
+  std::unique_ptr<LoudnessMeter> loudness_meter;
+  if (options.analyze) {
+    loudness_meter = std::make_unique<LoudnessMeter>();
+    ret = loudness_meter->Init(wav_file_info.sample_rate,
+                               wav_file_info.channels);
+    if (ret) {
+      printf("Init loudness meter failed\n");
+      return -1;
+    }
+  }
+
+  int32_t status = 0;
   while (1) {
     int32_t read_bytes = wav_reader->Read(input_buf.get(), frame_size_in_bytes);
     if (read_bytes < 0) {
       printf("Read wav file failed\n");
+      status = -1;
       break;
     }
+    state.input_samples += read_bytes / (wav_file_info.channels * 2);
+    if (verifier) {
+      verifier->PushSource(input_buf.get(), read_bytes);
+    }
+
+    if (loudness_meter) {
+      loudness_meter->Process(input_buf.get(), read_bytes);
+    }
+
+    if (silence_detector && read_bytes > 0) {
+      num_frames += 1;
+      bool active = silence_detector->IsActive(input_buf.get(), read_bytes);
+      if (!active && pending_size > 0 && read_bytes == frame_size_in_bytes) {
+        pending_duration += aac_encoder_info.frame_length;
+        num_skipped_frames += 1;
+        continue;
+      }
+    }
 
     int32_t out_size_bytes = frame_size_in_bytes;
     int32_t ret = aac_encoder->GetEncoded(input_buf.get(), read_bytes,
                                           output_buf.get(), &out_size_bytes);
+    if (telemetry_writer) {
+      telemetry_writer->Drain(telemetry_ring.get());
+    }
     if (ret) {
+      // The flushed encoder ends the input with EOF
+      bool eof = false;
+      PrintEncoderErrors(aac_encoder.get(), &eof);
+      if (!eof) {
+        status = -1;
+      }
       break;
     } else if (out_size_bytes == 0) {
       continue;
     }
+    if (verifier) {
+      verifier->PushFrame(output_buf.get(), out_size_bytes);
+    }
+    if (drop_frames > 0) {
+      drop_frames -= 1;
+      continue;
+    }
 
-    m4a_writer->Write(output_buf.get(), out_size_bytes);
+    if (part) {
+      int32_t written =
+          WritePartFrame(part.get(), output_buf.get(), out_size_bytes);
+      if (written < 0) {
+        printf("Write %s failed\n", part_filename.c_str());
+        status = -1;
+        break;
+      }
+      state.frames += 1;
+      state.output_bytes += written;
+      if (state.frames >= next_checkpoint) {
+        // A failed checkpoint only costs the work since the last one
+        checkpoint->Save(part.get(), state);
+        next_checkpoint = state.frames + checkpoint_frames;
+      }
+      continue;
+    }
+
+    if (!silence_detector) {
+      m4a_writer->Write(output_buf.get(), out_size_bytes);
+      continue;
+    }
+
+    if (pending_size > 0) {
+      m4a_writer->Write(pending_buf.get(), pending_size, pending_duration);
+    }
+    memcpy(pending_buf.get(), output_buf.get(), out_size_bytes);
+    pending_size = out_size_bytes;
+    pending_duration = aac_encoder_info.frame_length;
   }
 
-  return 0;
+  if (silence_detector) {
+    if (pending_size > 0) {
+      m4a_writer->Write(pending_buf.get(), pending_size, pending_duration);
+    }
+    printf("DTX: %lld of %lld frames skipped\n",
+           static_cast<long long>(num_skipped_frames),
+           static_cast<long long>(num_frames));
+  }
+
+  if (loudness_meter) {
+    std::string report = std::string(outfile) + ".json";
+    if (loudness_meter->WriteReport(report.c_str(), infile) == 0) {
+      printf("Analysis: '%s'\n", report.c_str());
+    }
+  }
+
+  if (verifier && FinishVerifier(verifier.get(), options.verify_snr)) {
+    status = -1;
+  }
+
+  if (checkpoint && status == 0) {
+    part.reset();
+    ret = m4a_writer->Open(outfile, options.aot, wav_file_info.sample_rate,
+                           aac_encoder_info.frame_length,
+                           aac_encoder_info.conf, aac_encoder_info.conf_size);
+    if (ret || MuxPart(part_filename.c_str(), m4a_writer.get())) {
+      printf("Write m4a file failed, %s\n", outfile);
+      status = -1;
+    } else {
+      m4a_writer->Close();
+      unlink(part_filename.c_str());
+      checkpoint->Remove();
+    }
+  }
+
+  if (telemetry_writer) {
+    if (telemetry_writer->Close()) {
+      status = -1;
+    }
+    printf("Telemetry: '%s', %u records dropped\n", options.telemetry,
+           telemetry_ring->Dropped());
+  }
+
+  return status;
 }
 
 int main(int argc, char* argv[]) {
@@ -119,8 +519,8 @@ int main(int argc, char* argv[]) {
   parser.helpParams.addChoices = true;
   parser.helpParams.useValueNameOnce = true;
 
-  args::Positional<std::string> wav_file(parser, "Input", "WAV file",
-                                         args::Options::Required);
+  args::Positional<std::string> wav_file(
+      parser, "Input", "WAV file, - for stdin", args::Options::Required);
   args::Positional<std::string> m4a_file(parser, "Output", "M4A file",
                                          args::Options::Required);
   args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
@@ -142,6 +542,56 @@ int main(int argc, char* argv[]) {
 
   args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
                                    {'b', "bitrate"}, 64000);
+  args::ValueFlag<int32_t> bitrate_mode(
+      parser, "mode", "Bitrate mode, 0: CBR, 1~5: VBR(low to high quality)",
+      {'m', "bitrate-mode"}, 0);
+
+  args::MapFlag<std::string, int> preset(
+      parser, "preset", "Speed/quality preset", {'p', "preset"},
+      {{"fast", AAC_COMMON_PRESET_FAST},
+       {"quality", AAC_COMMON_PRESET_QUALITY}},
+      AAC_COMMON_PRESET_DEFAULT);
+  preset.HelpChoices({"fast", "quality"});
+  preset.HelpDefault(get_preset_info(AAC_COMMON_PRESET_DEFAULT)->friendly_name);
+
+  args::Flag dtx(parser, "dtx", "Skip encoding of silent frames", {"dtx"});
+  args::ValueFlag<double> dtx_threshold(parser, "dBFS",
+                                        "Level below which a frame is silent",
+                                        {"dtx-threshold"}, -60.0);
+  args::ValueFlag<int32_t> dtx_hangover(
+      parser, "frames", "Frames still encoded after the level drops",
+      {"dtx-hangover"}, 8);
+  args::Flag analyze(parser, "analyze",
+                     "Write loudness, true peak and RMS to <Output>.json",
+                     {"analyze"});
+  args::Flag follow(parser, "follow",
+                    "Keep encoding while the input is still being written",
+                    {'f', "follow"});
+  args::ValueFlag<int32_t> follow_timeout(
+      parser, "seconds", "End of input once it has not grown for this long",
+      {"follow-timeout"}, 10);
+  args::ValueFlag<std::string> cache_dir(
+      parser, "dir", "Reuse outputs of identical encodes from this directory",
+      {"cache-dir"});
+  args::ValueFlag<int64_t> cache_size(parser, "MB", "Size limit of the cache",
+                                      {"cache-size"}, 1024);
+  args::ValueFlag<std::string> telemetry(
+      parser, "file",
+      "Log bytes, bit reservoir and bitrate of every frame, see "
+      "aac_telemetry_csv",
+      {"telemetry"});
+  args::ValueFlag<int32_t> checkpoint(
+      parser, "seconds",
+      "Save progress to <Output>.ckpt this often, a killed encode run again "
+      "continues from there",
+      {"checkpoint"}, 0);
+  args::Flag verify(parser, "verify",
+                    "Decode the output while encoding, fail on decode errors "
+                    "or a low SNR against the input",
+                    {"verify"});
+  args::ValueFlag<double> verify_snr(parser, "dB",
+                                     "Lowest SNR the output may decode to",
+                                     {"verify-snr"}, 8.0);
 
   bool ret = parser.ParseCLI(argc, argv);
   if (!ret) {
@@ -164,9 +614,98 @@ int main(int argc, char* argv[]) {
   } else if (aot.GetError() != args::Error::None) {
     std::cout << aot.GetErrorMsg() << std::endl;
     return -1;
+  } else if (preset.GetError() != args::Error::None) {
+    std::cout << preset.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (follow_timeout.Get() <= 0) {
+    std::cout << "Invalid follow timeout, " << follow_timeout.Get()
+              << std::endl;
+    return -1;
+  } else if (m4a_file.Get() == "-") {
+    std::cout << "M4A output needs a seekable file" << std::endl;
+    return -1;
+  } else if (follow.Get() && wav_file.Get() == "-") {
+    std::cout << "--follow needs a file as input" << std::endl;
+    return -1;
+  } else if (cache_dir && wav_file.Get() == "-") {
+    std::cout << "--cache-dir needs a file as input" << std::endl;
+    return -1;
+  } else if (follow.Get() && cache_dir) {
+    std::cout << "--follow can not be used with --cache-dir" << std::endl;
+    return -1;
+  } else if (cache_dir && (verify.Get() || telemetry)) {
+    // A cache hit does not encode, there is nothing to verify or log
+    std::cout << "--cache-dir can not be used with --verify or --telemetry"
+              << std::endl;
+    return -1;
+  } else if (cache_size.Get() <= 0) {
+    std::cout << "Invalid cache size, " << cache_size.Get() << std::endl;
+    return -1;
+  } else if (bitrate_mode.Get() < 0 || bitrate_mode.Get() > 5) {
+    std::cout << "Invalid bitrate mode, " << bitrate_mode.Get() << std::endl;
+    return -1;
+  } else if (checkpoint.Get() < 0) {
+    std::cout << "Invalid checkpoint interval, " << checkpoint.Get()
+              << std::endl;
+    return -1;
+  } else if (checkpoint.Get() > 0 && wav_file.Get() == "-") {
+    std::cout << "--checkpoint needs a file as input" << std::endl;
+    return -1;
+  } else if (checkpoint.Get() > 0 &&
+             (dtx.Get() || analyze.Get() || follow.Get() || cache_dir)) {
+    std::cout << "--checkpoint can not be used with --dtx, --analyze, "
+                 "--follow or --cache-dir"
+              << std::endl;
+    return -1;
+  } else if (verify.Get() && (dtx.Get() || checkpoint.Get() > 0)) {
+    // A resumed encode has not seen the input before the checkpoint
+    std::cout << "--verify can not be used with --dtx or --checkpoint"
+              << std::endl;
+    return -1;
   }
 
-  EncodeM4a(wav_file.Get().c_str(), m4a_file.Get().c_str(), aot.Get(),
-            bitrate.Get());
-  return 0;
+  EncodeOptions options;
+  options.aot = aot.Get();
+  options.bitrate = bitrate.Get();
+  options.bitrate_mode = bitrate_mode.Get();
+  options.preset = preset.Get();
+  options.dtx = dtx.Get();
+  options.dtx_threshold = dtx_threshold.Get();
+  options.dtx_hangover = dtx_hangover.Get();
+  options.analyze = analyze.Get();
+  options.follow = follow.Get();
+  options.follow_timeout = follow_timeout.Get() * 1000;
+  options.telemetry = telemetry ? telemetry.Get().c_str() : nullptr;
+  options.checkpoint = checkpoint.Get();
+  options.verify = verify.Get();
+  options.verify_snr = verify_snr.Get();
+
+  const char* infile = wav_file.Get().c_str();
+  const char* outfile = m4a_file.Get().c_str();
+  int32_t status = 0;
+  auto encode_cache = std::make_unique<EncodeCache>();
+  if (cache_dir && encode_cache->Open(cache_dir.Get().c_str(),
+                                      cache_size.Get() * 1024 * 1024) == 0) {
+    EncodeCacheParams params;
+    params.format = "m4a";
+    params.aot = options.aot;
+    params.bitrate = options.bitrate;
+    params.bitrate_mode = options.bitrate_mode;
+    params.preset = options.preset;
+    params.dtx = options.dtx;
+    params.dtx_threshold = options.dtx_threshold;
+    params.dtx_hangover = options.dtx_hangover;
+    std::string report = std::string(outfile) + ".json";
+
+    // The report is written by the hashing pass of the cache
+    EncodeOptions encode_options = options;
+    encode_options.analyze = false;
+    status = encode_cache->Encode(
+        infile, outfile, params, options.analyze ? report.c_str() : nullptr,
+        [&]() { return EncodeM4a(infile, outfile, encode_options); });
+  } else {
+    status = EncodeM4a(infile, outfile, options);
+  }
+  // A failed encode, or one that did not verify, fails the job
+  return status;
 }
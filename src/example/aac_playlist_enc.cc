@@ -0,0 +1,379 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aac_encoder.h"
+#include "args.hxx"
+#include "m4a_writer.h"
+#include "wav_reader.h"
+
+struct PlaylistOptions {
+  int32_t aot;
+  int32_t bitrate;
+  int32_t bitrate_mode;
+  int32_t preset;
+};
+
+// Samples per channel of a track in the continuous input, and the frames of
+// the continuous output its own file is cut from
+struct PlaylistTrack {
+  std::string infile;
+  std::string outfile;
+  int64_t start;
+  int64_t end;
+  int64_t first_frame;
+  int64_t last_frame;
+  std::unique_ptr<M4aWriter> writer;
+};
+
+static std::string TrackFileName(const std::string& outdir,
+                                 const std::string& infile) {
+  std::string name = infile;
+  size_t slash = name.find_last_of('/');
+  if (slash != std::string::npos) {
+    name = name.substr(slash + 1);
+  }
+  size_t dot = name.find_last_of('.');
+  if (dot != std::string::npos && dot > 0) {
+    name = name.substr(0, dot);
+  }
+  return outdir + "/" + name + ".m4a";
+}
+
+static int32_t ProbeTracks(const std::vector<std::string>& wav_files,
+                           WavFileInfo* wav_file_info,
+                           std::vector<PlaylistTrack>* tracks) {
+  int64_t start = 0;
+  for (const auto& wav_file : wav_files) {
+    auto wav_reader = std::make_unique<WavReader>();
+    WavFileInfo info = {0};
+    if (wav_reader->Open(wav_file.c_str()) || wav_reader->GetInfo(&info)) {
+      printf("Open wav file failed, %s\n", wav_file.c_str());
+      return -1;
+    }
+    if (info.bits_per_sample != 16) {
+      printf("Only 16 bits/sample is supported, %s has %d\n",
+             wav_file.c_str(), info.bits_per_sample);
+      return -1;
+    } else if (tracks->empty()) {
+      *wav_file_info = info;
+    } else if (info.sample_rate != wav_file_info->sample_rate ||
+               info.channels != wav_file_info->channels ||
+               info.bits_per_sample != wav_file_info->bits_per_sample) {
+      printf("Format mismatch, %s is %d Hz %d ch(s) %d bits, %d Hz %d ch(s) "
+             "%d bits expected\n",
+             wav_file.c_str(), info.sample_rate, info.channels,
+             info.bits_per_sample, wav_file_info->sample_rate,
+             wav_file_info->channels, wav_file_info->bits_per_sample);
+      return -1;
+    }
+
+    PlaylistTrack track;
+    track.infile = wav_file;
+    track.start = start;
+    track.end = start + info.data_length / (info.channels * 2);
+    track.first_frame = 0;
+    track.last_frame = -1;
+    start = track.end;
+    tracks->push_back(std::move(track));
+  }
+  return 0;
+}
+
+static void PrintEncoderErrors(AacEncoder* aac_encoder, bool* eof) {
+  AacError error;
+  while (aac_encoder->PopError(&error) == 0) {
+    if (error.code == AAC_COMMON_ERROR_ENCODE_EOF) {
+      *eof = true;
+      continue;
+    }
+    printf("%s, %d\n", get_error_name(error.code), error.detail);
+  }
+}
+
+// All tracks go through one encoder as one continuous signal, which is cut
+// into frames: decoded sample j is input sample j - delay, so a track covers
+// [start + delay, end + delay) of the decoded stream. Its own file takes the
+// frames over that range, plus |preroll| frames before it for the overlap of
+// the transform(and the SBR filterbanks) to build up, and the samples beyond
+// the range are trimmed by the gapless info. With |outdir| empty all frames go
+// to |outfile| instead, trimmed by the delay and the final padding.
+static int32_t EncodePlaylist(std::vector<PlaylistTrack>* tracks,
+                              const WavFileInfo& wav_file_info,
+                              const char* outfile,
+                              const std::string& outdir,
+                              const PlaylistOptions& options) {
+  auto aac_encoder = std::make_unique<AacEncoder>();
+  AacEncoderConfig aac_encoder_config = {0};
+  aac_encoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  aac_encoder_config.aot = options.aot;
+  aac_encoder_config.sample_rate = wav_file_info.sample_rate;
+  aac_encoder_config.channels = wav_file_info.channels;
+  aac_encoder_config.bitrate = options.bitrate;
+  aac_encoder_config.bitrate_mode = options.bitrate_mode;
+  aac_encoder_config.preset = options.preset;
+  if (aac_encoder->Init(aac_encoder_config)) {
+    printf("Init aac raw encoder failed\n");
+    return -1;
+  }
+
+  AacEncoderInfo aac_encoder_info;
+  if (aac_encoder->GetInfo(&aac_encoder_info)) {
+    printf("Get info of aac encoder failed\n");
+    return -1;
+  }
+  const int32_t frame_length = aac_encoder_info.frame_length;
+  const int64_t delay = aac_encoder_info.delay;
+  const bool sbr = (options.aot == AAC_COMMON_AOT_HE ||
+                    options.aot == AAC_COMMON_AOT_HEv2);
+  const int64_t preroll = sbr ? 2 : 1;
+  print_aac_lib_info();
+  printf("%s, %d Hz, %d ch(s), frame length %d, delay %lld, %zu tracks\n",
+         get_aot_name(options.aot, 0), wav_file_info.sample_rate,
+         wav_file_info.channels, frame_length, static_cast<long long>(delay),
+         tracks->size());
+
+  for (auto& track : *tracks) {
+    track.first_frame =
+        std::max<int64_t>(0, (track.start + delay) / frame_length - preroll);
+    track.last_frame =
+        (track.end + delay + frame_length - 1) / frame_length - 1;
+    if (!outdir.empty()) {
+      track.outfile = TrackFileName(outdir, track.infile);
+    }
+  }
+
+  std::unique_ptr<M4aWriter> m4a_writer;
+  if (outdir.empty()) {
+    m4a_writer = std::make_unique<M4aWriter>();
+    if (m4a_writer->Open(outfile, options.aot, wav_file_info.sample_rate,
+                         frame_length, aac_encoder_info.conf,
+                         aac_encoder_info.conf_size)) {
+      printf("Open m4a file failed, %s\n", outfile);
+      return -1;
+    }
+  }
+
+  int32_t frame_size_in_bytes = wav_file_info.channels * 2 * frame_length;
+  auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+
+  // Frames are filled across track boundaries, only the last one is short
+  size_t next_track = 0;
+  std::unique_ptr<WavReader> wav_reader;
+  int64_t track_bytes = 0;
+  int64_t frame = 0;
+  int32_t status = 0;
+  bool eof = false;
+  while (!eof) {
+    int32_t filled = 0;
+    while (filled < frame_size_in_bytes && next_track <= tracks->size()) {
+      if (!wav_reader) {
+        if (next_track == tracks->size()) {
+          break;
+        }
+        wav_reader = std::make_unique<WavReader>();
+        if (wav_reader->Open((*tracks)[next_track].infile.c_str())) {
+          printf("Open wav file failed, %s\n",
+                 (*tracks)[next_track].infile.c_str());
+          return -1;
+        }
+      }
+      int32_t read_bytes = wav_reader->Read(input_buf.get() + filled,
+                                            frame_size_in_bytes - filled);
+      if (read_bytes < 0) {
+        printf("Read wav file failed, %s\n",
+               (*tracks)[next_track].infile.c_str());
+        return -1;
+      } else if (read_bytes == 0) {
+        // The cut points were computed from the headers
+        const PlaylistTrack& track = (*tracks)[next_track];
+        if (track_bytes !=
+            (track.end - track.start) * wav_file_info.channels * 2) {
+          printf("Read wav file failed, %s is shorter than its header\n",
+                 track.infile.c_str());
+          return -1;
+        }
+        wav_reader.reset();
+        track_bytes = 0;
+        next_track += 1;
+        continue;
+      }
+      filled += read_bytes;
+      track_bytes += read_bytes;
+    }
+
+    // An empty input flushes the encoder, until EOF
+    int32_t out_size_bytes = frame_size_in_bytes;
+    if (aac_encoder->GetEncoded(input_buf.get(), filled, output_buf.get(),
+                                &out_size_bytes)) {
+      PrintEncoderErrors(aac_encoder.get(), &eof);
+      if (!eof) {
+        status = -1;
+      }
+      break;
+    } else if (out_size_bytes == 0) {
+      continue;
+    }
+
+    if (m4a_writer) {
+      m4a_writer->Write(output_buf.get(), out_size_bytes);
+    }
+    for (auto& track : *tracks) {
+      if (m4a_writer || frame < track.first_frame ||
+          frame > track.last_frame || track.start == track.end) {
+        continue;
+      }
+      if (frame == track.first_frame) {
+        track.writer = std::make_unique<M4aWriter>();
+        if (track.writer->Open(track.outfile.c_str(), options.aot,
+                               wav_file_info.sample_rate, frame_length,
+                               aac_encoder_info.conf,
+                               aac_encoder_info.conf_size)) {
+          printf("Open m4a file failed, %s\n", track.outfile.c_str());
+          track.writer.reset();
+          status = -1;
+        }
+      }
+      if (!track.writer) {
+        continue;
+      }
+      track.writer->Write(output_buf.get(), out_size_bytes);
+      if (frame == track.last_frame) {
+        track.writer->SetGapless(
+            track.start + delay - track.first_frame * frame_length,
+            (track.last_frame + 1) * frame_length - (track.end + delay));
+        track.writer->Close();
+        track.writer.reset();
+        printf("Track: '%s', frames %lld~%lld\n", track.outfile.c_str(),
+               static_cast<long long>(track.first_frame),
+               static_cast<long long>(track.last_frame));
+      }
+    }
+    frame += 1;
+  }
+
+  const int64_t total = tracks->empty() ? 0 : tracks->back().end;
+  for (auto& track : *tracks) {
+    if (track.writer) {
+      // The encoder ended before the last frame of the track
+      printf("Track '%s' is incomplete\n", track.outfile.c_str());
+      track.writer->Close();
+      status = -1;
+    }
+  }
+  if (m4a_writer) {
+    m4a_writer->SetGapless(delay, frame * frame_length - delay - total);
+    m4a_writer->Close();
+    printf("Output: '%s', frames %lld\n", outfile,
+           static_cast<long long>(frame));
+  }
+  printf("Samples: %lld, frames: %lld, encoder opened once\n",
+         static_cast<long long>(total), static_cast<long long>(frame));
+  return status;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Encode an ordered list of WAV files gaplessly through one encoder, to "
+      "one M4A file or to one M4A file per track.\nTracks need the same "
+      "format, only support 1 or 2 channel(s)");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::PositionalList<std::string> wav_files(
+      parser, "Input", "WAV files in playing order", args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> output(parser, "output", "M4A file of all",
+                                      {'o', "output"});
+  args::ValueFlag<std::string> split(
+      parser, "dir",
+      "One M4A file per track in this directory, named after the input",
+      {"split"});
+
+  args::MapFlag<std::string, int> aot(
+      parser, "AOT", "Audio Object Type", {'a', "aot"},
+      {{std::to_string(AAC_COMMON_AOT_LC), AAC_COMMON_AOT_LC},
+       {std::to_string(AAC_COMMON_AOT_HE), AAC_COMMON_AOT_HE},
+       {std::to_string(AAC_COMMON_AOT_HEv2), AAC_COMMON_AOT_HEv2}},
+      AAC_COMMON_AOT_LC);
+  aot.HelpChoices({std::to_string(AAC_COMMON_AOT_LC) + "(LC)",
+                   std::to_string(AAC_COMMON_AOT_HE) + "(HE)",
+                   std::to_string(AAC_COMMON_AOT_HEv2) + "(HEv2)"});
+  aot.HelpDefault(std::to_string(AAC_COMMON_AOT_LC));
+
+  args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
+                                   {'b', "bitrate"}, 128000);
+  args::ValueFlag<int32_t> bitrate_mode(
+      parser, "mode", "Bitrate mode, 0: CBR, 1~5: VBR(low to high quality)",
+      {'m', "bitrate-mode"}, 0);
+
+  args::MapFlag<std::string, int> preset(
+      parser, "preset", "Speed/quality preset", {'p', "preset"},
+      {{"fast", AAC_COMMON_PRESET_FAST},
+       {"quality", AAC_COMMON_PRESET_QUALITY}},
+      AAC_COMMON_PRESET_DEFAULT);
+  preset.HelpChoices({"fast", "quality"});
+  preset.HelpDefault(get_preset_info(AAC_COMMON_PRESET_DEFAULT)->friendly_name);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_files.GetError() != args::Error::None) {
+    std::cout << wav_files.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (aot.GetError() != args::Error::None) {
+    std::cout << aot.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (preset.GetError() != args::Error::None) {
+    std::cout << preset.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (output.Get().empty() == split.Get().empty()) {
+    std::cout << "Either --output or --split is needed" << std::endl;
+    return -1;
+  } else if (bitrate_mode.Get() < 0 || bitrate_mode.Get() > 5) {
+    std::cout << "Invalid bitrate mode, " << bitrate_mode.Get() << std::endl;
+    return -1;
+  }
+  for (const auto& wav_file : wav_files.Get()) {
+    if (wav_file == "-") {
+      std::cout << "Inputs need to be files" << std::endl;
+      return -1;
+    }
+  }
+
+  PlaylistOptions options;
+  options.aot = aot.Get();
+  options.bitrate = bitrate.Get();
+  options.bitrate_mode = bitrate_mode.Get();
+  options.preset = preset.Get();
+
+  WavFileInfo wav_file_info = {0};
+  std::vector<PlaylistTrack> tracks;
+  if (ProbeTracks(wav_files.Get(), &wav_file_info, &tracks)) {
+    return -1;
+  }
+  return EncodePlaylist(&tracks, wav_file_info, output.Get().c_str(),
+                        split.Get(), options) == 0
+             ? 0
+             : -1;
+}
@@ -0,0 +1,418 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_adts_reader.h"
+#include "aac_common.h"
+#include "aac_decoder.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "m4a_reader.h"
+
+#define AAC_PROBE_MAX_FRAME_SIZE 65536
+#define AAC_PROBE_OUT_BUF_SIZE (8 * 2048 * 2)
+// Frames fed to the decoder at most before giving up on --deep
+#define AAC_PROBE_DEEP_FRAMES 8
+
+struct ProbeResult {
+  std::string filename;
+  std::string format;  // "adts" or "m4a"
+  std::string error;
+
+  asc_info asc;
+  int64_t frames;
+  int64_t total_bytes;
+  double duration;  // seconds
+  int64_t avg_bitrate;
+  int64_t peak_bitrate;  // over any 1 second
+  int32_t min_frame_size;
+  int32_t max_frame_size;
+  int32_t frame_size_p50;
+  int32_t frame_size_p95;
+  int32_t frame_size_p99;
+
+  AacAdtsReaderStats adts_stats;
+
+  bool deep;
+  AacDecoderInfo decoder_info;
+};
+
+// Frame sizes and bitrate, fed with one frame at a time in file order.
+class FrameStats {
+ public:
+  explicit FrameStats(int64_t timescale)
+      : timescale_(timescale),
+        time_(0),
+        frames_(0),
+        total_bytes_(0),
+        window_bytes_(0),
+        max_window_bytes_(0),
+        histogram_(AAC_PROBE_MAX_FRAME_SIZE + 1, 0) {}
+
+  void Add(int32_t size, int64_t duration) {
+    frames_ += 1;
+    total_bytes_ += size;
+    histogram_[std::min(size, AAC_PROBE_MAX_FRAME_SIZE)] += 1;
+
+    // Frames that started within the last second
+    window_.push_back({time_, size});
+    window_bytes_ += size;
+    time_ += duration;
+    while (!window_.empty() && window_.front().first + timescale_ < time_) {
+      window_bytes_ -= window_.front().second;
+      window_.pop_front();
+    }
+    max_window_bytes_ = std::max(max_window_bytes_, window_bytes_);
+  }
+
+  void Fill(ProbeResult* result) const {
+    result->frames = frames_;
+    result->total_bytes = total_bytes_;
+    result->duration =
+        timescale_ > 0 ? static_cast<double>(time_) / timescale_ : 0;
+    result->avg_bitrate =
+        time_ > 0 ? total_bytes_ * 8 * timescale_ / time_ : 0;
+    // A file shorter than 1 second peaks at its average
+    result->peak_bitrate = time_ >= timescale_ ? max_window_bytes_ * 8
+                                               : result->avg_bitrate;
+    result->min_frame_size = Percentile(0);
+    result->max_frame_size = Percentile(100);
+    result->frame_size_p50 = Percentile(50);
+    result->frame_size_p95 = Percentile(95);
+    result->frame_size_p99 = Percentile(99);
+  }
+
+ private:
+  int32_t Percentile(int32_t percent) const {
+    if (frames_ == 0) {
+      return 0;
+    }
+    int64_t rank = std::max<int64_t>(1, (frames_ * percent + 99) / 100);
+    int64_t count = 0;
+    for (int32_t size = 0; size <= AAC_PROBE_MAX_FRAME_SIZE; ++size) {
+      count += histogram_[size];
+      if (count >= rank) {
+        return size;
+      }
+    }
+    return AAC_PROBE_MAX_FRAME_SIZE;
+  }
+
+ private:
+  int64_t timescale_;
+  int64_t time_;
+  int64_t frames_;
+  int64_t total_bytes_;
+  std::deque<std::pair<int64_t, int32_t>> window_;
+  int64_t window_bytes_;
+  int64_t max_window_bytes_;
+  std::vector<int64_t> histogram_;
+};
+
+static bool IsAdtsFile(const std::string& filename) {
+  std::string ext = GetExtension(filename);
+  return ext == "aac" || ext == "adts";
+}
+
+static bool IsM4aFile(const std::string& filename) {
+  std::string ext = GetExtension(filename);
+  return ext == "m4a" || ext == "mp4";
+}
+
+// Files are probed by extension, else by their first bytes.
+static bool SniffM4a(const char* filename) {
+  if (IsM4aFile(filename)) {
+    return true;
+  } else if (IsAdtsFile(filename)) {
+    return false;
+  }
+
+  uint8_t head[8] = {0};
+  std::unique_ptr<FILE, decltype(&fclose)> file(fopen(filename, "rb"),
+                                                &fclose);
+  if (file == nullptr || fread(head, 1, sizeof(head), file.get()) != 8) {
+    return false;
+  }
+  return memcmp(head + 4, "ftyp", 4) == 0;
+}
+
+static void ProbeAdts(const char* filename, bool deep, ProbeResult* result) {
+  result->format = "adts";
+
+  auto aac_adts_reader = std::make_unique<AacAdtsReader>();
+  if (aac_adts_reader->Open(filename)) {
+    result->error = "open failed";
+    return;
+  }
+
+  auto frame = std::make_unique<uint8_t[]>(AAC_PROBE_MAX_FRAME_SIZE);
+  std::unique_ptr<FrameStats> frame_stats;
+  std::unique_ptr<AacDecoder> aac_decoder;
+  std::unique_ptr<uint8_t[]> out_buf;
+  int32_t deep_frames = 0;
+  if (deep) {
+    aac_decoder = std::make_unique<AacDecoder>();
+    if (aac_decoder->Init(AAC_TRANSPORT_TYPE_ADTS)) {
+      aac_decoder.reset();
+    }
+    out_buf = std::make_unique<uint8_t[]>(AAC_PROBE_OUT_BUF_SIZE);
+  }
+
+  while (1) {
+    int32_t size = AAC_PROBE_MAX_FRAME_SIZE;
+    if (aac_adts_reader->ReadOneFrame(frame.get(), &size)) {
+      break;
+    }
+
+    const uint8_t* header = frame.get();
+    if (frame_stats == nullptr) {
+      // Only the fixed header, the rest of the stream has to match it.
+      result->asc.aot = ((header[2] >> 6) & 0x03) + 1;
+      result->asc.sample_rate = get_sample_rate((header[2] >> 2) & 0x0f);
+      result->asc.ext_sample_rate = result->asc.sample_rate;
+      result->asc.channel_config =
+          ((header[2] & 0x01) << 2) | ((header[3] >> 6) & 0x03);
+      result->asc.frame_length = 1024;
+      // HE-AAC in ADTS is only signaled implicitly, --deep decodes to know
+      result->asc.sbr = -1;
+      result->asc.ps = -1;
+      frame_stats = std::make_unique<FrameStats>(result->asc.sample_rate);
+    }
+
+    int32_t raw_data_blocks = (header[6] & 0x03) + 1;
+    frame_stats->Add(size, raw_data_blocks * result->asc.frame_length);
+
+    if (aac_decoder && deep_frames < AAC_PROBE_DEEP_FRAMES) {
+      deep_frames += 1;
+      int32_t out_size = AAC_PROBE_OUT_BUF_SIZE;
+      if (aac_decoder->GetDecoded(frame.get(), size, out_buf.get(),
+                                  &out_size) == 0 &&
+          out_size > 0 && aac_decoder->GetInfo(&result->decoder_info) == 0) {
+        result->deep = true;
+        aac_decoder.reset();
+      }
+    }
+  }
+
+  aac_adts_reader->GetStats(&result->adts_stats);
+  if (frame_stats == nullptr) {
+    result->error = "no ADTS frame";
+    return;
+  }
+  frame_stats->Fill(result);
+
+  if (result->deep) {
+    // The decoder found out what the header can not tell
+    result->asc.sbr = result->decoder_info.sbr;
+    result->asc.ps = result->decoder_info.ps;
+    result->asc.ext_sample_rate = result->decoder_info.sample_rate;
+  }
+}
+
+static void ProbeM4a(const char* filename, bool deep, ProbeResult* result) {
+  result->format = "m4a";
+
+  auto m4a_reader = std::make_unique<M4aReader>();
+  if (m4a_reader->Open(filename)) {
+    result->error = "open failed";
+    return;
+  }
+
+  M4aFileInfo m4a_file_info;
+  m4a_reader->GetInfo(&m4a_file_info);
+  if (parse_audio_specific_config(m4a_file_info.conf, m4a_file_info.conf_size,
+                                  &result->asc)) {
+    result->error = "bad AudioSpecificConfig";
+    return;
+  }
+
+  FrameStats frame_stats(m4a_file_info.timescale);
+  for (int32_t i = 0; i < m4a_file_info.num_samples; ++i) {
+    frame_stats.Add(m4a_reader->GetSampleSize(i),
+                    m4a_reader->GetSampleDuration(i));
+  }
+  frame_stats.Fill(result);
+
+  if (!deep || m4a_file_info.num_samples == 0) {
+    return;
+  }
+
+  auto aac_decoder = std::make_unique<AacDecoder>();
+  if (aac_decoder->Init(AAC_TRANSPORT_TYPE_RAW) ||
+      aac_decoder->ConfigRaw(m4a_file_info.conf, m4a_file_info.conf_size)) {
+    return;
+  }
+
+  auto frame = std::make_unique<uint8_t[]>(AAC_PROBE_MAX_FRAME_SIZE);
+  auto out_buf = std::make_unique<uint8_t[]>(AAC_PROBE_OUT_BUF_SIZE);
+  int32_t num_frames =
+      std::min(m4a_file_info.num_samples, AAC_PROBE_DEEP_FRAMES);
+  for (int32_t i = 0; i < num_frames; ++i) {
+    int32_t size = AAC_PROBE_MAX_FRAME_SIZE;
+    int32_t out_size = AAC_PROBE_OUT_BUF_SIZE;
+    if (m4a_reader->ReadSample(i, frame.get(), &size) == 0 &&
+        aac_decoder->GetDecoded(frame.get(), size, out_buf.get(),
+                                &out_size) == 0 &&
+        out_size > 0 && aac_decoder->GetInfo(&result->decoder_info) == 0) {
+      result->deep = true;
+      break;
+    }
+  }
+}
+
+static const char* JsonFlag(int32_t flag) {
+  return flag < 0 ? "null" : (flag ? "true" : "false");
+}
+
+static std::string FormatJson(const ProbeResult& result) {
+  std::string json = "  {\"file\": ";
+  AppendJsonString(&json, result.filename);
+  json += ", \"format\": ";
+  AppendJsonString(&json, result.format);
+
+  char buf[1024];
+  if (!result.error.empty()) {
+    json += ", \"error\": ";
+    AppendJsonString(&json, result.error);
+    json += "}";
+    return json;
+  }
+
+  const asc_info& asc = result.asc;
+  snprintf(buf, sizeof(buf),
+           ", \"aot\": %d, \"sample_rate\": %d, \"output_sample_rate\": %d, "
+           "\"channel_config\": %d, \"sbr\": %s, \"ps\": %s, "
+           "\"frames\": %lld, \"bytes\": %lld, \"duration\": %.3f, "
+           "\"avg_bitrate\": %lld, \"peak_bitrate\": %lld, "
+           "\"frame_size\": {\"min\": %d, \"p50\": %d, \"p95\": %d, "
+           "\"p99\": %d, \"max\": %d}",
+           asc.aot, asc.sample_rate, asc.ext_sample_rate, asc.channel_config,
+           JsonFlag(asc.sbr), JsonFlag(asc.ps),
+           static_cast<long long>(result.frames),
+           static_cast<long long>(result.total_bytes), result.duration,
+           static_cast<long long>(result.avg_bitrate),
+           static_cast<long long>(result.peak_bitrate), result.min_frame_size,
+           result.frame_size_p50, result.frame_size_p95,
+           result.frame_size_p99, result.max_frame_size);
+  json += buf;
+
+  if (result.format == "adts") {
+    snprintf(buf, sizeof(buf),
+             ", \"skipped_bytes\": %lld, \"resyncs\": %lld",
+             static_cast<long long>(result.adts_stats.skipped_bytes),
+             static_cast<long long>(result.adts_stats.resyncs));
+    json += buf;
+  }
+
+  if (result.deep) {
+    const AacDecoderInfo& info = result.decoder_info;
+    snprintf(buf, sizeof(buf),
+             ", \"decoder\": {\"aot\": %d, \"name\": \"%s\", "
+             "\"sample_rate\": %d, \"channels\": %d, \"frame_length\": %d, "
+             "\"output_delay\": %d}",
+             info.aot, get_aot_name(info.aot, info.aot_flags),
+             info.sample_rate, info.channels, info.frame_length,
+             info.output_delay);
+    json += buf;
+  }
+
+  json += "}";
+  return json;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Probe ADTS and M4A files from their headers and sample tables, "
+      "without decoding.\nA JSON array is printed to stdout");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::PositionalList<std::string> inputs(
+      parser, "Input", "AAC/M4A files or directories", args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  int32_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+  args::ValueFlag<int32_t> jobs(parser, "jobs", "Files probed in parallel",
+                                {'j', "jobs"}, num_cpus);
+  args::Flag deep(parser, "deep",
+                  "Decode the first frame for decoder info, and SBR/PS of ADTS",
+                  {"deep"});
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (inputs.GetError() != args::Error::None) {
+    std::cout << inputs.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (jobs.Get() <= 0) {
+    std::cout << "Invalid jobs, " << jobs.Get() << std::endl;
+    return -1;
+  }
+
+  std::unique_ptr<FILE, decltype(&fclose)> out(TakeStdout(), &fclose);
+  if (out == nullptr) {
+    printf("Open stdout failed\n");
+    return -1;
+  }
+
+  std::vector<std::string> files;
+  for (const auto& input : inputs.Get()) {
+    ListFiles(input, {"aac", "adts", "m4a", "mp4"}, &files);
+  }
+
+  // Workers take the next file, results are printed in file order.
+  // Value initialized, so the numbers start from 0.
+  std::vector<ProbeResult> results(files.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i = 0;
+    while ((i = next.fetch_add(1)) < files.size()) {
+      ProbeResult& result = results[i];
+      result.filename = files[i];
+      if (SniffM4a(files[i].c_str())) {
+        ProbeM4a(files[i].c_str(), deep.Get(), &result);
+      } else {
+        ProbeAdts(files[i].c_str(), deep.Get(), &result);
+      }
+    }
+  };
+
+  int32_t num_threads =
+      std::min<int32_t>(jobs.Get(), std::max<size_t>(1, files.size()));
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  fprintf(out.get(), "[\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    fprintf(out.get(), "%s%s\n", FormatJson(results[i]).c_str(),
+            i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out.get(), "]\n");
+  return 0;
+}
@@ -0,0 +1,715 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "aac_decoder.h"
+#include "aac_encoder.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "pcm_kernels.h"
+
+// Frame times are kept in a histogram of 1 us buckets up to this
+#define AAC_RT_CHECK_MAX_US 100000
+// fdk-aac sets up the decoder on the config of the first ADTS frame, so the
+// first frames are run before the hot path is watched.
+#define AAC_RT_CHECK_WARMUP_FRAMES 2
+// Frames after a bitrate switch checked for a glitch
+#define AAC_RT_CHECK_SWITCH_FRAMES 8
+// Mean squared sample of -50 dBFS, quieter windows are not checked
+#define AAC_RT_CHECK_QUIET_POWER 10737.0
+
+// The hot path is watched by interposing the allocator, write() and the
+// stdio entry points of the process, glibc only. Calls are only counted on
+// the thread that armed the watch, while it is armed.
+struct HotPathCalls {
+  std::atomic<int64_t> allocs;
+  std::atomic<int64_t> frees;
+  std::atomic<int64_t> writes;  // write() and stdio
+};
+
+static HotPathCalls g_calls;
+static thread_local bool g_armed = false;
+
+static inline void CountAlloc() {
+  if (g_armed) {
+    g_calls.allocs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static inline void CountFree(void* ptr) {
+  if (g_armed && ptr != nullptr) {
+    g_calls.frees.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static inline void CountWrite() {
+  if (g_armed) {
+    g_calls.writes.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+  CountAlloc();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  CountAlloc();
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  CountAlloc();
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  CountAlloc();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  CountAlloc();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  CountAlloc();
+  void* mem = __libc_memalign(alignment, size);
+  if (mem == nullptr) {
+    return ENOMEM;
+  }
+  *ptr = mem;
+  return 0;
+}
+
+void free(void* ptr) {
+  CountFree(ptr);
+  __libc_free(ptr);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+  CountWrite();
+  return syscall(SYS_write, fd, buf, count);
+}
+}
+
+// stdio writes through internal calls of libc, so its entry points are
+// interposed as well and forwarded to the next definition.
+typedef int (*VfprintfFunc)(FILE*, const char*, va_list);
+typedef int (*FputsFunc)(const char*, FILE*);
+typedef int (*PutsFunc)(const char*);
+typedef int (*FputcFunc)(int, FILE*);
+typedef size_t (*FwriteFunc)(const void*, size_t, size_t, FILE*);
+
+struct StdioFuncs {
+  StdioFuncs()
+      : vfprintf_func(reinterpret_cast<VfprintfFunc>(
+            dlsym(RTLD_NEXT, "vfprintf"))),
+        fputs_func(reinterpret_cast<FputsFunc>(dlsym(RTLD_NEXT, "fputs"))),
+        puts_func(reinterpret_cast<PutsFunc>(dlsym(RTLD_NEXT, "puts"))),
+        fputc_func(reinterpret_cast<FputcFunc>(dlsym(RTLD_NEXT, "fputc"))),
+        fwrite_func(
+            reinterpret_cast<FwriteFunc>(dlsym(RTLD_NEXT, "fwrite"))) {}
+
+  VfprintfFunc vfprintf_func;
+  FputsFunc fputs_func;
+  PutsFunc puts_func;
+  FputcFunc fputc_func;
+  FwriteFunc fwrite_func;
+};
+
+// Resolved on first use, which is before the hot path is armed
+static const StdioFuncs& GetStdioFuncs() {
+  static const StdioFuncs funcs;
+  return funcs;
+}
+
+extern "C" {
+int vfprintf(FILE* stream, const char* format, va_list args) {
+  CountWrite();
+  return GetStdioFuncs().vfprintf_func(stream, format, args);
+}
+
+int vprintf(const char* format, va_list args) {
+  CountWrite();
+  return GetStdioFuncs().vfprintf_func(stdout, format, args);
+}
+
+int fprintf(FILE* stream, const char* format, ...) {
+  CountWrite();
+  va_list args;
+  va_start(args, format);
+  int ret = GetStdioFuncs().vfprintf_func(stream, format, args);
+  va_end(args);
+  return ret;
+}
+
+int printf(const char* format, ...) {
+  CountWrite();
+  va_list args;
+  va_start(args, format);
+  int ret = GetStdioFuncs().vfprintf_func(stdout, format, args);
+  va_end(args);
+  return ret;
+}
+
+int fputs(const char* str, FILE* stream) {
+  CountWrite();
+  return GetStdioFuncs().fputs_func(str, stream);
+}
+
+int puts(const char* str) {
+  CountWrite();
+  return GetStdioFuncs().puts_func(str);
+}
+
+int fputc(int c, FILE* stream) {
+  CountWrite();
+  return GetStdioFuncs().fputc_func(c, stream);
+}
+
+int putchar(int c) {
+  CountWrite();
+  return GetStdioFuncs().fputc_func(c, stdout);
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* stream) {
+  CountWrite();
+  return GetStdioFuncs().fwrite_func(ptr, size, count, stream);
+}
+}
+
+// Times of the calls of one codec, in a histogram allocated up front.
+class FrameTimes {
+ public:
+  FrameTimes()
+      : frames_(0),
+        total_us_(0),
+        max_us_(0),
+        over_budget_(0),
+        histogram_(AAC_RT_CHECK_MAX_US + 1, 0) {}
+
+  void Add(double us, double budget_us) {
+    frames_ += 1;
+    total_us_ += us;
+    max_us_ = std::max(max_us_, us);
+    if (us > budget_us) {
+      over_budget_ += 1;
+    }
+    int32_t bucket = static_cast<int32_t>(us);
+    histogram_[std::min(bucket, AAC_RT_CHECK_MAX_US)] += 1;
+  }
+
+  void Print(const char* name, double budget_us) const {
+    printf("%s: %lld frames, mean %.1f us, p99 %d us, p99.9 %d us, max %.1f "
+           "us, budget %.0f us, %lld over\n",
+           name, static_cast<long long>(frames_),
+           frames_ > 0 ? total_us_ / frames_ : 0, Percentile(990),
+           Percentile(999), max_us_, budget_us,
+           static_cast<long long>(over_budget_));
+  }
+
+  double max_us() const { return max_us_; }
+  int64_t over_budget() const { return over_budget_; }
+
+ private:
+  // |permille| of the frames took at most the returned time
+  int32_t Percentile(int32_t permille) const {
+    if (frames_ == 0) {
+      return 0;
+    }
+    int64_t rank = std::max<int64_t>(1, (frames_ * permille + 999) / 1000);
+    int64_t count = 0;
+    for (int32_t us = 0; us <= AAC_RT_CHECK_MAX_US; ++us) {
+      count += histogram_[us];
+      if (count >= rank) {
+        // The bucket holds [us, us + 1)
+        return us + 1;
+      }
+    }
+    return AAC_RT_CHECK_MAX_US;
+  }
+
+ private:
+  int64_t frames_;
+  double total_us_;
+  double max_us_;
+  int64_t over_budget_;
+  std::vector<int64_t> histogram_;
+};
+
+static double ElapsedUs(std::chrono::steady_clock::time_point start,
+                        std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static void PrintCodecErrors(AacEncoder* aac_encoder, AacDecoder* aac_decoder) {
+  AacError error;
+  while (aac_encoder->PopError(&error) == 0) {
+    printf("Encoder: %s, %d\n", get_error_name(error.code), error.detail);
+  }
+  while (aac_decoder->PopError(&error) == 0) {
+    printf("Decoder: %s, %d\n", get_error_name(error.code), error.detail);
+  }
+}
+
+struct CheckOptions {
+  int32_t aot;
+  int32_t bitrate;
+  int32_t switch_bitrate;  // alternated with |bitrate| every second, 0: off
+  int32_t seconds;
+  double max_frame_us;  // 0: no limit
+  double max_snr_drop;  // dB, of the frames after a switch
+};
+
+// HUGE_VAL for a lossless window
+static double Snr(double signal, double error) {
+  if (error == 0) {
+    return HUGE_VAL;
+  }
+  return 10 * log10(std::max(signal, 1.0) / error);
+}
+
+// The decoded PCM lined up with the source it was encoded from. Frames right
+// after a bitrate switch are summed per switch and the other frames per
+// bitrate, so a switch that glitches shows as a drop of its SNR below the
+// steady state. Everything is allocated up front.
+class SwitchContinuity {
+ public:
+  SwitchContinuity(const std::vector<uint8_t>& pcm,
+                   int32_t channels,
+                   int32_t frame_length,
+                   int32_t frames_per_switch,
+                   int64_t num_switches)
+      : source_(reinterpret_cast<const int16_t*>(pcm.data())),
+        channels_(channels),
+        frame_length_(frame_length),
+        frames_per_loop_(pcm.size() / (2 * channels * frame_length)),
+        frames_per_switch_(frames_per_switch),
+        delay_(-1),
+        decoded_samples_(0),
+        steady_signal_{0, 0},
+        steady_error_{0, 0},
+        window_signal_(num_switches + 1, 0),
+        window_error_(num_switches + 1, 0),
+        window_values_(num_switches + 1, 0) {}
+
+  // What the decoded stream lags the source, known after the first frame
+  void SetDelay(int64_t delay) { delay_ = delay; }
+  bool HasDelay() const { return delay_ >= 0; }
+
+  // |num_samples| samples per channel, following the ones added before
+  void Add(const int16_t* decoded, int32_t num_samples) {
+    int32_t done = 0;
+    while (done < num_samples) {
+      int64_t src = decoded_samples_ + done - delay_;
+      if (src < 0) {
+        done += static_cast<int32_t>(
+            std::min<int64_t>(num_samples - done, -src));
+        continue;
+      }
+      // Up to the end of the source frame, frames wrap around the input
+      int64_t frame = src / frame_length_;
+      int32_t pos = static_cast<int32_t>(src % frame_length_);
+      int32_t count = std::min(num_samples - done, frame_length_ - pos);
+      const int16_t* ref =
+          source_ +
+          ((frame % frames_per_loop_) * frame_length_ + pos) * channels_;
+      int32_t num_values = count * channels_;
+      int32_t max_abs_err = 0;
+      Accumulate(frame, pcm_sum_squares_s16(ref, num_values),
+                 pcm_diff_s16(ref, decoded + done * channels_, num_values,
+                              &max_abs_err),
+                 num_values);
+      done += count;
+    }
+    decoded_samples_ += num_samples;
+  }
+
+  // Returns -1 if a switch dropped more than |max_snr_drop| below the
+  // steady SNR of the lower bitrate.
+  int32_t Print(double max_snr_drop) const {
+    double steady_snr[2] = {Snr(steady_signal_[0], steady_error_[0]),
+                            Snr(steady_signal_[1], steady_error_[1])};
+    double reference = std::min(steady_snr[0], steady_snr[1]);
+    int64_t checked = 0;
+    int64_t failed = 0;
+    double worst_drop = -HUGE_VAL;
+    for (size_t i = 1; i < window_values_.size(); ++i) {
+      // Too quiet to tell a glitch from the codec
+      if (window_values_[i] == 0 ||
+          window_signal_[i] < AAC_RT_CHECK_QUIET_POWER * window_values_[i]) {
+        continue;
+      }
+      double snr = Snr(window_signal_[i], window_error_[i]);
+      double drop = snr == HUGE_VAL ? -HUGE_VAL : reference - snr;
+      worst_drop = std::max(worst_drop, drop);
+      checked += 1;
+      if (drop > max_snr_drop) {
+        failed += 1;
+      }
+    }
+
+    printf("Continuity: steady SNR %.1f/%.1f dB, %lld switch(es) checked, "
+           "worst drop %.1f dB, %lld over %.1f dB\n",
+           steady_snr[0], steady_snr[1], static_cast<long long>(checked),
+           worst_drop > -HUGE_VAL ? worst_drop : 0,
+           static_cast<long long>(failed), max_snr_drop);
+    return failed > 0 ? -1 : 0;
+  }
+
+ private:
+  void Accumulate(int64_t frame,
+                  int64_t signal,
+                  int64_t error,
+                  int32_t num_values) {
+    int64_t period = frame / frames_per_switch_;
+    bool after_switch = period > 0 && frame % frames_per_switch_ <
+                                          AAC_RT_CHECK_SWITCH_FRAMES;
+    if (after_switch && period < static_cast<int64_t>(window_values_.size())) {
+      window_signal_[period] += signal;
+      window_error_[period] += error;
+      window_values_[period] += num_values;
+    } else {
+      steady_signal_[period % 2] += signal;
+      steady_error_[period % 2] += error;
+    }
+  }
+
+ private:
+  const int16_t* source_;
+  int32_t channels_;
+  int32_t frame_length_;
+  int64_t frames_per_loop_;
+  int32_t frames_per_switch_;
+  int64_t delay_;
+  int64_t decoded_samples_;
+  // Sums of squares in double, int64 overflows within hours of full scale
+  double steady_signal_[2];
+  double steady_error_[2];
+  std::vector<double> window_signal_;  // indexed by the second switched at
+  std::vector<double> window_error_;
+  std::vector<int64_t> window_values_;
+};
+
+// Encodes |pcm| over and over for |seconds| of audio, and decodes every
+// frame, as an audio callback would. Only the GetEncoded(), GetDecoded() and
+// SetBitrate() calls are armed and timed. With a switch bitrate, the frame
+// after each switch is timed on its own, as the encoder applies the new
+// bitrate in it.
+static int32_t CheckHotPath(const std::vector<uint8_t>& pcm,
+                            const WavFileInfo& wav_file_info,
+                            const CheckOptions& options) {
+  AacEncoderConfig config = {0};
+  config.transport_type = AAC_TRANSPORT_TYPE_ADTS;
+  config.aot = options.aot;
+  config.sample_rate = wav_file_info.sample_rate;
+  config.channels = wav_file_info.channels;
+  config.bitrate = options.bitrate;
+  config.preset = AAC_COMMON_PRESET_DEFAULT;
+
+  auto aac_encoder = std::make_unique<AacEncoder>();
+  int32_t ret = aac_encoder->Init(config);
+  if (ret) {
+    printf("Init aac encoder failed\n");
+    return -1;
+  }
+  AacEncoderInfo aac_encoder_info;
+  ret = aac_encoder->GetInfo(&aac_encoder_info);
+  if (ret) {
+    printf("Get info of aac encoder failed\n");
+    return -1;
+  }
+
+  auto aac_decoder = std::make_unique<AacDecoder>();
+  ret = aac_decoder->Init(AAC_TRANSPORT_TYPE_ADTS);
+  if (ret) {
+    printf("Init aac decoder failed\n");
+    return -1;
+  }
+
+  // Everything the loop needs is allocated here
+  const int32_t frame_length = aac_encoder_info.frame_length;
+  const int32_t frame_size_in_bytes =
+      wav_file_info.channels * 2 * frame_length;
+  if (pcm.size() < static_cast<size_t>(frame_size_in_bytes)) {
+    printf("Input is shorter than a frame\n");
+    return -1;
+  }
+  const int32_t out_buf_capacity = 8 * 2048 * 2;
+  auto input_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto output_buf = std::make_unique<uint8_t[]>(frame_size_in_bytes);
+  auto pcm_buf = std::make_unique<uint8_t[]>(out_buf_capacity);
+  FrameTimes encode_times;
+  FrameTimes decode_times;
+  FrameTimes switch_times;
+  const double budget_us = 1000000.0 * frame_length / wav_file_info.sample_rate;
+  const int64_t num_frames = static_cast<int64_t>(options.seconds) *
+                             wav_file_info.sample_rate / frame_length;
+  const bool switching = options.switch_bitrate > 0;
+  const int32_t frames_per_switch =
+      std::max(1, wav_file_info.sample_rate / frame_length);
+  const int32_t bitrates[2] = {options.bitrate, options.switch_bitrate};
+  int64_t bytes_at[2] = {0, 0};
+  int64_t frames_at[2] = {0, 0};
+  SwitchContinuity continuity(pcm, wav_file_info.channels, frame_length,
+                              frames_per_switch,
+                              num_frames / frames_per_switch);
+  bool compare = switching;
+  int64_t codec_errors = 0;
+  int64_t gaps = 0;  // frames missing from the encoded or decoded stream
+  bool encoding = false;
+  GetStdioFuncs();
+
+  printf("Checking %lld frames of %d samples/channel, %d Hz, %d ch(s), %s, "
+         "%d bps\n",
+         static_cast<long long>(num_frames), frame_length,
+         wav_file_info.sample_rate, wav_file_info.channels,
+         get_aot_name(options.aot, 0), options.bitrate);
+  if (switching) {
+    printf("Switching to %d bps and back every %d frames\n",
+           options.switch_bitrate, frames_per_switch);
+  }
+
+  size_t offset = 0;
+  for (int64_t i = 0; i < num_frames; ++i) {
+    // The input wraps around, whole frames only
+    if (offset + frame_size_in_bytes > pcm.size()) {
+      offset = 0;
+    }
+    memcpy(input_buf.get(), pcm.data() + offset, frame_size_in_bytes);
+    offset += frame_size_in_bytes;
+    bool watched = i >= AAC_RT_CHECK_WARMUP_FRAMES;
+    int32_t setting = switching ? (i / frames_per_switch) % 2 : 0;
+    bool switched = switching && i > 0 && i % frames_per_switch == 0;
+
+    int32_t out_size_bytes = frame_size_in_bytes;
+    g_armed = watched;
+    auto start = std::chrono::steady_clock::now();
+    ret = switched ? aac_encoder->SetBitrate(bitrates[setting]) : 0;
+    if (ret == 0) {
+      ret = aac_encoder->GetEncoded(input_buf.get(), frame_size_in_bytes,
+                                    output_buf.get(), &out_size_bytes);
+    }
+    auto end = std::chrono::steady_clock::now();
+    g_armed = false;
+    if (watched) {
+      FrameTimes* times = switched ? &switch_times : &encode_times;
+      times->Add(ElapsedUs(start, end), budget_us);
+    }
+    if (ret) {
+      codec_errors += 1;
+      PrintCodecErrors(aac_encoder.get(), aac_decoder.get());
+      continue;
+    } else if (out_size_bytes == 0) {
+      // Only while the encoder is filling its delay
+      gaps += encoding ? 1 : 0;
+      continue;
+    }
+    encoding = true;
+    bytes_at[setting] += out_size_bytes;
+    frames_at[setting] += 1;
+
+    int32_t pcm_size_bytes = out_buf_capacity;
+    g_armed = watched;
+    start = std::chrono::steady_clock::now();
+    ret = aac_decoder->GetDecoded(output_buf.get(), out_size_bytes,
+                                  pcm_buf.get(), &pcm_size_bytes);
+    end = std::chrono::steady_clock::now();
+    g_armed = false;
+    if (watched) {
+      decode_times.Add(ElapsedUs(start, end), budget_us);
+    }
+    if (ret) {
+      codec_errors += 1;
+    }
+    PrintCodecErrors(aac_encoder.get(), aac_decoder.get());
+    if (ret) {
+      continue;
+    } else if (pcm_size_bytes != frame_size_in_bytes) {
+      gaps += 1;
+    }
+
+    if (compare && !continuity.HasDelay()) {
+      AacDecoderInfo aac_decoder_info;
+      if (aac_decoder->GetInfo(&aac_decoder_info) ||
+          aac_decoder_info.channels != wav_file_info.channels) {
+        printf("Decoded channels differ, continuity is not checked\n");
+        compare = false;
+      } else {
+        continuity.SetDelay(aac_encoder_info.delay +
+                            aac_decoder_info.output_delay);
+      }
+    }
+    if (compare) {
+      continuity.Add(reinterpret_cast<const int16_t*>(pcm_buf.get()),
+                     pcm_size_bytes / (2 * wav_file_info.channels));
+    }
+  }
+
+  encode_times.Print("Encode", budget_us);
+  decode_times.Print("Decode", budget_us);
+  int64_t allocs = g_calls.allocs.load();
+  int64_t frees = g_calls.frees.load();
+  int64_t writes = g_calls.writes.load();
+  printf("Hot path: %lld allocation(s), %lld free(s), %lld write(s), %lld "
+         "codec error(s)\n",
+         static_cast<long long>(allocs), static_cast<long long>(frees),
+         static_cast<long long>(writes), static_cast<long long>(codec_errors));
+
+  int32_t status = 0;
+  if (allocs > 0 || frees > 0 || writes > 0) {
+    printf("Failed, the hot path allocates or writes\n");
+    status = -1;
+  }
+  if (options.max_frame_us > 0 &&
+      (encode_times.max_us() > options.max_frame_us ||
+       decode_times.max_us() > options.max_frame_us ||
+       switch_times.max_us() > options.max_frame_us)) {
+    printf("Failed, a frame took longer than %.0f us\n", options.max_frame_us);
+    status = -1;
+  }
+  if (!switching) {
+    return status;
+  }
+
+  // The frame a switch is applied in against the others
+  switch_times.Print("Switch", budget_us);
+  for (int32_t k = 0; k < 2; ++k) {
+    printf("At %d bps: %.0f bps\n", bitrates[k],
+           frames_at[k] > 0 ? 8.0 * bytes_at[k] * wav_file_info.sample_rate /
+                                  (frames_at[k] * frame_length)
+                            : 0);
+  }
+  printf("Gaps: %lld frame(s)\n", static_cast<long long>(gaps));
+  if (codec_errors > 0 || gaps > 0) {
+    printf("Failed, the stream is not continuous over the switches\n");
+    status = -1;
+  }
+  if (compare && continuity.Print(options.max_snr_drop)) {
+    printf("Failed, a switch is audible\n");
+    status = -1;
+  }
+  return status;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Check that AacEncoder::GetEncoded and AacDecoder::GetDecoded are "
+      "real-time safe.\nAllocation, free, write() and stdio are counted "
+      "while they run, and their worst-case time is measured over a long "
+      "run");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> wav_file(parser, "Input", "WAV file",
+                                         args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+
+  args::MapFlag<std::string, int> aot(
+      parser, "AOT", "Audio Object Type", {'a', "aot"},
+      {{std::to_string(AAC_COMMON_AOT_LC), AAC_COMMON_AOT_LC},
+       {std::to_string(AAC_COMMON_AOT_HE), AAC_COMMON_AOT_HE},
+       {std::to_string(AAC_COMMON_AOT_HEv2), AAC_COMMON_AOT_HEv2},
+       {std::to_string(AAC_COMMON_AOT_LD), AAC_COMMON_AOT_LD},
+       {std::to_string(AAC_COMMON_AOT_ELD), AAC_COMMON_AOT_ELD}},
+      AAC_COMMON_AOT_LC);
+  aot.HelpChoices({std::to_string(AAC_COMMON_AOT_LC) + "(LC)",
+                   std::to_string(AAC_COMMON_AOT_HE) + "(HE)",
+                   std::to_string(AAC_COMMON_AOT_HEv2) + "(HEv2)",
+                   std::to_string(AAC_COMMON_AOT_LD) + "(LD)",
+                   std::to_string(AAC_COMMON_AOT_ELD) + "(ELD)"});
+  aot.HelpDefault(std::to_string(AAC_COMMON_AOT_LC));
+
+  args::ValueFlag<int32_t> bitrate(parser, "bitrate", "Encode bitrate(bps)",
+                                   {'b', "bitrate"}, 64000);
+  args::ValueFlag<int32_t> seconds(parser, "seconds",
+                                   "Audio to run through, the input is "
+                                   "repeated",
+                                   {'s', "seconds"}, 600);
+  args::ValueFlag<double> max_frame_us(
+      parser, "us", "Fail if a frame takes longer, 0 for no limit",
+      {"max-frame-us"}, 0);
+  args::ValueFlag<int32_t> switch_bitrate(
+      parser, "bitrate",
+      "Switch to this bitrate(bps) and back every second, 0 for none",
+      {"switch-bitrate"}, 0);
+  args::ValueFlag<double> max_snr_drop(
+      parser, "dB",
+      "Fail if the frames after a switch lose more SNR than the steady state",
+      {"max-snr-drop"}, 6.0);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_file.GetError() != args::Error::None) {
+    std::cout << wav_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (aot.GetError() != args::Error::None) {
+    std::cout << aot.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (seconds.Get() <= 0) {
+    std::cout << "Invalid seconds, " << seconds.Get() << std::endl;
+    return -1;
+  } else if (switch_bitrate.Get() < 0) {
+    std::cout << "Invalid switch bitrate, " << switch_bitrate.Get()
+              << std::endl;
+    return -1;
+  } else if (max_frame_us.Get() < 0) {
+    std::cout << "Invalid max frame time, " << max_frame_us.Get()
+              << std::endl;
+    return -1;
+  }
+
+  WavFileInfo wav_file_info;
+  std::vector<uint8_t> pcm;
+  if (LoadWav(wav_file.Get().c_str(), &wav_file_info, &pcm)) {
+    return -1;
+  }
+
+  CheckOptions options;
+  options.aot = aot.Get();
+  options.bitrate = bitrate.Get();
+  options.switch_bitrate = switch_bitrate.Get();
+  options.seconds = seconds.Get();
+  options.max_frame_us = max_frame_us.Get();
+  options.max_snr_drop = max_snr_drop.Get();
+
+  print_aac_lib_info();
+  return CheckHotPath(pcm, wav_file_info, options);
+}
@@ -0,0 +1,350 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "aac_common.h"
+#include "aac_decoder.h"
+#include "aac_jitter_buffer.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "rtp_aac.h"
+#include "wav_writer.h"
+
+struct LatencyStats {
+  int64_t frames;
+  double sum_ms;
+  double max_ms;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void OnSignal(int) {
+  g_stop = 1;
+}
+
+static int32_t ReadSdp(const char* path,
+                       int32_t* payload_type,
+                       uint8_t* conf,
+                       int32_t* conf_size) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    printf("Open %s failed\n", path);
+    return -1;
+  }
+  char sdp[4096] = {0};
+  size_t size = fread(sdp, 1, sizeof(sdp) - 1, file);
+  fclose(file);
+  sdp[size] = '\0';
+
+  if (rtp_aac_parse_sdp(sdp, payload_type, conf, conf_size)) {
+    printf("No AAC-hbr stream in %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+static void PrintReport(int64_t seconds,
+                        AacJitterBuffer* jitter_buffer,
+                        const AacJitterBufferConfig& config,
+                        const LatencyStats& latency) {
+  AacJitterBufferStats stats;
+  jitter_buffer->GetStats(&stats);
+  const double frame_ms = config.frame_length * 1000.0 / config.sample_rate;
+  printf("%6lld %8lld %6lld %6lld %8lld %6lld %10.2f %10.1f %10.1f %9.1f "
+         "%9.1f\n",
+         static_cast<long long>(seconds),
+         static_cast<long long>(stats.received),
+         static_cast<long long>(stats.late), static_cast<long long>(stats.lost),
+         static_cast<long long>(stats.underruns),
+         static_cast<long long>(stats.skipped), stats.jitter_ms,
+         stats.target_frames * frame_ms, stats.buffered_frames * frame_ms,
+         latency.frames > 0 ? latency.sum_ms / latency.frames : 0,
+         latency.max_ms);
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Receive AAC over RTP(RFC 3640, AAC-hbr), reorder it in an adaptive "
+      "jitter buffer and decode it to continuous PCM, lost frames "
+      "concealed.\nLatency is from the capture time stamped by aac_rtp_send "
+      "to the output, only meaningful on one host");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> wav_file(parser, "Output", "WAV file",
+                                         args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> sdp_file(
+      parser, "sdp", "Session description written by aac_rtp_send", {"sdp"},
+      "", args::Options::Required);
+  args::ValueFlag<int32_t> port(parser, "port", "UDP port to listen on",
+                                {'p', "port"}, 5004);
+  args::ValueFlag<int32_t> min_delay(parser, "min-delay",
+                                     "Jitter buffer delay at least(ms)",
+                                     {"min-delay"}, 20);
+  args::ValueFlag<int32_t> max_delay(parser, "max-delay",
+                                     "Jitter buffer delay at most(ms)",
+                                     {"max-delay"}, 400);
+  args::MapFlag<std::string, int> conceal(
+      parser, "conceal", "Concealment of lost frames", {"conceal"},
+      {{std::to_string(AAC_COMMON_CONCEAL_MUTE), AAC_COMMON_CONCEAL_MUTE},
+       {std::to_string(AAC_COMMON_CONCEAL_NOISE), AAC_COMMON_CONCEAL_NOISE},
+       {std::to_string(AAC_COMMON_CONCEAL_INTERPOLATE),
+        AAC_COMMON_CONCEAL_INTERPOLATE}},
+      AAC_COMMON_CONCEAL_NOISE);
+  conceal.HelpChoices(
+      {std::to_string(AAC_COMMON_CONCEAL_MUTE) + "(mute)",
+       std::to_string(AAC_COMMON_CONCEAL_NOISE) + "(noise)",
+       std::to_string(AAC_COMMON_CONCEAL_INTERPOLATE) + "(interpolate)"});
+  conceal.HelpDefault(std::to_string(AAC_COMMON_CONCEAL_NOISE));
+  args::ValueFlag<int32_t> timeout(
+      parser, "timeout", "Stop after no packet arrived for(s)", {"timeout"},
+      3);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (wav_file.GetError() != args::Error::None) {
+    std::cout << wav_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (conceal.GetError() != args::Error::None) {
+    std::cout << conceal.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (timeout.Get() <= 0) {
+    std::cout << "Invalid timeout, " << timeout.Get() << std::endl;
+    return -1;
+  }
+
+  int32_t payload_type = 0;
+  uint8_t conf[64];
+  int32_t conf_size = sizeof(conf);
+  struct asc_info asc;
+  if (ReadSdp(sdp_file.Get().c_str(), &payload_type, conf, &conf_size)) {
+    return -1;
+  }
+  if (parse_audio_specific_config(conf, conf_size, &asc)) {
+    printf("Invalid AudioSpecificConfig\n");
+    return -1;
+  }
+
+  // RTP timestamps run at the rate of the core coder, one AU per frame
+  AacJitterBufferConfig jitter_config;
+  jitter_config.sample_rate = asc.sample_rate;
+  jitter_config.frame_length = asc.frame_length;
+  jitter_config.min_delay_ms = min_delay.Get();
+  jitter_config.max_delay_ms = max_delay.Get();
+  AacJitterBuffer jitter_buffer;
+  if (jitter_buffer.Init(jitter_config)) {
+    return -1;
+  }
+
+  AacDecoderConfig decoder_config = {0};
+  decoder_config.transport_type = AAC_TRANSPORT_TYPE_RAW;
+  decoder_config.conceal_method = conceal.Get();
+  AacDecoder aac_decoder;
+  if (aac_decoder.Init(decoder_config) ||
+      aac_decoder.ConfigRaw(conf, conf_size)) {
+    printf("Init aac decoder failed\n");
+    return -1;
+  }
+
+  int32_t socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port.Get());
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (socket_fd < 0 ||
+      bind(socket_fd, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr))) {
+    printf("Bind udp port %d failed\n", port.Get());
+    if (socket_fd >= 0) {
+      close(socket_fd);
+    }
+    return -1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = OnSignal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  printf("Listening on udp port %d, %s, %d Hz, %d samples per frame\n",
+         port.Get(), get_aot_name(asc.aot, 0), asc.sample_rate,
+         asc.frame_length);
+  printf("%6s %8s %6s %6s %8s %6s %10s %10s %10s %9s %9s\n", "second",
+         "received", "late", "lost", "underrun", "skip", "jitter(ms)",
+         "target(ms)", "buffer(ms)", "avg(ms)", "max(ms)");
+  fflush(stdout);
+
+  const int32_t out_buf_capacity = 8 * 2048 * 2;
+  auto out_buf = std::make_unique<uint8_t[]>(out_buf_capacity);
+  uint8_t packet_buf[RTP_AAC_MAX_PACKET_SIZE];
+  uint8_t au[RTP_AAC_MAX_AU_SIZE];
+
+  auto wav_writer = std::make_unique<WavWriter>();
+  bool wav_opened = false;
+  AacDecoderInfo decoder_info = {0};
+  LatencyStats latency = {0};
+  int64_t concealed = 0;
+  int64_t foreign = 0;
+
+  const double frame_us = asc.frame_length * 1000000.0 / asc.sample_rate;
+  int64_t first_tick_us = -1;
+  int64_t ticks = 0;
+  int64_t last_packet_us = -1;
+  int64_t report_us = -1;
+  while (!g_stop) {
+    int64_t now = NowUs();
+    int32_t wait_ms = 100;
+    if (first_tick_us >= 0) {
+      int64_t next_tick_us =
+          first_tick_us + static_cast<int64_t>(ticks * frame_us);
+      wait_ms = std::max<int64_t>(0, (next_tick_us - now + 999) / 1000);
+    }
+
+    struct pollfd pfd;
+    pfd.fd = socket_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, wait_ms) > 0) {
+      // Every packet that is there, they share the arrival time
+      int64_t arrival_us = NowUs();
+      while (1) {
+        ssize_t size = recv(socket_fd, packet_buf, sizeof(packet_buf),
+                            MSG_DONTWAIT);
+        if (size <= 0) {
+          break;
+        }
+        struct rtp_aac_packet packet;
+        if (rtp_aac_parse(packet_buf, size, &packet) ||
+            packet.payload_type != payload_type) {
+          foreign += 1;
+          continue;
+        }
+        for (int32_t i = 0; i < packet.num_aus; ++i) {
+          jitter_buffer.Put(packet.timestamp + i * asc.frame_length,
+                            packet.aus[i], packet.au_sizes[i], arrival_us,
+                            packet.send_time_us);
+        }
+        last_packet_us = arrival_us;
+        if (first_tick_us < 0) {
+          first_tick_us = arrival_us;
+          report_us = arrival_us + 1000000;
+        }
+      }
+    }
+
+    now = NowUs();
+    if (last_packet_us >= 0 &&
+        now - last_packet_us > timeout.Get() * 1000000LL) {
+      break;
+    }
+    if (first_tick_us < 0 ||
+        now < first_tick_us + static_cast<int64_t>(ticks * frame_us)) {
+      continue;
+    }
+
+    // One frame per frame duration on the local clock
+    ticks += 1;
+    int32_t au_size = sizeof(au);
+    int64_t send_time_us = -1;
+    int32_t action = jitter_buffer.Pop(au, &au_size, &send_time_us);
+    int32_t out_size = out_buf_capacity;
+    while (action == AAC_JITTER_SKIP) {
+      // Decoded to keep the decoder state, the PCM is dropped
+      aac_decoder.GetDecoded(au, au_size, out_buf.get(), &out_size);
+      au_size = sizeof(au);
+      out_size = out_buf_capacity;
+      action = jitter_buffer.Pop(au, &au_size, &send_time_us);
+    }
+    if (action == AAC_JITTER_FRAME) {
+      if (aac_decoder.GetDecoded(au, au_size, out_buf.get(), &out_size)) {
+        out_size = 0;
+      }
+    } else if (action == AAC_JITTER_CONCEAL && wav_opened) {
+      if (aac_decoder.GetConcealed(out_buf.get(), &out_size) == 0) {
+        concealed += 1;
+      } else {
+        out_size = 0;
+      }
+    } else {
+      out_size = 0;
+    }
+    AacError error;
+    while (aac_decoder.PopError(&error) == 0) {
+    }
+
+    if (out_size > 0) {
+      if (!wav_opened) {
+        if (aac_decoder.GetInfo(&decoder_info) ||
+            wav_writer->Open(wav_file.Get().c_str(), decoder_info.sample_rate,
+                             decoder_info.channels, 16)) {
+          printf("Open wav file failed, %s\n", wav_file.Get().c_str());
+          break;
+        }
+        wav_opened = true;
+      }
+      wav_writer->Write(out_buf.get(), out_size);
+
+      // The decoder holds the frame back by its output delay
+      if (action == AAC_JITTER_FRAME && send_time_us >= 0) {
+        double ms = (NowUs() - send_time_us) / 1000.0 +
+                    decoder_info.output_delay * 1000.0 /
+                        decoder_info.sample_rate;
+        latency.frames += 1;
+        latency.sum_ms += ms;
+        latency.max_ms = std::max(latency.max_ms, ms);
+      }
+    }
+
+    if (now >= report_us) {
+      PrintReport((report_us - first_tick_us) / 1000000, &jitter_buffer,
+                  jitter_config, latency);
+      fflush(stdout);
+      report_us += 1000000;
+    }
+  }
+  close(socket_fd);
+  wav_writer->Close();
+
+  AacJitterBufferStats stats;
+  jitter_buffer.GetStats(&stats);
+  printf("\nReceived %lld AUs, late %lld, lost %lld, underruns %lld, skipped "
+         "%lld, duplicates %lld, resets %lld, foreign packets %lld\n",
+         static_cast<long long>(stats.received),
+         static_cast<long long>(stats.late), static_cast<long long>(stats.lost),
+         static_cast<long long>(stats.underruns),
+         static_cast<long long>(stats.skipped),
+         static_cast<long long>(stats.duplicates),
+         static_cast<long long>(stats.resets), static_cast<long long>(foreign));
+  printf("Concealed %lld frames, latency avg %.1f ms, max %.1f ms\n",
+         static_cast<long long>(concealed),
+         latency.frames > 0 ? latency.sum_ms / latency.frames : 0,
+         latency.max_ms);
+  return 0;
+}
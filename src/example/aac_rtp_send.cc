@@ -0,0 +1,234 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aac_adts_reader.h"
+#include "aac_common.h"
+#include "args.hxx"
+#include "example_common.h"
+#include "rtp_aac.h"
+
+#define AAC_ADTS_HEADER_SIZE 7
+#define AAC_ADTS_FRAME_LENGTH 1024
+
+static void SleepUntil(int64_t time_us) {
+  int64_t now = NowUs();
+  if (time_us > now) {
+    std::this_thread::sleep_for(std::chrono::microseconds(time_us - now));
+  }
+}
+
+static int32_t WriteSdp(const char* path, const char* sdp) {
+  FILE* file = fopen(path, "w");
+  if (file == nullptr) {
+    printf("Open %s failed\n", path);
+    return -1;
+  }
+  fputs(sdp, file);
+  fclose(file);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Send an ADTS file as RTP(RFC 3640, AAC-hbr) in real time, one AU per "
+      "packet, with optional loss and jitter.\nEvery packet carries its "
+      "capture time for aac_rtp_recv to measure the latency on one host");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> aac_file(parser, "Input", "AAC file in ADTS",
+                                         args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> dest(parser, "dest", "Destination IPv4 address",
+                                    {"dest"}, "127.0.0.1");
+  args::ValueFlag<int32_t> port(parser, "port", "Destination UDP port",
+                                {'p', "port"}, 5004);
+  args::ValueFlag<std::string> sdp_file(
+      parser, "sdp", "Write the session description for aac_rtp_recv here",
+      {"sdp"}, "");
+  args::ValueFlag<int32_t> payload_type(parser, "pt", "RTP payload type",
+                                        {"pt"}, 96);
+  args::ValueFlag<double> loss(parser, "loss", "Packets dropped(%)",
+                               {"loss"}, 0);
+  args::ValueFlag<int32_t> jitter(
+      parser, "jitter", "Random extra delay of each packet, up to(ms)",
+      {"jitter"}, 0);
+  args::ValueFlag<int32_t> seed(parser, "seed", "Seed of loss and jitter",
+                                {"seed"}, 1);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (aac_file.GetError() != args::Error::None) {
+    std::cout << aac_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (loss.Get() < 0 || loss.Get() > 100) {
+    std::cout << "Invalid loss, " << loss.Get() << std::endl;
+    return -1;
+  } else if (jitter.Get() < 0) {
+    std::cout << "Invalid jitter, " << jitter.Get() << std::endl;
+    return -1;
+  }
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port.Get());
+  if (inet_pton(AF_INET, dest.Get().c_str(), &addr.sin_addr) != 1) {
+    printf("Invalid address, %s\n", dest.Get().c_str());
+    return -1;
+  }
+
+  auto aac_adts_reader = std::make_unique<AacAdtsReader>();
+  if (aac_adts_reader->Open(aac_file.Get().c_str())) {
+    printf("Open aac adts file failed, %s\n", aac_file.Get().c_str());
+    return -1;
+  }
+
+  int32_t socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (socket_fd < 0) {
+    printf("socket failed\n");
+    return -1;
+  }
+
+  std::mt19937 random(seed.Get());
+  std::uniform_real_distribution<double> uniform(0, 1);
+  // Packets waiting for their jittered send time, which reorders them
+  std::multimap<int64_t, std::vector<uint8_t>> pending;
+
+  const int32_t frame_capacity = 8192;
+  auto frame = std::make_unique<uint8_t[]>(frame_capacity);
+  uint8_t packet_buf[RTP_AAC_MAX_PACKET_SIZE];
+
+  struct rtp_aac_packet packet;
+  memset(&packet, 0, sizeof(packet));
+  packet.payload_type = payload_type.Get();
+  packet.marker = 1;
+  packet.ssrc = random();
+  uint16_t seq = random();
+  uint32_t timestamp = random();
+
+  int32_t sample_rate = 0;
+  int64_t start_us = 0;
+  int64_t frames = 0;
+  int64_t sent = 0;
+  int64_t dropped = 0;
+  while (1) {
+    int32_t size = frame_capacity;
+    if (aac_adts_reader->ReadOneFrame(frame.get(), &size)) {
+      break;
+    }
+    const uint8_t* header = frame.get();
+    const int32_t header_size =
+        AAC_ADTS_HEADER_SIZE + ((header[1] & 0x01) ? 0 : 2);
+    if ((header[6] & 0x03) != 0) {
+      printf("ADTS frames of several raw data blocks are not supported\n");
+      break;
+    }
+
+    if (sample_rate == 0) {
+      // AudioSpecificConfig from the fixed header
+      int32_t profile = (header[2] >> 6) & 0x03;
+      int32_t sf_index = (header[2] >> 2) & 0x0f;
+      int32_t channel_config =
+          ((header[2] & 0x01) << 2) | ((header[3] >> 6) & 0x03);
+      uint8_t conf[2];
+      conf[0] = ((profile + 1) << 3) | (sf_index >> 1);
+      conf[1] = ((sf_index & 0x01) << 7) | (channel_config << 3);
+      sample_rate = get_sample_rate(sf_index);
+      if (sample_rate == 0) {
+        printf("Invalid sampling frequency index, %d\n", sf_index);
+        break;
+      }
+
+      char sdp[1024];
+      if (rtp_aac_format_sdp(packet.payload_type, sample_rate, channel_config,
+                             conf, sizeof(conf), port.Get(), sdp,
+                             sizeof(sdp)) ||
+          (!sdp_file.Get().empty() &&
+           WriteSdp(sdp_file.Get().c_str(), sdp))) {
+        break;
+      }
+      printf("%s", sdp);
+      fflush(stdout);
+      start_us = NowUs();
+    }
+
+    // Real time from the first frame on
+    int64_t capture_us =
+        start_us + frames * AAC_ADTS_FRAME_LENGTH * 1000000LL / sample_rate;
+    frames += 1;
+    while (!pending.empty() && pending.begin()->first <= capture_us) {
+      SleepUntil(pending.begin()->first);
+      const std::vector<uint8_t>& data = pending.begin()->second;
+      sendto(socket_fd, data.data(), data.size(), 0,
+             reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+      pending.erase(pending.begin());
+      sent += 1;
+    }
+    SleepUntil(capture_us);
+
+    packet.seq = seq++;
+    packet.timestamp = timestamp;
+    timestamp += AAC_ADTS_FRAME_LENGTH;
+    packet.send_time_us = capture_us;
+    packet.num_aus = 1;
+    packet.aus[0] = frame.get() + header_size;
+    packet.au_sizes[0] = size - header_size;
+    int32_t packet_size =
+        rtp_aac_pack(&packet, packet_buf, sizeof(packet_buf));
+    if (packet_size < 0) {
+      printf("AU too large for a packet, %d bytes\n", packet.au_sizes[0]);
+      break;
+    }
+
+    if (uniform(random) * 100 < loss.Get()) {
+      dropped += 1;
+      continue;
+    }
+    int64_t send_us = capture_us + static_cast<int64_t>(
+                                       uniform(random) * jitter.Get() * 1000);
+    pending.emplace(send_us,
+                    std::vector<uint8_t>(packet_buf, packet_buf + packet_size));
+  }
+
+  for (const auto& it : pending) {
+    SleepUntil(it.first);
+    sendto(socket_fd, it.second.data(), it.second.size(), 0,
+           reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    sent += 1;
+  }
+  close(socket_fd);
+
+  printf("Frames %lld, sent %lld, dropped %lld\n",
+         static_cast<long long>(frames), static_cast<long long>(sent),
+         static_cast<long long>(dropped));
+  return 0;
+}
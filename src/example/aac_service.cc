@@ -0,0 +1,85 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include "aac_common.h"
+#include "aac_ipc_server.h"
+#include "args.hxx"
+
+static AacIpcServer* g_server = nullptr;
+
+static void OnSignal(int) {
+  if (g_server) {
+    g_server->Stop();
+  }
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "AAC encoding/decoding service. Clients open sessions on a Unix socket "
+      "with AacIpcEncoder/AacIpcDecoder, PCM and AAC frames go through "
+      "shared memory");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+  args::ValueFlag<std::string> socket_path(parser, "socket",
+                                           "Unix socket to listen on",
+                                           {'s', "socket"}, "/tmp/aac.sock");
+  args::ValueFlag<int32_t> pool(parser, "pool",
+                                "Idle encoders/decoders kept for reuse",
+                                {"pool"}, 16);
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (pool.Get() < 0) {
+    std::cout << "Invalid pool, " << pool.Get() << std::endl;
+    return -1;
+  }
+
+  print_aac_lib_info();
+
+  AacIpcServer server;
+  if (server.Init(socket_path.Get().c_str(), pool.Get())) {
+    return -1;
+  }
+
+  g_server = &server;
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = OnSignal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("Listening on %s\n", socket_path.Get().c_str());
+  fflush(stdout);
+  server.Run();
+
+  AacIpcServerStats stats;
+  server.GetStats(&stats);
+  printf("Sessions %lld, reused codecs %lld\n",
+         static_cast<long long>(stats.sessions),
+         static_cast<long long>(stats.pool_hits));
+  server.Uninit();
+  g_server = nullptr;
+  return 0;
+}
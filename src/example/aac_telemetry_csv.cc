@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "aac_common.h"
+#include "aac_telemetry.h"
+#include "args.hxx"
+#include "example_common.h"
+
+static int32_t ConvertToCsv(const char* infile, const char* outfile) {
+  std::unique_ptr<FILE, decltype(&fclose)> out(nullptr, &fclose);
+  if (strcmp(outfile, "-") == 0) {
+    out.reset(TakeStdout());
+  } else {
+    out.reset(fopen(outfile, "w"));
+  }
+  if (out == nullptr) {
+    printf("Open output file failed, %s\n", outfile);
+    return -1;
+  }
+
+  auto reader = std::make_unique<AacTelemetryReader>();
+  AacTelemetryHeader header;
+  if (reader->Open(infile, &header)) {
+    return -1;
+  }
+  if (header.sample_rate <= 0 || header.frame_length <= 0) {
+    printf("Invalid telemetry header, %d Hz, %d samples/frame\n",
+           header.sample_rate, header.frame_length);
+    return -1;
+  }
+
+  fprintf(out.get(),
+          "frame,time_s,bytes,bitrate,target_bitrate,reservoir_bits,limit,vbr,"
+          "error\n");
+
+  int64_t records = 0;
+  int64_t frames = 0;
+  int64_t missing = 0;
+  int64_t limits = 0;
+  int64_t errors = 0;
+  int64_t total_bytes = 0;
+  int32_t peak_bitrate = 0;
+  int32_t min_reservoir = -1;
+  int64_t next_frame = 0;
+  AacFrameStats stats;
+  while (reader->Read(&stats) == 0) {
+    records += 1;
+    double time_s = static_cast<double>(stats.frame) * header.frame_length /
+                    header.sample_rate;
+    fprintf(out.get(), "%u,%.3f,%u,%d,%d,%d,%d,%d,%d\n", stats.frame,
+            time_s, stats.bytes, stats.bitrate, stats.target_bitrate,
+            stats.reservoir_bits,
+            (stats.flags & AAC_TELEMETRY_FLAG_LIMIT) ? 1 : 0,
+            (stats.flags & AAC_TELEMETRY_FLAG_VBR) ? 1 : 0,
+            (stats.flags & AAC_TELEMETRY_FLAG_ERROR) ? 1 : 0);
+
+    if (stats.flags & AAC_TELEMETRY_FLAG_LIMIT) {
+      limits += 1;
+    }
+    if (stats.flags & AAC_TELEMETRY_FLAG_ERROR) {
+      // Failed frames keep the index of the next frame
+      errors += 1;
+      continue;
+    }
+
+    // Indices start over after Reset() of the encoder
+    if (stats.frame > next_frame) {
+      missing += stats.frame - next_frame;
+    }
+    next_frame = static_cast<int64_t>(stats.frame) + 1;
+    frames += 1;
+    total_bytes += stats.bytes;
+    peak_bitrate = std::max(peak_bitrate, stats.bitrate);
+    if (stats.reservoir_bits >= 0 &&
+        (min_reservoir < 0 || stats.reservoir_bits < min_reservoir)) {
+      min_reservoir = stats.reservoir_bits;
+    }
+  }
+
+  const char* aot_name = get_aot_name(header.aot, 0);
+  if (header.bitrate_mode == 0) {
+    printf("%s, %d Hz, %d ch(s), CBR %d bps\n", aot_name, header.sample_rate,
+           header.channels, header.bitrate);
+  } else {
+    printf("%s, %d Hz, %d ch(s), VBR mode %d\n", aot_name, header.sample_rate,
+           header.channels, header.bitrate_mode);
+  }
+  double duration_s =
+      static_cast<double>(frames) * header.frame_length / header.sample_rate;
+  printf("Records: %lld, frames %lld, missing %lld, errors %lld\n",
+         static_cast<long long>(records), static_cast<long long>(frames),
+         static_cast<long long>(missing), static_cast<long long>(errors));
+  if (duration_s > 0) {
+    printf("Bitrate: average %.0f bps, peak frame %d bps\n",
+           total_bytes * 8 / duration_s, peak_bitrate);
+  }
+  printf("Output size limit hit: %lld frame(s)\n",
+         static_cast<long long>(limits));
+  if (min_reservoir >= 0) {
+    printf("Lowest reservoir: %d bits\n", min_reservoir);
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  args::ArgumentParser parser(
+      "Convert a telemetry log of aac_adts_enc/aac_m4a_enc --telemetry to CSV, "
+      "one row per frame, and print a summary");
+  parser.helpParams.progindent = 0;
+  parser.helpParams.addDefault = true;
+  parser.helpParams.addChoices = true;
+  parser.helpParams.useValueNameOnce = true;
+
+  args::Positional<std::string> log_file(parser, "Input", "Telemetry log",
+                                         args::Options::Required);
+  args::Positional<std::string> csv_file(
+      parser, "Output", "CSV file, - for stdout", args::Options::Required);
+  args::HelpFlag help(parser, "help", "Show usage and exit", {'h', "help"});
+
+  bool ret = parser.ParseCLI(argc, argv);
+  if (!ret) {
+    if (parser.GetError() != args::Error::None) {
+      std::cout << parser.GetErrorMsg() << std::endl << std::endl;
+    }
+    std::cout << parser.Help();
+    return -1;
+  } else if (help.Get()) {
+    std::cout << parser.Help();
+    return 0;
+  }
+
+  if (log_file.GetError() != args::Error::None) {
+    std::cout << log_file.GetErrorMsg() << std::endl;
+    return -1;
+  } else if (csv_file.GetError() != args::Error::None) {
+    std::cout << csv_file.GetErrorMsg() << std::endl;
+    return -1;
+  }
+
+  return ConvertToCsv(log_file.Get().c_str(), csv_file.Get().c_str()) ? -1
+                                                                       : 0;
+}
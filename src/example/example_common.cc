@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include "example_common.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+FILE* TakeStdout() {
+  fflush(stdout);
+  int32_t fd = dup(STDOUT_FILENO);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  FILE* file = fdopen(fd, "wb");
+  if (file == nullptr) {
+    close(fd);
+  }
+  return file;
+}
+
+int32_t LoadWav(const char* infile,
+                WavFileInfo* wav_file_info,
+                std::vector<uint8_t>* pcm) {
+  auto wav_reader = std::make_unique<WavReader>();
+  int32_t ret = wav_reader->Open(infile);
+  if (ret) {
+    printf("Open wav file failed, %s\n", infile);
+    return -1;
+  }
+
+  ret = wav_reader->GetInfo(wav_file_info);
+  if (ret) {
+    printf("Get info of wav file failed\n");
+    return -1;
+  }
+  if (wav_file_info->bits_per_sample != 16) {
+    printf("Only 16-bit PCM is supported, %s\n", infile);
+    return -1;
+  }
+
+  // Read in chunks, one read is limited to 2 GiB
+  const int32_t chunk_size = 1024 * 1024;
+  pcm->clear();
+  pcm->reserve(wav_file_info->data_length);
+  while (1) {
+    size_t offset = pcm->size();
+    pcm->resize(offset + chunk_size);
+    int32_t read_bytes = wav_reader->Read(pcm->data() + offset, chunk_size);
+    if (read_bytes < 0) {
+      printf("Read wav file failed\n");
+      return -1;
+    }
+    pcm->resize(offset + read_bytes);
+    if (read_bytes == 0) {
+      break;
+    }
+  }
+  return 0;
+}
+
+std::string GetExtension(const std::string& filename) {
+  size_t pos = filename.rfind('.');
+  if (pos == std::string::npos ||
+      filename.find('/', pos) != std::string::npos) {
+    return "";
+  }
+  std::string ext = filename.substr(pos + 1);
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](unsigned char c) { return tolower(c); });
+  return ext;
+}
+
+void ListFiles(const std::string& input,
+               const std::vector<std::string>& extensions,
+               std::vector<std::string>* files) {
+  DIR* dir = opendir(input.c_str());
+  if (dir == nullptr) {
+    files->push_back(input);
+    return;
+  }
+
+  std::vector<std::string> names;
+  struct dirent* entry = nullptr;
+  while ((entry = readdir(dir)) != nullptr) {
+    if (entry->d_name[0] == '.') {
+      // ".", ".." and hidden files
+      continue;
+    }
+    names.push_back(input + "/" + entry->d_name);
+  }
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+  for (const auto& name : names) {
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      ListFiles(name, extensions, files);
+    } else if (std::find(extensions.begin(), extensions.end(),
+                         GetExtension(name)) != extensions.end()) {
+      files->push_back(name);
+    }
+  }
+}
+
+void AppendJsonString(std::string* json, const std::string& value) {
+  json->push_back('"');
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      json->push_back('\\');
+      json->push_back(c);
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      json->append(buf);
+    } else {
+      json->push_back(c);
+    }
+  }
+  json->push_back('"');
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
@@ -0,0 +1,39 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#ifndef EXAMPLE_COMMON_H_
+#define EXAMPLE_COMMON_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "wav_reader.h"
+
+// Streams written to "-" take over the original stdout, and stdout itself is
+// pointed at stderr so diagnostics printed from anywhere do not corrupt them.
+FILE* TakeStdout();
+
+// The whole 16-bit PCM payload of a WAV file, for the tools that run over
+// the same input more than once.
+int32_t LoadWav(const char* infile,
+                WavFileInfo* wav_file_info,
+                std::vector<uint8_t>* pcm);
+
+// Lower case extension of |filename|, empty if it has none
+std::string GetExtension(const std::string& filename);
+
+// Directories are walked recursively in name order, keeping the files with
+// one of |extensions|. Anything else in |input| is taken as a file.
+void ListFiles(const std::string& input,
+               const std::vector<std::string>& extensions,
+               std::vector<std::string>* files);
+
+// Append |value| to |json| as a quoted and escaped JSON string
+void AppendJsonString(std::string* json, const std::string& value);
+
+// Monotonic clock
+int64_t NowUs();
+
+#endif  // EXAMPLE_COMMON_H_
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#include "perf_counters.h"
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct perf_counter_event {
+  uint32_t type;
+  uint64_t config;
+};
+
+static const perf_counter_event perf_counter_events[PERF_COUNTER_NUM] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+static int32_t perf_event_open(struct perf_event_attr* attr, int32_t group_fd) {
+  // No glibc wrapper, this thread on any CPU
+  return static_cast<int32_t>(
+      syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0));
+}
+
+PerfCounters::PerfCounters() : group_fd_(-1), num_open_(0) {
+  for (int32_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+    fds_[i] = -1;
+    index_[i] = -1;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+int32_t PerfCounters::Open() {
+  Close();
+
+  int32_t leader_errno = 0;
+  for (int32_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perf_counter_events[i].type;
+    attr.config = perf_counter_events[i].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Members follow the leader, which starts disabled
+    attr.disabled = group_fd_ < 0;
+
+    int32_t fd = perf_event_open(&attr, group_fd_);
+    if (fd < 0) {
+      if (group_fd_ < 0) {
+        leader_errno = errno;
+      }
+      continue;
+    }
+    if (group_fd_ < 0) {
+      group_fd_ = fd;
+    }
+    fds_[i] = fd;
+    index_[i] = num_open_++;
+  }
+
+  if (group_fd_ < 0) {
+    printf("Performance counters unavailable, %s\n", strerror(leader_errno));
+    return -1;
+  }
+  return 0;
+}
+
+void PerfCounters::Close() {
+  for (int32_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+    fds_[i] = -1;
+    index_[i] = -1;
+  }
+  group_fd_ = -1;
+  num_open_ = 0;
+}
+
+void PerfCounters::Reset() {
+  if (group_fd_ >= 0) {
+    ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::Start() {
+  if (group_fd_ >= 0) {
+    ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::Stop() {
+  if (group_fd_ >= 0) {
+    ioctl(group_fd_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+int32_t PerfCounters::Read(PerfCounterValues* values) {
+  for (int32_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+    values->values[i] = -1;
+  }
+  if (group_fd_ < 0) {
+    return -1;
+  }
+
+  // nr, time_enabled, time_running, value[nr]
+  uint64_t buf[3 + PERF_COUNTER_NUM];
+  ssize_t size = read(group_fd_, buf, sizeof(buf));
+  if (size < static_cast<ssize_t>((3 + num_open_) * sizeof(uint64_t))) {
+    return -1;
+  }
+
+  uint64_t enabled = buf[1];
+  uint64_t running = buf[2];
+  if (running == 0 && enabled > 0) {
+    // Never scheduled, e.g. the PMU is taken by another group
+    return -1;
+  }
+
+  double scale = running > 0 ? static_cast<double>(enabled) / running : 0;
+  for (int32_t i = 0; i < PERF_COUNTER_NUM; ++i) {
+    if (index_[i] >= 0) {
+      values->values[i] = static_cast<int64_t>(buf[3 + index_[i]] * scale);
+    }
+  }
+  return 0;
+}
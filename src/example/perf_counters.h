@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2022, Russell. All rights reserved.
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <stdint.h>
+
+#define PERF_COUNTER_CYCLES 0
+#define PERF_COUNTER_INSTRUCTIONS 1
+#define PERF_COUNTER_L1D_MISSES 2
+#define PERF_COUNTER_LLC_MISSES 3
+#define PERF_COUNTER_BRANCH_MISSES 4
+#define PERF_COUNTER_NUM 5
+
+struct PerfCounterValues {
+  int64_t values[PERF_COUNTER_NUM];  // -1 if not available
+};
+
+// Hardware counters of the calling thread, user space only, opened as one
+// perf_event group so a single ioctl starts or stops all of them. Counters
+// the CPU or kernel does not offer are left out; Open() fails when none is
+// usable, e.g. in a VM without PMU or with perf_event_paranoid > 2.
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  int32_t Open();
+  void Close();
+  // Counting is paused between Stop() and Start(), Reset() zeroes the values
+  void Reset();
+  void Start();
+  void Stop();
+  // Values are scaled up if the kernel had to multiplex the group
+  int32_t Read(PerfCounterValues* values);
+
+ private:
+  int32_t group_fd_;
+  int32_t fds_[PERF_COUNTER_NUM];
+  int32_t num_open_;
+  int32_t index_[PERF_COUNTER_NUM];  // position in the group read, or -1
+};
+
+#endif  // PERF_COUNTERS_H_